@@ -56,7 +56,9 @@
 #undef NEAR
 #undef FAR
 #else
+#if defined(__x86_64__) || defined(__i386__)
 #include <x86intrin.h>
+#endif
 
 #define __debugbreak() __builtin_trap()
 #endif
@@ -1414,6 +1416,7 @@ constexpr inline T lsClampWrap(T val, const T min, const T max)
 
 int64_t lsGetCurrentTimeMs();
 int64_t lsGetCurrentTimeNs();
+void lsSleepUntilNs(const int64_t timeNs); // relative to `lsGetCurrentTimeNs`. uses a high resolution timer & spins for the last bit.
 inline int64_t lsGetCurrentTicks() { return __rdtsc(); }
 uint64_t lsGetRand();
 
@@ -1431,6 +1434,31 @@ uint64_t lsGetRand(rand_seed &seed);
 
 //////////////////////////////////////////////////////////////////////////
 
+// Instruction sets supported by both the CPU and the OS, for kernels with an implementation per level. Every level includes the ones
+// below it. Kernels for higher levels than the build targets need `LS_TARGET_AVX2` or `LS_TARGET_AVX512`.
+enum lsCpuLevel
+{
+  lsCL_Scalar,
+  lsCL_SSE2,
+  lsCL_AVX2,
+  lsCL_AVX512, // F and BW.
+
+  lsCL_Count,
+};
+
+lsCpuLevel lsGetCpuLevel(); // detected on the first call.
+const char *lsCpuLevel_to_string(const lsCpuLevel level);
+
+#ifdef _MSC_VER
+#define LS_TARGET_AVX2
+#define LS_TARGET_AVX512
+#else
+#define LS_TARGET_AVX2 __attribute__((target("avx2")))
+#define LS_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+
 #include "sformat.h"
 #include "utf8_string.h"
 
@@ -1508,6 +1536,13 @@ bool lsStartsWithInt(_In_ const char *text, const size_t length);
 bool lsStartsWithUInt(_In_ const char *text);
 bool lsStartsWithUInt(_In_ const char *text, const size_t length);
 
+// Bulk parsing for large exports like CSV files or ASCII grids: values are separated by any run of whitespace, `,` or `;`. Converts
+// eight digits at a time and results are exact, unlike `lsParseFloat`. Fails with `lsR_InvalidParameter` on anything else than a
+// number between the separators and with `lsR_ArgumentOutOfBounds` if there are more than `capacity` values or an int doesn't fit.
+// `*pCount` is the number of values parsed, also if that fails. Floats may look like `-12`, `.5`, `1.25e-3`, `nan` or `inf`.
+lsResult lsParseInts(_In_ const char *text, const size_t length, _Out_ int32_t *pValues, const size_t capacity, _Out_ size_t *pCount);
+lsResult lsParseFloats(_In_ const char *text, const size_t length, _Out_ float_t *pValues, const size_t capacity, _Out_ size_t *pCount);
+
 int64_t lsParseInt(_In_ const wchar_t *start, _Out_ const wchar_t **pEnd = nullptr);
 uint64_t lsParseUInt(_In_ const wchar_t *start, _Out_ const wchar_t **pEnd = nullptr);
 double_t lsParseFloat(_In_ const wchar_t *start, _Out_ const wchar_t **pEnd = nullptr);
@@ -29,7 +29,7 @@ lsResult queue_reserve(queue<T> *pQueue, const size_t newCapacity)
     pQueue->pBack = pQueue->pStart + offsetEnd;
     pQueue->pLast = pQueue->pStart + pQueue->capacity;
 
-    if (offsetStart > 0 && offsetStart + pQueue->count > pQueue->capacity)
+    if (pQueue->count > 0 && offsetStart + pQueue->count >= pQueue->capacity) // wrapped, `pBack` may be at `pStart`.
     {
       const size_t wrappedCount = pQueue->count - (pQueue->capacity - offsetStart);
       memmove(pQueue->pLast, pQueue->pStart, wrappedCount * sizeof(T));
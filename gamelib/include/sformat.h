@@ -1167,6 +1167,15 @@ inline bool sformat_to(char *destination, const size_t capacity, Args && ...args
   return true;
 }
 
+// Bulk output for exports like CSV, JSON or ASCII grids: every value is followed by `separator`, regardless of `sformatState` and the
+// culture. Floats use the fewest digits that parse back to the same value (up to `sformat_BulkMaxFloatBytes`). Writes as many whole
+// values as fit into `capacity`, returns the number of bytes written and sets `*pValuesWritten` to the number of values.
+constexpr size_t sformat_BulkMaxInt32Bytes = sizeof("-2147483648") - 1;
+constexpr size_t sformat_BulkMaxFloatBytes = sizeof("-1.23456789e-38") - 1;
+
+size_t sformat_bulkTo(char *destination, const size_t capacity, const int32_t *pValues, const size_t count, const char separator, size_t *pValuesWritten);
+size_t sformat_bulkTo(char *destination, const size_t capacity, const float *pValues, const size_t count, const char separator, size_t *pValuesWritten);
+
 template <typename T>
 void _sformat_ApplyFormat(sformatState &fs)
 {
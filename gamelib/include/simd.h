@@ -0,0 +1,917 @@
+#pragma once
+
+#include "core.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Fixed width vectors of `uint16_t`, `int32_t` or `float` lanes for bulk data, so kernels can be written once for all targets. A vector
+// is a row of native registers: 256 bit wide with AVX2 if its size is a multiple of that, 128 bit with SSE2 or NEON, and plain arrays
+// of 16 bytes without either. The target is picked at compile time from the build flags, define `LS_SIMD_FORCE_SCALAR` to test the
+// fallback. Kernels compiled for a higher level than the build targets (see `lsCpuLevel`) still need intrinsics of their own.
+// Sizes have to be multiples of 16 bytes, so `uint16_t` comes with 8, 16 or 32 lanes and the others with 4, 8, 16 or 32.
+// Arithmetic on integers wraps around. Division, square roots and interleaved triples are only there for `float`, the upper halves of
+// products, bit shifts and conversions to `float` only for `int32_t`. Loads and stores don't need to be aligned.
+
+#if defined(LS_SIMD_FORCE_SCALAR)
+#define LS_SIMD_SCALAR 1
+#elif defined(__AVX2__)
+#define LS_SIMD_AVX2 1
+#define LS_SIMD_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LS_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define LS_SIMD_NEON 1
+#else
+#define LS_SIMD_SCALAR 1
+#endif
+
+#ifdef LS_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// Operations on a single native register of `Bits` holding lanes of `T`.
+template <typename T, size_t Bits>
+struct simd_native;
+
+#ifdef LS_SIMD_AVX2
+constexpr size_t simd_MaxNativeBits = 256;
+#else
+constexpr size_t simd_MaxNativeBits = 128;
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+
+#ifdef LS_SIMD_SCALAR
+
+// Bit patterns of masks, all ones for lanes that are set.
+template <typename T>
+using simd_bits = std::conditional_t<sizeof(T) == sizeof(uint16_t), uint16_t, uint32_t>;
+
+template <typename T>
+struct simd_native<T, 128>
+{
+  static constexpr size_t Lanes = 16 / sizeof(T);
+  struct block { T lanes[Lanes]; };
+
+  static inline simd_bits<T> bits(const T v) { simd_bits<T> b; memcpy(&b, &v, sizeof(b)); return b; }
+  static inline T fromBits(const simd_bits<T> b) { T v; memcpy(&v, &b, sizeof(v)); return v; }
+  static inline T mask(const bool set) { return fromBits(set ? (simd_bits<T>)~simd_bits<T>(0) : 0); }
+
+  static inline block load(const T *pSrc) { block r; memcpy(r.lanes, pSrc, sizeof(r.lanes)); return r; }
+  static inline void store(T *pDst, const block a) { memcpy(pDst, a.lanes, sizeof(a.lanes)); }
+  static inline block set1(const T v) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = v; return r; }
+
+  // Integers go through `uint32_t`, so overflow wraps.
+  template <typename Func>
+  static inline block apply(const block a, const block b, Func func)
+  {
+    block r;
+
+    for (size_t i = 0; i < Lanes; i++)
+    {
+      if constexpr (std::is_floating_point_v<T>)
+        r.lanes[i] = func(a.lanes[i], b.lanes[i]);
+      else
+        r.lanes[i] = (T)func((uint32_t)a.lanes[i], (uint32_t)b.lanes[i]);
+    }
+
+    return r;
+  }
+
+  static inline block add(const block a, const block b) { return apply(a, b, [](const auto x, const auto y) { return x + y; }); }
+  static inline block sub(const block a, const block b) { return apply(a, b, [](const auto x, const auto y) { return x - y; }); }
+  static inline block mul(const block a, const block b) { return apply(a, b, [](const auto x, const auto y) { return x * y; }); }
+
+  // Only for `float`.
+  static inline block div(const block a, const block b) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] / b.lanes[i]; return r; }
+  static inline block sqrt(const block a) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = sqrtf(a.lanes[i]); return r; }
+
+  // Only for `int32_t`, on the lanes as unsigned integers.
+  static inline block mulHi(const block a, const block b) { return apply(a, b, [](const auto x, const auto y) { return (uint32_t)(((uint64_t)x * y) >> 32); }); }
+  static inline block mulHiLo(const block a, const block b, _Out_ block *pHi) { *pHi = mulHi(a, b); return mul(a, b); }
+  template <uint32_t Count>
+  static inline block shiftBitsRight(const block a) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = (T)((uint32_t)a.lanes[i] >> Count); return r; }
+  template <typename F = float> // deferred, `simd_native<float, 128>` may be the one being declared.
+  static inline typename simd_native<F, 128>::block toFloat(const block a) { typename simd_native<F, 128>::block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = (F)a.lanes[i]; return r; }
+
+  // `Lanes` interleaved triples like `x0, y0, z0, x1, ...`.
+  static inline void load3(const T *pSrc, _Out_ block *pX, _Out_ block *pY, _Out_ block *pZ)
+  {
+    for (size_t i = 0; i < Lanes; i++)
+    {
+      pX->lanes[i] = pSrc[i * 3];
+      pY->lanes[i] = pSrc[i * 3 + 1];
+      pZ->lanes[i] = pSrc[i * 3 + 2];
+    }
+  }
+
+  static inline void store3(T *pDst, const block x, const block y, const block z)
+  {
+    for (size_t i = 0; i < Lanes; i++)
+    {
+      pDst[i * 3] = x.lanes[i];
+      pDst[i * 3 + 1] = y.lanes[i];
+      pDst[i * 3 + 2] = z.lanes[i];
+    }
+  }
+
+  static inline block min(const block a, const block b) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = b.lanes[i] < a.lanes[i] ? b.lanes[i] : a.lanes[i]; return r; }
+  static inline block max(const block a, const block b) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = a.lanes[i] < b.lanes[i] ? b.lanes[i] : a.lanes[i]; return r; }
+
+  static inline block equal(const block a, const block b) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = mask(a.lanes[i] == b.lanes[i]); return r; }
+  static inline block less(const block a, const block b) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = mask(a.lanes[i] < b.lanes[i]); return r; }
+  static inline block greater(const block a, const block b) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = mask(a.lanes[i] > b.lanes[i]); return r; }
+
+  static inline block bitAnd(const block a, const block b) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = fromBits(bits(a.lanes[i]) & bits(b.lanes[i])); return r; }
+  static inline block bitOr(const block a, const block b) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = fromBits(bits(a.lanes[i]) | bits(b.lanes[i])); return r; }
+  static inline block bitXor(const block a, const block b) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = fromBits(bits(a.lanes[i]) ^ bits(b.lanes[i])); return r; }
+  static inline block select(const block m, const block a, const block b) { block r; for (size_t i = 0; i < Lanes; i++) r.lanes[i] = bits(m.lanes[i]) ? a.lanes[i] : b.lanes[i]; return r; }
+  static inline uint32_t maskBits(const block m) { uint32_t r = 0; for (size_t i = 0; i < Lanes; i++) r |= (bits(m.lanes[i]) ? 1u : 0u) << i; return r; }
+
+  // Lanes `Count` to `Count + Lanes - 1` of `a` followed by `b`.
+  template <size_t Count>
+  static inline block shift(const block a, const block b)
+  {
+    block r;
+
+    for (size_t i = 0; i < Lanes; i++)
+      r.lanes[i] = i + Count < Lanes ? a.lanes[i + Count] : b.lanes[i + Count - Lanes];
+
+    return r;
+  }
+};
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+
+#ifdef LS_SIMD_SSE2
+
+// Whole register shift for SSE2, which lacks `_mm_alignr_epi8`.
+template <size_t Bytes>
+inline __m128i simd_alignr_internal(const __m128i a, const __m128i b)
+{
+  return _mm_or_si128(_mm_srli_si128(a, Bytes), _mm_slli_si128(b, 16 - Bytes));
+}
+
+template <>
+struct simd_native<uint16_t, 128>
+{
+  static constexpr size_t Lanes = 8;
+  using block = __m128i;
+
+  static inline block load(const uint16_t *pSrc) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(pSrc)); }
+  static inline void store(uint16_t *pDst, const block a) { _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst), a); }
+  static inline block set1(const uint16_t v) { return _mm_set1_epi16((int16_t)v); }
+
+  static inline block add(const block a, const block b) { return _mm_add_epi16(a, b); }
+  static inline block sub(const block a, const block b) { return _mm_sub_epi16(a, b); }
+  static inline block mul(const block a, const block b) { return _mm_mullo_epi16(a, b); }
+
+  // SSE2 only has signed 16 bit min and max, but saturated subtraction is unsigned.
+  static inline block min(const block a, const block b) { return _mm_sub_epi16(a, _mm_subs_epu16(a, b)); }
+  static inline block max(const block a, const block b) { return _mm_add_epi16(b, _mm_subs_epu16(a, b)); }
+
+  static inline block equal(const block a, const block b) { return _mm_cmpeq_epi16(a, b); }
+  static inline block less(const block a, const block b) { return greater(b, a); }
+
+  static inline block greater(const block a, const block b)
+  {
+    const __m128i sign = _mm_set1_epi16((int16_t)0x8000);
+    return _mm_cmpgt_epi16(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+  }
+
+  static inline block bitAnd(const block a, const block b) { return _mm_and_si128(a, b); }
+  static inline block bitOr(const block a, const block b) { return _mm_or_si128(a, b); }
+  static inline block bitXor(const block a, const block b) { return _mm_xor_si128(a, b); }
+  static inline block select(const block m, const block a, const block b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+
+  static inline uint32_t maskBits(const block m) { return (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(m, _mm_setzero_si128())); }
+
+  template <size_t Count>
+  static inline block shift(const block a, const block b) { return simd_alignr_internal<Count * sizeof(uint16_t)>(a, b); }
+};
+
+template <>
+struct simd_native<int32_t, 128>
+{
+  static constexpr size_t Lanes = 4;
+  using block = __m128i;
+
+  static inline block load(const int32_t *pSrc) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(pSrc)); }
+  static inline void store(int32_t *pDst, const block a) { _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst), a); }
+  static inline block set1(const int32_t v) { return _mm_set1_epi32(v); }
+
+  static inline block add(const block a, const block b) { return _mm_add_epi32(a, b); }
+  static inline block sub(const block a, const block b) { return _mm_sub_epi32(a, b); }
+
+  // `_mm_mullo_epi32` is SSE4.1, so multiply the even and odd lanes to 64 bit and keep the lower halves.
+  static inline block mul(const block a, const block b)
+  {
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+  }
+
+  // The same, keeping the upper halves. The odd products are already in place.
+  static inline block mulHi(const block a, const block b)
+  {
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_or_si128(_mm_srli_epi64(even, 32), _mm_and_si128(odd, _mm_set1_epi64x((int64_t)0xFFFFFFFF00000000)));
+  }
+
+  // Both halves from the same products.
+  static inline block mulHiLo(const block a, const block b, _Out_ block *pHi)
+  {
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    const __m128i upper = _mm_set1_epi64x((int64_t)0xFFFFFFFF00000000);
+
+    *pHi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_and_si128(odd, upper));
+    return _mm_or_si128(_mm_andnot_si128(upper, even), _mm_slli_epi64(odd, 32));
+  }
+
+  template <uint32_t Count>
+  static inline block shiftBitsRight(const block a) { return _mm_srli_epi32(a, Count); }
+  static inline __m128 toFloat(const block a) { return _mm_cvtepi32_ps(a); }
+
+  static inline block min(const block a, const block b) { return select(_mm_cmpgt_epi32(a, b), b, a); }
+  static inline block max(const block a, const block b) { return select(_mm_cmpgt_epi32(a, b), a, b); }
+
+  static inline block equal(const block a, const block b) { return _mm_cmpeq_epi32(a, b); }
+  static inline block less(const block a, const block b) { return _mm_cmplt_epi32(a, b); }
+  static inline block greater(const block a, const block b) { return _mm_cmpgt_epi32(a, b); }
+
+  static inline block bitAnd(const block a, const block b) { return _mm_and_si128(a, b); }
+  static inline block bitOr(const block a, const block b) { return _mm_or_si128(a, b); }
+  static inline block bitXor(const block a, const block b) { return _mm_xor_si128(a, b); }
+  static inline block select(const block m, const block a, const block b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+
+  static inline uint32_t maskBits(const block m) { return (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(m)); }
+
+  template <size_t Count>
+  static inline block shift(const block a, const block b) { return simd_alignr_internal<Count * sizeof(int32_t)>(a, b); }
+};
+
+template <>
+struct simd_native<float, 128>
+{
+  static constexpr size_t Lanes = 4;
+  using block = __m128;
+
+  static inline block load(const float *pSrc) { return _mm_loadu_ps(pSrc); }
+  static inline void store(float *pDst, const block a) { _mm_storeu_ps(pDst, a); }
+  static inline block set1(const float v) { return _mm_set1_ps(v); }
+
+  static inline block add(const block a, const block b) { return _mm_add_ps(a, b); }
+  static inline block sub(const block a, const block b) { return _mm_sub_ps(a, b); }
+  static inline block mul(const block a, const block b) { return _mm_mul_ps(a, b); }
+  static inline block div(const block a, const block b) { return _mm_div_ps(a, b); }
+  static inline block sqrt(const block a) { return _mm_sqrt_ps(a); }
+
+  // From `x0 y0 z0 x1`, `y1 z1 x2 y2`, `z2 x3 y3 z3`.
+  static inline void load3(const float *pSrc, _Out_ block *pX, _Out_ block *pY, _Out_ block *pZ)
+  {
+    const __m128 a = _mm_loadu_ps(pSrc);
+    const __m128 b = _mm_loadu_ps(pSrc + 4);
+    const __m128 c = _mm_loadu_ps(pSrc + 8);
+
+    *pX = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 1, 0, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+    *pY = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 0, 3, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+    *pZ = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0));
+  }
+
+  static inline void store3(float *pDst, const block x, const block y, const block z)
+  {
+    const __m128 xy0 = _mm_unpacklo_ps(x, y);
+    const __m128 xy2 = _mm_unpackhi_ps(x, y);
+
+    _mm_storeu_ps(pDst, _mm_shuffle_ps(xy0, _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(pDst + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), xy2, _MM_SHUFFLE(1, 0, 2, 0)));
+    _mm_storeu_ps(pDst + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+  }
+  static inline block min(const block a, const block b) { return _mm_min_ps(a, b); }
+  static inline block max(const block a, const block b) { return _mm_max_ps(a, b); }
+
+  static inline block equal(const block a, const block b) { return _mm_cmpeq_ps(a, b); }
+  static inline block less(const block a, const block b) { return _mm_cmplt_ps(a, b); }
+  static inline block greater(const block a, const block b) { return _mm_cmpgt_ps(a, b); }
+
+  static inline block bitAnd(const block a, const block b) { return _mm_and_ps(a, b); }
+  static inline block bitOr(const block a, const block b) { return _mm_or_ps(a, b); }
+  static inline block bitXor(const block a, const block b) { return _mm_xor_ps(a, b); }
+  static inline block select(const block m, const block a, const block b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+  static inline uint32_t maskBits(const block m) { return (uint32_t)_mm_movemask_ps(m); }
+
+  template <size_t Count>
+  static inline block shift(const block a, const block b) { return _mm_castsi128_ps(simd_alignr_internal<Count * sizeof(float)>(_mm_castps_si128(a), _mm_castps_si128(b))); }
+};
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+
+#ifdef LS_SIMD_AVX2
+
+// `_mm256_alignr_epi8` works within the 128 bit halves, so the middle half is put together first.
+template <size_t Bytes>
+inline __m256i simd_alignr256_internal(const __m256i a, const __m256i b)
+{
+  const __m256i middle = _mm256_permute2x128_si256(a, b, 0x21);
+
+  if constexpr (Bytes < 16)
+    return _mm256_alignr_epi8(middle, a, Bytes);
+  else if constexpr (Bytes == 16)
+    return middle;
+  else
+    return _mm256_alignr_epi8(b, middle, Bytes - 16);
+}
+
+template <>
+struct simd_native<uint16_t, 256>
+{
+  static constexpr size_t Lanes = 16;
+  using block = __m256i;
+
+  static inline block load(const uint16_t *pSrc) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSrc)); }
+  static inline void store(uint16_t *pDst, const block a) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(pDst), a); }
+  static inline block set1(const uint16_t v) { return _mm256_set1_epi16((int16_t)v); }
+
+  static inline block add(const block a, const block b) { return _mm256_add_epi16(a, b); }
+  static inline block sub(const block a, const block b) { return _mm256_sub_epi16(a, b); }
+  static inline block mul(const block a, const block b) { return _mm256_mullo_epi16(a, b); }
+  static inline block min(const block a, const block b) { return _mm256_min_epu16(a, b); }
+  static inline block max(const block a, const block b) { return _mm256_max_epu16(a, b); }
+
+  static inline block equal(const block a, const block b) { return _mm256_cmpeq_epi16(a, b); }
+  static inline block less(const block a, const block b) { return greater(b, a); }
+
+  static inline block greater(const block a, const block b)
+  {
+    const __m256i sign = _mm256_set1_epi16((int16_t)0x8000);
+    return _mm256_cmpgt_epi16(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+  }
+
+  static inline block bitAnd(const block a, const block b) { return _mm256_and_si256(a, b); }
+  static inline block bitOr(const block a, const block b) { return _mm256_or_si256(a, b); }
+  static inline block bitXor(const block a, const block b) { return _mm256_xor_si256(a, b); }
+  static inline block select(const block m, const block a, const block b) { return _mm256_blendv_epi8(b, a, m); }
+
+  // Packing works within the 128 bit halves as well, so the bytes end up in the lower quarter of each half.
+  static inline uint32_t maskBits(const block m)
+  {
+    const uint32_t bytes = (uint32_t)_mm256_movemask_epi8(_mm256_packs_epi16(m, _mm256_setzero_si256()));
+    return (bytes & 0xFF) | ((bytes >> 8) & 0xFF00);
+  }
+
+  template <size_t Count>
+  static inline block shift(const block a, const block b) { return simd_alignr256_internal<Count * sizeof(uint16_t)>(a, b); }
+};
+
+template <>
+struct simd_native<int32_t, 256>
+{
+  static constexpr size_t Lanes = 8;
+  using block = __m256i;
+
+  static inline block load(const int32_t *pSrc) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSrc)); }
+  static inline void store(int32_t *pDst, const block a) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(pDst), a); }
+  static inline block set1(const int32_t v) { return _mm256_set1_epi32(v); }
+
+  static inline block add(const block a, const block b) { return _mm256_add_epi32(a, b); }
+  static inline block sub(const block a, const block b) { return _mm256_sub_epi32(a, b); }
+  static inline block mul(const block a, const block b) { return _mm256_mullo_epi32(a, b); }
+
+  static inline block mulHi(const block a, const block b)
+  {
+    const __m256i even = _mm256_mul_epu32(a, b);
+    const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+  }
+
+  // Cheaper than `_mm256_mullo_epi32` on top of `mulHi`.
+  static inline block mulHiLo(const block a, const block b, _Out_ block *pHi)
+  {
+    const __m256i even = _mm256_mul_epu32(a, b);
+    const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+
+    *pHi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+    return _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+  }
+
+  template <uint32_t Count>
+  static inline block shiftBitsRight(const block a) { return _mm256_srli_epi32(a, Count); }
+  static inline __m256 toFloat(const block a) { return _mm256_cvtepi32_ps(a); }
+
+  static inline block min(const block a, const block b) { return _mm256_min_epi32(a, b); }
+  static inline block max(const block a, const block b) { return _mm256_max_epi32(a, b); }
+
+  static inline block equal(const block a, const block b) { return _mm256_cmpeq_epi32(a, b); }
+  static inline block less(const block a, const block b) { return _mm256_cmpgt_epi32(b, a); }
+  static inline block greater(const block a, const block b) { return _mm256_cmpgt_epi32(a, b); }
+
+  static inline block bitAnd(const block a, const block b) { return _mm256_and_si256(a, b); }
+  static inline block bitOr(const block a, const block b) { return _mm256_or_si256(a, b); }
+  static inline block bitXor(const block a, const block b) { return _mm256_xor_si256(a, b); }
+  static inline block select(const block m, const block a, const block b) { return _mm256_blendv_epi8(b, a, m); }
+
+  static inline uint32_t maskBits(const block m) { return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(m)); }
+
+  template <size_t Count>
+  static inline block shift(const block a, const block b) { return simd_alignr256_internal<Count * sizeof(int32_t)>(a, b); }
+};
+
+template <>
+struct simd_native<float, 256>
+{
+  static constexpr size_t Lanes = 8;
+  using block = __m256;
+
+  static inline block load(const float *pSrc) { return _mm256_loadu_ps(pSrc); }
+  static inline void store(float *pDst, const block a) { _mm256_storeu_ps(pDst, a); }
+  static inline block set1(const float v) { return _mm256_set1_ps(v); }
+
+  static inline block add(const block a, const block b) { return _mm256_add_ps(a, b); }
+  static inline block sub(const block a, const block b) { return _mm256_sub_ps(a, b); }
+  static inline block mul(const block a, const block b) { return _mm256_mul_ps(a, b); }
+  static inline block div(const block a, const block b) { return _mm256_div_ps(a, b); }
+  static inline block sqrt(const block a) { return _mm256_sqrt_ps(a); }
+
+  // As two halves of `simd_native<float, 128>`.
+  static inline void load3(const float *pSrc, _Out_ block *pX, _Out_ block *pY, _Out_ block *pZ)
+  {
+    __m128 lo[3], hi[3];
+    simd_native<float, 128>::load3(pSrc, &lo[0], &lo[1], &lo[2]);
+    simd_native<float, 128>::load3(pSrc + 12, &hi[0], &hi[1], &hi[2]);
+
+    *pX = _mm256_insertf128_ps(_mm256_castps128_ps256(lo[0]), hi[0], 1);
+    *pY = _mm256_insertf128_ps(_mm256_castps128_ps256(lo[1]), hi[1], 1);
+    *pZ = _mm256_insertf128_ps(_mm256_castps128_ps256(lo[2]), hi[2], 1);
+  }
+
+  static inline void store3(float *pDst, const block x, const block y, const block z)
+  {
+    simd_native<float, 128>::store3(pDst, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z));
+    simd_native<float, 128>::store3(pDst + 12, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1));
+  }
+  static inline block min(const block a, const block b) { return _mm256_min_ps(a, b); }
+  static inline block max(const block a, const block b) { return _mm256_max_ps(a, b); }
+
+  static inline block equal(const block a, const block b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  static inline block less(const block a, const block b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static inline block greater(const block a, const block b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+  static inline block bitAnd(const block a, const block b) { return _mm256_and_ps(a, b); }
+  static inline block bitOr(const block a, const block b) { return _mm256_or_ps(a, b); }
+  static inline block bitXor(const block a, const block b) { return _mm256_xor_ps(a, b); }
+  static inline block select(const block m, const block a, const block b) { return _mm256_blendv_ps(b, a, m); }
+
+  static inline uint32_t maskBits(const block m) { return (uint32_t)_mm256_movemask_ps(m); }
+
+  template <size_t Count>
+  static inline block shift(const block a, const block b) { return _mm256_castsi256_ps(simd_alignr256_internal<Count * sizeof(float)>(_mm256_castps_si256(a), _mm256_castps_si256(b))); }
+};
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+
+#ifdef LS_SIMD_NEON
+
+template <>
+struct simd_native<uint16_t, 128>
+{
+  static constexpr size_t Lanes = 8;
+  using block = uint16x8_t;
+
+  static inline block load(const uint16_t *pSrc) { return vld1q_u16(pSrc); }
+  static inline void store(uint16_t *pDst, const block a) { vst1q_u16(pDst, a); }
+  static inline block set1(const uint16_t v) { return vdupq_n_u16(v); }
+
+  static inline block add(const block a, const block b) { return vaddq_u16(a, b); }
+  static inline block sub(const block a, const block b) { return vsubq_u16(a, b); }
+  static inline block mul(const block a, const block b) { return vmulq_u16(a, b); }
+  static inline block min(const block a, const block b) { return vminq_u16(a, b); }
+  static inline block max(const block a, const block b) { return vmaxq_u16(a, b); }
+
+  static inline block equal(const block a, const block b) { return vceqq_u16(a, b); }
+  static inline block less(const block a, const block b) { return vcltq_u16(a, b); }
+  static inline block greater(const block a, const block b) { return vcgtq_u16(a, b); }
+
+  static inline block bitAnd(const block a, const block b) { return vandq_u16(a, b); }
+  static inline block bitOr(const block a, const block b) { return vorrq_u16(a, b); }
+  static inline block bitXor(const block a, const block b) { return veorq_u16(a, b); }
+  static inline block select(const block m, const block a, const block b) { return vbslq_u16(m, a, b); }
+
+  // NEON has no movemask, so each lane keeps its own bit and they're added up.
+  static inline uint32_t maskBits(const block m)
+  {
+    const int16_t shifts[Lanes] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    return vaddvq_u16(vshlq_u16(vshrq_n_u16(m, 15), vld1q_s16(shifts)));
+  }
+
+  template <size_t Count>
+  static inline block shift(const block a, const block b) { return vextq_u16(a, b, Count); }
+};
+
+template <>
+struct simd_native<int32_t, 128>
+{
+  static constexpr size_t Lanes = 4;
+  using block = int32x4_t;
+
+  static inline block load(const int32_t *pSrc) { return vld1q_s32(pSrc); }
+  static inline void store(int32_t *pDst, const block a) { vst1q_s32(pDst, a); }
+  static inline block set1(const int32_t v) { return vdupq_n_s32(v); }
+
+  static inline block add(const block a, const block b) { return vaddq_s32(a, b); }
+  static inline block sub(const block a, const block b) { return vsubq_s32(a, b); }
+  static inline block mul(const block a, const block b) { return vmulq_s32(a, b); }
+
+  static inline block mulHi(const block a, const block b)
+  {
+    const uint32x4_t ua = vreinterpretq_u32_s32(a);
+    const uint32x4_t ub = vreinterpretq_u32_s32(b);
+    return vreinterpretq_s32_u32(vcombine_u32(vshrn_n_u64(vmull_u32(vget_low_u32(ua), vget_low_u32(ub)), 32), vshrn_n_u64(vmull_high_u32(ua, ub), 32)));
+  }
+
+  static inline block mulHiLo(const block a, const block b, _Out_ block *pHi) { *pHi = mulHi(a, b); return mul(a, b); }
+
+  template <uint32_t Count>
+  static inline block shiftBitsRight(const block a) { return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a), Count)); }
+  static inline float32x4_t toFloat(const block a) { return vcvtq_f32_s32(a); }
+
+  static inline block min(const block a, const block b) { return vminq_s32(a, b); }
+  static inline block max(const block a, const block b) { return vmaxq_s32(a, b); }
+
+  static inline block equal(const block a, const block b) { return vreinterpretq_s32_u32(vceqq_s32(a, b)); }
+  static inline block less(const block a, const block b) { return vreinterpretq_s32_u32(vcltq_s32(a, b)); }
+  static inline block greater(const block a, const block b) { return vreinterpretq_s32_u32(vcgtq_s32(a, b)); }
+
+  static inline block bitAnd(const block a, const block b) { return vandq_s32(a, b); }
+  static inline block bitOr(const block a, const block b) { return vorrq_s32(a, b); }
+  static inline block bitXor(const block a, const block b) { return veorq_s32(a, b); }
+  static inline block select(const block m, const block a, const block b) { return vbslq_s32(vreinterpretq_u32_s32(m), a, b); }
+
+  static inline uint32_t maskBits(const block m)
+  {
+    const int32_t shifts[Lanes] = { 0, 1, 2, 3 };
+    return vaddvq_u32(vshlq_u32(vshrq_n_u32(vreinterpretq_u32_s32(m), 31), vld1q_s32(shifts)));
+  }
+
+  template <size_t Count>
+  static inline block shift(const block a, const block b) { return vextq_s32(a, b, Count); }
+};
+
+template <>
+struct simd_native<float, 128>
+{
+  static constexpr size_t Lanes = 4;
+  using block = float32x4_t;
+
+  static inline block load(const float *pSrc) { return vld1q_f32(pSrc); }
+  static inline void store(float *pDst, const block a) { vst1q_f32(pDst, a); }
+  static inline block set1(const float v) { return vdupq_n_f32(v); }
+
+  static inline block add(const block a, const block b) { return vaddq_f32(a, b); }
+  static inline block sub(const block a, const block b) { return vsubq_f32(a, b); }
+  static inline block mul(const block a, const block b) { return vmulq_f32(a, b); }
+  static inline block div(const block a, const block b) { return vdivq_f32(a, b); }
+  static inline block sqrt(const block a) { return vsqrtq_f32(a); }
+
+  static inline void load3(const float *pSrc, _Out_ block *pX, _Out_ block *pY, _Out_ block *pZ)
+  {
+    const float32x4x3_t v = vld3q_f32(pSrc);
+    *pX = v.val[0];
+    *pY = v.val[1];
+    *pZ = v.val[2];
+  }
+
+  static inline void store3(float *pDst, const block x, const block y, const block z)
+  {
+    float32x4x3_t v;
+    v.val[0] = x;
+    v.val[1] = y;
+    v.val[2] = z;
+    vst3q_f32(pDst, v);
+  }
+  static inline block min(const block a, const block b) { return vminq_f32(a, b); }
+  static inline block max(const block a, const block b) { return vmaxq_f32(a, b); }
+
+  static inline block equal(const block a, const block b) { return vreinterpretq_f32_u32(vceqq_f32(a, b)); }
+  static inline block less(const block a, const block b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+  static inline block greater(const block a, const block b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+
+  static inline block bitAnd(const block a, const block b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+  static inline block bitOr(const block a, const block b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+  static inline block bitXor(const block a, const block b) { return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+  static inline block select(const block m, const block a, const block b) { return vbslq_f32(vreinterpretq_u32_f32(m), a, b); }
+
+  static inline uint32_t maskBits(const block m)
+  {
+    const int32_t shifts[Lanes] = { 0, 1, 2, 3 };
+    return vaddvq_u32(vshlq_u32(vshrq_n_u32(vreinterpretq_u32_f32(m), 31), vld1q_s32(shifts)));
+  }
+
+  template <size_t Count>
+  static inline block shift(const block a, const block b) { return vextq_f32(a, b, Count); }
+};
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+
+template <typename T, size_t N>
+struct simd
+{
+  static_assert(std::is_same_v<T, uint16_t> || std::is_same_v<T, int32_t> || std::is_same_v<T, float>, "Unsupported lane type.");
+  static_assert((N * sizeof(T)) % 16 == 0, "Vectors have to be a multiple of 16 bytes.");
+
+  static constexpr size_t Bits = (N * sizeof(T) * 8) % simd_MaxNativeBits == 0 ? simd_MaxNativeBits : 128;
+  using native = simd_native<T, Bits>;
+  static constexpr size_t BlockCount = N / native::Lanes;
+
+  typename native::block blocks[BlockCount];
+};
+
+// All bits of a lane are set where the comparison held.
+template <typename T, size_t N>
+struct simd_mask
+{
+  typename simd<T, N>::native::block blocks[simd<T, N>::BlockCount];
+};
+
+using simd_u16x8 = simd<uint16_t, 8>;
+using simd_u16x16 = simd<uint16_t, 16>;
+using simd_u16x32 = simd<uint16_t, 32>;
+using simd_i32x4 = simd<int32_t, 4>;
+using simd_i32x8 = simd<int32_t, 8>;
+using simd_i32x16 = simd<int32_t, 16>;
+using simd_i32x32 = simd<int32_t, 32>;
+using simd_f32x4 = simd<float, 4>;
+using simd_f32x8 = simd<float, 8>;
+using simd_f32x16 = simd<float, 16>;
+using simd_f32x32 = simd<float, 32>;
+
+//////////////////////////////////////////////////////////////////////////
+
+template <size_t N, typename T>
+inline simd<T, N> simd_load(const T *pSrc)
+{
+  using native = typename simd<T, N>::native;
+  simd<T, N> r;
+
+  for (size_t i = 0; i < simd<T, N>::BlockCount; i++)
+    r.blocks[i] = native::load(pSrc + i * native::Lanes);
+
+  return r;
+}
+
+template <typename T, size_t N>
+inline void simd_store(T *pDst, const simd<T, N> &a)
+{
+  using native = typename simd<T, N>::native;
+
+  for (size_t i = 0; i < simd<T, N>::BlockCount; i++)
+    native::store(pDst + i * native::Lanes, a.blocks[i]);
+}
+
+// All lanes set to `value`.
+template <size_t N, typename T>
+inline simd<T, N> simd_set(const T value)
+{
+  using native = typename simd<T, N>::native;
+  const typename native::block block = native::set1(value);
+  simd<T, N> r;
+
+  for (size_t i = 0; i < simd<T, N>::BlockCount; i++)
+    r.blocks[i] = block;
+
+  return r;
+}
+
+#define SIMD_DEFINE_BINARY_INTERNAL(Result, name, op) \
+  template <typename T, size_t N> \
+  inline Result<T, N> name(const simd<T, N> &a, const simd<T, N> &b) \
+  { \
+    Result<T, N> r; \
+    for (size_t i = 0; i < simd<T, N>::BlockCount; i++) \
+      r.blocks[i] = simd<T, N>::native::op(a.blocks[i], b.blocks[i]); \
+    return r; \
+  }
+
+SIMD_DEFINE_BINARY_INTERNAL(simd, operator +, add)
+SIMD_DEFINE_BINARY_INTERNAL(simd, operator -, sub)
+SIMD_DEFINE_BINARY_INTERNAL(simd, operator *, mul)
+SIMD_DEFINE_BINARY_INTERNAL(simd, operator /, div)
+SIMD_DEFINE_BINARY_INTERNAL(simd, operator ^, bitXor)
+SIMD_DEFINE_BINARY_INTERNAL(simd, simd_mulHi, mulHi)
+SIMD_DEFINE_BINARY_INTERNAL(simd, simd_min, min)
+SIMD_DEFINE_BINARY_INTERNAL(simd, simd_max, max)
+SIMD_DEFINE_BINARY_INTERNAL(simd_mask, simd_equal, equal)
+SIMD_DEFINE_BINARY_INTERNAL(simd_mask, simd_less, less)
+SIMD_DEFINE_BINARY_INTERNAL(simd_mask, simd_greater, greater)
+
+#undef SIMD_DEFINE_BINARY_INTERNAL
+
+template <typename T, size_t N> inline simd<T, N> &operator +=(simd<T, N> &a, const simd<T, N> &b) { return a = a + b; }
+template <typename T, size_t N> inline simd<T, N> &operator -=(simd<T, N> &a, const simd<T, N> &b) { return a = a - b; }
+template <typename T, size_t N> inline simd<T, N> &operator *=(simd<T, N> &a, const simd<T, N> &b) { return a = a * b; }
+template <typename T, size_t N> inline simd<T, N> &operator /=(simd<T, N> &a, const simd<T, N> &b) { return a = a / b; }
+
+template <typename T, size_t N>
+inline simd_mask<T, N> operator &(const simd_mask<T, N> &a, const simd_mask<T, N> &b)
+{
+  simd_mask<T, N> r;
+
+  for (size_t i = 0; i < simd<T, N>::BlockCount; i++)
+    r.blocks[i] = simd<T, N>::native::bitAnd(a.blocks[i], b.blocks[i]);
+
+  return r;
+}
+
+template <typename T, size_t N>
+inline simd_mask<T, N> operator |(const simd_mask<T, N> &a, const simd_mask<T, N> &b)
+{
+  simd_mask<T, N> r;
+
+  for (size_t i = 0; i < simd<T, N>::BlockCount; i++)
+    r.blocks[i] = simd<T, N>::native::bitOr(a.blocks[i], b.blocks[i]);
+
+  return r;
+}
+
+template <size_t N>
+inline simd<float, N> simd_sqrt(const simd<float, N> &a)
+{
+  simd<float, N> r;
+
+  for (size_t i = 0; i < simd<float, N>::BlockCount; i++)
+    r.blocks[i] = simd<float, N>::native::sqrt(a.blocks[i]);
+
+  return r;
+}
+
+// The lower halves of the products, with the upper ones in `pHi`, for `int32_t` lanes as unsigned integers.
+template <size_t N>
+inline simd<int32_t, N> simd_mulHiLo(const simd<int32_t, N> &a, const simd<int32_t, N> &b, _Out_ simd<int32_t, N> *pHi)
+{
+  simd<int32_t, N> r;
+
+  for (size_t i = 0; i < simd<int32_t, N>::BlockCount; i++)
+    r.blocks[i] = simd<int32_t, N>::native::mulHiLo(a.blocks[i], b.blocks[i], &pHi->blocks[i]);
+
+  return r;
+}
+
+// Shifts the bits of each lane right by `Count`, filling in zeroes.
+template <uint32_t Count, size_t N>
+inline simd<int32_t, N> simd_shiftBitsRight(const simd<int32_t, N> &a)
+{
+  static_assert(Count > 0 && Count < 32, "Invalid shift.");
+
+  simd<int32_t, N> r;
+
+  for (size_t i = 0; i < simd<int32_t, N>::BlockCount; i++)
+    r.blocks[i] = simd<int32_t, N>::native::template shiftBitsRight<Count>(a.blocks[i]);
+
+  return r;
+}
+
+template <size_t N>
+inline simd<float, N> simd_toFloat(const simd<int32_t, N> &a)
+{
+  static_assert(simd<int32_t, N>::Bits == simd<float, N>::Bits, "Lanes don't line up.");
+
+  simd<float, N> r;
+
+  for (size_t i = 0; i < simd<int32_t, N>::BlockCount; i++)
+    r.blocks[i] = simd<int32_t, N>::native::toFloat(a.blocks[i]);
+
+  return r;
+}
+
+// Splits `N` interleaved triples like `x0, y0, z0, x1, ...` into their components, for arrays of `vec3f`.
+template <size_t N>
+inline void simd_loadInterleaved3(const float *pSrc, _Out_ simd<float, N> *pX, _Out_ simd<float, N> *pY, _Out_ simd<float, N> *pZ)
+{
+  using native = typename simd<float, N>::native;
+
+  for (size_t i = 0; i < simd<float, N>::BlockCount; i++)
+    native::load3(pSrc + i * native::Lanes * 3, &pX->blocks[i], &pY->blocks[i], &pZ->blocks[i]);
+}
+
+template <size_t N>
+inline void simd_storeInterleaved3(float *pDst, const simd<float, N> &x, const simd<float, N> &y, const simd<float, N> &z)
+{
+  using native = typename simd<float, N>::native;
+
+  for (size_t i = 0; i < simd<float, N>::BlockCount; i++)
+    native::store3(pDst + i * native::Lanes * 3, x.blocks[i], y.blocks[i], z.blocks[i]);
+}
+
+// Bit `i` is set if lane `i` of `mask` is.
+template <typename T, size_t N>
+inline uint32_t simd_getMaskBits(const simd_mask<T, N> &mask)
+{
+  using native = typename simd<T, N>::native;
+  uint32_t bits = 0;
+
+  for (size_t i = 0; i < simd<T, N>::BlockCount; i++)
+    bits |= native::maskBits(mask.blocks[i]) << (i * native::Lanes);
+
+  return bits;
+}
+
+// `a` where `mask` is set, `b` elsewhere.
+template <typename T, size_t N>
+inline simd<T, N> simd_select(const simd_mask<T, N> &mask, const simd<T, N> &a, const simd<T, N> &b)
+{
+  simd<T, N> r;
+
+  for (size_t i = 0; i < simd<T, N>::BlockCount; i++)
+    r.blocks[i] = simd<T, N>::native::select(mask.blocks[i], a.blocks[i], b.blocks[i]);
+
+  return r;
+}
+
+// Lanes `Count` to `Count + N - 1` of `a` followed by `b`, for neighbours across the border of two vectors loaded one after the other:
+// `simd_shift<1>(current, next)` holds the right neighbour of each lane, `simd_shift<N - 1>(previous, current)` the left one.
+template <size_t Count, typename T, size_t N>
+inline simd<T, N> simd_shift(const simd<T, N> &a, const simd<T, N> &b)
+{
+  static_assert(Count <= N, "Can't shift by more than a whole vector.");
+
+  using native = typename simd<T, N>::native;
+  constexpr size_t BlockCount = simd<T, N>::BlockCount;
+  constexpr size_t BlockOffset = Count / native::Lanes;
+  constexpr size_t LaneOffset = Count % native::Lanes;
+
+  simd<T, N> r;
+
+  for (size_t i = 0; i < BlockCount; i++)
+  {
+    const size_t first = i + BlockOffset;
+    const typename native::block &lo = first < BlockCount ? a.blocks[first] : b.blocks[first - BlockCount];
+
+    if constexpr (LaneOffset == 0)
+    {
+      r.blocks[i] = lo;
+    }
+    else
+    {
+      const typename native::block &hi = first + 1 < BlockCount ? a.blocks[first + 1] : b.blocks[first + 1 - BlockCount];
+      r.blocks[i] = native::template shift<LaneOffset>(lo, hi);
+    }
+  }
+
+  return r;
+}
+
+// Combines the lanes of `block` in halves, so the first lane ends up with the result of all of them.
+template <size_t Lanes, typename Native, typename Func>
+inline typename Native::block simd_fold_internal(const typename Native::block block, Func func)
+{
+  if constexpr (Lanes == 1)
+    return block;
+  else
+    return simd_fold_internal<Lanes / 2, Native>(func(block, Native::template shift<Lanes / 2>(block, block)), func);
+}
+
+// Reductions combine the native registers lane by lane before the lanes of the last one are combined, so they're meant for the end of
+// a loop rather than its body. The sum of `uint16_t` lanes wraps around.
+template <typename T, size_t N, typename Func>
+inline T simd_reduce_internal(const simd<T, N> &a, Func func)
+{
+  using native = typename simd<T, N>::native;
+
+  typename native::block block = a.blocks[0];
+
+  for (size_t i = 1; i < simd<T, N>::BlockCount; i++)
+    block = func(block, a.blocks[i]);
+
+  T lanes[native::Lanes];
+  native::store(lanes, simd_fold_internal<native::Lanes, native>(block, func));
+
+  return lanes[0];
+}
+
+template <typename T, size_t N>
+inline T simd_reduceSum(const simd<T, N> &a)
+{
+  return simd_reduce_internal(a, simd<T, N>::native::add);
+}
+
+template <typename T, size_t N>
+inline T simd_reduceMin(const simd<T, N> &a)
+{
+  return simd_reduce_internal(a, simd<T, N>::native::min);
+}
+
+template <typename T, size_t N>
+inline T simd_reduceMax(const simd<T, N> &a)
+{
+  return simd_reduce_internal(a, simd<T, N>::native::max);
+}
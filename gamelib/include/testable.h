@@ -6,7 +6,9 @@ struct _testable_init { size_t instanceId; };
 
 typedef lsResult(*testable_func)();
 _testable_init register_testable(const char *name, testable_func func);
+_testable_init register_benchmark(const char *name, testable_func func);
 lsResult run_testables();
+lsResult run_benchmarks();
 
 #define DEFINE_TESTABLE(name) \
   lsResult test_ ## name(); \
@@ -18,6 +20,17 @@ lsResult run_testables();
   extern "C" auto __test__ ## name ## __ref = test_ ## name ## obj(); \
   lsResult test_ ## name()
 
+// Benchmarks print timings rather than checking results, so they only run with `run_benchmarks`, not with the tests.
+#define DEFINE_BENCHMARK(name) \
+  lsResult benchmark_ ## name(); \
+  struct benchmark_ ## name ## obj \
+  { const _testable_init &__benchmark_init_; \
+    inline benchmark_ ## name ## obj() : __benchmark_init_(register_benchmark(#name, & benchmark_ ## name)) { } \
+  }; \
+  __pragma(comment(linker, "/include:__benchmark__" #name "__ref")) \
+  extern "C" auto __benchmark__ ## name ## __ref = benchmark_ ## name ## obj(); \
+  lsResult benchmark_ ## name()
+
 template <size_t n>
 void register_testable_files();
 
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "core.h"
+
+#include <atomic>
+
+//////////////////////////////////////////////////////////////////////////
+
+typedef void (thread_pool_task_func)(void *pUserData, const size_t index);
+
+struct thread_pool;
+
+// Tracks a set of tasks that can be waited for together.
+struct thread_pool_group
+{
+  std::atomic<size_t> pending = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// `threadCount` of 0 creates one worker per hardware thread, minus the calling thread.
+lsResult threadPool_create(_Out_ thread_pool **ppPool, const size_t threadCount = 0);
+void threadPool_destroy(thread_pool **ppPool);
+
+// Shared pool, created on first use.
+thread_pool *threadPool_getDefault();
+
+size_t threadPool_getWorkerCount(const thread_pool *pPool);
+
+// Queues `pFunc(pUserData, index)` to run on a worker.
+lsResult threadPool_run(thread_pool *pPool, thread_pool_task_func *pFunc, void *pUserData, thread_pool_group *pGroup, const size_t index = 0);
+
+// Executes queued tasks on the calling thread until all tasks of `pGroup` have completed, so it's safe to wait from within a task.
+void threadPool_wait(thread_pool *pPool, thread_pool_group *pGroup);
+
+// Calls `pFunc(pUserData, i)` for every `i` in [0, count) on the workers & the calling thread. Returns once all calls have completed.
+void threadPool_parallelFor(thread_pool *pPool, const size_t count, thread_pool_task_func *pFunc, void *pUserData);
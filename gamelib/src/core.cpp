@@ -1,9 +1,16 @@
 #include "core.h"
+#include "simd.h"
 
 #ifdef LS_PLATFORM_WINDOWS
 #include <winnt.h>
 #include <fcntl.h>
 #include <corecrt_io.h>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <thread>
 #endif
 
 //////////////////////////////////////////////////////////////////////////
@@ -84,6 +91,36 @@ int64_t lsGetCurrentTimeNs()
   return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
 }
 
+void lsSleepUntilNs(const int64_t timeNs)
+{
+  constexpr int64_t spinNs = 500 * 1000; // os timers tend to overshoot by about that much.
+
+  const int64_t remainingNs = timeNs - lsGetCurrentTimeNs();
+
+  if (remainingNs <= 0)
+    return;
+
+  if (remainingNs > spinNs)
+  {
+#ifdef LS_PLATFORM_WINDOWS
+    thread_local HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = -(remainingNs - spinNs) / 100; // relative, in 100ns intervals.
+
+    if (timer != nullptr && SetWaitableTimer(timer, &dueTime, 0, nullptr, nullptr, FALSE))
+      WaitForSingleObject(timer, INFINITE);
+    else
+      Sleep((DWORD)((remainingNs - spinNs) / 1000000));
+#else
+    std::this_thread::sleep_for(std::chrono::nanoseconds(remainingNs - spinNs));
+#endif
+  }
+
+  while (lsGetCurrentTimeNs() < timeNs)
+    _mm_pause();
+}
+
 uint64_t lsGetRand()
 {
   __declspec(align(16)) static uint64_t last[2] = { (uint64_t)lsGetCurrentTimeNs(), __rdtsc() };
@@ -137,6 +174,71 @@ uint64_t lsGetRand(rand_seed &seed)
 
 //////////////////////////////////////////////////////////////////////////
 
+static lsCpuLevel lsDetectCpuLevel()
+{
+#ifdef _MSC_VER
+  int32_t info[4];
+
+  __cpuid(info, 0);
+  const int32_t maxLeaf = info[0];
+
+  __cpuid(info, 1);
+
+  if ((info[3] & (1 << 26)) == 0)
+    return lsCL_Scalar;
+
+  // The OS has to save the upper halves of the registers as well.
+  if (maxLeaf < 7 || (info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+    return lsCL_SSE2;
+
+  __cpuidex(info, 7, 0);
+
+  if ((info[1] & (1 << 5)) == 0)
+    return lsCL_SSE2;
+
+  // And the opmask registers and upper 16 vector registers.
+  if ((info[1] & (1 << 16)) == 0 || (info[1] & (1 << 30)) == 0 || (_xgetbv(0) & 0xE6) != 0xE6)
+    return lsCL_AVX2;
+
+  return lsCL_AVX512;
+#elif defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init(); // this may run during static initialization.
+
+  if (!__builtin_cpu_supports("sse2"))
+    return lsCL_Scalar;
+
+  if (!__builtin_cpu_supports("avx2"))
+    return lsCL_SSE2;
+
+  if (!__builtin_cpu_supports("avx512f") || !__builtin_cpu_supports("avx512bw"))
+    return lsCL_AVX2;
+
+  return lsCL_AVX512;
+#else
+  return lsCL_Scalar; // the levels only cover x86, see `simd.h` for NEON.
+#endif
+}
+
+lsCpuLevel lsGetCpuLevel()
+{
+  static const lsCpuLevel level = lsDetectCpuLevel();
+  return level;
+}
+
+const char *lsCpuLevel_to_string(const lsCpuLevel level)
+{
+  switch (level)
+  {
+  case lsCL_Scalar: return "Scalar";
+  case lsCL_SSE2: return "SSE2";
+  case lsCL_AVX2: return "AVX2";
+  case lsCL_AVX512: return "AVX-512";
+  default: return "<Invalid lsCpuLevel>";
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 int64_t lsParseInt(_In_ const char *start, _Out_ const char **pEnd /* = nullptr */)
 {
   const char *endIfNoEnd = nullptr;
@@ -277,6 +379,342 @@ double_t lsParseFloat(_In_ const char *start, _Out_ const char **pEnd /* = nullp
 
 //////////////////////////////////////////////////////////////////////////
 
+// Bulk parsing takes two passes over blocks of 64 bytes: the separators of a block are found at once, with SSE2 where the build targets
+// it, then the numbers between them are converted eight digits at a time. Finding the next number doesn't depend on converting the
+// current one, so the conversions can overlap.
+
+static bool lsIsBulkSeparator(const char c)
+{
+  constexpr uint64_t separators = (1ULL << ' ') | (1ULL << ',') | (1ULL << ';') | (1ULL << '\n') | (1ULL << '\r') | (1ULL << '\t');
+
+  return (uint8_t)c < 64 && ((separators >> (uint8_t)c) & 1);
+}
+
+// Bit `i` is set if `block[i]` is a separator. Reads 64 bytes. Picks the same target as `simd.h`, which has no byte lanes.
+static uint64_t lsGetBulkSeparatorMask(_In_ const char *block)
+{
+  uint64_t mask = 0;
+
+#ifdef LS_SIMD_SSE2
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i semicolon = _mm_set1_epi8(';');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i lineFeed = _mm_set1_epi8('\n');
+  const __m128i carriageReturn = _mm_set1_epi8('\r');
+
+  for (size_t i = 0; i < 64; i += sizeof(__m128i))
+  {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+
+    const __m128i separators = _mm_or_si128(
+      _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, space), _mm_cmpeq_epi8(bytes, comma)), _mm_or_si128(_mm_cmpeq_epi8(bytes, semicolon), _mm_cmpeq_epi8(bytes, tab))),
+      _mm_or_si128(_mm_cmpeq_epi8(bytes, lineFeed), _mm_cmpeq_epi8(bytes, carriageReturn)));
+
+    mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(separators) << i;
+  }
+#else
+  for (size_t i = 0; i < 64; i++)
+    mask |= (uint64_t)lsIsBulkSeparator(block[i]) << i;
+#endif
+
+  return mask;
+}
+
+// Pads the rest of the block with separators.
+static uint64_t lsGetBulkTailSeparatorMask(_In_ const char *text, const size_t available)
+{
+  char block[64];
+  memset(block, ' ', sizeof(block));
+  memcpy(block, text, available);
+
+  return lsGetBulkSeparatorMask(block);
+}
+
+// The last few bytes of a text, padded with spaces.
+static uint64_t lsLoadBulkTail(_In_ const char *text, const size_t available)
+{
+  uint64_t chunk = 0x2020202020202020;
+  memcpy(&chunk, text, available);
+
+  return chunk;
+}
+
+// Converts the digits at the start of the next eight bytes at once (SWAR) and sets `*pDigits` to their count.
+// Reads no more than `available` bytes.
+inline static uint64_t lsParseUpToEightDigits(_In_ const char *text, const size_t available, _Out_ size_t *pDigits)
+{
+  uint64_t chunk;
+
+  if (available >= sizeof(chunk)) [[likely]]
+    memcpy(&chunk, text, sizeof(chunk));
+  else
+    chunk = lsLoadBulkTail(text, available);
+
+  // The digits become 0 to 9, the high bit of all other bytes is set.
+  uint64_t digits = chunk ^ 0x3030303030303030;
+  const uint64_t nonDigits = (((digits & 0x7F7F7F7F7F7F7F7F) + 0x7676767676767676) | digits) & 0x8080808080808080;
+  const size_t count = nonDigits == 0 ? 8 : (size_t)(lsLowestBit(nonDigits) >> 3);
+
+  *pDigits = count;
+
+  if (count == 0)
+    return 0;
+
+  // The first character is in the lowest byte, shifting the digits up fills in leading zeros.
+  if (count < 8)
+    digits <<= (8 - count) * 8;
+
+  // See: http://govnokod.ru/13461#comment189156 (as used in simdjson).
+  digits = digits * 10 + (digits >> 8);
+  digits = (((digits & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) + (((digits >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+
+  return digits;
+}
+
+// Appends the digits at `text` to `*pValue`. Sticks to `UINT64_MAX` instead of wrapping around.
+inline static const char *lsParseBulkDigits(_In_ const char *text, _In_ const char *end, _In_Out_ uint64_t *pValue, _Out_ size_t *pDigits)
+{
+  static constexpr uint64_t powersOfTen[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+  constexpr uint64_t maxSafeValue = (UINT64_MAX - 99999999) / 100000000; // can take eight more digits without checking.
+
+  uint64_t value = *pValue;
+  size_t digits = 0;
+
+  while (text < end)
+  {
+    size_t count;
+    const uint64_t next = lsParseUpToEightDigits(text, (size_t)(end - text), &count);
+
+    if (value <= maxSafeValue || value <= (UINT64_MAX - 1 - next) / powersOfTen[count])
+      value = value * powersOfTen[count] + next;
+    else
+      value = UINT64_MAX;
+
+    digits += count;
+    text += count;
+
+    if (count < 8)
+      break;
+  }
+
+  *pValue = value;
+  *pDigits = digits;
+
+  return text;
+}
+
+// Calls `Parse(numberStart, textEnd, pValue)` for all numbers, which has to check that the number ends at a separator.
+template <typename T, lsResult (*Parse)(const char *, const char *, T *)>
+static lsResult lsParseBulk(_In_ const char *text, const size_t length, _Out_ T *pValues, const size_t capacity, _Out_ size_t *pCount)
+{
+  lsResult result = lsR_Success;
+  size_t count = 0;
+
+  LS_ERROR_IF(text == nullptr || pValues == nullptr || pCount == nullptr, lsR_ArgumentNull);
+
+  {
+    const char *end = text + length;
+    uint64_t previousIsSeparator = 1;
+
+    for (size_t offset = 0; offset < length; offset += 64)
+    {
+      const char *block = text + offset;
+      const uint64_t separators = length - offset >= 64 ? lsGetBulkSeparatorMask(block) : lsGetBulkTailSeparatorMask(block, length - offset);
+
+      // Set where numbers start.
+      uint64_t starts = ~separators & ((separators << 1) | previousIsSeparator);
+      previousIsSeparator = separators >> 63;
+
+      while (starts != 0)
+      {
+        LS_ERROR_IF(count == capacity, lsR_ArgumentOutOfBounds);
+        LS_ERROR_CHECK(Parse(block + lsLowestBit(starts), end, &pValues[count]));
+
+        count++;
+        starts &= starts - 1;
+      }
+    }
+  }
+
+epilogue:
+  if (pCount != nullptr)
+    *pCount = count;
+
+  return result;
+}
+
+inline static lsResult lsParseBulkInt(_In_ const char *text, _In_ const char *end, _Out_ int32_t *pValue)
+{
+  lsResult result = lsR_Success;
+
+  const bool negative = (*text == '-');
+
+  if (negative || *text == '+')
+    text++;
+
+  uint64_t value = 0;
+  size_t digits;
+  text = lsParseBulkDigits(text, end, &value, &digits);
+
+  LS_ERROR_IF(digits == 0 || (text < end && !lsIsBulkSeparator(*text)), lsR_InvalidParameter);
+  LS_ERROR_IF(value > (uint64_t)INT32_MAX + negative, lsR_ArgumentOutOfBounds);
+
+  *pValue = (int32_t)(negative ? 0u - (uint32_t)value : (uint32_t)value);
+
+epilogue:
+  return result;
+}
+
+// Case insensitive, `lowercase` must be lowercase.
+static bool lsBulkWordEquals(_In_ const char *text, const size_t length, _In_ const char *lowercase)
+{
+  for (size_t i = 0; i < length; i++)
+    if ((text[i] | 0x20) != lowercase[i] || lowercase[i] == '\0')
+      return false;
+
+  return lowercase[length] == '\0';
+}
+
+inline static lsResult lsParseBulkFloat(_In_ const char *text, _In_ const char *end, _Out_ float_t *pValue)
+{
+  static constexpr float_t exactFloatPowersOfTen[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+  static constexpr double_t exactDoublePowersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+  lsResult result = lsR_Success;
+
+  const bool negative = (*text == '-');
+
+  if (negative || *text == '+')
+    text++;
+
+  const char *numberStart = text;
+  float_t value = 0;
+
+  if (text < end && ((*text | 0x20) == 'n' || (*text | 0x20) == 'i'))
+  {
+    while (text < end && !lsIsBulkSeparator(*text))
+      text++;
+
+    const size_t wordLength = (size_t)(text - numberStart);
+
+    if (lsBulkWordEquals(numberStart, wordLength, "nan"))
+      value = NAN;
+    else if (lsBulkWordEquals(numberStart, wordLength, "inf") || lsBulkWordEquals(numberStart, wordLength, "infinity"))
+      value = INFINITY;
+    else
+      LS_ERROR_SET(lsR_InvalidParameter);
+  }
+  else
+  {
+    uint64_t mantissa = 0;
+    size_t integerDigits, fractionDigits = 0;
+    text = lsParseBulkDigits(text, end, &mantissa, &integerDigits);
+
+    if (text < end && *text == '.')
+      text = lsParseBulkDigits(text + 1, end, &mantissa, &fractionDigits);
+
+    LS_ERROR_IF(integerDigits + fractionDigits == 0, lsR_InvalidParameter);
+
+    int64_t exponent = 0;
+
+    if (text < end && (*text == 'e' || *text == 'E'))
+    {
+      text++;
+
+      const bool negativeExponent = (text < end && *text == '-');
+
+      if (negativeExponent || (text < end && *text == '+'))
+        text++;
+
+      uint64_t exponentValue = 0;
+      size_t exponentDigits;
+      text = lsParseBulkDigits(text, end, &exponentValue, &exponentDigits);
+
+      LS_ERROR_IF(exponentDigits == 0, lsR_InvalidParameter);
+
+      exponent = (int64_t)lsMin(exponentValue, (uint64_t)100000);
+
+      if (negativeExponent)
+        exponent = -exponent;
+    }
+
+    LS_ERROR_IF(text < end && !lsIsBulkSeparator(*text), lsR_InvalidParameter);
+
+    exponent -= (int64_t)fractionDigits;
+
+    bool exact = false;
+
+    // Both the mantissa and the power of ten are exact, so the single multiplication or division rounds correctly.
+    if (mantissa <= ((uint64_t)1 << 24) && exponent >= -10 && exponent <= 10)
+    {
+      if (exponent >= 0)
+        value = (float_t)mantissa * exactFloatPowersOfTen[exponent];
+      else
+        value = (float_t)mantissa / exactFloatPowersOfTen[-exponent];
+
+      exact = true;
+    }
+    else if (mantissa <= ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22)
+    {
+      double_t correct;
+
+      if (exponent >= 0)
+        correct = (double_t)mantissa * exactDoublePowersOfTen[exponent];
+      else
+        correct = (double_t)mantissa / exactDoublePowersOfTen[-exponent];
+
+      // Rounding to `double_t` first is only a problem if that lands exactly in the middle between two floats.
+      uint64_t bits;
+      static_assert(sizeof(bits) == sizeof(correct), "Platform not supported.");
+      memcpy(&bits, &correct, sizeof(bits));
+
+      if ((bits & 0x1FFFFFFF) != 0x10000000)
+      {
+        value = (float_t)correct;
+        exact = true;
+      }
+    }
+
+    // Long mantissas or large exponents. `strtof` stops at any separator, so it only needs a copy if the text ends with the number.
+    if (!exact)
+    {
+      if (text < end)
+      {
+        value = strtof(numberStart, nullptr);
+      }
+      else
+      {
+        char number[128];
+        const size_t numberLength = (size_t)(text - numberStart);
+        LS_ERROR_IF(numberLength >= LS_ARRAYSIZE(number), lsR_ArgumentOutOfBounds);
+
+        memcpy(number, numberStart, numberLength);
+        number[numberLength] = '\0';
+
+        value = strtof(number, nullptr);
+      }
+    }
+  }
+
+  *pValue = negative ? -value : value;
+
+epilogue:
+  return result;
+}
+
+lsResult lsParseInts(_In_ const char *text, const size_t length, _Out_ int32_t *pValues, const size_t capacity, _Out_ size_t *pCount)
+{
+  return lsParseBulk<int32_t, lsParseBulkInt>(text, length, pValues, capacity, pCount);
+}
+
+lsResult lsParseFloats(_In_ const char *text, const size_t length, _Out_ float_t *pValues, const size_t capacity, _Out_ size_t *pCount)
+{
+  return lsParseBulk<float_t, lsParseBulkFloat>(text, length, pValues, capacity, pCount);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 bool lsIsInt(_In_ const char *text)
 {
   if (text == nullptr)
@@ -1173,3 +1611,341 @@ lsResult lsToWide(_In_ const char *string, const size_t inChars, _Out_ wchar_t *
 epilogue:
   return result;
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+#include "counterRand.h"
+
+REGISTER_TESTABLE_FILE(24)
+
+DEFINE_TESTABLE(core_TestBulkFormatInts)
+{
+  lsResult result = lsR_Success;
+
+  const int32_t values[] = { 0, 1, -1, 9, 10, -10, 99, 100, 12345, -99999, 100000, 1234567, 9999999, 10000000, 123456789, 999999999, 1000000000, -1000000000, INT32_MAX, INT32_MIN, INT32_MIN + 1 };
+
+  char text[LS_ARRAYSIZE(values) * (sformat_BulkMaxInt32Bytes + 1)];
+  char expected[LS_ARRAYSIZE(text)];
+  size_t expectedLength = 0;
+
+  for (const int32_t value : values)
+    expectedLength += (size_t)snprintf(expected + expectedLength, LS_ARRAYSIZE(expected) - expectedLength, "%" PRIi32 ",", value);
+
+  size_t written = 0;
+  const size_t length = sformat_bulkTo(text, LS_ARRAYSIZE(text), values, LS_ARRAYSIZE(values), ',', &written);
+
+  TESTABLE_ASSERT_EQUAL(written, LS_ARRAYSIZE(values));
+  TESTABLE_ASSERT_EQUAL(length, expectedLength);
+  TESTABLE_ASSERT_EQUAL(memcmp(text, expected, length), 0);
+
+  // Stops as soon as the longest possible value wouldn't fit anymore.
+  {
+    const size_t partialLength = sformat_bulkTo(text, (sformat_BulkMaxInt32Bytes + 1) * 3 - 2, values + 18, 3, ' ', &written);
+
+    TESTABLE_ASSERT_EQUAL(written, 2);
+    TESTABLE_ASSERT_EQUAL(partialLength, sizeof("2147483647 -2147483648 ") - 1);
+    TESTABLE_ASSERT_EQUAL(memcmp(text, "2147483647 -2147483648 ", partialLength), 0);
+  }
+
+  // Back and forth.
+  {
+    int32_t parsed[LS_ARRAYSIZE(values)];
+    size_t parsedCount = 0;
+
+    TESTABLE_ASSERT_SUCCESS(lsParseInts(expected, expectedLength, parsed, LS_ARRAYSIZE(parsed), &parsedCount));
+    TESTABLE_ASSERT_EQUAL(parsedCount, LS_ARRAYSIZE(values));
+
+    for (size_t i = 0; i < LS_ARRAYSIZE(values); i++)
+      TESTABLE_ASSERT_EQUAL(parsed[i], values[i]);
+  }
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(core_TestBulkFormatFloats)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t count = 200 * 1000;
+
+  uint32_t *pBits = nullptr;
+  float_t *pParsed = nullptr;
+  char *text = nullptr;
+  const size_t capacity = count * (sformat_BulkMaxFloatBytes + 1);
+
+  // The shortest representation.
+  {
+    const float_t values[] = { 0.f, -0.f, 1.f, -2.5f, 0.1f, 0.0001f, 0.00001f, 123456.7f, 100.f, 1e9f, 123456792.f, 0.000123456789f, 1.5e-7f, 3.4028235e38f, -1.17549435e-38f, 1e-45f, INFINITY, -INFINITY, NAN };
+    const char expected[] = "0;-0;1;-2.5;0.1;0.0001;1e-5;123456.7;100;1e9;123456790;0.00012345679;1.5e-7;3.4028235e38;-1.1754944e-38;1e-45;Infinity;-Infinity;NaN;";
+
+    char shortText[LS_ARRAYSIZE(values) * (sformat_BulkMaxFloatBytes + 1)];
+    size_t written = 0;
+    const size_t length = sformat_bulkTo(shortText, LS_ARRAYSIZE(shortText), values, LS_ARRAYSIZE(values), ';', &written);
+
+    TESTABLE_ASSERT_EQUAL(written, LS_ARRAYSIZE(values));
+    TESTABLE_ASSERT_EQUAL(length, LS_ARRAYSIZE(expected) - 1);
+    TESTABLE_ASSERT_EQUAL(memcmp(shortText, expected, length), 0);
+  }
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pBits, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pParsed, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&text, capacity));
+
+  // All bit patterns have to come back unchanged.
+  {
+    counter_rand rand(0x5F0A);
+    TESTABLE_ASSERT_SUCCESS(counterRand_fill(&rand, pBits, count));
+
+    const float_t *pValues = reinterpret_cast<const float_t *>(pBits);
+
+    size_t written = 0;
+    const size_t length = sformat_bulkTo(text, capacity, pValues, count, '\n', &written);
+    TESTABLE_ASSERT_EQUAL(written, count);
+
+    size_t parsedCount = 0;
+    TESTABLE_ASSERT_SUCCESS(lsParseFloats(text, length, pParsed, count, &parsedCount));
+    TESTABLE_ASSERT_EQUAL(parsedCount, count);
+
+    const char *value = text;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      if (isnan(pValues[i]))
+      {
+        TESTABLE_ASSERT_TRUE(isnan(pParsed[i]));
+      }
+      else
+      {
+        uint32_t parsedBits;
+        memcpy(&parsedBits, &pParsed[i], sizeof(parsedBits));
+        TESTABLE_ASSERT_EQUAL(parsedBits, pBits[i]);
+
+        const float_t reference = strtof(value, nullptr);
+        memcpy(&parsedBits, &reference, sizeof(parsedBits));
+        TESTABLE_ASSERT_EQUAL(parsedBits, pBits[i]);
+      }
+
+      value = strchr(value, '\n') + 1;
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pBits);
+  lsFreePtr(&pParsed);
+  lsFreePtr(&text);
+  return result;
+}
+
+DEFINE_TESTABLE(core_TestBulkParse)
+{
+  lsResult result = lsR_Success;
+
+  int32_t ints[16];
+  float_t floats[16];
+  size_t count = 0;
+
+  // The separator masks of all byte values match the scalar check, for whichever target was built.
+  for (size_t first = 0; first < 256; first += 64)
+  {
+    char block[64];
+
+    for (size_t i = 0; i < 64; i++)
+      block[i] = (char)(first + i);
+
+    const uint64_t mask = lsGetBulkSeparatorMask(block);
+
+    for (size_t i = 0; i < 64; i++)
+      TESTABLE_ASSERT_EQUAL((mask >> i) & 1, (uint64_t)lsIsBulkSeparator(block[i]));
+  }
+
+  {
+    const char text[] = "  12,-7;+3\r\n0000000000000000000000042\t2147483647 -2147483648 123456789012345678 ,";
+    TESTABLE_ASSERT_FAILURE(lsParseInts(text, LS_ARRAYSIZE(text) - 1, ints, LS_ARRAYSIZE(ints), &count));
+    TESTABLE_ASSERT_EQUAL(count, 6);
+
+    TESTABLE_ASSERT_EQUAL(ints[0], 12);
+    TESTABLE_ASSERT_EQUAL(ints[1], -7);
+    TESTABLE_ASSERT_EQUAL(ints[2], 3);
+    TESTABLE_ASSERT_EQUAL(ints[3], 42);
+    TESTABLE_ASSERT_EQUAL(ints[4], INT32_MAX);
+    TESTABLE_ASSERT_EQUAL(ints[5], INT32_MIN);
+  }
+
+  // The end of the text doesn't have to be terminated.
+  {
+    const char text[] = "1 22 333 4444 55555 666666 7777777 88888888 999999999";
+    TESTABLE_ASSERT_SUCCESS(lsParseInts(text, LS_ARRAYSIZE(text) - 2, ints, LS_ARRAYSIZE(ints), &count));
+    TESTABLE_ASSERT_EQUAL(count, 9);
+    TESTABLE_ASSERT_EQUAL(ints[7], 88888888);
+    TESTABLE_ASSERT_EQUAL(ints[8], 99999999);
+  }
+
+  TESTABLE_ASSERT_SUCCESS(lsParseInts("", 0, ints, LS_ARRAYSIZE(ints), &count));
+  TESTABLE_ASSERT_EQUAL(count, 0);
+
+  TESTABLE_ASSERT_FAILURE(lsParseInts("1 2 3", 5, ints, 2, &count));
+  TESTABLE_ASSERT_FAILURE(lsParseInts("2147483648", 10, ints, 1, &count));
+  TESTABLE_ASSERT_FAILURE(lsParseInts("-2147483649", 11, ints, 1, &count));
+  TESTABLE_ASSERT_FAILURE(lsParseInts("1 - 2", 5, ints, 4, &count));
+  TESTABLE_ASSERT_FAILURE(lsParseInts("12a", 3, ints, 4, &count));
+  TESTABLE_ASSERT_FAILURE(lsParseInts("1.5", 3, ints, 4, &count));
+
+  {
+    const char *values[] = { "0", "-0", "1", ".5", "-.25", "+3.", "1e3", "1E+3", "2.5e-3", "16777217", "0.1", "3.4028235e38", "3.4028236e38", "1e39", "1e-46", "1.401298464324817e-45", "0.000000000000000000000000000000000000011754942807573642917", "123456789012345678901234567890", "7.038531e-26" };
+
+    for (const char *value : values)
+    {
+      TESTABLE_ASSERT_SUCCESS(lsParseFloats(value, strlen(value), floats, 1, &count));
+      TESTABLE_ASSERT_EQUAL(count, 1);
+
+      const float_t reference = strtof(value, nullptr);
+      TESTABLE_ASSERT_EQUAL(memcmp(&floats[0], &reference, sizeof(reference)), 0);
+    }
+  }
+
+  {
+    const char text[] = "nan -INF Infinity -nan";
+    TESTABLE_ASSERT_SUCCESS(lsParseFloats(text, LS_ARRAYSIZE(text) - 1, floats, LS_ARRAYSIZE(floats), &count));
+    TESTABLE_ASSERT_EQUAL(count, 4);
+    TESTABLE_ASSERT_TRUE(isnan(floats[0]));
+    TESTABLE_ASSERT_EQUAL(floats[1], -INFINITY);
+    TESTABLE_ASSERT_EQUAL(floats[2], INFINITY);
+    TESTABLE_ASSERT_TRUE(isnan(floats[3]));
+  }
+
+  TESTABLE_ASSERT_FAILURE(lsParseFloats(".", 1, floats, 4, &count));
+  TESTABLE_ASSERT_FAILURE(lsParseFloats("1e", 2, floats, 4, &count));
+  TESTABLE_ASSERT_FAILURE(lsParseFloats("1.2.3", 5, floats, 4, &count));
+  TESTABLE_ASSERT_FAILURE(lsParseFloats("infinite", 8, floats, 4, &count));
+  TESTABLE_ASSERT_FAILURE(lsParseFloats("0x10", 4, floats, 4, &count));
+  TESTABLE_ASSERT_FAILURE(lsParseFloats("1 2", 3, floats, 1, &count));
+
+epilogue:
+  return result;
+}
+
+DEFINE_BENCHMARK(core_BenchmarkBulkNumbers)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t count = 1024 * 1024;
+  constexpr size_t maxBytes = sformat_BulkMaxFloatBytes + 1;
+
+  uint32_t *pBits = nullptr;
+  int32_t *pInts = nullptr;
+  float_t *pFloats = nullptr;
+  char *text = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pBits, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pInts, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pFloats, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&text, count * maxBytes + 1));
+
+  // Heights and the like: ints of all lengths and floats with a few decimals.
+  {
+    counter_rand rand(0xB0);
+    TESTABLE_ASSERT_SUCCESS(counterRand_fill(&rand, pBits, count));
+
+    for (size_t i = 0; i < count; i++)
+    {
+      pInts[i] = (int32_t)pBits[i] >> (pBits[i] & 31);
+      pFloats[i] = (float_t)((int32_t)pBits[i] >> 12) / 1000.f;
+    }
+  }
+
+  {
+    int64_t start = lsGetCurrentTimeNs();
+    size_t length = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      TESTABLE_ASSERT_TRUE(sformat_to(text + length, count * maxBytes - length, pInts[i], ','));
+      length += strlen(text + length);
+    }
+
+    const int64_t formatIntNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    start = lsGetCurrentTimeNs();
+    sformat_bulkTo(text, count * maxBytes, pInts, count, ',', nullptr);
+    const int64_t bulkFormatIntNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    start = lsGetCurrentTimeNs();
+    length = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      TESTABLE_ASSERT_TRUE(sformat_to(text + length, count * maxBytes - length, pFloats[i], ','));
+      length += strlen(text + length);
+    }
+
+    const int64_t formatFloatNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    start = lsGetCurrentTimeNs();
+    sformat_bulkTo(text, count * maxBytes, pFloats, count, ',', nullptr);
+    const int64_t bulkFormatFloatNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    print("core bulk formatting: ints ", (double)formatIntNs / count, " ns per value with `sformat_to`, ", (double)bulkFormatIntNs / count, " ns with `sformat_bulkTo`; floats ", (double)formatFloatNs / count, " ns with `sformat_to`, ", (double)bulkFormatFloatNs / count, " ns (shortest) with `sformat_bulkTo`\n");
+  }
+
+  {
+    size_t length = sformat_bulkTo(text, count * maxBytes, pInts, count, ',', nullptr);
+    text[length] = '\0';
+
+    int64_t start = lsGetCurrentTimeNs();
+    const char *next = text;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      pInts[i] = (int32_t)lsParseInt(next, &next);
+      next++;
+    }
+
+    const int64_t parseIntNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+    size_t parsedCount = 0;
+
+    start = lsGetCurrentTimeNs();
+    TESTABLE_ASSERT_SUCCESS(lsParseInts(text, length, pInts, count, &parsedCount));
+    const int64_t bulkParseIntNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    length = sformat_bulkTo(text, count * maxBytes, pFloats, count, ',', nullptr);
+    text[length] = '\0';
+
+    start = lsGetCurrentTimeNs();
+    next = text;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      pFloats[i] = (float_t)lsParseFloat(next, &next);
+      next++;
+    }
+
+    const int64_t parseFloatNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    start = lsGetCurrentTimeNs();
+    next = text;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      char *end;
+      pFloats[i] = strtof(next, &end);
+      next = end + 1;
+    }
+
+    const int64_t strtofNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    start = lsGetCurrentTimeNs();
+    TESTABLE_ASSERT_SUCCESS(lsParseFloats(text, length, pFloats, count, &parsedCount));
+    const int64_t bulkParseFloatNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    print("core bulk parsing: ints ", (double)parseIntNs / count, " ns per value with `lsParseInt`, ", (double)bulkParseIntNs / count, " ns with `lsParseInts`; floats ", (double)parseFloatNs / count, " ns with `lsParseFloat`, ", (double)strtofNs / count, " ns with `strtof`, ", (double)bulkParseFloatNs / count, " ns (exact) with `lsParseFloats`\n");
+  }
+
+epilogue:
+  lsFreePtr(&pBits);
+  lsFreePtr(&pInts);
+  lsFreePtr(&pFloats);
+  lsFreePtr(&text);
+  return result;
+}
@@ -0,0 +1,401 @@
+#include "counterRand.h"
+#include "simd.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+constexpr uint32_t counterRand_Multiplier0 = 0xD2511F53;
+constexpr uint32_t counterRand_Multiplier1 = 0xCD9E8D57;
+constexpr uint32_t counterRand_KeyStep0 = 0x9E3779B9;
+constexpr uint32_t counterRand_KeyStep1 = 0xBB67AE85;
+constexpr size_t counterRand_Rounds = 7;
+
+constexpr size_t counterRand_Lanes = counterRand_GroupSize / 4;
+constexpr size_t counterRand_JobSize = 64 * 1024;
+
+using counterRand_vec = simd<int32_t, counterRand_Lanes>;
+
+static inline uint32_t counterRand_set_internal(const uint32_t value, const uint32_t *) { return value; }
+static inline counterRand_vec counterRand_set_internal(const uint32_t value, const counterRand_vec *) { return simd_set<counterRand_Lanes>((int32_t)value); }
+
+static inline uint32_t counterRand_mulHiLo_internal(const uint32_t a, const uint32_t b, _Out_ uint32_t *pHi)
+{
+  const uint64_t product = (uint64_t)a * b;
+  *pHi = (uint32_t)(product >> 32);
+  return (uint32_t)product;
+}
+
+static inline counterRand_vec counterRand_mulHiLo_internal(const counterRand_vec &a, const counterRand_vec &b, _Out_ counterRand_vec *pHi) { return simd_mulHiLo(a, b, pHi); }
+
+// Replaces the 128 bit counter in `c` with its hash, for a single block or a block per lane.
+template <typename T>
+static void counterRand_philox_internal(T c[4], const uint64_t key)
+{
+  const T multiplier0 = counterRand_set_internal(counterRand_Multiplier0, c);
+  const T multiplier1 = counterRand_set_internal(counterRand_Multiplier1, c);
+
+  uint32_t key0 = (uint32_t)key;
+  uint32_t key1 = (uint32_t)(key >> 32);
+
+  for (size_t round = 0; round < counterRand_Rounds; round++)
+  {
+    if (round > 0)
+    {
+      key0 += counterRand_KeyStep0;
+      key1 += counterRand_KeyStep1;
+    }
+
+    T hi0, hi1;
+    const T lo0 = counterRand_mulHiLo_internal(multiplier0, c[0], &hi0);
+    const T lo1 = counterRand_mulHiLo_internal(multiplier1, c[2], &hi1);
+
+    c[0] = hi1 ^ c[1] ^ counterRand_set_internal(key0, c);
+    c[1] = lo1;
+    c[2] = hi0 ^ c[3] ^ counterRand_set_internal(key1, c);
+    c[3] = lo0;
+  }
+}
+
+// The words of the blocks of `group`, one `counterRand_vec` per word.
+static void counterRand_getGroup_internal(const uint64_t key, const uint64_t group, _Out_ counterRand_vec words[4])
+{
+  static const int32_t laneIndices[counterRand_Lanes] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+  static_assert(LS_ARRAYSIZE(laneIndices) == counterRand_Lanes);
+
+  const uint64_t firstBlock = group * counterRand_Lanes; // the lanes don't carry into the upper half.
+
+  words[0] = simd_set<counterRand_Lanes>((int32_t)(uint32_t)firstBlock) + simd_load<counterRand_Lanes>(laneIndices);
+  words[1] = simd_set<counterRand_Lanes>((int32_t)(uint32_t)(firstBlock >> 32));
+  words[2] = words[3] = simd_set<counterRand_Lanes>(0);
+
+  counterRand_philox_internal(words, key);
+}
+
+// Calls `func(group, pGroupValues)` for every group touched by the range, on a copy for the ones it doesn't cover entirely.
+template <typename T, typename Func>
+static void counterRand_fill_internal(const uint64_t position, _Out_ T *pValues, const size_t count, Func func)
+{
+  size_t done = 0;
+
+  while (done < count)
+  {
+    const uint64_t group = (position + done) / counterRand_GroupSize;
+    const size_t offset = (size_t)((position + done) % counterRand_GroupSize);
+    const size_t groupCount = lsMin(counterRand_GroupSize - offset, count - done);
+
+    if (groupCount == counterRand_GroupSize)
+    {
+      func(group, pValues + done);
+    }
+    else
+    {
+      T values[counterRand_GroupSize];
+      func(group, values);
+      lsMemcpy(pValues + done, values + offset, groupCount);
+    }
+
+    done += groupCount;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+uint32_t counterRand_get(const counter_rand &rand, const uint64_t index)
+{
+  const uint64_t block = (index / counterRand_GroupSize) * counterRand_Lanes + index % counterRand_Lanes;
+  uint32_t words[4] = { (uint32_t)block, (uint32_t)(block >> 32), 0, 0 };
+
+  counterRand_philox_internal(words, rand.key);
+
+  return words[(index / counterRand_Lanes) % 4];
+}
+
+uint32_t counterRand_next(counter_rand *pRand)
+{
+  return counterRand_get(*pRand, pRand->position++);
+}
+
+void counterRand_skip(counter_rand *pRand, const uint64_t count)
+{
+  pRand->position += count;
+}
+
+lsResult counterRand_fill(counter_rand *pRand, _Out_ uint32_t *pValues, const size_t count)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pRand == nullptr || pValues == nullptr, lsR_ArgumentNull);
+
+  counterRand_fill_internal(pRand->position, pValues, count, [key = pRand->key](const uint64_t group, uint32_t *pGroupValues)
+    {
+      counterRand_vec words[4];
+      counterRand_getGroup_internal(key, group, words);
+
+      for (size_t i = 0; i < 4; i++)
+        simd_store(reinterpret_cast<int32_t *>(pGroupValues) + i * counterRand_Lanes, words[i]);
+    });
+
+  pRand->position += count;
+
+epilogue:
+  return result;
+}
+
+lsResult counterRand_fill(counter_rand *pRand, _Out_ float *pValues, const size_t count, const float min, const float max)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pRand == nullptr || pValues == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(!(min <= max), lsR_InvalidParameter);
+
+  {
+    const simd<float, counterRand_Lanes> offset = simd_set<counterRand_Lanes>(min);
+    const simd<float, counterRand_Lanes> scale = simd_set<counterRand_Lanes>((max - min) * (1.f / (1 << 24)));
+    const simd<float, counterRand_Lanes> last = simd_set<counterRand_Lanes>(lsMax(min, nextafterf(max, min))); // rounding may reach `max`.
+
+    counterRand_fill_internal(pRand->position, pValues, count, [&](const uint64_t group, float *pGroupValues)
+      {
+        counterRand_vec words[4];
+        counterRand_getGroup_internal(pRand->key, group, words);
+
+        for (size_t i = 0; i < 4; i++)
+          simd_store(pGroupValues + i * counterRand_Lanes, simd_min(simd_toFloat(simd_shiftBitsRight<8>(words[i])) * scale + offset, last));
+      });
+
+    pRand->position += count;
+  }
+
+epilogue:
+  return result;
+}
+
+struct counter_rand_fill_context
+{
+  counter_rand rand;
+  float *pValues;
+  size_t count;
+  float min, max;
+};
+
+static void counterRand_fillJob_internal(void *pUserData, const size_t index)
+{
+  const counter_rand_fill_context *pContext = reinterpret_cast<const counter_rand_fill_context *>(pUserData);
+
+  const size_t offset = index * counterRand_JobSize;
+  counter_rand rand = pContext->rand;
+  counterRand_skip(&rand, offset);
+
+  counterRand_fill(&rand, pContext->pValues + offset, lsMin(counterRand_JobSize, pContext->count - offset), pContext->min, pContext->max);
+}
+
+lsResult counterRand_fill(counter_rand *pRand, _Out_ float *pValues, const size_t count, const float min, const float max, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pRand == nullptr || pValues == nullptr || pPool == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(!(min <= max), lsR_InvalidParameter);
+
+  {
+    counter_rand_fill_context context = { *pRand, pValues, count, min, max };
+    threadPool_parallelFor(pPool, (count + counterRand_JobSize - 1) / counterRand_JobSize, counterRand_fillJob_internal, &context);
+
+    counterRand_skip(pRand, count);
+  }
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(23)
+
+DEFINE_TESTABLE(counterRand_TestKnownAnswers)
+{
+  lsResult result = lsR_Success;
+
+  // From the reference implementation (Random123, `kat_vectors` for 7 rounds).
+  {
+    uint32_t words[4] = { 0, 0, 0, 0 };
+    counterRand_philox_internal(words, 0);
+
+    TESTABLE_ASSERT_EQUAL(words[0], 0x5F6FB709u);
+    TESTABLE_ASSERT_EQUAL(words[1], 0x0D893F64u);
+    TESTABLE_ASSERT_EQUAL(words[2], 0x4F121F81u);
+    TESTABLE_ASSERT_EQUAL(words[3], 0x4F730A48u);
+  }
+
+  {
+    uint32_t words[4] = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+    counterRand_philox_internal(words, UINT64_MAX);
+
+    TESTABLE_ASSERT_EQUAL(words[0], 0x5207DDC2u);
+    TESTABLE_ASSERT_EQUAL(words[1], 0x45165E59u);
+    TESTABLE_ASSERT_EQUAL(words[2], 0x4D8EE751u);
+    TESTABLE_ASSERT_EQUAL(words[3], 0x8C52F662u);
+  }
+
+  {
+    uint32_t words[4] = { 0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344 };
+    counterRand_philox_internal(words, 0x299F31D0A4093822);
+
+    TESTABLE_ASSERT_EQUAL(words[0], 0x4DFCCABAu);
+    TESTABLE_ASSERT_EQUAL(words[1], 0x190A87F0u);
+    TESTABLE_ASSERT_EQUAL(words[2], 0xC47362BAu);
+    TESTABLE_ASSERT_EQUAL(words[3], 0xB6B5242Au);
+  }
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(counterRand_TestFill)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t count = 300 * 1000;
+  constexpr uint64_t start = ((uint64_t)1 << 37) - 1003; // the block index crosses into the upper half of the counter.
+
+  uint32_t *pValues = nullptr;
+  float *pFloats = nullptr;
+  float *pParallelFloats = nullptr;
+  thread_pool *pPool = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pValues, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pFloats, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pParallelFloats, count));
+
+  // Filled in odd pieces, like by a few threads.
+  {
+    counter_rand rand(12345, start);
+    size_t done = 0;
+
+    for (size_t piece = 1; done < count; piece = piece * 3 + 1)
+    {
+      const size_t pieceCount = lsMin(piece, count - done);
+      TESTABLE_ASSERT_SUCCESS(counterRand_fill(&rand, pValues + done, pieceCount));
+      done += pieceCount;
+    }
+
+    TESTABLE_ASSERT_EQUAL(rand.position, start + count);
+  }
+
+  {
+    counter_rand rand(12345, start);
+    size_t ones = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      if (i % 997 == 0)
+      {
+        TESTABLE_ASSERT_EQUAL(counterRand_next(&rand), pValues[i]);
+      }
+      else
+      {
+        TESTABLE_ASSERT_EQUAL(counterRand_get(rand, start + i), pValues[i]);
+        counterRand_skip(&rand, 1);
+      }
+
+      ones += (pValues[i] >> 31) + (pValues[i] & 1);
+    }
+
+    TESTABLE_ASSERT_EQUAL(fabs((double)ones / (count * 2) - 0.5) < 5e-3, true);
+  }
+
+  // Different keys differ.
+  {
+    counter_rand rand(12346, start);
+    size_t same = 0;
+
+    for (size_t i = 0; i < count; i++)
+      same += counterRand_next(&rand) == pValues[i];
+
+    TESTABLE_ASSERT_EQUAL(same < 2, true);
+  }
+
+  {
+    counter_rand rand(99, 7);
+    double sum = 0;
+
+    TESTABLE_ASSERT_SUCCESS(counterRand_fill(&rand, pFloats, count, -2.f, 3.f));
+
+    for (size_t i = 0; i < count; i++)
+    {
+      TESTABLE_ASSERT_TRUE(pFloats[i] >= -2.f && pFloats[i] < 3.f);
+      sum += pFloats[i];
+    }
+
+    TESTABLE_ASSERT_EQUAL(fabs(sum / count - 0.5) < 0.02, true);
+  }
+
+  // The same for any number of workers.
+  for (size_t threadCount = 1; threadCount <= 4; threadCount += 3)
+  {
+    counter_rand rand(99, 7);
+
+    TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, threadCount));
+    TESTABLE_ASSERT_SUCCESS(counterRand_fill(&rand, pParallelFloats, count, -2.f, 3.f, pPool));
+    threadPool_destroy(&pPool);
+
+    TESTABLE_ASSERT_EQUAL(rand.position, 7 + count);
+    TESTABLE_ASSERT_EQUAL(memcmp(pFloats, pParallelFloats, count * sizeof(float)), 0);
+  }
+
+  {
+    counter_rand rand(1);
+    TESTABLE_ASSERT_EQUAL(counterRand_fill(&rand, pFloats, count, 1.f, 0.f), lsR_InvalidParameter);
+    TESTABLE_ASSERT_EQUAL(counterRand_fill(&rand, (float *)nullptr, count, 0.f, 1.f), lsR_ArgumentNull);
+  }
+
+epilogue:
+  threadPool_destroy(&pPool);
+  lsFreePtr(&pValues);
+  lsFreePtr(&pFloats);
+  lsFreePtr(&pParallelFloats);
+  return result;
+}
+
+DEFINE_BENCHMARK(counterRand_BenchmarkFill)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t count = 1024 * 1024;
+  constexpr size_t repetitions = 8;
+
+  float *pValues = nullptr;
+  thread_pool *pPool = threadPool_getDefault();
+  rand_seed seed(1, 2);
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pValues, count));
+
+  {
+    const int64_t start = lsGetCurrentTimeNs();
+
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+      for (size_t i = 0; i < count; i++)
+        pValues[i] = (float)(lsGetRand(seed) >> 40) * (1.f / (1 << 24));
+
+    const int64_t serialNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    counter_rand rand(3);
+    const int64_t fillStart = lsGetCurrentTimeNs();
+
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+      TESTABLE_ASSERT_SUCCESS(counterRand_fill(&rand, pValues, count, 0.f, 1.f));
+
+    const int64_t fillNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - fillStart);
+    const int64_t parallelStart = lsGetCurrentTimeNs();
+
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+      TESTABLE_ASSERT_SUCCESS(counterRand_fill(&rand, pValues, count, 0.f, 1.f, pPool));
+
+    const int64_t parallelNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - parallelStart);
+
+    print("counterRand floats: ", (double)serialNs / (double)(count * repetitions), " ns per value with `lsGetRand(rand_seed &)`, ", (double)fillNs / (double)(count * repetitions), " ns filled, ", (double)parallelNs / (double)(count * repetitions), " ns filled on ", threadPool_getWorkerCount(pPool) + 1, " threads\n");
+  }
+
+epilogue:
+  lsFreePtr(&pValues);
+  return result;
+}
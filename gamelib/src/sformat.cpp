@@ -4339,6 +4339,192 @@ size_t _sformat_Append(const double_t value, const sformatState &fs, char *text)
   }
 }
 
+//////////////////////////////////////////////////////////////////////////
+
+static size_t _sformat_BulkDigitCount(const uint32_t value)
+{
+  if (value < 100000)
+  {
+    if (value < 100)
+      return value < 10 ? 1 : 2;
+    else
+      return value < 1000 ? 3 : (value < 10000 ? 4 : 5);
+  }
+  else
+  {
+    if (value < 10000000)
+      return value < 1000000 ? 6 : 7;
+    else
+      return value < 100000000 ? 8 : (value < 1000000000 ? 9 : 10);
+  }
+}
+
+// Writes exactly `digits` digits of `value` to `text`, two at a time.
+static void _sformat_BulkAppendDigits(uint32_t value, const size_t digits, char *text)
+{
+  char *pEnd = text + digits;
+
+  while (value >= 100)
+  {
+    pEnd -= 2;
+    memcpy(pEnd, _sformat_DecimalLUT + (value % 100) * 2, 2);
+    value /= 100;
+  }
+
+  if (value >= 10)
+    memcpy(pEnd - 2, _sformat_DecimalLUT + value * 2, 2);
+  else
+    pEnd[-1] = (char)('0' + value);
+}
+
+static size_t _sformat_BulkAppendInt32(const int32_t value, char *text)
+{
+  const size_t sign = value < 0;
+  const uint32_t abs = sign ? 0u - (uint32_t)value : (uint32_t)value;
+  const size_t digits = _sformat_BulkDigitCount(abs);
+
+  *text = '-';
+  _sformat_BulkAppendDigits(abs, digits, text + sign);
+
+  return sign + digits;
+}
+
+// Plain digits where the decimal point is within or just before them (`0.00123`, `123.45`, `1200`), otherwise `1.2345e-12`.
+static size_t _sformat_BulkAppendFloat(const float value, char *text)
+{
+  typedef jkj::dragonbox::default_float_traits<float> FloatTraits;
+
+  auto const br = jkj::dragonbox::float_bits<float, FloatTraits>(value);
+  auto const exponent_bits = br.extract_exponent_bits();
+  auto const s = br.remove_exponent_bits(exponent_bits);
+
+  if (!br.is_finite(exponent_bits))
+  {
+    if (!s.has_all_zero_significand_bits())
+    {
+      memcpy(text, "NaN", 3);
+      return 3;
+    }
+    else if (s.is_negative())
+    {
+      memcpy(text, "-Infinity", 9);
+      return 9;
+    }
+    else
+    {
+      memcpy(text, "Infinity", 8);
+      return 8;
+    }
+  }
+
+  size_t length = 0;
+
+  if (s.is_negative())
+    text[length++] = '-';
+
+  if (!br.is_nonzero())
+  {
+    text[length++] = '0';
+    return length;
+  }
+
+  auto const decimal = jkj::dragonbox::to_decimal<float, FloatTraits>(s, exponent_bits,
+    jkj::dragonbox::policy::sign::ignore,
+    jkj::dragonbox::policy::trailing_zero::remove,
+    jkj::dragonbox::policy::decimal_to_binary_rounding::nearest_to_even,
+    jkj::dragonbox::policy::binary_to_decimal_rounding::to_even,
+    jkj::dragonbox::policy::cache::full);
+
+  char digits[10];
+  const size_t digitCount = _sformat_BulkDigitCount(decimal.significand);
+  _sformat_BulkAppendDigits(decimal.significand, digitCount, digits);
+
+  const int64_t point = (int64_t)digitCount + decimal.exponent; // digits before the decimal point.
+
+  if (point > 0 && point <= 9)
+  {
+    if (decimal.exponent >= 0)
+    {
+      memcpy(text + length, digits, digitCount);
+      memset(text + length + digitCount, '0', (size_t)decimal.exponent);
+      length += (size_t)point;
+    }
+    else
+    {
+      memcpy(text + length, digits, (size_t)point);
+      text[length + point] = '.';
+      memcpy(text + length + point + 1, digits + point, digitCount - (size_t)point);
+      length += digitCount + 1;
+    }
+  }
+  else if (point <= 0 && point > -4)
+  {
+    text[length++] = '0';
+    text[length++] = '.';
+    memset(text + length, '0', (size_t)-point);
+    length += (size_t)-point;
+    memcpy(text + length, digits, digitCount);
+    length += digitCount;
+  }
+  else
+  {
+    text[length++] = digits[0];
+
+    if (digitCount > 1)
+    {
+      text[length++] = '.';
+      memcpy(text + length, digits + 1, digitCount - 1);
+      length += digitCount - 1;
+    }
+
+    const int64_t exponent = point - 1;
+    text[length++] = 'e';
+
+    if (exponent < 0)
+      text[length++] = '-';
+
+    const uint32_t absExponent = (uint32_t)(exponent < 0 ? -exponent : exponent);
+    const size_t exponentDigits = absExponent < 10 ? 1 : 2;
+    _sformat_BulkAppendDigits(absExponent, exponentDigits, text + length);
+    length += exponentDigits;
+  }
+
+  return length;
+}
+
+template <typename T, size_t MaxBytes, typename Func>
+static size_t _sformat_BulkTo(char *destination, const size_t capacity, const T *pValues, const size_t count, const char separator, size_t *pValuesWritten, Func func)
+{
+  size_t length = 0;
+  size_t i = 0;
+
+  if (destination != nullptr && pValues != nullptr)
+  {
+    for (; i < count && capacity - length >= MaxBytes + 1; i++)
+    {
+      length += func(pValues[i], destination + length);
+      destination[length++] = separator;
+    }
+  }
+
+  if (pValuesWritten != nullptr)
+    *pValuesWritten = i;
+
+  return length;
+}
+
+size_t sformat_bulkTo(char *destination, const size_t capacity, const int32_t *pValues, const size_t count, const char separator, size_t *pValuesWritten)
+{
+  return _sformat_BulkTo<int32_t, sformat_BulkMaxInt32Bytes>(destination, capacity, pValues, count, separator, pValuesWritten, _sformat_BulkAppendInt32);
+}
+
+size_t sformat_bulkTo(char *destination, const size_t capacity, const float *pValues, const size_t count, const char separator, size_t *pValuesWritten)
+{
+  return _sformat_BulkTo<float, sformat_BulkMaxFloatBytes>(destination, capacity, pValues, count, separator, pValuesWritten, _sformat_BulkAppendFloat);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 size_t _sformat_AppendBool(const bool value, const sformatState &fs, char *text)
 {
   if (value)
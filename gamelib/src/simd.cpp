@@ -0,0 +1,321 @@
+#include "simd.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(21)
+
+// Values that cover wrapping around, negative numbers and fractions depending on `T`.
+template <typename T>
+static T simd_TestValue(const size_t index, const size_t salt)
+{
+  const uint32_t hash = (uint32_t)((index + 1) * 2654435761u ^ (salt * 40503u));
+
+  if constexpr (std::is_same_v<T, float>)
+    return (float)(int32_t)(hash % 2001) * 0.125f - 125.f;
+  else if constexpr (std::is_same_v<T, int32_t>)
+    return (int32_t)hash;
+  else
+    return (T)(index % 5 == 0 ? 0xFFFF - index : hash);
+}
+
+// `a + b`, `a - b` and `a * b` wrapping around like the lanes do.
+template <typename T> static T simd_TestAdd(const T a, const T b) { if constexpr (std::is_floating_point_v<T>) return a + b; else return (T)((uint32_t)a + (uint32_t)b); }
+template <typename T> static T simd_TestSub(const T a, const T b) { if constexpr (std::is_floating_point_v<T>) return a - b; else return (T)((uint32_t)a - (uint32_t)b); }
+template <typename T> static T simd_TestMul(const T a, const T b) { if constexpr (std::is_floating_point_v<T>) return a * b; else return (T)((uint32_t)a * (uint32_t)b); }
+
+template <typename T>
+static bool simd_TestBits(const T value)
+{
+  uint32_t bits = 0;
+  memcpy(&bits, &value, sizeof(value));
+  return bits != 0;
+}
+
+// Compares every operation on `simd<T, N>` against the same on each lane.
+template <typename T, size_t N>
+static lsResult simd_TestLanes()
+{
+  lsResult result = lsR_Success;
+
+  T a[N], b[N], out[N];
+
+  for (size_t i = 0; i < N; i++)
+  {
+    a[i] = simd_TestValue<T>(i, 1);
+    b[i] = i % 3 == 0 ? a[i] : simd_TestValue<T>(i, 2);
+  }
+
+  const simd<T, N> va = simd_load<N>(a);
+  const simd<T, N> vb = simd_load<N>(b);
+
+  simd_store(out, va + vb);
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], simd_TestAdd(a[i], b[i]));
+
+  simd_store(out, va - vb);
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], simd_TestSub(a[i], b[i]));
+
+  simd_store(out, va * vb);
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], simd_TestMul(a[i], b[i]));
+
+  simd_store(out, simd_min(va, vb));
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], lsMin(a[i], b[i]));
+
+  simd_store(out, simd_max(va, vb));
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], lsMax(a[i], b[i]));
+
+  simd_store(out, simd_select(simd_less(va, vb) | simd_equal(va, vb), va, simd_set<N>((T)7)));
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], a[i] <= b[i] ? a[i] : (T)7);
+
+  simd_store(out, simd_select(simd_greater(va, vb) & simd_greater(va, simd_set<N>((T)0)), va, vb));
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], a[i] > b[i] && a[i] > (T)0 ? a[i] : b[i]);
+
+  {
+    simd_mask<T, N> mask = simd_equal(va, vb);
+    T maskLanes[N];
+    memcpy(maskLanes, &mask, sizeof(maskLanes));
+
+    uint32_t expectedBits = 0;
+
+    for (size_t i = 0; i < N; i++)
+    {
+      TESTABLE_ASSERT_EQUAL(simd_TestBits(maskLanes[i]), a[i] == b[i]);
+      expectedBits |= (a[i] == b[i] ? 1u : 0u) << i;
+    }
+
+    TESTABLE_ASSERT_EQUAL(simd_getMaskBits(mask), expectedBits);
+  }
+
+  {
+    T sum = 0, min = a[0], max = a[0];
+
+    for (size_t i = 0; i < N; i++)
+    {
+      sum = simd_TestAdd(sum, a[i]);
+      min = lsMin(min, a[i]);
+      max = lsMax(max, a[i]);
+    }
+
+    if constexpr (std::is_floating_point_v<T>) // the order of the additions differs.
+      TESTABLE_ASSERT_EQUAL(fabsf(simd_reduceSum(va) - sum) < 1e-3f * N, true);
+    else
+      TESTABLE_ASSERT_EQUAL(simd_reduceSum(va), sum);
+
+    TESTABLE_ASSERT_EQUAL(simd_reduceMin(va), min);
+    TESTABLE_ASSERT_EQUAL(simd_reduceMax(va), max);
+  }
+
+epilogue:
+  return result;
+}
+
+template <size_t Count, typename T, size_t N>
+static lsResult simd_TestShift(const T *pValues)
+{
+  lsResult result = lsR_Success;
+
+  T out[N];
+
+  simd_store(out, simd_shift<Count>(simd_load<N>(pValues), simd_load<N>(pValues + N)));
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], pValues[i + Count]);
+
+epilogue:
+  return result;
+}
+
+// Shifts by every count that crosses a native register differently.
+template <typename T, size_t N>
+static lsResult simd_TestShifts()
+{
+  lsResult result = lsR_Success;
+
+  T values[N * 2];
+
+  for (size_t i = 0; i < N * 2; i++)
+    values[i] = (T)(i + 1);
+
+  TESTABLE_ASSERT_SUCCESS((simd_TestShift<0, T, N>(values)));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShift<1, T, N>(values)));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShift<N / 4, T, N>(values)));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShift<N / 2, T, N>(values)));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShift<N / 2 + 1, T, N>(values)));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShift<N - 1, T, N>(values)));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShift<N, T, N>(values)));
+
+epilogue:
+  return result;
+}
+
+template <size_t N>
+static lsResult simd_TestInt32Only()
+{
+  lsResult result = lsR_Success;
+
+  int32_t a[N], b[N], out[N];
+  float outFloat[N];
+
+  for (size_t i = 0; i < N; i++)
+  {
+    a[i] = simd_TestValue<int32_t>(i, 3);
+    b[i] = simd_TestValue<int32_t>(i, 4);
+  }
+
+  const simd<int32_t, N> va = simd_load<N>(a);
+  const simd<int32_t, N> vb = simd_load<N>(b);
+
+  simd_store(out, va ^ vb);
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], a[i] ^ b[i]);
+
+  simd_store(out, simd_mulHi(va, vb));
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL((uint32_t)out[i], (uint32_t)(((uint64_t)(uint32_t)a[i] * (uint32_t)b[i]) >> 32));
+
+  {
+    simd<int32_t, N> hi;
+    const simd<int32_t, N> lo = simd_mulHiLo(va, vb, &hi);
+
+    simd_store(out, lo);
+
+    for (size_t i = 0; i < N; i++)
+      TESTABLE_ASSERT_EQUAL(out[i], simd_TestMul(a[i], b[i]));
+
+    simd_store(out, hi);
+
+    for (size_t i = 0; i < N; i++)
+      TESTABLE_ASSERT_EQUAL((uint32_t)out[i], (uint32_t)(((uint64_t)(uint32_t)a[i] * (uint32_t)b[i]) >> 32));
+  }
+
+  simd_store(out, simd_shiftBitsRight<7>(va));
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL((uint32_t)out[i], (uint32_t)a[i] >> 7);
+
+  simd_store(outFloat, simd_toFloat(va));
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(outFloat[i], (float)a[i]);
+
+epilogue:
+  return result;
+}
+
+template <size_t N>
+static lsResult simd_TestFloatOnly()
+{
+  lsResult result = lsR_Success;
+
+  float a[N], b[N], out[N];
+
+  for (size_t i = 0; i < N; i++)
+  {
+    a[i] = (float)(i * i) + 0.25f;
+    b[i] = (float)i - 3.5f;
+  }
+
+  simd_store(out, simd_load<N>(a) / simd_load<N>(b));
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], a[i] / b[i]);
+
+  simd_store(out, simd_sqrt(simd_load<N>(a)));
+
+  for (size_t i = 0; i < N; i++)
+    TESTABLE_ASSERT_EQUAL(out[i], sqrtf(a[i]));
+
+  // Deinterleaves and interleaves again, rotated by a component.
+  {
+    float interleaved[N * 3];
+    float rotated[N * 3];
+    simd<float, N> x, y, z;
+
+    for (size_t i = 0; i < N * 3; i++)
+      interleaved[i] = (float)i;
+
+    simd_loadInterleaved3(interleaved, &x, &y, &z);
+    simd_store(out, y);
+
+    for (size_t i = 0; i < N; i++)
+      TESTABLE_ASSERT_EQUAL(out[i], interleaved[i * 3 + 1]);
+
+    simd_storeInterleaved3(rotated, y, z, x);
+
+    for (size_t i = 0; i < N; i++)
+      for (size_t j = 0; j < 3; j++)
+        TESTABLE_ASSERT_EQUAL(rotated[i * 3 + j], interleaved[i * 3 + (j + 1) % 3]);
+  }
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(simd_TestUInt16)
+{
+  lsResult result = lsR_Success;
+
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<uint16_t, 8>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<uint16_t, 16>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<uint16_t, 32>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<uint16_t, 8>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<uint16_t, 16>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<uint16_t, 32>()));
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(simd_TestInt32)
+{
+  lsResult result = lsR_Success;
+
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<int32_t, 4>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<int32_t, 8>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<int32_t, 16>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<int32_t, 32>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<int32_t, 4>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<int32_t, 8>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<int32_t, 16>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<int32_t, 32>()));
+  TESTABLE_ASSERT_SUCCESS(simd_TestInt32Only<4>());
+  TESTABLE_ASSERT_SUCCESS(simd_TestInt32Only<32>());
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(simd_TestFloat)
+{
+  lsResult result = lsR_Success;
+
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<float, 4>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<float, 8>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<float, 16>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestLanes<float, 32>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<float, 4>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<float, 8>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<float, 16>()));
+  TESTABLE_ASSERT_SUCCESS((simd_TestShifts<float, 32>()));
+  TESTABLE_ASSERT_SUCCESS(simd_TestFloatOnly<4>());
+  TESTABLE_ASSERT_SUCCESS(simd_TestFloatOnly<32>());
+
+epilogue:
+  return result;
+}
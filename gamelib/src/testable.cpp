@@ -3,25 +3,33 @@
 #include <map>
 
 static std::map<std::string, testable_func> *_pTests;
+static std::map<std::string, testable_func> *_pBenchmarks;
 
-_testable_init register_testable(const char *name, testable_func func)
+static _testable_init register_internal(std::map<std::string, testable_func> **ppMap, const char *name, testable_func func)
 {
-  static bool initialized = false;
+  if (*ppMap == nullptr)
+    *ppMap = new std::map<std::string, testable_func>();
 
-  if (!initialized)
-  {
-    initialized = true;
-    _pTests = new std::map<std::string, testable_func>();
-  }
+  (*ppMap)->insert(std::make_pair(name, func));
+
+  return { (*ppMap)->size() };
+}
 
-  _pTests->insert(std::make_pair(name, func));
+_testable_init register_testable(const char *name, testable_func func)
+{
+  return register_internal(&_pTests, name, func);
+}
 
-  return { _pTests->size() };
+_testable_init register_benchmark(const char *name, testable_func func)
+{
+  return register_internal(&_pBenchmarks, name, func);
 }
 
+template <> void register_testable_files<0>() { }
+
 lsResult run_testables()
 {
-  register_testable_files<10>(); // <-- INCREMENT, when new tests are added.
+  register_testable_files<24>(); // <-- INCREMENT, when new tests are added.
 
   lsResult result = lsR_Success;
 
@@ -86,3 +94,40 @@ lsResult run_testables()
 epilogue:
   return result;
 }
+
+lsResult run_benchmarks()
+{
+  register_testable_files<24>(); // benchmarks live in the same files as the tests.
+
+  lsResult result = lsR_Success;
+
+  lsErrorPushSilentImpl _silent;
+
+  if (_pBenchmarks == nullptr)
+  {
+    print_error_line("No benchmarks discovered.");
+    goto epilogue;
+  }
+
+  print(_pBenchmarks->size(), " benchmarks discovered.\n\n");
+
+  for (const auto &_item : *_pBenchmarks)
+  {
+    lsSetConsoleColor(lsCC_DarkGray, lsCC_Black);
+    print("[RUNNING] ");
+    lsResetConsoleColor();
+    print(_item.first.c_str(), "\n");
+
+    if (LS_FAILED(_item.second()))
+    {
+      result = lsR_Failure;
+      lsSetConsoleColor(lsCC_BrightRed, lsCC_Black);
+      print("[XFAILED] ", _item.first.c_str(), "\n");
+      lsResetConsoleColor();
+    }
+  }
+
+  goto epilogue;
+epilogue:
+  return result;
+}
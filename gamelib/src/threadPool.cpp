@@ -0,0 +1,309 @@
+#include "threadPool.h"
+#include "queue.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//////////////////////////////////////////////////////////////////////////
+
+struct thread_pool_task
+{
+  thread_pool_task_func *pFunc;
+  void *pUserData;
+  thread_pool_group *pGroup;
+  size_t index;
+};
+
+struct thread_pool
+{
+  std::thread *pThreads = nullptr;
+  size_t threadCount = 0;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  queue<thread_pool_task> tasks;
+  bool shutdown = false;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+static void threadPool_execute_internal(const thread_pool_task &task)
+{
+  task.pFunc(task.pUserData, task.index);
+
+  if (task.pGroup != nullptr)
+    task.pGroup->pending.fetch_sub(1, std::memory_order_release);
+}
+
+static bool threadPool_tryExecuteOne_internal(thread_pool *pPool)
+{
+  thread_pool_task task;
+
+  {
+    std::unique_lock<std::mutex> lock(pPool->mutex);
+
+    if (pPool->tasks.count == 0)
+      return false;
+
+    queue_popFront(&pPool->tasks, &task);
+  }
+
+  threadPool_execute_internal(task);
+
+  return true;
+}
+
+static void threadPool_worker_internal(thread_pool *pPool)
+{
+  while (true)
+  {
+    thread_pool_task task;
+
+    {
+      std::unique_lock<std::mutex> lock(pPool->mutex);
+      pPool->condition.wait(lock, [pPool]() { return pPool->shutdown || pPool->tasks.count > 0; });
+
+      if (pPool->tasks.count == 0) // only on shutdown.
+        return;
+
+      queue_popFront(&pPool->tasks, &task);
+    }
+
+    threadPool_execute_internal(task);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult threadPool_create(_Out_ thread_pool **ppPool, const size_t threadCount /* = 0 */)
+{
+  lsResult result = lsR_Success;
+
+  thread_pool *pPool = nullptr;
+
+  LS_ERROR_IF(ppPool == nullptr, lsR_ArgumentNull);
+
+  pPool = new (std::nothrow) thread_pool();
+  LS_ERROR_IF(pPool == nullptr, lsR_MemoryAllocationFailure);
+
+  pPool->threadCount = threadCount != 0 ? threadCount : lsMax(1U, std::thread::hardware_concurrency()) - 1;
+
+  LS_ERROR_CHECK(queue_reserve(&pPool->tasks, 256));
+
+  if (pPool->threadCount > 0)
+  {
+    pPool->pThreads = new (std::nothrow) std::thread[pPool->threadCount];
+    LS_ERROR_IF(pPool->pThreads == nullptr, lsR_MemoryAllocationFailure);
+
+    for (size_t i = 0; i < pPool->threadCount; i++)
+      pPool->pThreads[i] = std::thread(threadPool_worker_internal, pPool);
+  }
+
+  *ppPool = pPool;
+  pPool = nullptr;
+
+epilogue:
+  threadPool_destroy(&pPool);
+  return result;
+}
+
+void threadPool_destroy(thread_pool **ppPool)
+{
+  if (ppPool == nullptr || *ppPool == nullptr)
+    return;
+
+  thread_pool *pPool = *ppPool;
+
+  {
+    std::unique_lock<std::mutex> lock(pPool->mutex);
+    pPool->shutdown = true;
+  }
+
+  pPool->condition.notify_all();
+
+  if (pPool->pThreads != nullptr)
+    for (size_t i = 0; i < pPool->threadCount; i++)
+      if (pPool->pThreads[i].joinable())
+        pPool->pThreads[i].join();
+
+  delete[] pPool->pThreads;
+  queue_destroy(&pPool->tasks);
+  delete pPool;
+
+  *ppPool = nullptr;
+}
+
+thread_pool *threadPool_getDefault()
+{
+  static thread_pool *pDefault = nullptr;
+  static std::once_flag once;
+
+  std::call_once(once, []() { threadPool_create(&pDefault); });
+
+  return pDefault;
+}
+
+size_t threadPool_getWorkerCount(const thread_pool *pPool)
+{
+  return pPool == nullptr ? 0 : pPool->threadCount;
+}
+
+lsResult threadPool_run(thread_pool *pPool, thread_pool_task_func *pFunc, void *pUserData, thread_pool_group *pGroup, const size_t index /* = 0 */)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pPool == nullptr || pFunc == nullptr, lsR_ArgumentNull);
+
+  {
+    thread_pool_task task;
+    task.pFunc = pFunc;
+    task.pUserData = pUserData;
+    task.pGroup = pGroup;
+    task.index = index;
+
+    if (pGroup != nullptr)
+      pGroup->pending.fetch_add(1, std::memory_order_relaxed);
+
+    {
+      std::unique_lock<std::mutex> lock(pPool->mutex);
+      result = queue_pushBack(&pPool->tasks, task);
+    }
+
+    if (LS_FAILED(result))
+    {
+      if (pGroup != nullptr)
+        pGroup->pending.fetch_sub(1, std::memory_order_relaxed);
+
+      LS_ERROR_SET(result);
+    }
+
+    pPool->condition.notify_one();
+  }
+
+epilogue:
+  return result;
+}
+
+void threadPool_wait(thread_pool *pPool, thread_pool_group *pGroup)
+{
+  lsAssert(pPool != nullptr && pGroup != nullptr);
+
+  while (pGroup->pending.load(std::memory_order_acquire) != 0)
+    if (!threadPool_tryExecuteOne_internal(pPool))
+      std::this_thread::yield();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+struct thread_pool_parallel_for
+{
+  std::atomic<size_t> next;
+  size_t count;
+  thread_pool_task_func *pFunc;
+  void *pUserData;
+};
+
+static void threadPool_parallelForTask_internal(void *pUserData, const size_t)
+{
+  thread_pool_parallel_for *pState = reinterpret_cast<thread_pool_parallel_for *>(pUserData);
+
+  for (size_t i = pState->next.fetch_add(1, std::memory_order_relaxed); i < pState->count; i = pState->next.fetch_add(1, std::memory_order_relaxed))
+    pState->pFunc(pState->pUserData, i);
+}
+
+void threadPool_parallelFor(thread_pool *pPool, const size_t count, thread_pool_task_func *pFunc, void *pUserData)
+{
+  const size_t workerCount = threadPool_getWorkerCount(pPool);
+
+  if (workerCount == 0 || count <= 1)
+  {
+    for (size_t i = 0; i < count; i++)
+      pFunc(pUserData, i);
+
+    return;
+  }
+
+  thread_pool_parallel_for state;
+  state.next = 0;
+  state.count = count;
+  state.pFunc = pFunc;
+  state.pUserData = pUserData;
+
+  thread_pool_group group;
+
+  // If a task can't be queued the remaining indices are picked up by the calling thread.
+  for (size_t i = 0; i < lsMin(workerCount, count - 1); i++)
+    if (LS_FAILED(threadPool_run(pPool, threadPool_parallelForTask_internal, &state, &group)))
+      break;
+
+  threadPool_parallelForTask_internal(&state, 0);
+  threadPool_wait(pPool, &group);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(3)
+
+static void threadPool_TestAdd(void *pUserData, const size_t index)
+{
+  reinterpret_cast<std::atomic<size_t> *>(pUserData)->fetch_add(index + 1);
+}
+
+DEFINE_TESTABLE(threadPool_TestParallelFor)
+{
+  lsResult result = lsR_Success;
+
+  thread_pool *pPool = nullptr;
+  std::atomic<size_t> sum = 0;
+  constexpr size_t count = 10000;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 4));
+
+  threadPool_parallelFor(pPool, count, threadPool_TestAdd, &sum);
+  TESTABLE_ASSERT_EQUAL(sum.load(), count * (count + 1) / 2);
+
+  sum = 0;
+  threadPool_parallelFor(pPool, 1, threadPool_TestAdd, &sum);
+  TESTABLE_ASSERT_EQUAL(sum.load(), 1ULL);
+
+epilogue:
+  threadPool_destroy(&pPool);
+  return result;
+}
+
+struct threadPool_TestNested
+{
+  thread_pool *pPool;
+  std::atomic<size_t> sum;
+};
+
+static void threadPool_TestNestedTask(void *pUserData, const size_t)
+{
+  threadPool_TestNested *pTest = reinterpret_cast<threadPool_TestNested *>(pUserData);
+  threadPool_parallelFor(pTest->pPool, 100, threadPool_TestAdd, &pTest->sum);
+}
+
+DEFINE_TESTABLE(threadPool_TestNestedWait)
+{
+  lsResult result = lsR_Success;
+
+  threadPool_TestNested test;
+  test.pPool = nullptr;
+  test.sum = 0;
+
+  thread_pool_group group;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&test.pPool, 2));
+
+  for (size_t i = 0; i < 8; i++)
+    TESTABLE_ASSERT_SUCCESS(threadPool_run(test.pPool, threadPool_TestNestedTask, &test, &group));
+
+  threadPool_wait(test.pPool, &group);
+  TESTABLE_ASSERT_EQUAL(test.sum.load(), 8ULL * (100 * 101 / 2));
+
+epilogue:
+  threadPool_destroy(&test.pPool);
+  return result;
+}
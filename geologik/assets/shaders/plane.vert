@@ -2,7 +2,7 @@
 
 attribute vec2 position;
 
-uniform mat4 matrix;
+attribute mat4 matrix; // per instance.
 
 out vec2 _texCoord;
 
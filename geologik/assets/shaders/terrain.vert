@@ -1,9 +1,18 @@
 #version 430 core
 
 layout(location = 0) in uvec2 position;
+layout(location = 1) in uvec2 offset; // per patch instance.
 
-uniform uvec2 offset;
 uniform uint width;
+uniform uint height;
+
+layout(std140) uniform frameConstants
+{
+  mat4 vp;
+  mat4 vpFar;
+  float ticksSinceOrigin;
+  float frameRatio;
+};
 
 out vec2 _texCoord;
 
@@ -14,18 +23,19 @@ layout(binding = 0, std430) buffer data
 
 void main ()
 {
-  uvec2 pos = position + offset;
+  // Patches at the right and bottom edges overhang the terrain, their extra vertices collapse onto the last column and row.
+  uvec2 pos = min(position + offset, uvec2(width - 1, height - 1));
   uint idx = (pos.y * width + pos.x) * 4;
   
   uint mask = 0XFFFF;
-  uint height = 0; 
+  uint total = 0; 
 
   for (uint i = 0; i < 4; i++)
   {
     uint j = idx + i;
-    height += vals[j] & mask;
-    height += vals[j] >> 16;
+    total += vals[j] & mask;
+    total += vals[j] >> 16;
   }
 
-  gl_Position = vec4(pos, height, 1.0);
+  gl_Position = vp * vec4(pos, total, 1.0);
 }
@@ -0,0 +1,286 @@
+#include "framePipeline.h"
+
+#include "GL/glew.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult framePipeline_create(_Out_ frame_pipeline *pPipeline, const frame_pipeline_backend *pBackend, void *pContext, thread_pool *pPool, const int64_t frameIntervalNs)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pPipeline == nullptr || pBackend == nullptr || pPool == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(frameIntervalNs < 0, lsR_InvalidParameter);
+
+  pPipeline->pBackend = pBackend;
+  pPipeline->pContext = pContext;
+  pPipeline->pPool = pPool;
+  pPipeline->simulation.pending = 0;
+  lsZeroMemory(pPipeline->frameFences, LS_ARRAYSIZE(pPipeline->frameFences));
+  pPipeline->frameIndex = 0;
+  pPipeline->frameIntervalNs = frameIntervalNs;
+  pPipeline->nextFrameStartNs = lsGetCurrentTimeNs();
+
+epilogue:
+  return result;
+}
+
+void framePipeline_destroy(frame_pipeline *pPipeline)
+{
+  if (pPipeline == nullptr || pPipeline->pBackend == nullptr)
+    return;
+
+  threadPool_wait(pPipeline->pPool, &pPipeline->simulation);
+
+  for (size_t i = 0; i < framePipeline_MaxFramesInFlight; i++)
+  {
+    if (pPipeline->frameFences[i] != 0)
+    {
+      pPipeline->pBackend->pDeleteFence(pPipeline->pContext, pPipeline->frameFences[i]);
+      pPipeline->frameFences[i] = 0;
+    }
+  }
+
+  pPipeline->pBackend = nullptr;
+}
+
+lsResult framePipeline_beginFrame(frame_pipeline *pPipeline)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pPipeline == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pPipeline->pBackend == nullptr, lsR_ResourceStateInvalid);
+
+  {
+    uint64_t &fence = pPipeline->frameFences[pPipeline->frameIndex % framePipeline_MaxFramesInFlight];
+
+    if (fence != 0)
+    {
+      LS_ERROR_CHECK(pPipeline->pBackend->pWaitFence(pPipeline->pContext, fence, (uint64_t)-1));
+      pPipeline->pBackend->pDeleteFence(pPipeline->pContext, fence);
+      fence = 0;
+    }
+  }
+
+  // Helps out with the simulation step if it hasn't completed yet.
+  threadPool_wait(pPipeline->pPool, &pPipeline->simulation);
+
+epilogue:
+  return result;
+}
+
+lsResult framePipeline_kickSimulation(frame_pipeline *pPipeline, thread_pool_task_func *pFunc, void *pUserData)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pPipeline == nullptr || pFunc == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pPipeline->simulation.pending.load() != 0, lsR_ResourceBusy); // one step per frame.
+
+  LS_ERROR_CHECK(threadPool_run(pPipeline->pPool, pFunc, pUserData, &pPipeline->simulation, (size_t)pPipeline->frameIndex));
+
+epilogue:
+  return result;
+}
+
+lsResult framePipeline_endFrame(frame_pipeline *pPipeline)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pPipeline == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pPipeline->pBackend == nullptr, lsR_ResourceStateInvalid);
+
+  pPipeline->frameFences[pPipeline->frameIndex % framePipeline_MaxFramesInFlight] = pPipeline->pBackend->pInsertFence(pPipeline->pContext);
+  pPipeline->frameIndex++;
+
+  if (pPipeline->frameIntervalNs > 0)
+  {
+    const int64_t now = lsGetCurrentTimeNs();
+
+    pPipeline->nextFrameStartNs += pPipeline->frameIntervalNs;
+
+    // Don't try to catch up on frames we've missed.
+    if (pPipeline->nextFrameStartNs < now - pPipeline->frameIntervalNs)
+      pPipeline->nextFrameStartNs = now;
+
+    lsSleepUntilNs(pPipeline->nextFrameStartNs);
+  }
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static uint64_t framePipeline_GLInsertFence(void *)
+{
+  return reinterpret_cast<uint64_t>(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+static lsResult framePipeline_GLWaitFence(void *, const uint64_t fence, const uint64_t timeoutNs)
+{
+  lsResult result = lsR_Success;
+
+  switch (glClientWaitSync(reinterpret_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNs))
+  {
+  case GL_ALREADY_SIGNALED:
+  case GL_CONDITION_SATISFIED:
+    break;
+
+  case GL_TIMEOUT_EXPIRED:
+    LS_ERROR_SET(lsR_ResourceBusy);
+
+  default:
+    LS_ERROR_SET(lsR_Failure);
+  }
+
+epilogue:
+  return result;
+}
+
+static void framePipeline_GLDeleteFence(void *, const uint64_t fence)
+{
+  glDeleteSync(reinterpret_cast<GLsync>(fence));
+}
+
+const frame_pipeline_backend framePipeline_GLBackend = { framePipeline_GLInsertFence, framePipeline_GLWaitFence, framePipeline_GLDeleteFence };
+
+//////////////////////////////////////////////////////////////////////////
+
+static uint64_t framePipeline_FakeInsertFence(void *pContext)
+{
+  frame_pipeline_fake_gpu *pGpu = reinterpret_cast<frame_pipeline_fake_gpu *>(pContext);
+
+  return ++pGpu->lastFence;
+}
+
+static lsResult framePipeline_FakeWaitFence(void *pContext, const uint64_t fence, const uint64_t timeoutNs)
+{
+  lsResult result = lsR_Success;
+
+  frame_pipeline_fake_gpu *pGpu = reinterpret_cast<frame_pipeline_fake_gpu *>(pContext);
+
+  if (fence <= pGpu->completedFence)
+    goto epilogue;
+
+  LS_ERROR_IF(timeoutNs == 0, lsR_ResourceBusy);
+
+  pGpu->stallCount++;
+  pGpu->completedFence = pGpu->lastFence;
+
+epilogue:
+  return result;
+}
+
+static void framePipeline_FakeDeleteFence(void *, const uint64_t)
+{
+}
+
+const frame_pipeline_backend framePipeline_FakeBackend = { framePipeline_FakeInsertFence, framePipeline_FakeWaitFence, framePipeline_FakeDeleteFence };
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(4)
+
+DEFINE_TESTABLE(framePipeline_TestNoStallWhileGpuKeepsUp)
+{
+  lsResult result = lsR_Success;
+
+  frame_pipeline_fake_gpu gpu = {};
+  frame_pipeline pipeline;
+  thread_pool *pPool = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 1));
+  TESTABLE_ASSERT_SUCCESS(framePipeline_create(&pipeline, &framePipeline_FakeBackend, &gpu, pPool, 0));
+
+  for (size_t i = 0; i < 16; i++)
+  {
+    TESTABLE_ASSERT_SUCCESS(framePipeline_beginFrame(&pipeline));
+    TESTABLE_ASSERT_SUCCESS(framePipeline_endFrame(&pipeline));
+
+    gpu.completedFence = gpu.lastFence - 1; // the gpu is one frame behind.
+  }
+
+  TESTABLE_ASSERT_EQUAL(gpu.stallCount, 0ULL);
+
+epilogue:
+  framePipeline_destroy(&pipeline);
+  threadPool_destroy(&pPool);
+  return result;
+}
+
+DEFINE_TESTABLE(framePipeline_TestStallsOnceFramesInFlightAreExhausted)
+{
+  lsResult result = lsR_Success;
+
+  frame_pipeline_fake_gpu gpu = {};
+  frame_pipeline pipeline;
+  thread_pool *pPool = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 1));
+  TESTABLE_ASSERT_SUCCESS(framePipeline_create(&pipeline, &framePipeline_FakeBackend, &gpu, pPool, 0));
+
+  for (size_t i = 0; i < framePipeline_MaxFramesInFlight; i++)
+  {
+    TESTABLE_ASSERT_SUCCESS(framePipeline_beginFrame(&pipeline));
+    TESTABLE_ASSERT_SUCCESS(framePipeline_endFrame(&pipeline));
+  }
+
+  TESTABLE_ASSERT_EQUAL(gpu.stallCount, 0ULL);
+  TESTABLE_ASSERT_EQUAL(gpu.completedFence, 0ULL);
+
+  // the gpu hasn't completed anything, so the next frame has to wait for the first one.
+  TESTABLE_ASSERT_SUCCESS(framePipeline_beginFrame(&pipeline));
+  TESTABLE_ASSERT_EQUAL(gpu.stallCount, 1ULL);
+
+epilogue:
+  framePipeline_destroy(&pipeline);
+  threadPool_destroy(&pPool);
+  return result;
+}
+
+struct framePipeline_TestSimulation
+{
+  std::atomic<size_t> steps;
+  uint64_t lastFrameIndex;
+};
+
+static void framePipeline_TestSimulationStep(void *pUserData, const size_t frameIndex)
+{
+  framePipeline_TestSimulation *pSimulation = reinterpret_cast<framePipeline_TestSimulation *>(pUserData);
+
+  pSimulation->lastFrameIndex = frameIndex;
+  pSimulation->steps++;
+}
+
+DEFINE_TESTABLE(framePipeline_TestSimulationIsJoinedByNextFrame)
+{
+  lsResult result = lsR_Success;
+
+  frame_pipeline_fake_gpu gpu = {};
+  frame_pipeline pipeline;
+  thread_pool *pPool = nullptr;
+  framePipeline_TestSimulation simulation;
+  simulation.steps = 0;
+  simulation.lastFrameIndex = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(framePipeline_create(&pipeline, &framePipeline_FakeBackend, &gpu, pPool, 0));
+
+  for (size_t i = 0; i < 8; i++)
+  {
+    TESTABLE_ASSERT_SUCCESS(framePipeline_beginFrame(&pipeline));
+    TESTABLE_ASSERT_EQUAL(simulation.steps.load(), i); // the step of the previous frame has completed.
+
+    TESTABLE_ASSERT_SUCCESS(framePipeline_kickSimulation(&pipeline, framePipeline_TestSimulationStep, &simulation));
+    TESTABLE_ASSERT_SUCCESS(framePipeline_endFrame(&pipeline));
+  }
+
+  TESTABLE_ASSERT_SUCCESS(framePipeline_beginFrame(&pipeline));
+  TESTABLE_ASSERT_EQUAL(simulation.steps.load(), 8ULL);
+  TESTABLE_ASSERT_EQUAL(simulation.lastFrameIndex, 7ULL);
+
+epilogue:
+  framePipeline_destroy(&pipeline);
+  threadPool_destroy(&pPool);
+  return result;
+}
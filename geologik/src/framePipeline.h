@@ -0,0 +1,62 @@
+#pragma once
+
+#include "core.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Lets the CPU run up to `framePipeline_MaxFramesInFlight` frames ahead of the GPU and the simulation step for the next frame run on
+// worker threads while the current frame renders. Frames are synchronized with fences instead of waiting for the GPU to finish.
+
+constexpr size_t framePipeline_MaxFramesInFlight = 2;
+
+struct frame_pipeline_backend
+{
+  typedef uint64_t(InsertFence)(void *pContext); // signaled once all previously submitted GPU work has completed. never 0.
+  typedef lsResult(WaitFence)(void *pContext, const uint64_t fence, const uint64_t timeoutNs); // returns `lsR_ResourceBusy` if the fence wasn't signaled within `timeoutNs`.
+  typedef void (DeleteFence)(void *pContext, const uint64_t fence);
+
+  InsertFence *pInsertFence;
+  WaitFence *pWaitFence;
+  DeleteFence *pDeleteFence;
+};
+
+extern const frame_pipeline_backend framePipeline_GLBackend;
+
+// Stand-in for the GPU. fences complete once `completedFence` is set past them or on a blocking wait, which counts as a stall.
+struct frame_pipeline_fake_gpu
+{
+  uint64_t lastFence;
+  uint64_t completedFence;
+  size_t stallCount;
+};
+
+extern const frame_pipeline_backend framePipeline_FakeBackend; // `pContext` is a `frame_pipeline_fake_gpu *`.
+
+struct frame_pipeline
+{
+  const frame_pipeline_backend *pBackend = nullptr;
+  void *pContext = nullptr;
+  thread_pool *pPool = nullptr;
+
+  thread_pool_group simulation;
+  uint64_t frameFences[framePipeline_MaxFramesInFlight] = {}; // 0 if not in flight.
+  uint64_t frameIndex = 0;
+
+  int64_t frameIntervalNs = 0; // 0 to not pace frames.
+  int64_t nextFrameStartNs = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult framePipeline_create(_Out_ frame_pipeline *pPipeline, const frame_pipeline_backend *pBackend, void *pContext, thread_pool *pPool, const int64_t frameIntervalNs);
+void framePipeline_destroy(frame_pipeline *pPipeline);
+
+// Waits until the GPU has finished the frame that last used this frame's slot and the simulation step kicked off last frame has completed.
+lsResult framePipeline_beginFrame(frame_pipeline *pPipeline);
+
+// Runs `pFunc(pUserData, frameIndex)` on a worker. Kick off once this frame no longer reads the simulation state it modifies.
+lsResult framePipeline_kickSimulation(frame_pipeline *pPipeline, thread_pool_task_func *pFunc, void *pUserData);
+
+// Fences the GPU work of this frame and sleeps until the next frame is due.
+lsResult framePipeline_endFrame(frame_pipeline *pPipeline);
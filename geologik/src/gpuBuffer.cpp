@@ -43,9 +43,6 @@ lsResult gpuBuffer_set(gpu_buffer *pBuffer, const uint8_t *pData /*nullptr valid
   pBuffer->uploaded = true;
 
 epilogue:
-  if (pData != nullptr)
-    lsFreePtr(&pData);
-
   return result;
 }
 
@@ -78,7 +75,7 @@ epilogue:
   return result;
 }
 
-// TODO update data func for cases when buffer access type allows updating data
+// Use a `gpu_buffer_stream` (gpuBufferStream.h) to update or read back parts of the buffer every frame.
 
 lsResult gpuBuffer_bind(const gpu_buffer *pBuffer)
 {
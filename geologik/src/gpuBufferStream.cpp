@@ -0,0 +1,598 @@
+#include "gpuBufferStream.h"
+#include "gpuBuffer.h"
+
+#include "GL/glew.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+static lsResult gpuBufferStream_addCopy_internal(gpu_buffer_stream *pStream, const gpu_buffer_stream_copy &copy)
+{
+  lsResult result = lsR_Success;
+
+  // Merge with the previous copy if both sides are contiguous.
+  if (pStream->copyCount > 0)
+  {
+    gpu_buffer_stream_copy &last = pStream->pCopies[pStream->copyCount - 1];
+
+    if (last.direction == copy.direction && last.ringOffset + last.size == copy.ringOffset && last.targetOffset + last.size == copy.targetOffset)
+    {
+      last.size += copy.size;
+      goto epilogue;
+    }
+  }
+
+  if (pStream->copyCount == pStream->copyCapacity)
+  {
+    const size_t newCapacity = lsMax((size_t)64, pStream->copyCapacity * 2);
+    LS_ERROR_CHECK(lsRealloc(&pStream->pCopies, newCapacity));
+    pStream->copyCapacity = newCapacity;
+  }
+
+  pStream->pCopies[pStream->copyCount] = copy;
+  pStream->copyCount++;
+
+epilogue:
+  return result;
+}
+
+static lsResult gpuBufferStream_waitSection_internal(gpu_buffer_stream *pStream, const size_t section, const bool block)
+{
+  lsResult result = lsR_Success;
+
+  const uint64_t fence = pStream->sectionFences[section];
+
+  if (fence == 0)
+    goto epilogue;
+
+  LS_ERROR_CHECK(pStream->pBackend->pWaitFence(pStream->pContext, fence, block ? (uint64_t)-1 : 0));
+
+  pStream->pBackend->pDeleteFence(pStream->pContext, fence);
+  pStream->sectionFences[section] = 0;
+
+epilogue:
+  return result;
+}
+
+static lsResult gpuBufferStream_allocate_internal(gpu_buffer_stream *pStream, const size_t size, const size_t alignment, _Out_ size_t *pRingOffset)
+{
+  lsResult result = lsR_Success;
+
+  const size_t offset = (pStream->sectionUsed + alignment - 1) & ~(alignment - 1);
+
+  LS_ERROR_IF(offset + size > pStream->sectionSize, lsR_ResourceFull);
+
+  pStream->sectionUsed = offset + size;
+  *pRingOffset = (pStream->frameIndex % gpuBufferStream_SectionCount) * pStream->sectionSize + offset;
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult gpuBufferStream_create(_Out_ gpu_buffer_stream *pStream, const gpu_buffer_stream_backend *pBackend, void *pTarget, const size_t targetSize, const size_t sectionSize)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pStream == nullptr || pBackend == nullptr || pTarget == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(sectionSize == 0 || (sectionSize % gpuBufferStream_Alignment) != 0, lsR_InvalidParameter);
+
+  lsZeroMemory(pStream);
+
+  pStream->pBackend = pBackend;
+  pStream->sectionSize = sectionSize;
+  pStream->targetSize = targetSize;
+
+  LS_ERROR_CHECK(pBackend->pCreate(&pStream->pContext, pTarget, targetSize, sectionSize * gpuBufferStream_SectionCount, &pStream->pRing));
+
+epilogue:
+  return result;
+}
+
+void gpuBufferStream_destroy(gpu_buffer_stream *pStream)
+{
+  if (pStream == nullptr || pStream->pBackend == nullptr)
+    return;
+
+  for (size_t i = 0; i < gpuBufferStream_SectionCount; i++)
+  {
+    if (pStream->sectionFences[i] != 0)
+    {
+      pStream->pBackend->pDeleteFence(pStream->pContext, pStream->sectionFences[i]);
+      pStream->sectionFences[i] = 0;
+    }
+  }
+
+  pStream->pBackend->pDestroy(&pStream->pContext);
+  pStream->pBackend = nullptr;
+  pStream->pRing = nullptr;
+
+  lsFreePtr(&pStream->pCopies);
+  pStream->copyCount = pStream->copyCapacity = 0;
+}
+
+lsResult gpuBufferStream_beginFrame(gpu_buffer_stream *pStream, const bool block /* = true */)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pStream == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pStream->pBackend == nullptr || pStream->inFrame, lsR_ResourceStateInvalid);
+
+  LS_ERROR_CHECK(gpuBufferStream_waitSection_internal(pStream, pStream->frameIndex % gpuBufferStream_SectionCount, block));
+
+  pStream->sectionUsed = 0;
+  pStream->copyCount = 0;
+  pStream->inFrame = true;
+
+epilogue:
+  return result;
+}
+
+lsResult gpuBufferStream_upload(gpu_buffer_stream *pStream, const size_t targetOffset, const void *pData, const size_t size)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pStream == nullptr || pData == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(!pStream->inFrame, lsR_ResourceStateInvalid);
+  LS_ERROR_IF(targetOffset + size > pStream->targetSize, lsR_ArgumentOutOfBounds);
+
+  if (size == 0)
+    goto epilogue;
+
+  {
+    gpu_buffer_stream_copy copy;
+    copy.direction = gbscd_ringToTarget;
+    copy.targetOffset = targetOffset;
+    copy.size = size;
+
+    const size_t previouslyUsed = pStream->sectionUsed;
+    LS_ERROR_CHECK(gpuBufferStream_allocate_internal(pStream, size, 1, &copy.ringOffset)); // unaligned, so consecutive uploads can be merged into a single copy.
+
+    if (LS_FAILED(gpuBufferStream_addCopy_internal(pStream, copy)))
+    {
+      pStream->sectionUsed = previouslyUsed;
+      LS_ERROR_SET(lsR_MemoryAllocationFailure);
+    }
+
+    memcpy(pStream->pRing + copy.ringOffset, pData, size);
+  }
+
+epilogue:
+  return result;
+}
+
+lsResult gpuBufferStream_requestReadback(gpu_buffer_stream *pStream, const size_t targetOffset, const size_t size, _Out_ gpu_buffer_stream_readback *pReadback)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pStream == nullptr || pReadback == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(!pStream->inFrame, lsR_ResourceStateInvalid);
+  LS_ERROR_IF(targetOffset + size > pStream->targetSize, lsR_ArgumentOutOfBounds);
+
+  {
+    gpu_buffer_stream_copy copy;
+    copy.direction = gbscd_targetToRing;
+    copy.targetOffset = targetOffset;
+    copy.size = size;
+
+    const size_t previouslyUsed = pStream->sectionUsed;
+    LS_ERROR_CHECK(gpuBufferStream_allocate_internal(pStream, size, gpuBufferStream_Alignment, &copy.ringOffset));
+
+    if (LS_FAILED(gpuBufferStream_addCopy_internal(pStream, copy)))
+    {
+      pStream->sectionUsed = previouslyUsed;
+      LS_ERROR_SET(lsR_MemoryAllocationFailure);
+    }
+
+    pReadback->frameIndex = pStream->frameIndex;
+    pReadback->ringOffset = copy.ringOffset;
+    pReadback->size = size;
+  }
+
+epilogue:
+  return result;
+}
+
+lsResult gpuBufferStream_endFrame(gpu_buffer_stream *pStream)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pStream == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(!pStream->inFrame, lsR_ResourceStateInvalid);
+
+  if (pStream->copyCount > 0)
+  {
+    pStream->pBackend->pSubmit(pStream->pContext, pStream->pCopies, pStream->copyCount);
+    pStream->sectionFences[pStream->frameIndex % gpuBufferStream_SectionCount] = pStream->pBackend->pInsertFence(pStream->pContext);
+  }
+
+  pStream->copyCount = 0;
+  pStream->frameIndex++;
+  pStream->inFrame = false;
+
+epilogue:
+  return result;
+}
+
+lsResult gpuBufferStream_getReadback(gpu_buffer_stream *pStream, const gpu_buffer_stream_readback &readback, _Out_ const uint8_t **ppData, const bool block /* = true */)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pStream == nullptr || ppData == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(readback.frameIndex >= pStream->frameIndex, lsR_ResourceStateInvalid); // not submitted yet.
+  LS_ERROR_IF(pStream->frameIndex - readback.frameIndex > gpuBufferStream_SectionCount - (pStream->inFrame ? 1 : 0), lsR_ResourceInvalid); // section has been reused since.
+
+  LS_ERROR_CHECK(gpuBufferStream_waitSection_internal(pStream, readback.frameIndex % gpuBufferStream_SectionCount, block));
+
+  *ppData = pStream->pRing + readback.ringOffset;
+
+epilogue:
+  return result;
+}
+
+lsResult gpuBufferStream_finish(gpu_buffer_stream *pStream)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pStream == nullptr, lsR_ArgumentNull);
+
+  for (size_t i = 0; i < gpuBufferStream_SectionCount; i++)
+    LS_ERROR_CHECK(gpuBufferStream_waitSection_internal(pStream, i, true));
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+struct gpu_buffer_stream_gl_context
+{
+  GLuint ringBufferId;
+  GLuint targetBufferId;
+};
+
+static lsResult gpuBufferStream_GLCreate(_Out_ void **ppContext, void *pTarget, const size_t targetSize, const size_t ringSize, _Out_ uint8_t **ppRing)
+{
+  lsResult result = lsR_Success;
+
+  const gpu_buffer *pTargetBuffer = reinterpret_cast<const gpu_buffer *>(pTarget);
+  gpu_buffer_stream_gl_context *pContext = nullptr;
+  constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+  LS_ERROR_IF(!pTargetBuffer->bufferId || !pTargetBuffer->uploaded, lsR_ResourceStateInvalid);
+  LS_ERROR_IF(targetSize > pTargetBuffer->size, lsR_ArgumentOutOfBounds);
+
+  LS_ERROR_CHECK(lsAllocZero(&pContext));
+  pContext->targetBufferId = pTargetBuffer->bufferId;
+
+  glCreateBuffers(1, &pContext->ringBufferId);
+  LS_ERROR_IF(pContext->ringBufferId == 0, lsR_ResourceInvalid);
+
+  glNamedBufferStorage(pContext->ringBufferId, ringSize, nullptr, flags);
+  *ppRing = reinterpret_cast<uint8_t *>(glMapNamedBufferRange(pContext->ringBufferId, 0, ringSize, flags));
+  LS_ERROR_IF(*ppRing == nullptr, lsR_ResourceInvalid);
+
+  *ppContext = pContext;
+  pContext = nullptr;
+
+epilogue:
+  if (pContext != nullptr)
+  {
+    if (pContext->ringBufferId != 0)
+      glDeleteBuffers(1, &pContext->ringBufferId);
+
+    lsFreePtr(&pContext);
+  }
+
+  return result;
+}
+
+static void gpuBufferStream_GLDestroy(void **ppContext)
+{
+  gpu_buffer_stream_gl_context *pContext = reinterpret_cast<gpu_buffer_stream_gl_context *>(*ppContext);
+
+  if (pContext == nullptr)
+    return;
+
+  glUnmapNamedBuffer(pContext->ringBufferId);
+  glDeleteBuffers(1, &pContext->ringBufferId);
+
+  lsFreePtr(&pContext);
+  *ppContext = nullptr;
+}
+
+static void gpuBufferStream_GLSubmit(void *pContext, const gpu_buffer_stream_copy *pCopies, const size_t count)
+{
+  const gpu_buffer_stream_gl_context *pGL = reinterpret_cast<const gpu_buffer_stream_gl_context *>(pContext);
+  bool barrierIssued = false;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    const gpu_buffer_stream_copy &copy = pCopies[i];
+
+    if (copy.direction == gbscd_ringToTarget)
+    {
+      glCopyNamedBufferSubData(pGL->ringBufferId, pGL->targetBufferId, copy.ringOffset, copy.targetOffset, copy.size);
+    }
+    else
+    {
+      if (!barrierIssued)
+      {
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT); // shader writes to the target have to be visible to the copy.
+        barrierIssued = true;
+      }
+
+      glCopyNamedBufferSubData(pGL->targetBufferId, pGL->ringBufferId, copy.targetOffset, copy.ringOffset, copy.size);
+    }
+  }
+}
+
+static uint64_t gpuBufferStream_GLInsertFence(void *)
+{
+  return reinterpret_cast<uint64_t>(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+static lsResult gpuBufferStream_GLWaitFence(void *, const uint64_t fence, const uint64_t timeoutNs)
+{
+  lsResult result = lsR_Success;
+
+  switch (glClientWaitSync(reinterpret_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNs))
+  {
+  case GL_ALREADY_SIGNALED:
+  case GL_CONDITION_SATISFIED:
+    break;
+
+  case GL_TIMEOUT_EXPIRED:
+    LS_ERROR_SET(lsR_ResourceBusy);
+
+  default:
+    LS_ERROR_SET(lsR_Failure);
+  }
+
+epilogue:
+  return result;
+}
+
+static void gpuBufferStream_GLDeleteFence(void *, const uint64_t fence)
+{
+  glDeleteSync(reinterpret_cast<GLsync>(fence));
+}
+
+const gpu_buffer_stream_backend gpuBufferStream_GLBackend = { gpuBufferStream_GLCreate, gpuBufferStream_GLDestroy, gpuBufferStream_GLSubmit, gpuBufferStream_GLInsertFence, gpuBufferStream_GLWaitFence, gpuBufferStream_GLDeleteFence };
+
+//////////////////////////////////////////////////////////////////////////
+
+struct gpu_buffer_stream_cpu_pending_copy
+{
+  gpu_buffer_stream_copy copy;
+  uint64_t fence; // the fence that completes it.
+};
+
+struct gpu_buffer_stream_cpu_context
+{
+  uint8_t *pRing;
+  uint8_t *pTarget;
+  uint64_t lastFence, completedFence;
+
+  gpu_buffer_stream_cpu_pending_copy *pPending; // copies only execute once their fence completes, like they would on a GPU that's lagging behind.
+  size_t pendingCount, pendingCapacity;
+};
+
+static lsResult gpuBufferStream_CpuCreate(_Out_ void **ppContext, void *pTarget, const size_t /* targetSize */, const size_t ringSize, _Out_ uint8_t **ppRing)
+{
+  lsResult result = lsR_Success;
+
+  gpu_buffer_stream_cpu_context *pContext = nullptr;
+
+  LS_ERROR_CHECK(lsAllocZero(&pContext));
+  LS_ERROR_CHECK(lsAllocZero(&pContext->pRing, ringSize));
+
+  pContext->pTarget = reinterpret_cast<uint8_t *>(pTarget);
+
+  *ppRing = pContext->pRing;
+  *ppContext = pContext;
+  pContext = nullptr;
+
+epilogue:
+  if (pContext != nullptr)
+  {
+    lsFreePtr(&pContext->pRing);
+    lsFreePtr(&pContext);
+  }
+
+  return result;
+}
+
+static void gpuBufferStream_CpuDestroy(void **ppContext)
+{
+  gpu_buffer_stream_cpu_context *pContext = reinterpret_cast<gpu_buffer_stream_cpu_context *>(*ppContext);
+
+  if (pContext == nullptr)
+    return;
+
+  lsFreePtr(&pContext->pRing);
+  lsFreePtr(&pContext->pPending);
+  lsFreePtr(&pContext);
+  *ppContext = nullptr;
+}
+
+static void gpuBufferStream_CpuSubmit(void *pContext, const gpu_buffer_stream_copy *pCopies, const size_t count)
+{
+  gpu_buffer_stream_cpu_context *pCpu = reinterpret_cast<gpu_buffer_stream_cpu_context *>(pContext);
+
+  if (pCpu->pendingCount + count > pCpu->pendingCapacity)
+  {
+    const size_t newCapacity = lsMax(pCpu->pendingCount + count, pCpu->pendingCapacity * 2);
+
+    if (LS_FAILED(lsRealloc(&pCpu->pPending, newCapacity)))
+    {
+      pCpu->pendingCount = pCpu->pendingCapacity = 0;
+      return;
+    }
+
+    pCpu->pendingCapacity = newCapacity;
+  }
+
+  for (size_t i = 0; i < count; i++)
+  {
+    pCpu->pPending[pCpu->pendingCount].copy = pCopies[i];
+    pCpu->pPending[pCpu->pendingCount].fence = pCpu->lastFence + 1;
+    pCpu->pendingCount++;
+  }
+}
+
+static uint64_t gpuBufferStream_CpuInsertFence(void *pContext)
+{
+  gpu_buffer_stream_cpu_context *pCpu = reinterpret_cast<gpu_buffer_stream_cpu_context *>(pContext);
+
+  return ++pCpu->lastFence;
+}
+
+static lsResult gpuBufferStream_CpuWaitFence(void *pContext, const uint64_t fence, const uint64_t timeoutNs)
+{
+  lsResult result = lsR_Success;
+
+  gpu_buffer_stream_cpu_context *pCpu = reinterpret_cast<gpu_buffer_stream_cpu_context *>(pContext);
+
+  if (fence <= pCpu->completedFence)
+    goto epilogue;
+
+  LS_ERROR_IF(timeoutNs == 0, lsR_ResourceBusy);
+
+  // Blocking waits complete everything that has been submitted so far.
+  for (size_t i = 0; i < pCpu->pendingCount; i++)
+  {
+    const gpu_buffer_stream_copy &copy = pCpu->pPending[i].copy;
+
+    if (copy.direction == gbscd_ringToTarget)
+      memcpy(pCpu->pTarget + copy.targetOffset, pCpu->pRing + copy.ringOffset, copy.size);
+    else
+      memcpy(pCpu->pRing + copy.ringOffset, pCpu->pTarget + copy.targetOffset, copy.size);
+  }
+
+  pCpu->pendingCount = 0;
+  pCpu->completedFence = pCpu->lastFence;
+
+epilogue:
+  return result;
+}
+
+static void gpuBufferStream_CpuDeleteFence(void *, const uint64_t)
+{
+}
+
+const gpu_buffer_stream_backend gpuBufferStream_CpuBackend = { gpuBufferStream_CpuCreate, gpuBufferStream_CpuDestroy, gpuBufferStream_CpuSubmit, gpuBufferStream_CpuInsertFence, gpuBufferStream_CpuWaitFence, gpuBufferStream_CpuDeleteFence };
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(2)
+
+DEFINE_TESTABLE(gpuBufferStream_TestUploadReachesTarget)
+{
+  lsResult result = lsR_Success;
+
+  gpu_buffer_stream stream;
+  uint8_t target[256] = {};
+  uint8_t data[100];
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(data); i++)
+    data[i] = (uint8_t)(i + 1);
+
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_create(&stream, &gpuBufferStream_CpuBackend, target, sizeof(target), 128));
+
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_beginFrame(&stream));
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_upload(&stream, 10, data, 50));
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_upload(&stream, 60, data + 50, 50));
+  TESTABLE_ASSERT_EQUAL(stream.copyCount, 1ULL); // the second upload is contiguous with the first one.
+  TESTABLE_ASSERT_FAILURE(gpuBufferStream_upload(&stream, 0, data, 100)); // section is full.
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_endFrame(&stream));
+
+  TESTABLE_ASSERT_EQUAL(target[10], 0); // not yet completed.
+
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_finish(&stream));
+
+  TESTABLE_ASSERT_EQUAL(target[9], 0);
+  TESTABLE_ASSERT_EQUAL(memcmp(target + 10, data, sizeof(data)), 0);
+  TESTABLE_ASSERT_EQUAL(target[110], 0);
+
+epilogue:
+  gpuBufferStream_destroy(&stream);
+  return result;
+}
+
+DEFINE_TESTABLE(gpuBufferStream_TestSectionReuseWaitsForFence)
+{
+  lsResult result = lsR_Success;
+
+  gpu_buffer_stream stream;
+  uint8_t target[gpuBufferStream_SectionCount + 1] = {};
+
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_create(&stream, &gpuBufferStream_CpuBackend, target, sizeof(target), 16));
+
+  for (uint8_t i = 0; i < gpuBufferStream_SectionCount; i++)
+  {
+    const uint8_t value = (uint8_t)(i + 1);
+
+    TESTABLE_ASSERT_SUCCESS(gpuBufferStream_beginFrame(&stream, false));
+    TESTABLE_ASSERT_SUCCESS(gpuBufferStream_upload(&stream, i, &value, 1));
+    TESTABLE_ASSERT_SUCCESS(gpuBufferStream_endFrame(&stream));
+  }
+
+  // all sections are in flight.
+  TESTABLE_ASSERT_EQUAL(gpuBufferStream_beginFrame(&stream, false), lsR_ResourceBusy);
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_beginFrame(&stream, true));
+
+  for (uint8_t i = 0; i < gpuBufferStream_SectionCount; i++)
+    TESTABLE_ASSERT_EQUAL(target[i], i + 1);
+
+  {
+    const uint8_t value = 0xFF;
+    TESTABLE_ASSERT_SUCCESS(gpuBufferStream_upload(&stream, gpuBufferStream_SectionCount, &value, 1));
+    TESTABLE_ASSERT_SUCCESS(gpuBufferStream_endFrame(&stream));
+    TESTABLE_ASSERT_SUCCESS(gpuBufferStream_finish(&stream));
+  }
+
+  TESTABLE_ASSERT_EQUAL(target[0], 1); // the reused section didn't overwrite earlier uploads.
+  TESTABLE_ASSERT_EQUAL(target[gpuBufferStream_SectionCount], 0xFF);
+
+epilogue:
+  gpuBufferStream_destroy(&stream);
+  return result;
+}
+
+DEFINE_TESTABLE(gpuBufferStream_TestReadback)
+{
+  lsResult result = lsR_Success;
+
+  gpu_buffer_stream stream;
+  uint8_t target[64];
+  gpu_buffer_stream_readback readback;
+  const uint8_t *pData = nullptr;
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(target); i++)
+    target[i] = (uint8_t)(i * 3);
+
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_create(&stream, &gpuBufferStream_CpuBackend, target, sizeof(target), 64));
+
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_beginFrame(&stream));
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_requestReadback(&stream, 8, 32, &readback));
+  TESTABLE_ASSERT_FAILURE(gpuBufferStream_getReadback(&stream, readback, &pData)); // not submitted.
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_endFrame(&stream));
+
+  TESTABLE_ASSERT_EQUAL(gpuBufferStream_getReadback(&stream, readback, &pData, false), lsR_ResourceBusy);
+  TESTABLE_ASSERT_SUCCESS(gpuBufferStream_getReadback(&stream, readback, &pData, true));
+  TESTABLE_ASSERT_EQUAL(memcmp(pData, target + 8, 32), 0);
+
+  for (size_t i = 0; i < gpuBufferStream_SectionCount; i++)
+  {
+    TESTABLE_ASSERT_SUCCESS(gpuBufferStream_beginFrame(&stream));
+    TESTABLE_ASSERT_SUCCESS(gpuBufferStream_endFrame(&stream));
+  }
+
+  TESTABLE_ASSERT_EQUAL(gpuBufferStream_getReadback(&stream, readback, &pData), lsR_ResourceInvalid); // section has been reused.
+
+epilogue:
+  gpuBufferStream_destroy(&stream);
+  return result;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "core.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Streams uploads into & readbacks out of a target buffer through a persistently mapped ring of `gpuBufferStream_SectionCount` sections.
+// Every frame writes into its own section, which is only reused once the fence of the frame that last used it has been signaled.
+
+constexpr size_t gpuBufferStream_SectionCount = 3;
+constexpr size_t gpuBufferStream_Alignment = 16;
+
+enum gpu_buffer_stream_copy_direction
+{
+  gbscd_ringToTarget,
+  gbscd_targetToRing,
+};
+
+struct gpu_buffer_stream_copy
+{
+  size_t ringOffset;
+  size_t targetOffset;
+  size_t size;
+  gpu_buffer_stream_copy_direction direction;
+};
+
+// The fencing & copying the stream relies on. `gpuBufferStream_GLBackend` for the real thing, `gpuBufferStream_CpuBackend` to run without a GPU.
+struct gpu_buffer_stream_backend
+{
+  typedef lsResult(Create)(_Out_ void **ppContext, void *pTarget, const size_t targetSize, const size_t ringSize, _Out_ uint8_t **ppRing);
+  typedef void (Destroy)(void **ppContext);
+  typedef void (Submit)(void *pContext, const gpu_buffer_stream_copy *pCopies, const size_t count); // executed in order, after all previously submitted work.
+  typedef uint64_t(InsertFence)(void *pContext); // signaled once all previously submitted work has completed. never 0.
+  typedef lsResult(WaitFence)(void *pContext, const uint64_t fence, const uint64_t timeoutNs); // returns `lsR_ResourceBusy` if the fence wasn't signaled within `timeoutNs`.
+  typedef void (DeleteFence)(void *pContext, const uint64_t fence);
+
+  Create *pCreate;
+  Destroy *pDestroy;
+  Submit *pSubmit;
+  InsertFence *pInsertFence;
+  WaitFence *pWaitFence;
+  DeleteFence *pDeleteFence;
+};
+
+extern const gpu_buffer_stream_backend gpuBufferStream_GLBackend; // `pTarget` is a `gpu_buffer *`.
+extern const gpu_buffer_stream_backend gpuBufferStream_CpuBackend; // `pTarget` is a `uint8_t *` of `targetSize` bytes. fences only complete on blocking waits.
+
+struct gpu_buffer_stream_readback
+{
+  uint64_t frameIndex;
+  size_t ringOffset;
+  size_t size;
+};
+
+struct gpu_buffer_stream
+{
+  const gpu_buffer_stream_backend *pBackend = nullptr;
+  void *pContext = nullptr;
+
+  uint8_t *pRing = nullptr; // `gpuBufferStream_SectionCount` * `sectionSize` bytes, persistently mapped.
+  size_t sectionSize;
+  size_t targetSize;
+
+  uint64_t frameIndex; // the section of a frame is `frameIndex % gpuBufferStream_SectionCount`.
+  uint64_t sectionFences[gpuBufferStream_SectionCount]; // 0 if the section isn't in flight.
+  size_t sectionUsed; // in bytes.
+  bool inFrame;
+
+  gpu_buffer_stream_copy *pCopies = nullptr; // recorded for the current frame.
+  size_t copyCount, copyCapacity;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult gpuBufferStream_create(_Out_ gpu_buffer_stream *pStream, const gpu_buffer_stream_backend *pBackend, void *pTarget, const size_t targetSize, const size_t sectionSize);
+void gpuBufferStream_destroy(gpu_buffer_stream *pStream);
+
+// Waits until the section of this frame is no longer in use. Returns `lsR_ResourceBusy` if `block` is false and it still is.
+lsResult gpuBufferStream_beginFrame(gpu_buffer_stream *pStream, const bool block = true);
+
+// Copies `pData` into the ring. Returns `lsR_ResourceFull` if the section of this frame has no space left; retry next frame.
+lsResult gpuBufferStream_upload(gpu_buffer_stream *pStream, const size_t targetOffset, const void *pData, const size_t size);
+
+// The data is available through `gpuBufferStream_getReadback` once the frame has completed and until its section is reused.
+lsResult gpuBufferStream_requestReadback(gpu_buffer_stream *pStream, const size_t targetOffset, const size_t size, _Out_ gpu_buffer_stream_readback *pReadback);
+
+// Submits the copies of this frame and fences its section.
+lsResult gpuBufferStream_endFrame(gpu_buffer_stream *pStream);
+
+// `*ppData` points into the ring, don't hold on to it past `gpuBufferStream_SectionCount - 1` frames.
+lsResult gpuBufferStream_getReadback(gpu_buffer_stream *pStream, const gpu_buffer_stream_readback &readback, _Out_ const uint8_t **ppData, const bool block = true);
+
+// Waits for all sections.
+lsResult gpuBufferStream_finish(gpu_buffer_stream *pStream);
@@ -32,3 +32,20 @@ epilogue:
 
   return result;
 }
+
+lsResult lsSeekFile(FILE *pFile, const uint64_t offset)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pFile == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(offset > INT64_MAX, lsR_ArgumentOutOfBounds);
+
+#ifdef _WIN32
+  LS_ERROR_IF(0 != _fseeki64(pFile, (int64_t)offset, SEEK_SET), lsR_IOFailure);
+#else
+  LS_ERROR_IF(0 != fseeko(pFile, (off_t)offset, SEEK_SET), lsR_IOFailure);
+#endif
+
+epilogue:
+  return result;
+}
@@ -9,3 +9,6 @@ lsResult lsReadFile(const char *filename, _Out_ T **ppData, _Out_ size_t *pCount
 {
   return lsReadFileBytes(filename, reinterpret_cast<uint8_t **>(ppData), sizeof(T), pCount);
 }
+
+// `fseek` with 64 bit offsets, relative to the start of the file.
+lsResult lsSeekFile(FILE *pFile, const uint64_t offset);
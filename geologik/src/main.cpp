@@ -1,11 +1,25 @@
 #include "platform.h"
 #include "render.h"
+#include "framePipeline.h"
+#include "terrain.h"
+#include "terrainIncision.h"
+#include "testable.h"
 
 #include <stdio.h>
 
 //////////////////////////////////////////////////////////////////////////
 
 static lsAppState _AppState = { };
+static terrain _Terrain = { };
+
+// Only touched by the simulation step, which runs on a worker while the frame that kicked it off renders.
+static struct
+{
+  terrain_flow flow;
+  terrain_incision_params incision;
+  uint64_t step;
+  lsResult result; // of the last step, checked once the next frame has joined it.
+} _Simulation = { };
 
 lsResult MainGameLoop(int32_t argc, const char **pArgs);
 
@@ -13,11 +27,35 @@ lsResult MainGameLoop(int32_t argc, const char **pArgs);
 
 int32_t main(int32_t argc, char **pArgv)
 {
+  if (argc > 1 && strcmp(pArgv[1], "--test") == 0)
+    return LS_SUCCESS(run_testables()) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  if (argc > 1 && strcmp(pArgv[1], "--benchmark") == 0)
+    return LS_SUCCESS(run_benchmarks()) ? EXIT_SUCCESS : EXIT_FAILURE;
+
   return LS_SUCCESS(MainGameLoop(argc, const_cast<const char **>(pArgv))) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 //////////////////////////////////////////////////////////////////////////
 
+static void MainGameLoop_simulate_internal(void *, const size_t)
+{
+  lsResult result = lsR_Success;
+
+  if (_Simulation.step % lsMax(_Simulation.incision.flowInterval, 1U) == 0)
+  {
+    terrainFlow_destroy(&_Simulation.flow);
+    LS_ERROR_CHECK(terrainFlow_compute(&_Simulation.flow, &_Terrain, threadPool_getDefault()));
+  }
+
+  LS_ERROR_CHECK(terrainIncision_step(&_Terrain, &_Simulation.flow, &_Simulation.incision, threadPool_getDefault()));
+
+  _Simulation.step++;
+
+epilogue:
+  _Simulation.result = result;
+}
+
 lsResult MainGameLoop(int32_t argc, const char **pArgs)
 {
   lsResult result = lsR_Success;
@@ -25,12 +63,16 @@ lsResult MainGameLoop(int32_t argc, const char **pArgs)
   (void)argc;
   (void)pArgs;
 
+  frame_pipeline pipeline;
+
   LS_ERROR_CHECK(lsAppState_Create(&_AppState, "Engine", vec2s(1600, 1200)));
-  // TODO terrain init
 
-  LS_ERROR_CHECK(render_init(&_AppState));
+  LS_ERROR_CHECK(terrain_init(&_Terrain, 1024, 1024));
+  terrain_generate(&_Terrain);
+
+  LS_ERROR_CHECK(render_init(&_AppState, &_Terrain));
+  LS_ERROR_CHECK(framePipeline_create(&pipeline, &framePipeline_GLBackend, nullptr, threadPool_getDefault(), 1000000000LL / 120));
 
-  const float_t updateTimeMs = 1000.0f / 120.f;
   size_t frameCount = 0;
   float_t frameTimesMs = 0;
   float_t cpuTimesMs = 0;
@@ -39,6 +81,14 @@ lsResult MainGameLoop(int32_t argc, const char **pArgs)
   {
     const int64_t before = lsGetCurrentTimeNs();
 
+    LS_ERROR_CHECK(framePipeline_beginFrame(&pipeline));
+    LS_ERROR_CHECK(_Simulation.result);
+
+    render_startFrame(&_AppState);
+
+    // Only the chunks the simulation changed are uploaded. All of them start out dirty, so the first frames fill the buffer.
+    LS_ERROR_CHECK(render_streamTerrain(&_Terrain));
+
     lsAppView *pNext = _AppState.pCurrentView;
 
     LS_ERROR_CHECK(_AppState.pCurrentView->pUpdate(_AppState.pCurrentView, &pNext, &_AppState));
@@ -51,19 +101,21 @@ lsResult MainGameLoop(int32_t argc, const char **pArgs)
       _AppState.pCurrentView = pNext;
     }
 
+    // Nothing reads the terrain for the rest of the frame, so the next step can run while it renders.
+    LS_ERROR_CHECK(framePipeline_kickSimulation(&pipeline, MainGameLoop_simulate_internal, nullptr));
+
     const int64_t afterCPU = lsGetCurrentTimeNs();
 
+    render_endFrame(&_AppState);
     render_finalize();
 
     const int64_t afterRender = lsGetCurrentTimeNs();
 
     lsAppState_Swap(&_AppState);
 
+    LS_ERROR_CHECK(framePipeline_endFrame(&pipeline));
+
     const float_t ms = (afterRender - before) * 1e-6f;
-    const int64_t sleepMs = (int64_t)floorf(updateTimeMs - ms - 0.5f /* if vsync, leave vsync 0.5ms to play with */);
-    
-    if (sleepMs > 0)
-      Sleep((DWORD)sleepMs);
 
     frameTimesMs += ms;
     cpuTimesMs += (afterCPU - before) * 1e-6f;
@@ -83,7 +135,10 @@ epilogue:
   if (_AppState.pCurrentView)
     _AppState.pCurrentView->pDestroy(&_AppState.pCurrentView, &_AppState);
   
+  framePipeline_destroy(&pipeline); // joins the simulation step still running.
   render_destroy();
+  terrainFlow_destroy(&_Simulation.flow);
+  terrain_destroy(&_Terrain);
 
   return result;
 }
@@ -0,0 +1,433 @@
+#include "pngWriter.h"
+#include "threadPool.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#pragma warning(push)
+#pragma warning(disable: 4100)
+#include "stb_image_write.h"
+#pragma warning(pop)
+
+//////////////////////////////////////////////////////////////////////////
+
+struct png_writer_crc_table
+{
+  uint32_t values[256];
+
+  constexpr png_writer_crc_table() : values()
+  {
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t c = i;
+
+      for (size_t k = 0; k < 8; k++)
+        c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+
+      values[i] = c;
+    }
+  }
+};
+
+static constexpr png_writer_crc_table pngWriter_CrcTable;
+
+// Fixed huffman codes are stored most significant bit first.
+struct png_writer_reverse_table
+{
+  uint16_t values[512];
+
+  constexpr png_writer_reverse_table() : values()
+  {
+    for (uint32_t i = 0; i < 512; i++)
+    {
+      uint32_t reversed = 0;
+
+      for (size_t k = 0; k < 9; k++)
+        reversed |= ((i >> k) & 1) << (8 - k);
+
+      values[i] = (uint16_t)reversed;
+    }
+  }
+};
+
+static constexpr png_writer_reverse_table pngWriter_Reverse9;
+
+static const uint8_t pngWriter_Signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+static const uint8_t pngWriter_EmptyStoredBlock[] = { 0x00, 0x00, 0xFF, 0xFF }; // LEN, NLEN of a stored block without data.
+static const uint8_t pngWriter_EmptyFinalBlock[] = { 0x03, 0x00 }; // BFINAL, fixed huffman, end of block.
+
+struct png_writer_strip
+{
+  uint8_t *pCompressed; // allocated by stb.
+  size_t offset;
+  size_t length; // excluding `pngWriter_EmptyStoredBlock`.
+  uint32_t crc;
+  uint32_t adler;
+  size_t uncompressedLength;
+  lsResult result;
+};
+
+struct png_writer_context
+{
+  size_t height;
+  size_t rowBytes;
+  size_t bytesPerPixel;
+  size_t stripRows;
+  size_t firstStrip;
+  png_writer_strip *pStrips;
+
+  png_writer_row_func *pFunc;
+  void *pUserData;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+static uint32_t pngWriter_crc_internal(uint32_t crc, const uint8_t *pData, const size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    crc = pngWriter_CrcTable.values[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+
+  return crc;
+}
+
+static void pngWriter_storeBigEndian_internal(uint8_t *pData, const uint32_t value)
+{
+  pData[0] = (uint8_t)(value >> 24);
+  pData[1] = (uint8_t)(value >> 16);
+  pData[2] = (uint8_t)(value >> 8);
+  pData[3] = (uint8_t)value;
+}
+
+// See `adler32_combine` in zlib.
+static uint32_t pngWriter_combineAdler_internal(const uint32_t adlerA, const uint32_t adlerB, const size_t lengthB)
+{
+  constexpr uint64_t base = 65521;
+
+  const uint64_t remainder = lengthB % base;
+  uint64_t sumA = adlerA & 0xFFFF;
+  uint64_t sumB = (remainder * sumA) % base;
+
+  sumA += (adlerB & 0xFFFF) + base - 1;
+  sumB += (adlerA >> 16) + (adlerB >> 16) + base - remainder;
+
+  sumA %= base;
+  sumB %= base;
+
+  return (uint32_t)(sumA | (sumB << 16));
+}
+
+static lsResult pngWriter_writeChunk_internal(FILE *pFile, const char *type, const uint8_t *pData, const size_t size, const uint8_t *pTrailer, const size_t trailerSize, const uint32_t crc)
+{
+  lsResult result = lsR_Success;
+
+  uint8_t header[8];
+  uint8_t footer[4];
+
+  pngWriter_storeBigEndian_internal(header, (uint32_t)(size + trailerSize));
+  lsMemcpy(header + 4, reinterpret_cast<const uint8_t *>(type), 4);
+  pngWriter_storeBigEndian_internal(footer, crc);
+
+  LS_ERROR_IF(sizeof(header) != fwrite(header, 1, sizeof(header), pFile), lsR_IOFailure);
+  LS_ERROR_IF(size > 0 && size != fwrite(pData, 1, size, pFile), lsR_IOFailure);
+  LS_ERROR_IF(trailerSize > 0 && trailerSize != fwrite(pTrailer, 1, trailerSize, pFile), lsR_IOFailure);
+  LS_ERROR_IF(sizeof(footer) != fwrite(footer, 1, sizeof(footer), pFile), lsR_IOFailure);
+
+epilogue:
+  return result;
+}
+
+static lsResult pngWriter_writeChunk_internal(FILE *pFile, const char *type, const uint8_t *pData, const size_t size)
+{
+  uint32_t crc = pngWriter_crc_internal(0xFFFFFFFF, reinterpret_cast<const uint8_t *>(type), 4);
+  crc = pngWriter_crc_internal(crc, pData, size) ^ 0xFFFFFFFF;
+
+  return pngWriter_writeChunk_internal(pFile, type, pData, size, nullptr, 0, crc);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static uint8_t pngWriter_paeth_internal(const int32_t left, const int32_t up, const int32_t upLeft)
+{
+  const int32_t prediction = left + up - upLeft;
+  const int32_t distanceLeft = lsAbs(prediction - left);
+  const int32_t distanceUp = lsAbs(prediction - up);
+  const int32_t distanceUpLeft = lsAbs(prediction - upLeft);
+
+  if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft)
+    return (uint8_t)left;
+  else if (distanceUp <= distanceUpLeft)
+    return (uint8_t)up;
+  else
+    return (uint8_t)upLeft;
+}
+
+static void pngWriter_filterRow_internal(const uint8_t *pPrevious, const uint8_t *pRow, const size_t rowBytes, const size_t bytesPerPixel, _Out_ uint8_t *pFiltered)
+{
+  pFiltered[0] = 4; // paeth
+  pFiltered++;
+
+  for (size_t i = 0; i < bytesPerPixel; i++)
+    pFiltered[i] = (uint8_t)(pRow[i] - pPrevious[i]);
+
+  for (size_t i = bytesPerPixel; i < rowBytes; i++)
+    pFiltered[i] = (uint8_t)(pRow[i] - pngWriter_paeth_internal(pRow[i - bytesPerPixel], pPrevious[i], pPrevious[i - bytesPerPixel]));
+}
+
+static uint32_t pngWriter_peekBits_internal(const uint8_t *pData, const size_t size, const size_t bitOffset, const size_t count)
+{
+  const size_t first = bitOffset / 8;
+  uint32_t bits = 0;
+
+  for (size_t i = 0; i < 3 && first + i < size; i++)
+    bits |= (uint32_t)pData[first + i] << (i * 8);
+
+  return (bits >> (bitOffset % 8)) & ((1U << count) - 1);
+}
+
+// stb emits a single block of fixed huffman codes. Retrieves the bit offset right after its end of block code.
+static lsResult pngWriter_findEndOfBlock_internal(const uint8_t *pDeflate, const size_t size, _Out_ size_t *pBitOffset)
+{
+  lsResult result = lsR_Success;
+
+  size_t bitOffset = 3;
+
+  LS_ERROR_IF(size == 0 || pngWriter_peekBits_internal(pDeflate, size, 1, 2) != 1, lsR_ResourceIncompatible);
+
+  while (true)
+  {
+    LS_ERROR_IF(bitOffset >= size * 8, lsR_ResourceInvalid);
+
+    const uint32_t code = pngWriter_Reverse9.values[pngWriter_peekBits_internal(pDeflate, size, bitOffset, 9)];
+    uint32_t symbol;
+
+    if ((code >> 2) < 24) // 256 - 279
+    {
+      symbol = 256 + (code >> 2);
+      bitOffset += 7;
+    }
+    else if ((code >> 1) < 0xC0) // literal 0 - 143
+    {
+      bitOffset += 8;
+      continue;
+    }
+    else if ((code >> 1) < 0xC8) // 280 - 287
+    {
+      symbol = 280 + (code >> 1) - 0xC0;
+      bitOffset += 8;
+    }
+    else // literal 144 - 255
+    {
+      bitOffset += 9;
+      continue;
+    }
+
+    if (symbol == 256)
+      break;
+
+    LS_ERROR_IF(symbol > 285, lsR_ResourceInvalid);
+
+    if (symbol >= 265 && symbol < 285)
+      bitOffset += (symbol - 261) / 4;
+
+    const uint32_t distanceCode = (uint32_t)pngWriter_Reverse9.values[pngWriter_peekBits_internal(pDeflate, size, bitOffset, 5)] >> 4;
+    bitOffset += 5;
+
+    LS_ERROR_IF(distanceCode > 29, lsR_ResourceInvalid);
+
+    if (distanceCode >= 4)
+      bitOffset += distanceCode / 2 - 1;
+  }
+
+  LS_ERROR_IF(bitOffset > size * 8, lsR_ResourceInvalid);
+
+  *pBitOffset = bitOffset;
+
+epilogue:
+  return result;
+}
+
+static void pngWriter_compressStrip_internal(void *pUserData, const size_t index)
+{
+  png_writer_context *pContext = reinterpret_cast<png_writer_context *>(pUserData);
+  png_writer_strip *pStrip = &pContext->pStrips[index];
+
+  const size_t stripIndex = pContext->firstStrip + index;
+  const size_t y0 = stripIndex * pContext->stripRows;
+  const size_t y1 = lsMin(y0 + pContext->stripRows, pContext->height);
+  const size_t rowBytes = pContext->rowBytes;
+  const size_t filteredSize = (y1 - y0) * (rowBytes + 1);
+
+  lsResult result = lsR_Success;
+
+  uint8_t *pRows = nullptr;
+  uint8_t *pFiltered = nullptr;
+  int32_t compressedSize = 0;
+
+  LS_ERROR_CHECK(lsAlloc(&pRows, (y1 - y0 + 1) * rowBytes));
+  LS_ERROR_CHECK(lsAlloc(&pFiltered, filteredSize));
+
+  // The first row is the one above the strip, which the filter of the first row in the strip refers to.
+  if (y0 == 0)
+    lsZeroMemory(pRows, rowBytes);
+  else
+    pContext->pFunc(pContext->pUserData, y0 - 1, pRows);
+
+  for (size_t y = y0; y < y1; y++)
+    pContext->pFunc(pContext->pUserData, y, pRows + (y - y0 + 1) * rowBytes);
+
+  for (size_t row = 0; row < y1 - y0; row++)
+    pngWriter_filterRow_internal(pRows + row * rowBytes, pRows + (row + 1) * rowBytes, rowBytes, pContext->bytesPerPixel, pFiltered + row * (rowBytes + 1));
+
+  pStrip->pCompressed = stbi_zlib_compress(pFiltered, (int32_t)filteredSize, &compressedSize, pngWriter_CompressionQuality);
+  LS_ERROR_IF(pStrip->pCompressed == nullptr, lsR_MemoryAllocationFailure);
+  LS_ERROR_IF(compressedSize < 2 + 1 + 4, lsR_InternalError); // zlib header, deflate block, adler32.
+
+  // Strips are joined by turning their block into a non-final one, followed by an empty stored block to get back to a byte boundary.
+  {
+    uint8_t *pDeflate = pStrip->pCompressed + 2;
+    const size_t deflateSize = (size_t)compressedSize - 2 - 4;
+    const uint8_t *pAdler = pDeflate + deflateSize;
+    size_t endBit;
+
+    pStrip->adler = ((uint32_t)pAdler[0] << 24) | ((uint32_t)pAdler[1] << 16) | ((uint32_t)pAdler[2] << 8) | pAdler[3];
+
+    LS_ERROR_CHECK(pngWriter_findEndOfBlock_internal(pDeflate, deflateSize, &endBit));
+
+    // The stored block header is 3 zero bits, which may spill into the first byte of the adler32 we've already read.
+    const size_t end = (endBit + 3 + 7) / 8;
+
+    pDeflate[0] = (uint8_t)(pDeflate[0] & 0xFE);
+    pDeflate[endBit / 8] = (uint8_t)(pDeflate[endBit / 8] & ((1U << (endBit % 8)) - 1));
+
+    for (size_t i = endBit / 8 + 1; i < end; i++)
+      pDeflate[i] = 0;
+
+    pStrip->offset = stripIndex == 0 ? 0 : 2; // the first strip brings the zlib header.
+    pStrip->length = 2 + end - pStrip->offset;
+    pStrip->uncompressedLength = filteredSize;
+
+    uint32_t crc = pngWriter_crc_internal(0xFFFFFFFF, reinterpret_cast<const uint8_t *>("IDAT"), 4);
+    crc = pngWriter_crc_internal(crc, pStrip->pCompressed + pStrip->offset, pStrip->length);
+    pStrip->crc = pngWriter_crc_internal(crc, pngWriter_EmptyStoredBlock, sizeof(pngWriter_EmptyStoredBlock)) ^ 0xFFFFFFFF;
+  }
+
+epilogue:
+  lsFreePtr(&pRows);
+  lsFreePtr(&pFiltered);
+
+  pStrip->result = result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult pngWriter_write(const char *filename, const size_t width, const size_t height, const png_pixel_format format, png_writer_row_func *pFunc, void *pUserData)
+{
+  lsResult result = lsR_Success;
+
+  thread_pool *pPool = threadPool_getDefault();
+  FILE *pFile = nullptr;
+  png_writer_strip *pStrips = nullptr;
+  size_t batchSize = 0;
+  uint32_t adler = 1;
+
+  png_writer_context context;
+  context.height = height;
+  context.pFunc = pFunc;
+  context.pUserData = pUserData;
+
+  LS_ERROR_IF(filename == nullptr || pFunc == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(width == 0 || height == 0 || width > INT32_MAX / 8 || height > INT32_MAX, lsR_ArgumentOutOfBounds);
+
+  {
+    uint8_t header[13];
+    pngWriter_storeBigEndian_internal(header, (uint32_t)width);
+    pngWriter_storeBigEndian_internal(header + 4, (uint32_t)height);
+    header[10] = 0; // deflate
+    header[11] = 0; // adaptive filtering
+    header[12] = 0; // not interlaced
+
+    switch (format)
+    {
+    case ppf_gray16:
+      context.bytesPerPixel = 2;
+      header[8] = 16;
+      header[9] = 0;
+      break;
+
+    case ppf_rgb8:
+      context.bytesPerPixel = 3;
+      header[8] = 8;
+      header[9] = 2;
+      break;
+
+    case ppf_rgba8:
+      context.bytesPerPixel = 4;
+      header[8] = 8;
+      header[9] = 6;
+      break;
+
+    default:
+      LS_ERROR_SET(lsR_InvalidParameter);
+    }
+
+    context.rowBytes = width * context.bytesPerPixel;
+    context.stripRows = lsMax((size_t)1, pngWriter_StripBytes / context.rowBytes);
+
+    const size_t stripCount = (height + context.stripRows - 1) / context.stripRows;
+    batchSize = lsMin(stripCount, (threadPool_getWorkerCount(pPool) + 1) * 2);
+
+    LS_ERROR_CHECK(lsAllocZero(&pStrips, batchSize));
+    context.pStrips = pStrips;
+
+    pFile = fopen(filename, "wb");
+    LS_ERROR_IF(pFile == nullptr, lsR_IOFailure);
+
+    LS_ERROR_IF(sizeof(pngWriter_Signature) != fwrite(pngWriter_Signature, 1, sizeof(pngWriter_Signature), pFile), lsR_IOFailure);
+    LS_ERROR_CHECK(pngWriter_writeChunk_internal(pFile, "IHDR", header, sizeof(header)));
+
+    for (size_t firstStrip = 0; firstStrip < stripCount; firstStrip += batchSize)
+    {
+      const size_t count = lsMin(batchSize, stripCount - firstStrip);
+
+      context.firstStrip = firstStrip;
+      threadPool_parallelFor(pPool, count, pngWriter_compressStrip_internal, &context);
+
+      for (size_t i = 0; i < count; i++)
+      {
+        png_writer_strip *pStrip = &pStrips[i];
+
+        LS_ERROR_CHECK(pStrip->result);
+        LS_ERROR_CHECK(pngWriter_writeChunk_internal(pFile, "IDAT", pStrip->pCompressed + pStrip->offset, pStrip->length, pngWriter_EmptyStoredBlock, sizeof(pngWriter_EmptyStoredBlock), pStrip->crc));
+
+        adler = pngWriter_combineAdler_internal(adler, pStrip->adler, pStrip->uncompressedLength);
+
+        free(pStrip->pCompressed);
+        pStrip->pCompressed = nullptr;
+      }
+    }
+  }
+
+  {
+    uint8_t end[sizeof(pngWriter_EmptyFinalBlock) + 4];
+    lsMemcpy(end, pngWriter_EmptyFinalBlock, sizeof(pngWriter_EmptyFinalBlock));
+    pngWriter_storeBigEndian_internal(end + sizeof(pngWriter_EmptyFinalBlock), adler);
+
+    LS_ERROR_CHECK(pngWriter_writeChunk_internal(pFile, "IDAT", end, sizeof(end)));
+    LS_ERROR_CHECK(pngWriter_writeChunk_internal(pFile, "IEND", nullptr, 0));
+  }
+
+epilogue:
+  if (pStrips != nullptr)
+    for (size_t i = 0; i < batchSize; i++)
+      free(pStrips[i].pCompressed);
+
+  lsFreePtr(&pStrips);
+
+  if (pFile != nullptr)
+  {
+    fclose(pFile);
+
+    if (LS_FAILED(result))
+      remove(filename);
+  }
+
+  return result;
+}
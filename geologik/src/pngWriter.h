@@ -0,0 +1,26 @@
+#pragma once
+
+#include "core.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// PNG encoder for large images. Strips of rows are filtered and compressed independently on the thread pool and joined into a single
+// zlib stream, so only the strips currently being compressed have to be in memory.
+
+enum png_pixel_format
+{
+  ppf_gray16,
+  ppf_rgb8,
+  ppf_rgba8,
+};
+
+constexpr size_t pngWriter_StripBytes = 1 << 20; // uncompressed bytes per strip. the compressor restarts its window every strip.
+constexpr int32_t pngWriter_CompressionQuality = 8; // zlib hash chain length, see `stbi_zlib_compress`. also used by the terrain file writers.
+
+// Writes row `y` in PNG byte order (16 bit samples are big endian) to `pRow`. Called concurrently for different rows.
+typedef void (png_writer_row_func)(void *pUserData, const size_t y, _Out_ uint8_t *pRow);
+
+lsResult pngWriter_write(const char *filename, const size_t width, const size_t height, const png_pixel_format format, png_writer_row_func *pFunc, void *pUserData);
+
+// Defined along with `stb_image_write` in `pngWriter.cpp`. Returns a zlib stream allocated with `malloc`.
+unsigned char *stbi_zlib_compress(unsigned char *data, int data_len, int *out_len, int quality);
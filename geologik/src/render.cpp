@@ -5,6 +5,8 @@
 #include "texture.h"
 #include "vertexBuffer.h"
 #include "gpuBuffer.h"
+#include "gpuBufferStream.h"
+#include "uniformBuffer.h"
 #include "framebuffer.h"
 #include "shader.h"
 #include "dataBlob.h"
@@ -20,6 +22,26 @@ extern const char _Attrib_Color[] = "color";
 extern const char _Attrib_Matrix[] = "matrix";
 extern const char _Attrib_Rot[] = "rotation";
 
+constexpr shader_name _Uniform_Texture = "texture";
+constexpr shader_name _Uniform_Width = "width";
+constexpr shader_name _Uniform_Height = "height";
+
+//////////////////////////////////////////////////////////////////////////
+
+// std140 layout of the `frameConstants` uniform block, uploaded once per flush.
+struct render_frameConstants
+{
+  matrix vp;
+  matrix vpFar;
+  float_t ticksSinceOrigin;
+  float_t frameRatio;
+  float_t _padding[2];
+};
+
+static_assert(sizeof(render_frameConstants) == 144, "Invalid std140 layout.");
+
+constexpr uint32_t render_frameConstantsBindingPoint = 0;
+
 //////////////////////////////////////////////////////////////////////////
 
 static struct
@@ -29,20 +51,45 @@ static struct
   {
     shader computeShader;
     gpu_buffer gpuBuffer;
+    gpu_buffer_stream stream; // uploads dirty terrain chunks into `gpuBuffer`.
   } erosion;
 
   struct
   {
     shader vertexFragmentShader;
-    vertexBuffer<vb_attribute_vec2u32<1, _Attrib_Pos>> buffer; // 128 * 128?
+    uint32_t widthUniform;
+    uint32_t heightUniform;
+    instancedVertexBuffer<vertexBuffer<vb_attribute_vec2u32<1, _Attrib_Pos>>, vb_attribute_vec2u32<1, _Attrib_Offs>> buffer; // one patch of `render_terrainPatchSize` * `render_terrainPatchSize` quads, instanced per patch offset.
+    uint32_t indirectBuffer; // actually a GLuint.
   } terrain;
 
   struct
   {
     shader shader;
-    vertexBuffer<vb_attribute_float<2, _Attrib_Pos>> buffer;
+    uint32_t textureUniform;
+    instancedVertexBuffer<vertexBuffer<vb_attribute_float<2, _Attrib_Pos>>, vb_attribute_mat4<_Attrib_Matrix>> buffer;
   } plane;
 
+  uniform_buffer frameConstants;
+
+  struct
+  {
+    uint64_t *pSortKeys; // see `render_quadSortKey`.
+    matrix *pModels; // in submission order.
+    matrix *pSortedModels; // in sort key order, uploaded as instance data.
+    size_t count, capacity;
+  } quadQueue;
+
+  struct
+  {
+    vec2u32 *pPatchOffsets;
+    vb_drawArraysIndirectCommand *pCommands;
+    size_t count, capacity;
+    uint32_t width, height;
+  } terrainQueue;
+
+  size_t droppedDrawCount; // see `render_getDroppedDrawCount`.
+
   pool<texture> textures;
   vec3f lookAt, up, cameraDistance;
   matrix vp, vpFar;
@@ -54,16 +101,53 @@ static struct
 
 //////////////////////////////////////////////////////////////////////////
 
+constexpr size_t render_terrainPatchSize = 128;
+constexpr size_t render_terrainStreamSectionSize = 4 * 1024 * 1024; // per frame, in bytes.
+
+// Quad draws are sorted by shader, then texture, then submission order.
+constexpr size_t render_quadSortKeyIndexBits = 24;
+constexpr size_t render_quadSortKeyTextureBits = 24;
+constexpr uint64_t render_quadSortKeyIndexMask = ((uint64_t)1 << render_quadSortKeyIndexBits) - 1;
+constexpr uint64_t render_quadSortKeyTextureMask = ((uint64_t)1 << render_quadSortKeyTextureBits) - 1;
+
+enum render_quadShader : uint64_t
+{
+  rQS_plane,
+};
+
+inline uint64_t render_quadSortKey(const render_quadShader shader, const size_t textureIndex, const size_t commandIndex)
+{
+  return ((uint64_t)shader << (render_quadSortKeyTextureBits + render_quadSortKeyIndexBits)) | (((uint64_t)textureIndex & render_quadSortKeyTextureMask) << render_quadSortKeyIndexBits) | ((uint64_t)commandIndex & render_quadSortKeyIndexMask);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void render_flushQuadQueue_internal();
+void render_flushTerrainQueue_internal();
+
+// Only the first dropped draw is reported, the count keeps track of the rest.
+static void render_dropDraws_internal(const char *queueName, const size_t count)
+{
+  if (_Render.droppedDrawCount == 0)
+    print_error_line("Failed to queue or upload ", queueName, " draws, dropping them.\n");
+
+  _Render.droppedDrawCount += count;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 lsResult set_terrain_vertexData()
 {
   lsResult result = lsR_Success;
 
-  const size_t quadCountX = 128;
-  const size_t quadCountY = 128;
+  const size_t quadCountX = render_terrainPatchSize;
+  const size_t quadCountY = render_terrainPatchSize;
 
-  vec2u32 quadData[] = { vec2u32(0, 0), vec2u32(0, 1), vec2u32(1, 0), vec2u32(0, 1), vec2u32(1, 1), vec2u32(1, 0), vec2u32(0, 0) };
+  vec2u32 quadData[] = { vec2u32(0, 0), vec2u32(0, 1), vec2u32(1, 0), vec2u32(0, 1), vec2u32(1, 1), vec2u32(1, 0) };
   const size_t quadDataSize = LS_ARRAYSIZE(quadData);
-  vec2u32 renderData[quadCountX * quadCountY * quadDataSize];
+  vec2u32 *renderData = nullptr;
+
+  LS_ERROR_CHECK(lsAlloc(&renderData, quadCountX * quadCountY * quadDataSize));
 
   for (size_t y = 0; y < quadCountY; y++)
   {
@@ -76,32 +160,34 @@ lsResult set_terrain_vertexData()
     }
   }
 
-  LS_ERROR_CHECK(vertexBuffer_setVertexBuffer(&_Render.terrain.buffer, renderData, LS_ARRAYSIZE(renderData)));
+  LS_ERROR_CHECK(instancedVertexBuffer_setInstancedVertexBuffer(&_Render.terrain.buffer, renderData, quadCountX * quadCountY * quadDataSize));
 
 epilogue:
+  lsFreePtr(&renderData);
   return result;
 }
 
-lsResult render_init(lsAppState *pAppState)
+lsResult render_init(lsAppState *pAppState, const terrain *pTerrain)
 {
   lsResult result = lsR_Success;
 
+  LS_ERROR_IF(pAppState == nullptr || pTerrain == nullptr, lsR_ArgumentNull);
+
   _Render.windowSize = pAppState->windowSize;
   _Render.cameraDistance = vec3f(0, 0, 5.f);
   render_setLookAt(vec2f(0), vec2f(0, 1));
   _Render.lastFrameStartNs = lsGetCurrentTimeNs();
 
+  LS_ERROR_CHECK(uniformBuffer_create<render_frameConstants>(&_Render.frameConstants, render_frameConstantsBindingPoint));
+
   // Create Erosion Buffer & Shader.
   {
-    terrain t;
-
-    LS_ERROR_CHECK(terrain_init(&t, 1024, 1024));
-    terrain_generate(&t);
+    _Render.erosion.gpuBuffer.size = sizeof(tile) * pTerrain->width * pTerrain->height;
+    _Render.erosion.gpuBuffer.accessType = gbat_dynamic;
 
     LS_ERROR_CHECK(gpuBuffer_create(&_Render.erosion.gpuBuffer));
-    LS_ERROR_CHECK(gpuBuffer_set(&_Render.erosion.gpuBuffer, t.pTiles)); // TODO!
-    
-    terrain_destroy(&t);
+    LS_ERROR_CHECK(gpuBuffer_set(&_Render.erosion.gpuBuffer, (const tile *)nullptr)); // only allocates the storage, the tiles are streamed in.
+    LS_ERROR_CHECK(gpuBufferStream_create(&_Render.erosion.stream, &gpuBufferStream_GLBackend, &_Render.erosion.gpuBuffer, _Render.erosion.gpuBuffer.size, render_terrainStreamSectionSize));
 
     //LS_ERROR_CHECK(shader_createFromFile_compute(&_Render.erosion.computeShader, "shaders/erosion.comp"));
   }
@@ -109,18 +195,24 @@ lsResult render_init(lsAppState *pAppState)
   // Create Terrain.
   {
     LS_ERROR_CHECK(shader_createFromFile_vertex_fragment(&_Render.terrain.vertexFragmentShader, "shaders/terrain.vert", "shaders/terrain.frag"));
-    
-    LS_ERROR_CHECK(vertexBuffer_create(&_Render.terrain.buffer, &_Render.terrain.vertexFragmentShader));
+    LS_ERROR_CHECK(shader_bindUniformBlock(&_Render.terrain.vertexFragmentShader, "frameConstants", render_frameConstantsBindingPoint));
+    _Render.terrain.widthUniform = shader_getUniformIndex(&_Render.terrain.vertexFragmentShader, _Uniform_Width);
+    _Render.terrain.heightUniform = shader_getUniformIndex(&_Render.terrain.vertexFragmentShader, _Uniform_Height);
+
+    LS_ERROR_CHECK(instancedVertexBuffer_create(&_Render.terrain.buffer, &_Render.terrain.vertexFragmentShader));
     LS_ERROR_CHECK(set_terrain_vertexData());
+
+    glGenBuffers(1, &_Render.terrain.indirectBuffer);
   }
 
   // Create Plane.
   {
     LS_ERROR_CHECK(shader_createFromFile_vertex_fragment(&_Render.plane.shader, "shaders/plane.vert", "shaders/plane.frag"));
+    _Render.plane.textureUniform = shader_getUniformIndex(&_Render.plane.shader, _Uniform_Texture);
 
     float_t renderData[] = { 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0 };
-    LS_ERROR_CHECK(vertexBuffer_create(&_Render.plane.buffer, &_Render.plane.shader));
-    LS_ERROR_CHECK(vertexBuffer_setVertexBuffer(&_Render.plane.buffer, renderData, LS_ARRAYSIZE(renderData)));
+    LS_ERROR_CHECK(instancedVertexBuffer_create(&_Render.plane.buffer, &_Render.plane.shader));
+    LS_ERROR_CHECK(instancedVertexBuffer_setInstancedVertexBuffer(&_Render.plane.buffer, renderData, LS_ARRAYSIZE(renderData)));
   }
 
   // Create Default Texture.
@@ -173,11 +265,17 @@ void render_startFrame(lsAppState *pAppState)
   render_setDepthTestEnabled(false);
 
   render_setLookAt(_Render.lookAt, _Render.up);
+
+  gpuBufferStream_beginFrame(&_Render.erosion.stream);
 }
 
 void render_endFrame(lsAppState *pAppState)
 {
   (void)pAppState;
+
+  gpuBufferStream_endFrame(&_Render.erosion.stream); // submit the terrain uploads before anything reads the buffer.
+
+  render_flushRenderQueue();
   
   framebuffer_unbind();
   
@@ -191,15 +289,33 @@ void render_destroy()
   
   pool_destroy(&_Render.textures);
 
-  vertexBuffer_destroy(&_Render.terrain.buffer);
+  instancedVertexBuffer_destroy(&_Render.terrain.buffer);
   shader_destroy(&_Render.terrain.vertexFragmentShader);
 
-  // todo: where to get data from buffer? here?
+  if (_Render.terrain.indirectBuffer != 0)
+  {
+    glDeleteBuffers(1, &_Render.terrain.indirectBuffer);
+    _Render.terrain.indirectBuffer = 0;
+  }
+
+  lsFreePtr(&_Render.quadQueue.pSortKeys);
+  lsFreePtr(&_Render.quadQueue.pModels);
+  lsFreePtr(&_Render.quadQueue.pSortedModels);
+  _Render.quadQueue.count = _Render.quadQueue.capacity = 0;
+
+  lsFreePtr(&_Render.terrainQueue.pPatchOffsets);
+  lsFreePtr(&_Render.terrainQueue.pCommands);
+  _Render.terrainQueue.count = _Render.terrainQueue.capacity = 0;
+
+  gpuBufferStream_finish(&_Render.erosion.stream);
+  gpuBufferStream_destroy(&_Render.erosion.stream);
   gpuBuffer_detroy(&_Render.erosion.gpuBuffer);
   shader_destroy(&_Render.erosion.computeShader);
 
-  vertexBuffer_destroy(&_Render.plane.buffer);
+  instancedVertexBuffer_destroy(&_Render.plane.buffer);
   shader_destroy(&_Render.plane.shader);
+
+  uniformBuffer_destroy(&_Render.frameConstants);
 }
 
 void render_setCameraOffset(const vec3f offset)
@@ -229,14 +345,77 @@ void render_setTicksSinceOrigin(const float_t ticksSinceOrigin)
   _Render.ticksSinceOrigin = ticksSinceOrigin;
 }
 
+lsResult render_streamTerrain(terrain *pTerrain)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pTerrain == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(sizeof(tile) * pTerrain->width * pTerrain->height != _Render.erosion.stream.targetSize, lsR_ResourceIncompatible);
+
+  for (size_t cy = 0; cy < pTerrain->chunkCountY; cy++)
+  {
+    const size_t y0 = cy * terrain_chunkSize;
+    const size_t y1 = lsMin(y0 + terrain_chunkSize, (size_t)pTerrain->height);
+
+    for (size_t cx = 0; cx < pTerrain->chunkCountX; cx++)
+    {
+      if (!terrain_isChunkDirty(pTerrain, cx, cy))
+        continue;
+
+      // Upload runs of dirty chunks row by row, consecutive rows of full width runs end up as a single copy.
+      size_t runEnd = cx + 1;
+
+      while (runEnd < pTerrain->chunkCountX && terrain_isChunkDirty(pTerrain, runEnd, cy))
+        runEnd++;
+
+      const size_t x0 = cx * terrain_chunkSize;
+      const size_t x1 = lsMin(runEnd * terrain_chunkSize, (size_t)pTerrain->width);
+
+      for (size_t y = y0; y < y1; y++)
+      {
+        const size_t tileIndex = y * pTerrain->width + x0;
+        const lsResult uploadResult = gpuBufferStream_upload(&_Render.erosion.stream, tileIndex * sizeof(tile), pTerrain->pTiles + tileIndex, (x1 - x0) * sizeof(tile));
+
+        if (uploadResult == lsR_ResourceFull) // the rest stays dirty until next frame.
+          goto epilogue;
+
+        LS_ERROR_CHECK(uploadResult);
+      }
+
+      for (; cx < runEnd; cx++)
+        terrain_clearChunkDirty(pTerrain, cx, cy);
+    }
+  }
+
+epilogue:
+  return result;
+}
+
 void render_drawQuad(const matrix &model, const render_textureId textureIndex)
 {
-  texture *pTex = pool_get(&_Render.textures, textureIndex);
-  texture_bind(pTex, 0);
-  shader_bind(&_Render.plane.shader);
-  shader_setUniform(&_Render.plane.shader, "texture", pTex);
-  shader_setUniform(&_Render.plane.shader, "matrix", model);
-  vertexBuffer_render(&_Render.plane.buffer);
+  auto &queue = _Render.quadQueue;
+
+  if (queue.count > render_quadSortKeyIndexMask)
+    render_flushQuadQueue_internal();
+
+  if (queue.count == queue.capacity)
+  {
+    const size_t newCapacity = lsMax((size_t)64, queue.capacity * 2);
+
+    if (LS_FAILED(lsRealloc(&queue.pSortKeys, newCapacity)) || LS_FAILED(lsRealloc(&queue.pModels, newCapacity)) || LS_FAILED(lsRealloc(&queue.pSortedModels, newCapacity)))
+    {
+      render_dropDraws_internal("quad", 1);
+      return;
+    }
+
+    queue.capacity = newCapacity;
+  }
+
+  lsAssert((size_t)textureIndex <= render_quadSortKeyTextureMask);
+
+  queue.pModels[queue.count] = model;
+  queue.pSortKeys[queue.count] = render_quadSortKey(rQS_plane, textureIndex, queue.count);
+  queue.count++;
 }
 
 void render_draw2DQuad(const matrix &model, const render_textureId textureIndex)
@@ -251,15 +430,133 @@ void render_draw3DQuad(const matrix &model, const render_textureId textureIndex)
 
 void render_drawTerrain(const uint16_t width, const uint16_t height)
 {
-  shader_bind(&_Render.terrain.vertexFragmentShader);
-  
-  for (size_t i = 0; i < width * height; i += 128)
+  auto &queue = _Render.terrainQueue;
+
+  // All queued patches share the `width` and `height` uniforms.
+  if (queue.count > 0 && (queue.width != width || queue.height != height))
+    render_flushTerrainQueue_internal();
+
+  queue.width = width;
+  queue.height = height;
+
+  const size_t patchCount = ((width + render_terrainPatchSize - 1) / render_terrainPatchSize) * ((height + render_terrainPatchSize - 1) / render_terrainPatchSize);
+
+  if (queue.count + patchCount > queue.capacity)
+  {
+    const size_t newCapacity = lsMax(queue.count + patchCount, queue.capacity * 2);
+
+    if (LS_FAILED(lsRealloc(&queue.pPatchOffsets, newCapacity)) || LS_FAILED(lsRealloc(&queue.pCommands, newCapacity)))
+    {
+      render_dropDraws_internal("terrain", patchCount);
+      return;
+    }
+
+    queue.capacity = newCapacity;
+  }
+
+  for (size_t y = 0; y < height; y += render_terrainPatchSize)
+    for (size_t x = 0; x < width; x += render_terrainPatchSize)
+      queue.pPatchOffsets[queue.count++] = vec2u32(x, y);
+}
+
+size_t render_getDroppedDrawCount()
+{
+  return _Render.droppedDrawCount;
+}
+
+void render_flushRenderQueue()
+{
+  render_frameConstants constants;
+  constants.vp = _Render.vp;
+  constants.vpFar = _Render.vpFar;
+  constants.ticksSinceOrigin = _Render.ticksSinceOrigin;
+  constants.frameRatio = _Render.frameRatio;
+
+  uniformBuffer_set(&_Render.frameConstants, constants);
+
+  render_flushTerrainQueue_internal();
+  render_flushQuadQueue_internal();
+}
+
+void render_flushQuadQueue_internal()
+{
+  auto &queue = _Render.quadQueue;
+
+  if (queue.count == 0)
+    return;
+
+  std::sort(queue.pSortKeys, queue.pSortKeys + queue.count);
+
+  for (size_t i = 0; i < queue.count; i++)
+    queue.pSortedModels[i] = queue.pModels[queue.pSortKeys[i] & render_quadSortKeyIndexMask];
+
+  if (LS_SUCCESS(instancedVertexBuffer_setInstanceBuffer(&_Render.plane.buffer, queue.pSortedModels, queue.count, true)))
+  {
+    shader_bind(&_Render.plane.shader);
+    instancedVertexBuffer_setAttributes(&_Render.plane.buffer);
 
-  shader_setUniform(&_Render.plane.shader, "offset", offset);
+    size_t batchStart = 0;
 
-  shader_setUniform(&_Render.plane.shader, "width", width);
+    // Every run of equal shader & texture is a single instanced draw call.
+    while (batchStart < queue.count)
+    {
+      const uint64_t state = queue.pSortKeys[batchStart] >> render_quadSortKeyIndexBits;
+      size_t batchEnd = batchStart + 1;
+
+      while (batchEnd < queue.count && (queue.pSortKeys[batchEnd] >> render_quadSortKeyIndexBits) == state)
+        batchEnd++;
+
+      texture *pTex = pool_get(&_Render.textures, (size_t)(state & render_quadSortKeyTextureMask));
+      texture_bind(pTex, 0);
+      shader_setUniformAtIndex(&_Render.plane.shader, _Render.plane.textureUniform, pTex);
+      instancedVertexBuffer_renderRange(&_Render.plane.buffer, batchStart, batchEnd - batchStart);
+
+      batchStart = batchEnd;
+    }
+  }
+  else
+  {
+    render_dropDraws_internal("quad", queue.count);
+  }
+
+  queue.count = 0;
+}
+
+void render_flushTerrainQueue_internal()
+{
+  auto &queue = _Render.terrainQueue;
+
+  if (queue.count == 0)
+    return;
+
+  for (size_t i = 0; i < queue.count; i++)
+  {
+    vb_drawArraysIndirectCommand &cmd = queue.pCommands[i];
+    cmd.vertexCount = (uint32_t)_Render.terrain.buffer.instancedBuffer.count;
+    cmd.instanceCount = 1;
+    cmd.firstVertex = 0;
+    cmd.baseInstance = (uint32_t)i;
+  }
+
+  if (LS_SUCCESS(instancedVertexBuffer_setInstanceBuffer(&_Render.terrain.buffer, queue.pPatchOffsets, queue.count, true)))
+  {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _Render.terrain.indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(vb_drawArraysIndirectCommand) * queue.count, queue.pCommands, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    shader_bind(&_Render.terrain.vertexFragmentShader);
+    shader_setUniformAtIndex(&_Render.terrain.vertexFragmentShader, _Render.terrain.widthUniform, queue.width);
+    shader_setUniformAtIndex(&_Render.terrain.vertexFragmentShader, _Render.terrain.heightUniform, queue.height);
+
+    instancedVertexBuffer_setAttributes(&_Render.terrain.buffer);
+    instancedVertexBuffer_renderIndirect(&_Render.terrain.buffer, _Render.terrain.indirectBuffer, queue.count);
+  }
+  else
+  {
+    render_dropDraws_internal("terrain", queue.count);
+  }
 
-  vertexBuffer_render(&_Render.terrain.buffer);
+  queue.count = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -340,6 +637,5 @@ void render_setBlendEnabled(const bool enabled)
 
 void render_finalize()
 {
-  glFlush();
-  glFinish();
+  glFlush(); // frames are synchronized with fences by the `frame_pipeline`.
 }
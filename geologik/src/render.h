@@ -2,12 +2,15 @@
 
 #include "platform.h"
 
+struct terrain;
+
 enum render_textureId : size_t
 {
   rTI_default,
 };
 
-lsResult render_init(lsAppState *pAppState);
+// Sizes the erosion buffer for `pTerrain`. Its contents are uploaded by `render_streamTerrain`.
+lsResult render_init(lsAppState *pAppState, const terrain *pTerrain);
 void render_startFrame(lsAppState *pAppState);
 void render_endFrame(lsAppState *pAppState);
 void render_destroy();
@@ -20,6 +23,14 @@ void render_setTicksSinceOrigin(const float_t ticksSinceOrigin);
 void render_drawQuad(const matrix &model, const render_textureId textureIndex);
 void render_draw2DQuad(const matrix &model, const render_textureId textureIndex);
 void render_draw3DQuad(const matrix &model, const render_textureId textureIndex);
+void render_drawTerrain(const uint16_t width, const uint16_t height);
+
+// Quads and terrain patches that were dropped because their queue or instance buffer couldn't be allocated. The first time is reported
+// as an error.
+size_t render_getDroppedDrawCount();
+
+// Streams the dirty chunks of `pTerrain` into the erosion buffer & clears their dirty flag. Call between `render_startFrame` and `render_endFrame`.
+lsResult render_streamTerrain(terrain *pTerrain);
 
 void render_flushRenderQueue();
 
@@ -115,6 +115,17 @@ void shader_bind(shader *pShader)
 //}
 //#endif
 
+static void shader_destroyReferences_internal(shader_name_ref **ppReferences, const size_t capacity)
+{
+  if (*ppReferences == nullptr)
+    return;
+
+  for (size_t i = 0; i < capacity; i++)
+    lsFreePtr(&(*ppReferences)[i].name);
+
+  lsFreePtr(ppReferences);
+}
+
 void shader_destroy(shader *pShader)
 {
   if (!pShader->initialized)
@@ -131,62 +142,134 @@ void shader_destroy(shader *pShader)
 //  lsFreePtr(&pShader->fragmentPath);
 //#endif
 
-  lsFreePtr(&pShader->pUniformReferences);
-  lsFreePtr(&pShader->pAttributeReferences);
+  shader_destroyReferences_internal(&pShader->pUniformReferences, pShader->uniformReferenceCapacity);
+  pShader->uniformReferenceCount = pShader->uniformReferenceCapacity = 0;
+  shader_destroyReferences_internal(&pShader->pAttributeReferences, pShader->attributeReferenceCapacity);
+  pShader->attributeReferenceCount = pShader->attributeReferenceCapacity = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////
 
-uint32_t shader_getUniformIndex(shader *pShader, const char *uniformName)
+static bool shader_findReference_internal(const shader_name_ref *pReferences, const size_t capacity, const uint64_t nameHash, const char *name, _Out_ uint32_t *pIndex)
 {
-  for (size_t i = 0; i < pShader->uniformReferenceCount; i++)
-    if (strncmp(pShader->pUniformReferences[i].name, uniformName, LS_ARRAYSIZE(pShader->pUniformReferences[i].name)) == 0)
-      return pShader->pUniformReferences[i].index;
+  if (capacity == 0)
+    return false;
+
+  const size_t mask = capacity - 1;
 
+  for (size_t i = (size_t)nameHash & mask; ; i = (i + 1) & mask)
+  {
+    if (pReferences[i].nameHash == nameHash && strcmp(pReferences[i].name, name) == 0)
+    {
+      *pIndex = pReferences[i].index;
+      return true;
+    }
+
+    if (pReferences[i].nameHash == 0)
+      return false;
+  }
+}
+
+static void shader_insertReference_internal(shader_name_ref *pReferences, const size_t capacity, const shader_name_ref ref)
+{
+  const size_t mask = capacity - 1;
+  size_t i = (size_t)ref.nameHash & mask;
+
+  while (pReferences[i].nameHash != 0)
+    i = (i + 1) & mask;
+
+  pReferences[i] = ref;
+}
+
+// Copies `name`, the caller's string may not outlive the shader.
+static lsResult shader_addReference_internal(shader_name_ref **ppReferences, size_t *pCount, size_t *pCapacity, const uint64_t nameHash, const char *name, const uint32_t index)
+{
+  lsResult result = lsR_Success;
+
+  shader_name_ref *pNewReferences = nullptr;
   shader_name_ref ref;
-  ref.index= glGetUniformLocation(pShader->shaderProgram, uniformName);
-  lsAssert(ref.index != (uint32_t)-1);
+  ref.nameHash = nameHash;
+  ref.name = nullptr;
+  ref.index = index;
 
-  const size_t length = strlen(uniformName);
+  const size_t nameLength = strlen(name);
 
-  if (length >= LS_ARRAYSIZE_C_STYLE(shader_name_ref::name))
-    return ref.index;
+  LS_ERROR_CHECK(lsAlloc(&ref.name, nameLength + 1));
+  memcpy(ref.name, name, nameLength + 1);
 
-  if (LS_FAILED(lsRealloc(&pShader->pUniformReferences, pShader->uniformReferenceCount + 1)))
-    return ref.index;
+  // Keep the load factor below 1/2.
+  if ((*pCount + 1) * 2 > *pCapacity)
+  {
+    const size_t newCapacity = lsMax((size_t)16, *pCapacity * 2);
+
+    LS_ERROR_CHECK(lsAllocZero(&pNewReferences, newCapacity));
 
-  memcpy(ref.name, uniformName, length + 1);
+    for (size_t i = 0; i < *pCapacity; i++)
+      if ((*ppReferences)[i].nameHash != 0)
+        shader_insertReference_internal(pNewReferences, newCapacity, (*ppReferences)[i]);
 
-  pShader->pUniformReferences[pShader->uniformReferenceCount] = ref;
-  pShader->uniformReferenceCount++;
+    lsFreePtr(ppReferences);
+    *ppReferences = pNewReferences;
+    pNewReferences = nullptr;
+    *pCapacity = newCapacity;
+  }
 
-  return ref.index;
+  shader_insertReference_internal(*ppReferences, *pCapacity, ref);
+  ref.name = nullptr;
+  (*pCount)++;
+
+epilogue:
+  lsFreePtr(&pNewReferences);
+  lsFreePtr(&ref.name);
+  return result;
 }
 
-uint32_t shader_getAttributeIndex(shader *pShader, const char *attributeName)
+uint32_t shader_getUniformIndex(shader *pShader, const uint64_t nameHash, const char *uniformName)
 {
-  for (size_t i = 0; i < pShader->attributeReferenceCount; i++)
-    if (strncmp(pShader->pAttributeReferences[i].name, attributeName, LS_ARRAYSIZE(pShader->pAttributeReferences[i].name)) == 0)
-      return pShader->pAttributeReferences[i].index;
+  uint32_t index;
 
-  shader_name_ref ref;
-  ref.index = glGetAttribLocation(pShader->shaderProgram, attributeName);
-  lsAssert(ref.index != (uint32_t)-1);
-  
-  const size_t length = strlen(attributeName);
-  
-  if (length >= LS_ARRAYSIZE_C_STYLE(shader_name_ref::name))
-    return ref.index;
+  if (shader_findReference_internal(pShader->pUniformReferences, pShader->uniformReferenceCapacity, nameHash, uniformName, &index))
+    return index;
+
+  index = glGetUniformLocation(pShader->shaderProgram, uniformName);
+  lsAssert(index != (uint32_t)-1);
+
+  shader_addReference_internal(&pShader->pUniformReferences, &pShader->uniformReferenceCount, &pShader->uniformReferenceCapacity, nameHash, uniformName, index); // if this fails, we'll just query again next time.
+
+  return index;
+}
+
+uint32_t shader_getAttributeIndex(shader *pShader, const uint64_t nameHash, const char *attributeName)
+{
+  uint32_t index;
 
-  if (LS_FAILED(lsRealloc(&pShader->pAttributeReferences, pShader->attributeReferenceCount + 1)))
-    return ref.index;
+  if (shader_findReference_internal(pShader->pAttributeReferences, pShader->attributeReferenceCapacity, nameHash, attributeName, &index))
+    return index;
 
-  memcpy(ref.name, attributeName, length + 1);
+  index = glGetAttribLocation(pShader->shaderProgram, attributeName);
+  lsAssert(index != (uint32_t)-1);
 
-  pShader->pAttributeReferences[pShader->attributeReferenceCount] = ref;
-  pShader->attributeReferenceCount++;
+  shader_addReference_internal(&pShader->pAttributeReferences, &pShader->attributeReferenceCount, &pShader->attributeReferenceCapacity, nameHash, attributeName, index); // if this fails, we'll just query again next time.
 
-  return ref.index;
+  return index;
+}
+
+lsResult shader_bindUniformBlock(shader *pShader, const char *blockName, const uint32_t bindingPoint)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pShader == nullptr || blockName == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(!pShader->initialized, lsR_ResourceStateInvalid);
+
+  {
+    const GLuint blockIndex = glGetUniformBlockIndex(pShader->shaderProgram, blockName);
+    LS_ERROR_IF(blockIndex == GL_INVALID_INDEX, lsR_ResourceNotFound);
+
+    glUniformBlockBinding(pShader->shaderProgram, blockIndex, bindingPoint);
+  }
+
+epilogue:
+  return result;
 }
 
 //////////////////////////////////////////////////////////////////////////
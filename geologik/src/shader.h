@@ -2,9 +2,31 @@
 
 #include "platform.h"
 
+// FNV-1a. Never returns 0, as 0 marks empty slots in the shader name reference tables.
+constexpr uint64_t shader_hashName(const char *name)
+{
+  uint64_t hash = 0xCBF29CE484222325ULL;
+
+  for (; *name != '\0'; name++)
+    hash = (hash ^ (uint8_t)*name) * 0x100000001B3ULL;
+
+  return hash == 0 ? 1 : hash;
+}
+
+// Uniform or attribute name with a precomputed hash. Declare as `constexpr` to hash at compile time.
+struct shader_name
+{
+  uint64_t hash;
+  const char *name;
+
+  template <size_t TCount>
+  constexpr shader_name(const char(&text)[TCount]) : hash(shader_hashName(text)), name(text) { }
+};
+
 struct shader_name_ref
 {
-  char name[28];
+  uint64_t nameHash; // 0 if empty.
+  char *name; // owned copy, compared on a hash match so that colliding names get their own entries.
   uint32_t index; // actually a GLuint.
 };
 
@@ -27,10 +49,13 @@ struct shader
 //  const char *fragmentPath = nullptr;
 //#endif
 
+  // Open addressing hash tables (power of two capacity) keyed by `shader_hashName`.
   shader_name_ref *pUniformReferences = nullptr;
   size_t uniformReferenceCount = 0;
+  size_t uniformReferenceCapacity = 0;
   shader_name_ref *pAttributeReferences = nullptr;
   size_t attributeReferenceCount = 0;
+  size_t attributeReferenceCapacity = 0;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -42,6 +67,9 @@ lsResult shader_createFromFile_compute(shader *pShader, const char *computePath)
 
 void shader_bind(shader *pShader);
 
+// Binds the uniform block `blockName` of the shader to the `uniform_buffer` binding point `bindingPoint`.
+lsResult shader_bindUniformBlock(shader *pShader, const char *blockName, const uint32_t bindingPoint);
+
 //#ifdef _DEBUG
 //lsResult shader_reload(shader *pShader);
 //#endif
@@ -50,8 +78,15 @@ void shader_destroy(shader *pShader);
 
 //////////////////////////////////////////////////////////////////////////
 
-uint32_t shader_getUniformIndex(shader *pShader, const char *uniformName);
-uint32_t shader_getAttributeIndex(shader *pShader, const char *attributeName);
+// Resolve uniform & attribute indices once and keep them next to the `shader` to skip the lookup on every set.
+uint32_t shader_getUniformIndex(shader *pShader, const uint64_t nameHash, const char *uniformName);
+uint32_t shader_getAttributeIndex(shader *pShader, const uint64_t nameHash, const char *attributeName);
+
+inline uint32_t shader_getUniformIndex(shader *pShader, const shader_name &name) { return shader_getUniformIndex(pShader, name.hash, name.name); }
+inline uint32_t shader_getAttributeIndex(shader *pShader, const shader_name &name) { return shader_getAttributeIndex(pShader, name.hash, name.name); }
+
+inline uint32_t shader_getUniformIndex(shader *pShader, const char *uniformName) { return shader_getUniformIndex(pShader, shader_hashName(uniformName), uniformName); }
+inline uint32_t shader_getAttributeIndex(shader *pShader, const char *attributeName) { return shader_getAttributeIndex(pShader, shader_hashName(attributeName), attributeName); }
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -98,6 +133,12 @@ void shader_setUniform(shader *pShader, const char *uniformName, T *pV, const si
   void shader_setUniformAtIndex(pShader, shader_getUniformIndex(pShader, uniformName), pV, count);
 }
 
+template <typename T>
+void shader_setUniform(shader *pShader, const shader_name &uniformName, T v)
+{
+  shader_setUniformAtIndex(pShader, shader_getUniformIndex(pShader, uniformName), v);
+}
+
 template <typename T>
 void shader_setUniformDepthStencil(shader *pShader, const char *uniformName, T v)
 {
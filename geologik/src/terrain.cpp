@@ -1,15 +1,36 @@
 #include "terrain.h"
+#include "io.h"
+
+#pragma warning(push)
+#pragma warning(disable: 4100)
+#include "stb_image.h"
+#pragma warning(pop)
 
 lsResult terrain_init(_Out_ terrain *pTerrain, const uint16_t width, const uint16_t height)
 {
   lsResult result = lsR_Success;
 
+  LS_ERROR_IF(pTerrain == nullptr, lsR_ArgumentNull);
+
+  lsZeroMemory(pTerrain);
+
   pTerrain->width = width;
   pTerrain->height = height;
+  pTerrain->chunkCountX = (uint16_t)((width + terrain_chunkSize - 1) / terrain_chunkSize);
+  pTerrain->chunkCountY = (uint16_t)((height + terrain_chunkSize - 1) / terrain_chunkSize);
 
-  LS_ERROR_CHECK(lsAlloc(&(pTerrain->pTiles), width * height));
+  LS_ERROR_CHECK(lsAlloc(&pTerrain->pTiles, (size_t)width * height));
+  LS_ERROR_CHECK(lsAllocZero(&pTerrain->pDirtyChunks, ((size_t)pTerrain->chunkCountX * pTerrain->chunkCountY + 63) / 64));
+  LS_ERROR_CHECK(lsAllocZero(&pTerrain->pUnsavedChunks, ((size_t)pTerrain->chunkCountX * pTerrain->chunkCountY + 63) / 64));
+  LS_ERROR_CHECK(lsAllocZero(&pTerrain->pStaleColumnChunks, ((size_t)pTerrain->chunkCountX * pTerrain->chunkCountY + 63) / 64));
+  LS_ERROR_CHECK(lsAllocZero(&pTerrain->pChunkVersions, (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY));
+
+  terrain_markAllDirty(pTerrain);
 
 epilogue:
+  if (LS_FAILED(result))
+    terrain_destroy(pTerrain);
+
   return result;
 }
 
@@ -31,6 +52,8 @@ void terrain_generate(terrain *pTerrain)
       pTerrain->pTiles[i].layerHeights[tt_bedrock] = 8;
     }
   }
+
+  terrain_markAllDirty(pTerrain);
 }
 
 void terrain_destroy(terrain *pTerrain)
@@ -38,7 +61,416 @@ void terrain_destroy(terrain *pTerrain)
   if (pTerrain == nullptr)
     return;
 
-  lsFreePtr(&pTerrain);
+  lsFreePtr(&pTerrain->pTiles);
+  lsFreePtr(&pTerrain->pDirtyChunks);
+  lsFreePtr(&pTerrain->pUnsavedChunks);
+  lsFreePtr(&pTerrain->pStaleColumnChunks);
+  lsFreePtr(&pTerrain->pChunkVersions);
+  lsFreePtr(&pTerrain->pTotalHeights);
+  lsFreePtr(&pTerrain->pTopLayers);
+  lsFreePtr(&pTerrain->pChunkMinHeights);
+  lsFreePtr(&pTerrain->pChunkMaxHeights);
+
+  for (size_t layer = 0; layer < tt_count; layer++)
+    lsFreePtr(&pTerrain->pFractions[layer]);
+}
+
+lsResult terrain_enableFractions(terrain *pTerrain, const uint32_t layerMask)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pTerrain == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(layerMask >= (1U << tt_count), lsR_ArgumentOutOfBounds);
+
+  for (size_t layer = 0; layer < tt_count; layer++)
+    if ((layerMask & (1U << layer)) && pTerrain->pFractions[layer] == nullptr)
+      LS_ERROR_CHECK(lsAllocZero(&pTerrain->pFractions[layer], (size_t)pTerrain->width * pTerrain->height));
+
+epilogue:
+  return result;
+}
+
+void terrain_disableFractions(terrain *pTerrain)
+{
+  if (pTerrain == nullptr)
+    return;
+
+  const size_t tileCount = (size_t)pTerrain->width * pTerrain->height;
+
+  for (size_t layer = 0; layer < tt_count; layer++)
+  {
+    uint16_t *pFractions = pTerrain->pFractions[layer];
+
+    if (pFractions == nullptr)
+      continue;
+
+    for (size_t i = 0; i < tileCount; i++)
+      if (pFractions[i] >= terrain_fixedOne / 2 && pTerrain->pTiles[i].layerHeights[layer] < UINT16_MAX)
+        pTerrain->pTiles[i].layerHeights[layer]++;
+
+    lsFreePtr(&pTerrain->pFractions[layer]);
+  }
+
+  terrain_markAllDirty(pTerrain);
+}
+
+void terrain_markDirty(terrain *pTerrain, const size_t x, const size_t y, const size_t width, const size_t height)
+{
+  lsAssert(x + width <= pTerrain->width && y + height <= pTerrain->height);
+
+  if (width == 0 || height == 0)
+    return;
+
+  const size_t chunkX0 = x / terrain_chunkSize;
+  const size_t chunkX1 = (x + width - 1) / terrain_chunkSize;
+  const size_t chunkY0 = y / terrain_chunkSize;
+  const size_t chunkY1 = (y + height - 1) / terrain_chunkSize;
+
+  for (size_t cy = chunkY0; cy <= chunkY1; cy++)
+  {
+    for (size_t cx = chunkX0; cx <= chunkX1; cx++)
+    {
+      const size_t index = cy * pTerrain->chunkCountX + cx;
+      pTerrain->pDirtyChunks[index / 64] |= (uint64_t)1 << (index % 64);
+      pTerrain->pUnsavedChunks[index / 64] |= (uint64_t)1 << (index % 64);
+      pTerrain->pStaleColumnChunks[index / 64] |= (uint64_t)1 << (index % 64);
+      pTerrain->pChunkVersions[index]++;
+    }
+  }
+}
+
+void terrain_markAllDirty(terrain *pTerrain)
+{
+  const size_t chunkCount = (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY;
+
+  for (size_t i = 0; i < chunkCount / 64; i++)
+    pTerrain->pDirtyChunks[i] = pTerrain->pUnsavedChunks[i] = pTerrain->pStaleColumnChunks[i] = (uint64_t)-1;
+
+  if (chunkCount % 64)
+    pTerrain->pDirtyChunks[chunkCount / 64] = pTerrain->pUnsavedChunks[chunkCount / 64] = pTerrain->pStaleColumnChunks[chunkCount / 64] = ((uint64_t)1 << (chunkCount % 64)) - 1;
+
+  for (size_t i = 0; i < chunkCount; i++)
+    pTerrain->pChunkVersions[i]++;
 }
 
-// TODO read/write data from/to file
+//////////////////////////////////////////////////////////////////////////
+
+static lsResult terrain_writeValue_internal(FILE *pFile, const void *pValue, const size_t size)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(size != fwrite(pValue, 1, size, pFile), lsR_IOFailure);
+
+epilogue:
+  return result;
+}
+
+static lsResult terrain_readValue_internal(FILE *pFile, _Out_ void *pValue, const size_t size)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(size != fread(pValue, 1, size, pFile), lsR_EndOfStream);
+
+epilogue:
+  return result;
+}
+
+lsResult terrain_read(_Out_ terrain *pTerrain, const char *filename)
+{
+  lsResult result = lsR_Success;
+
+  FILE *pFile = nullptr;
+  tile *pChunk = nullptr;
+  terrain_compressed_chunk *pChunkTable = nullptr;
+  uint8_t *pCompressed = nullptr;
+  size_t compressedCapacity = 0;
+  uint8_t version = 0;
+  uint16_t width = 0;
+  uint16_t height = 0;
+
+  LS_ERROR_IF(pTerrain == nullptr || filename == nullptr, lsR_ArgumentNull);
+
+  pFile = fopen(filename, "rb");
+  LS_ERROR_IF(pFile == nullptr, lsR_ResourceNotFound);
+
+  LS_ERROR_CHECK(terrain_readValue_internal(pFile, &version, sizeof(version)));
+
+  if (version == _Version)
+  {
+    LS_ERROR_CHECK(terrain_readValue_internal(pFile, &width, sizeof(width)));
+    LS_ERROR_CHECK(terrain_readValue_internal(pFile, &height, sizeof(height)));
+
+    LS_ERROR_CHECK(terrain_init(pTerrain, width, height));
+    LS_ERROR_CHECK(terrain_readValue_internal(pFile, pTerrain->pTiles, sizeof(tile) * width * height));
+  }
+  else
+  {
+    LS_ERROR_CHECK(lsSeekFile(pFile, 0));
+    LS_ERROR_CHECK(terrain_readChunkedHeader(pFile, &version, &width, &height));
+
+    LS_ERROR_CHECK(terrain_init(pTerrain, width, height));
+    LS_ERROR_CHECK(lsAlloc(&pChunk, terrain_chunkSize * terrain_chunkSize));
+
+    if (version == _CompressedChunkedVersion)
+    {
+      const size_t chunkCount = (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY;
+
+      LS_ERROR_CHECK(lsAlloc(&pChunkTable, chunkCount));
+      LS_ERROR_CHECK(terrain_readValue_internal(pFile, pChunkTable, sizeof(terrain_compressed_chunk) * chunkCount));
+    }
+
+    for (size_t cy = 0; cy < pTerrain->chunkCountY; cy++)
+    {
+      for (size_t cx = 0; cx < pTerrain->chunkCountX; cx++)
+      {
+        const size_t x = cx * terrain_chunkSize;
+        const size_t y = cy * terrain_chunkSize;
+        const size_t chunkWidth = lsMin(terrain_chunkSize, width - x);
+        const size_t chunkHeight = lsMin(terrain_chunkSize, height - y);
+
+        if (version == _ChunkedVersion)
+        {
+          LS_ERROR_CHECK(terrain_readValue_internal(pFile, pChunk, terrain_chunkBytes));
+        }
+        else
+        {
+          const terrain_compressed_chunk &entry = pChunkTable[cy * pTerrain->chunkCountX + cx];
+
+          if (entry.size == 0)
+          {
+            lsZeroMemory(pChunk, terrain_chunkSize * terrain_chunkSize);
+          }
+          else
+          {
+            LS_ERROR_IF(entry.size > INT32_MAX, lsR_ResourceInvalid);
+
+            if (compressedCapacity < entry.size)
+            {
+              LS_ERROR_CHECK(lsRealloc(&pCompressed, entry.size));
+              compressedCapacity = entry.size;
+            }
+
+            LS_ERROR_CHECK(lsSeekFile(pFile, entry.offset));
+            LS_ERROR_CHECK(terrain_readValue_internal(pFile, pCompressed, entry.size));
+            LS_ERROR_IF((int32_t)terrain_chunkBytes != stbi_zlib_decode_buffer(reinterpret_cast<char *>(pChunk), (int32_t)terrain_chunkBytes, reinterpret_cast<const char *>(pCompressed), (int32_t)entry.size), lsR_ResourceInvalid);
+          }
+        }
+
+        for (size_t row = 0; row < chunkHeight; row++)
+          lsMemcpy(&pTerrain->pTiles[(y + row) * width + x], &pChunk[row * terrain_chunkSize], chunkWidth);
+      }
+    }
+  }
+
+  terrain_markAllDirty(pTerrain);
+
+epilogue:
+  if (pFile != nullptr)
+    fclose(pFile);
+
+  lsFreePtr(&pChunk);
+  lsFreePtr(&pChunkTable);
+  lsFreePtr(&pCompressed);
+
+  return result;
+}
+
+lsResult terrain_write(const terrain *pTerrain, const char *filename)
+{
+  lsResult result = lsR_Success;
+
+  FILE *pFile = nullptr;
+
+  LS_ERROR_IF(pTerrain == nullptr || filename == nullptr, lsR_ArgumentNull);
+
+  pFile = fopen(filename, "wb");
+  LS_ERROR_IF(pFile == nullptr, lsR_IOFailure);
+
+  LS_ERROR_CHECK(terrain_writeValue_internal(pFile, &_Version, sizeof(_Version)));
+  LS_ERROR_CHECK(terrain_writeValue_internal(pFile, &pTerrain->width, sizeof(pTerrain->width)));
+  LS_ERROR_CHECK(terrain_writeValue_internal(pFile, &pTerrain->height, sizeof(pTerrain->height)));
+  LS_ERROR_CHECK(terrain_writeValue_internal(pFile, pTerrain->pTiles, sizeof(tile) * pTerrain->width * pTerrain->height));
+
+epilogue:
+  if (pFile != nullptr)
+    fclose(pFile);
+
+  return result;
+}
+
+lsResult terrain_writeChunked(const terrain *pTerrain, const char *filename)
+{
+  lsResult result = lsR_Success;
+
+  FILE *pFile = nullptr;
+  tile *pChunk = nullptr;
+
+  LS_ERROR_IF(pTerrain == nullptr || filename == nullptr, lsR_ArgumentNull);
+
+  pFile = fopen(filename, "wb");
+  LS_ERROR_IF(pFile == nullptr, lsR_IOFailure);
+
+  LS_ERROR_CHECK(terrain_writeChunkedHeader(pFile, _ChunkedVersion, pTerrain->width, pTerrain->height));
+  LS_ERROR_CHECK(lsAlloc(&pChunk, terrain_chunkSize * terrain_chunkSize));
+
+  for (size_t cy = 0; cy < pTerrain->chunkCountY; cy++)
+  {
+    for (size_t cx = 0; cx < pTerrain->chunkCountX; cx++)
+    {
+      const size_t x = cx * terrain_chunkSize;
+      const size_t y = cy * terrain_chunkSize;
+      const size_t chunkWidth = lsMin(terrain_chunkSize, pTerrain->width - x);
+      const size_t chunkHeight = lsMin(terrain_chunkSize, pTerrain->height - y);
+
+      // Tiles outside of the terrain are zero.
+      if (chunkWidth < terrain_chunkSize || chunkHeight < terrain_chunkSize)
+        lsZeroMemory(pChunk, terrain_chunkSize * terrain_chunkSize);
+
+      for (size_t row = 0; row < chunkHeight; row++)
+        lsMemcpy(&pChunk[row * terrain_chunkSize], &pTerrain->pTiles[(y + row) * pTerrain->width + x], chunkWidth);
+
+      LS_ERROR_CHECK(terrain_writeValue_internal(pFile, pChunk, terrain_chunkBytes));
+    }
+  }
+
+epilogue:
+  if (pFile != nullptr)
+    fclose(pFile);
+
+  lsFreePtr(&pChunk);
+
+  return result;
+}
+
+lsResult terrain_readChunkedHeader(FILE *pFile, _Out_ uint8_t *pVersion, _Out_ uint16_t *pWidth, _Out_ uint16_t *pHeight)
+{
+  lsResult result = lsR_Success;
+
+  uint16_t chunkSize = 0;
+
+  LS_ERROR_IF(pFile == nullptr || pVersion == nullptr || pWidth == nullptr || pHeight == nullptr, lsR_ArgumentNull);
+
+  LS_ERROR_CHECK(terrain_readValue_internal(pFile, pVersion, sizeof(uint8_t)));
+  LS_ERROR_IF(*pVersion != _ChunkedVersion && *pVersion != _CompressedChunkedVersion, lsR_ResourceIncompatible);
+
+  LS_ERROR_CHECK(terrain_readValue_internal(pFile, pWidth, sizeof(uint16_t)));
+  LS_ERROR_CHECK(terrain_readValue_internal(pFile, pHeight, sizeof(uint16_t)));
+  LS_ERROR_CHECK(terrain_readValue_internal(pFile, &chunkSize, sizeof(chunkSize)));
+  LS_ERROR_IF(chunkSize != terrain_chunkSize, lsR_ResourceIncompatible);
+
+  LS_ERROR_CHECK(lsSeekFile(pFile, terrain_chunkedHeaderSize));
+
+epilogue:
+  return result;
+}
+
+lsResult terrain_writeChunkedHeader(FILE *pFile, const uint8_t version, const uint16_t width, const uint16_t height)
+{
+  lsResult result = lsR_Success;
+
+  uint8_t header[terrain_chunkedHeaderSize] = {};
+  const uint16_t chunkSize = (uint16_t)terrain_chunkSize;
+
+  LS_ERROR_IF(pFile == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(version != _ChunkedVersion && version != _CompressedChunkedVersion, lsR_InvalidParameter);
+
+  header[0] = version;
+  lsMemcpy(header + 1, reinterpret_cast<const uint8_t *>(&width), sizeof(uint16_t));
+  lsMemcpy(header + 3, reinterpret_cast<const uint8_t *>(&height), sizeof(uint16_t));
+  lsMemcpy(header + 5, reinterpret_cast<const uint8_t *>(&chunkSize), sizeof(uint16_t));
+
+  LS_ERROR_CHECK(terrain_writeValue_internal(pFile, header, sizeof(header)));
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(11)
+
+DEFINE_TESTABLE(terrain_TestFractions)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  const int32_t tenth = (int32_t)(terrain_fixedOne / 10);
+
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 4, 4));
+  lsZeroMemory(t.pTiles, 16);
+
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&t, 1U << tt_soil));
+
+  // Small amounts add up with fractions, but round to nothing without them.
+  for (size_t i = 0; i < 25; i++)
+  {
+    terrain_addFixedHeight(&t, 0, tt_soil, tenth);
+    terrain_addFixedHeight(&t, 0, tt_sand, tenth);
+  }
+
+  TESTABLE_ASSERT_EQUAL(t.pTiles[0].layerHeights[tt_soil], 2);
+  TESTABLE_ASSERT_EQUAL(t.pTiles[0].layerHeights[tt_sand], 0);
+
+  // Only what's there can be removed.
+  TESTABLE_ASSERT_EQUAL(terrain_addFixedHeight(&t, 1, tt_soil, -tenth), 0);
+  TESTABLE_ASSERT_EQUAL(terrain_addFixedHeight(&t, 0, tt_soil, -10 * (int32_t)terrain_fixedOne), -25 * tenth);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 0, tt_soil), 0U);
+
+  t.pTiles[2].layerHeights[tt_soil] = UINT16_MAX;
+  TESTABLE_ASSERT_EQUAL(terrain_addFixedHeight(&t, 2, tt_soil, (int32_t)terrain_fixedOne), (int32_t)(terrain_fixedOne - 1));
+
+  // Rounds to the nearest decimeter.
+  terrain_addFixedHeight(&t, 3, tt_soil, 6 * tenth);
+  terrain_disableFractions(&t);
+
+  TESTABLE_ASSERT_EQUAL(t.pTiles[3].layerHeights[tt_soil], 1);
+  TESTABLE_ASSERT_EQUAL(t.pTiles[2].layerHeights[tt_soil], UINT16_MAX);
+  TESTABLE_ASSERT_EQUAL(t.pFractions[tt_soil], nullptr);
+
+epilogue:
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrain_TestErode)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  const int64_t tenth = terrain_fixedOne / 10;
+
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 2, 1));
+  lsZeroMemory(t.pTiles, 2);
+
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&t, 1U << tt_sand));
+
+  for (size_t i = 0; i < 2; i++)
+  {
+    t.pTiles[i].layerHeights[tt_soil] = 2;
+    t.pTiles[i].layerHeights[tt_sand] = 5;
+    t.pTiles[i].layerHeights[tt_stone] = 10;
+  }
+
+  // Soil has no fractions and rounds small amounts away, the sand below it stays covered.
+  TESTABLE_ASSERT_EQUAL(terrain_erodeFixedHeight(&t, 0, tt_grass, tt_bedrock, 3 * tenth), (int64_t)0);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 0, tt_sand), 5 * terrain_fixedOne);
+
+  TESTABLE_ASSERT_EQUAL(terrain_erodeFixedHeight(&t, 0, tt_grass, tt_bedrock, 13 * tenth), (int64_t)terrain_fixedOne);
+  TESTABLE_ASSERT_EQUAL(t.pTiles[0].layerHeights[tt_soil], 1);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 0, tt_sand), 5 * terrain_fixedOne);
+
+  // Once a layer is gone, the rest comes from the one below it.
+  TESTABLE_ASSERT_EQUAL(terrain_erodeFixedHeight(&t, 1, tt_grass, tt_bedrock, 23 * tenth), 23 * tenth);
+  TESTABLE_ASSERT_EQUAL(t.pTiles[1].layerHeights[tt_soil], 0);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 1, tt_sand), (uint32_t)(7 * terrain_fixedOne - 23 * tenth));
+  TESTABLE_ASSERT_EQUAL(t.pTiles[1].layerHeights[tt_stone], 10);
+
+epilogue:
+  terrain_destroy(&t);
+  return result;
+}
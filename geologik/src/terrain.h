@@ -3,6 +3,9 @@
 #include "core.h"
 
 constexpr uint8_t _Version = 1;
+constexpr uint8_t _ChunkedVersion = 2;
+constexpr uint8_t _CompressedChunkedVersion = 3;
+constexpr uint8_t _HistoryVersion = 4;
 
 enum terrain_type
 {
@@ -23,14 +26,146 @@ struct tile
   uint16_t layerHeights[tt_count]; // in decimeters
 };
 
+static_assert(sizeof(tile) == sizeof(uint16_t) * tt_count, "tiles are written to files as is");
+
+constexpr size_t terrain_chunkSize = 64; // in tiles. modifications are tracked per chunk.
+constexpr float terrain_tileSize = 100.f; // horizontal size of a tile in decimeters.
+constexpr size_t terrain_chunkedHeaderSize = 4096; // chunks in the chunked file format start page aligned after the header.
+constexpr size_t terrain_chunkBytes = terrain_chunkSize * terrain_chunkSize * sizeof(tile);
+
+// Entry of the chunk table of the compressed chunked file format.
+struct terrain_compressed_chunk
+{
+  uint64_t offset;
+  uint32_t size; // 0 if all tiles are zero.
+  uint32_t _reserved;
+};
+
+static_assert(sizeof(terrain_compressed_chunk) == 16, "chunk table entries are written to files as is");
+
 struct terrain
 {
   uint16_t width;
   uint16_t height;
 
   tile *pTiles;
+
+  uint16_t chunkCountX;
+  uint16_t chunkCountY;
+  uint64_t *pDirtyChunks; // one bit per chunk, row major.
+  uint64_t *pUnsavedChunks; // like `pDirtyChunks`, but cleared by checkpoints instead of uploads.
+  uint64_t *pStaleColumnChunks; // like `pDirtyChunks`, but cleared once the cached columns have been updated.
+  uint32_t *pChunkVersions; // incremented whenever a chunk is marked as dirty, so that processes can tell what changed since they last looked.
+
+  // Cached per tile by `terrainColumns_update`, `nullptr` until then.
+  uint32_t *pTotalHeights;
+  uint8_t *pTopLayers;
+  uint32_t *pChunkMinHeights; // lowest and highest total height per chunk, to skip chunks outside of a height range.
+  uint32_t *pChunkMaxHeights;
+
+  uint16_t *pFractions[tt_count]; // per tile in 1/65536 dm below `layerHeights`, see `terrain_enableFractions`. `nullptr` for most layers.
 };
 
 lsResult terrain_init(_Out_ terrain *pTerrain, const uint16_t width, const uint16_t height);
 void terrain_generate(terrain *pTerrain);
 void terrain_destroy(terrain *pTerrain);
+
+// See the file format in the `README.md`. `terrain_read` reads all versions.
+lsResult terrain_read(_Out_ terrain *pTerrain, const char *filename);
+lsResult terrain_write(const terrain *pTerrain, const char *filename);
+lsResult terrain_writeChunked(const terrain *pTerrain, const char *filename);
+
+// Header of the chunked file formats. Reading leaves the file at the first chunk or the chunk table.
+lsResult terrain_readChunkedHeader(FILE *pFile, _Out_ uint8_t *pVersion, _Out_ uint16_t *pWidth, _Out_ uint16_t *pHeight);
+lsResult terrain_writeChunkedHeader(FILE *pFile, const uint8_t version, const uint16_t width, const uint16_t height);
+
+// Simulation steps move material in amounts far below a decimeter, which would round to zero. Layers in `layerMask` (one bit per
+// `terrain_type`) get planes with the fractional part of their heights, next to the tiles instead of widening them, so everything that
+// only reads whole decimeters doesn't pay for the extra precision. Files only contain the whole decimeters.
+lsResult terrain_enableFractions(terrain *pTerrain, const uint32_t layerMask);
+void terrain_disableFractions(terrain *pTerrain); // rounds the heights to the nearest decimeter.
+
+// Marks all chunks overlapping the given tile rect as modified and unsaved.
+void terrain_markDirty(terrain *pTerrain, const size_t x, const size_t y, const size_t width, const size_t height);
+void terrain_markAllDirty(terrain *pTerrain);
+
+inline bool terrain_isChunkDirty(const terrain *pTerrain, const size_t chunkX, const size_t chunkY)
+{
+  const size_t index = chunkY * pTerrain->chunkCountX + chunkX;
+  return (pTerrain->pDirtyChunks[index / 64] >> (index % 64)) & 1;
+}
+
+inline void terrain_clearChunkDirty(terrain *pTerrain, const size_t chunkX, const size_t chunkY)
+{
+  const size_t index = chunkY * pTerrain->chunkCountX + chunkX;
+  pTerrain->pDirtyChunks[index / 64] &= ~((uint64_t)1 << (index % 64));
+}
+
+inline bool terrain_isChunkUnsaved(const terrain *pTerrain, const size_t chunkX, const size_t chunkY)
+{
+  const size_t index = chunkY * pTerrain->chunkCountX + chunkX;
+  return (pTerrain->pUnsavedChunks[index / 64] >> (index % 64)) & 1;
+}
+
+inline void terrain_clearChunkUnsaved(terrain *pTerrain, const size_t chunkX, const size_t chunkY)
+{
+  const size_t index = chunkY * pTerrain->chunkCountX + chunkX;
+  pTerrain->pUnsavedChunks[index / 64] &= ~((uint64_t)1 << (index % 64));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// Heights in 16.16 fixed point decimeters.
+constexpr uint32_t terrain_fixedOne = 1 << 16;
+
+inline uint32_t terrain_getFixedHeight(const terrain *pTerrain, const size_t index, const terrain_type layer)
+{
+  const uint32_t fraction = pTerrain->pFractions[layer] != nullptr ? pTerrain->pFractions[layer][index] : 0;
+  return ((uint32_t)pTerrain->pTiles[index].layerHeights[layer] << 16) | fraction;
+}
+
+// Rounds to the nearest decimeter for layers without fractions.
+inline void terrain_setFixedHeight(terrain *pTerrain, const size_t index, const terrain_type layer, const uint32_t height)
+{
+  if (pTerrain->pFractions[layer] != nullptr)
+  {
+    pTerrain->pTiles[index].layerHeights[layer] = (uint16_t)(height >> 16);
+    pTerrain->pFractions[layer][index] = (uint16_t)height;
+  }
+  else
+  {
+    pTerrain->pTiles[index].layerHeights[layer] = (uint16_t)lsMin(((uint64_t)height + terrain_fixedOne / 2) >> 16, (uint64_t)UINT16_MAX);
+  }
+}
+
+// Adds as much of `delta` as fits between zero and the maximum height. Returns the change, which is what has to be moved elsewhere to
+// conserve mass.
+inline int32_t terrain_addFixedHeight(terrain *pTerrain, const size_t index, const terrain_type layer, const int32_t delta)
+{
+  const int64_t before = terrain_getFixedHeight(pTerrain, index, layer);
+
+  terrain_setFixedHeight(pTerrain, index, layer, (uint32_t)lsClamp(before + delta, (int64_t)0, (int64_t)UINT32_MAX));
+
+  return (int32_t)((int64_t)terrain_getFixedHeight(pTerrain, index, layer) - before);
+}
+
+// Removes up to `amount` from the layers from `firstLayer` up to `endLayer` (exclusive), but only from the exposed one: the next layer is
+// only eroded once the one above it is gone. Layers without fractions round what they lose, so less than half a decimeter leaves them
+// and everything below them as they are. Returns what was removed.
+inline int64_t terrain_erodeFixedHeight(terrain *pTerrain, const size_t index, const terrain_type firstLayer, const terrain_type endLayer, const int64_t amount)
+{
+  int64_t removed = 0;
+
+  for (size_t layer = firstLayer; layer < endLayer && removed < amount; layer++)
+  {
+    if (terrain_getFixedHeight(pTerrain, index, (terrain_type)layer) == 0)
+      continue;
+
+    removed -= terrain_addFixedHeight(pTerrain, index, (terrain_type)layer, (int32_t)-lsMin(amount - removed, (int64_t)INT32_MAX));
+
+    if (terrain_getFixedHeight(pTerrain, index, (terrain_type)layer) != 0)
+      break;
+  }
+
+  return removed;
+}
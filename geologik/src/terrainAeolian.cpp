@@ -0,0 +1,436 @@
+#include "terrainAeolian.h"
+
+#include "terrainColumns.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+constexpr float terrainAeolian_Diagonal = 1.41421356f;
+constexpr size_t terrainAeolian_MaxHops = 64; // a slab that hasn't landed by then lands anyway, even without any wind.
+constexpr size_t terrainAeolian_MaxAvalancheSteps = 64;
+
+struct terrain_aeolian_rect
+{
+  size_t minX, minY, maxX, maxY; // the maximum is exclusive.
+};
+
+struct terrain_aeolian_context
+{
+  terrain *pTerrain;
+  const terrain_aeolian_params *pParams;
+  const uint32_t *pChunks; // of the current phase.
+  uint64_t seed; // of this step.
+  float shadowX, shadowY; // unit vector against the wind.
+  float shadowSlope; // height difference per tile below which the shadow zone starts, in decimeters.
+  float reposeSlope; // height difference per tile that sand still holds on.
+  terrain_aeolian_rect *pChangedRects; // per chunk.
+};
+
+struct terrain_aeolian_block
+{
+  const terrain_aeolian_context *pContext;
+  terrain *pTerrain;
+  terrain_aeolian_rect region; // tiles the chunk may read and modify.
+  terrain_aeolian_rect changed;
+  rand_seed seed;
+};
+
+static bool terrainAeolian_hasLooseSand_internal(const tile *pTile, const uint16_t slabHeight)
+{
+  return (pTile->layerHeights[tt_snow] | pTile->layerHeights[tt_water] | pTile->layerHeights[tt_grass] | pTile->layerHeights[tt_soil]) == 0 && pTile->layerHeights[tt_sand] >= slabHeight;
+}
+
+static bool terrainAeolian_isInRegion_internal(const terrain_aeolian_block *pBlock, const int64_t x, const int64_t y)
+{
+  return x >= (int64_t)pBlock->region.minX && x < (int64_t)pBlock->region.maxX && y >= (int64_t)pBlock->region.minY && y < (int64_t)pBlock->region.maxY;
+}
+
+// Adds or removes a slab, keeping the total height up to date.
+static void terrainAeolian_changeSand_internal(terrain_aeolian_block *pBlock, const size_t x, const size_t y, const bool add)
+{
+  terrain *pTerrain = pBlock->pTerrain;
+  const size_t i = y * pTerrain->width + x;
+  const uint16_t slabHeight = pBlock->pContext->pParams->slabHeight;
+
+  if (add)
+  {
+    pTerrain->pTiles[i].layerHeights[tt_sand] += slabHeight;
+    pTerrain->pTotalHeights[i] += slabHeight;
+  }
+  else
+  {
+    pTerrain->pTiles[i].layerHeights[tt_sand] -= slabHeight;
+    pTerrain->pTotalHeights[i] -= slabHeight;
+  }
+
+  pBlock->changed.minX = lsMin(pBlock->changed.minX, x);
+  pBlock->changed.minY = lsMin(pBlock->changed.minY, y);
+  pBlock->changed.maxX = lsMax(pBlock->changed.maxX, x + 1);
+  pBlock->changed.maxY = lsMax(pBlock->changed.maxY, y + 1);
+}
+
+static bool terrainAeolian_canLand_internal(const terrain_aeolian_block *pBlock, const size_t x, const size_t y)
+{
+  return pBlock->pTerrain->pTiles[y * pBlock->pTerrain->width + x].layerHeights[tt_sand] <= UINT16_MAX - pBlock->pContext->pParams->slabHeight;
+}
+
+// Looks upwind for terrain above the shadow angle. Stops at the edge of the region.
+static bool terrainAeolian_isInShadow_internal(const terrain_aeolian_block *pBlock, const size_t x, const size_t y)
+{
+  const terrain_aeolian_context *pContext = pBlock->pContext;
+  const terrain *pTerrain = pBlock->pTerrain;
+  const float height = (float)pTerrain->pTotalHeights[y * pTerrain->width + x];
+
+  for (size_t distance = 1; distance <= terrainAeolian_MaxReach; distance++)
+  {
+    const int64_t sx = (int64_t)floorf((float)x + pContext->shadowX * (float)distance + 0.5f);
+    const int64_t sy = (int64_t)floorf((float)y + pContext->shadowY * (float)distance + 0.5f);
+
+    if (!terrainAeolian_isInRegion_internal(pBlock, sx, sy))
+      return false;
+
+    if ((float)pTerrain->pTotalHeights[(size_t)sy * pTerrain->width + (size_t)sx] - height > pContext->shadowSlope * (float)distance)
+      return true;
+  }
+
+  return false;
+}
+
+// Finds the neighbour with the steepest drop from (`upslope` ? the neighbour to the tile : the tile to the neighbour) beyond the angle
+// of repose. Returns false if there is none.
+static bool terrainAeolian_findAvalanche_internal(const terrain_aeolian_block *pBlock, const size_t x, const size_t y, const bool upslope, _Out_ size_t *pX, _Out_ size_t *pY)
+{
+  const terrain *pTerrain = pBlock->pTerrain;
+  const float height = (float)pTerrain->pTotalHeights[y * pTerrain->width + x];
+  float steepest = pBlock->pContext->reposeSlope;
+  bool found = false;
+
+  for (int64_t dy = -1; dy <= 1; dy++)
+  {
+    for (int64_t dx = -1; dx <= 1; dx++)
+    {
+      const int64_t nx = (int64_t)x + dx;
+      const int64_t ny = (int64_t)y + dy;
+
+      if ((dx == 0 && dy == 0) || !terrainAeolian_isInRegion_internal(pBlock, nx, ny))
+        continue;
+
+      const size_t n = (size_t)ny * pTerrain->width + (size_t)nx;
+      const float difference = (float)pTerrain->pTotalHeights[n] - height;
+      const float slope = (upslope ? difference : -difference) / ((dx != 0 && dy != 0) ? terrainAeolian_Diagonal : 1.f);
+
+      if (slope <= steepest)
+        continue;
+
+      if (upslope ? !terrainAeolian_hasLooseSand_internal(&pTerrain->pTiles[n], pBlock->pContext->pParams->slabHeight) : !terrainAeolian_canLand_internal(pBlock, (size_t)nx, (size_t)ny))
+        continue;
+
+      steepest = slope;
+      *pX = (size_t)nx;
+      *pY = (size_t)ny;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+// Slides slabs down from a tile that has just received one, as long as it's too steep.
+static void terrainAeolian_slide_internal(terrain_aeolian_block *pBlock, size_t x, size_t y)
+{
+  for (size_t step = 0; step < terrainAeolian_MaxAvalancheSteps; step++)
+  {
+    size_t nx, ny;
+
+    if (!terrainAeolian_hasLooseSand_internal(&pBlock->pTerrain->pTiles[y * pBlock->pTerrain->width + x], pBlock->pContext->pParams->slabHeight) || !terrainAeolian_findAvalanche_internal(pBlock, x, y, false, &nx, &ny))
+      return;
+
+    terrainAeolian_changeSand_internal(pBlock, x, y, false);
+    terrainAeolian_changeSand_internal(pBlock, nx, ny, true);
+
+    x = nx;
+    y = ny;
+  }
+}
+
+// Slides slabs into a tile that has just lost one, from neighbours that are too steep now.
+static void terrainAeolian_fill_internal(terrain_aeolian_block *pBlock, size_t x, size_t y)
+{
+  for (size_t step = 0; step < terrainAeolian_MaxAvalancheSteps; step++)
+  {
+    size_t nx, ny;
+
+    if (!terrainAeolian_canLand_internal(pBlock, x, y) || !terrainAeolian_findAvalanche_internal(pBlock, x, y, true, &nx, &ny))
+      return;
+
+    terrainAeolian_changeSand_internal(pBlock, nx, ny, false);
+    terrainAeolian_changeSand_internal(pBlock, x, y, true);
+
+    x = nx;
+    y = ny;
+  }
+}
+
+static float terrainAeolian_getChance_internal(rand_seed &seed)
+{
+  return (float)(lsGetRand(seed) >> 40) * (1.f / (1 << 24));
+}
+
+static void terrainAeolian_processChunk_internal(void *pUserData, const size_t index)
+{
+  const terrain_aeolian_context *pContext = reinterpret_cast<const terrain_aeolian_context *>(pUserData);
+  terrain *pTerrain = pContext->pTerrain;
+  const terrain_aeolian_params *pParams = pContext->pParams;
+
+  const size_t chunk = pContext->pChunks[index];
+  const size_t x0 = (chunk % pTerrain->chunkCountX) * terrain_chunkSize;
+  const size_t y0 = (chunk / pTerrain->chunkCountX) * terrain_chunkSize;
+  const size_t width = lsMin(terrain_chunkSize, pTerrain->width - x0);
+  const size_t height = lsMin(terrain_chunkSize, pTerrain->height - y0);
+  const size_t picks = (size_t)(pParams->picksPerTile * (float)(width * height) + 0.5f);
+
+  terrain_aeolian_block block =
+  {
+    pContext,
+    pTerrain,
+    { x0 - lsMin(x0, terrainAeolian_MaxReach), y0 - lsMin(y0, terrainAeolian_MaxReach), lsMin(x0 + width + terrainAeolian_MaxReach, (size_t)pTerrain->width), lsMin(y0 + height + terrainAeolian_MaxReach, (size_t)pTerrain->height) },
+    { SIZE_MAX, SIZE_MAX, 0, 0 },
+    rand_seed(pContext->seed, (uint64_t)chunk << 1),
+  };
+
+  for (size_t pick = 0; pick < picks; pick++)
+  {
+    const size_t x = x0 + lsGetRand(block.seed) % width;
+    const size_t y = y0 + lsGetRand(block.seed) % height;
+
+    if (!terrainAeolian_hasLooseSand_internal(&pTerrain->pTiles[y * pTerrain->width + x], pParams->slabHeight) || terrainAeolian_isInShadow_internal(&block, x, y))
+      continue;
+
+    terrainAeolian_changeSand_internal(&block, x, y, false);
+    terrainAeolian_fill_internal(&block, x, y);
+
+    // Hops until the slab lands. Hops ending outside of the region land on the last tile inside it instead.
+    float px = (float)x;
+    float py = (float)y;
+    size_t lastX = x;
+    size_t lastY = y;
+
+    for (size_t hop = 0; ; hop++)
+    {
+      px += pParams->windX;
+      py += pParams->windY;
+
+      if (px < -0.5f || py < -0.5f || px >= (float)pTerrain->width - 0.5f || py >= (float)pTerrain->height - 0.5f)
+        break; // blown off the map.
+
+      const size_t nx = (size_t)(px + 0.5f);
+      const size_t ny = (size_t)(py + 0.5f);
+
+      if (!terrainAeolian_isInRegion_internal(&block, (int64_t)nx, (int64_t)ny) || hop + 1 == terrainAeolian_MaxHops)
+      {
+        const bool inRegion = terrainAeolian_isInRegion_internal(&block, (int64_t)nx, (int64_t)ny);
+        const size_t landX = inRegion ? nx : lastX;
+        const size_t landY = inRegion ? ny : lastY;
+
+        if (terrainAeolian_canLand_internal(&block, landX, landY))
+        {
+          terrainAeolian_changeSand_internal(&block, landX, landY, true);
+          terrainAeolian_slide_internal(&block, landX, landY);
+        }
+
+        break;
+      }
+
+      const tile *pTile = &pTerrain->pTiles[ny * pTerrain->width + nx];
+      const float chance = terrainAeolian_isInShadow_internal(&block, nx, ny) ? 1.f : (pTile->layerHeights[tt_sand] != 0 ? pParams->sandDepositChance : pParams->bareDepositChance);
+
+      if (terrainAeolian_getChance_internal(block.seed) < chance && terrainAeolian_canLand_internal(&block, nx, ny))
+      {
+        terrainAeolian_changeSand_internal(&block, nx, ny, true);
+        terrainAeolian_slide_internal(&block, nx, ny);
+        break;
+      }
+
+      lastX = nx;
+      lastY = ny;
+    }
+  }
+
+  pContext->pChangedRects[chunk] = block.changed;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainAeolian_step(terrain *pTerrain, const terrain_aeolian_params *pParams, rand_seed *pSeed, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_aeolian_context context;
+  lsZeroMemory(&context);
+  uint32_t *pChunks = nullptr;
+  size_t chunkCount = 0;
+  float windLength = 0;
+
+  LS_ERROR_IF(pTerrain == nullptr || pParams == nullptr || pSeed == nullptr || pPool == nullptr, lsR_ArgumentNull);
+
+  windLength = sqrtf(pParams->windX * pParams->windX + pParams->windY * pParams->windY);
+
+  LS_ERROR_IF(windLength > (float)terrainAeolian_MaxReach || pParams->slabHeight == 0 || pParams->picksPerTile < 0, lsR_ArgumentOutOfBounds);
+
+  chunkCount = (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY;
+
+  LS_ERROR_CHECK(lsAlloc(&pChunks, chunkCount));
+  LS_ERROR_CHECK(lsAlloc(&context.pChangedRects, chunkCount));
+  LS_ERROR_CHECK(terrainColumns_update(pTerrain, pPool));
+
+  context.pTerrain = pTerrain;
+  context.pParams = pParams;
+  context.pChunks = pChunks;
+  context.seed = lsGetRand(*pSeed);
+  context.shadowX = windLength > 0 ? -pParams->windX / windLength : 0.f;
+  context.shadowY = windLength > 0 ? -pParams->windY / windLength : 0.f;
+  context.shadowSlope = tanf(pParams->shadowAngle * (float)(3.14159265358979 / 180.0)) * terrain_tileSize;
+  context.reposeSlope = tanf(terrainMaterial_Properties[tt_sand].talusAngle * (float)(3.14159265358979 / 180.0)) * terrain_tileSize;
+
+  for (size_t phase = 0; phase < 4; phase++)
+  {
+    size_t count = 0;
+
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+      if (((chunk % pTerrain->chunkCountX) & 1) + ((chunk / pTerrain->chunkCountX) & 1) * 2 == phase)
+        pChunks[count++] = (uint32_t)chunk;
+
+    threadPool_parallelFor(pPool, count, terrainAeolian_processChunk_internal, &context);
+  }
+
+  for (size_t chunk = 0; chunk < chunkCount; chunk++)
+  {
+    const terrain_aeolian_rect *pRect = &context.pChangedRects[chunk];
+
+    if (pRect->minX < pRect->maxX)
+      terrain_markDirty(pTerrain, pRect->minX, pRect->minY, pRect->maxX - pRect->minX, pRect->maxY - pRect->minY);
+  }
+
+epilogue:
+  lsFreePtr(&pChunks);
+  lsFreePtr(&context.pChangedRects);
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(17)
+
+static void terrainAeolian_createDunefield_internal(terrain *pTerrain)
+{
+  rand_seed seed(7, 11);
+
+  for (size_t y = 0; y < pTerrain->height; y++)
+  {
+    for (size_t x = 0; x < pTerrain->width; x++)
+    {
+      tile *pTile = &pTerrain->pTiles[y * pTerrain->width + x];
+
+      lsZeroMemory(pTile);
+      pTile->layerHeights[tt_bedrock] = 8;
+      pTile->layerHeights[tt_stone] = 100;
+      pTile->layerHeights[tt_sand] = (uint16_t)(x >= 32 && x < 96 ? 10 + lsGetRand(seed) % 5 : 0);
+    }
+  }
+}
+
+DEFINE_TESTABLE(terrainAeolian_TestTransport)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  thread_pool *pPool = nullptr;
+  terrain_aeolian_params params;
+  rand_seed seed(1, 2);
+
+  uint64_t sandBefore = 0;
+  uint64_t sandAfter = 0;
+  double centerBefore = 0;
+  double centerAfter = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 320, 100));
+
+  terrainAeolian_createDunefield_internal(&t);
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    sandBefore += t.pTiles[i].layerHeights[tt_sand];
+    centerBefore += (double)(i % t.width) * t.pTiles[i].layerHeights[tt_sand];
+  }
+
+  for (size_t step = 0; step < 4; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainAeolian_step(&t, &params, &seed, pPool));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    sandAfter += t.pTiles[i].layerHeights[tt_sand];
+    centerAfter += (double)(i % t.width) * t.pTiles[i].layerHeights[tt_sand];
+
+    // Nothing blows upwind, the total heights are kept up to date.
+    if (i % t.width < 32)
+      TESTABLE_ASSERT_EQUAL(t.pTiles[i].layerHeights[tt_sand], 0);
+
+    TESTABLE_ASSERT_EQUAL(t.pTotalHeights[i], 108u + t.pTiles[i].layerHeights[tt_sand]);
+  }
+
+  // The sand moves downwind, none of it reaches the edge yet.
+  TESTABLE_ASSERT_EQUAL(sandAfter, sandBefore);
+  TESTABLE_ASSERT_EQUAL(centerAfter / (double)sandAfter > centerBefore / (double)sandBefore + 0.2, true);
+  TESTABLE_ASSERT_EQUAL(terrain_isChunkDirty(&t, 2, 0), true);
+
+epilogue:
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainAeolian_TestDeterministic)
+{
+  lsResult result = lsR_Success;
+
+  terrain a;
+  lsZeroMemory(&a);
+
+  terrain b;
+  lsZeroMemory(&b);
+
+  thread_pool *pSinglePool = nullptr;
+  thread_pool *pPool = nullptr;
+  terrain_aeolian_params params;
+  params.windX = 3.f;
+  params.windY = 2.f;
+
+  rand_seed seedA(3, 4);
+  rand_seed seedB(3, 4);
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pSinglePool, 1));
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 3));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&a, 200, 150));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&b, 200, 150));
+
+  terrainAeolian_createDunefield_internal(&a);
+  terrainAeolian_createDunefield_internal(&b);
+
+  for (size_t step = 0; step < 3; step++)
+  {
+    TESTABLE_ASSERT_SUCCESS(terrainAeolian_step(&a, &params, &seedA, pSinglePool));
+    TESTABLE_ASSERT_SUCCESS(terrainAeolian_step(&b, &params, &seedB, pPool));
+  }
+
+  TESTABLE_ASSERT_EQUAL(memcmp(a.pTiles, b.pTiles, sizeof(tile) * a.width * a.height), 0);
+
+epilogue:
+  threadPool_destroy(&pSinglePool);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&a);
+  terrain_destroy(&b);
+  return result;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "terrainMaterial.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Wind blowing sand into dunes, after Werner (1995). The wind lifts slabs of exposed sand at random tiles and carries them downwind in
+// saltation hops. After every hop a slab lands with a chance depending on whether there is sand, and always in the shadow zone behind
+// higher terrain, where it can't be lifted either. Sand steeper than its angle of repose slides down.
+// Hops reach at most `terrainAeolian_MaxReach` tiles beyond the chunk they start in, so chunks are processed in four phases of every
+// other chunk in both directions, which can't touch the same tiles. Every chunk draws from its own `rand_seed`, derived from the one
+// passed in, so the result only depends on that seed and not on the number of threads.
+
+constexpr size_t terrainAeolian_MaxReach = terrain_chunkSize / 2; // in tiles.
+
+struct terrain_aeolian_params
+{
+  float windX = 4.f; // displacement of a hop in tiles, along the prevailing wind. at most `terrainAeolian_MaxReach` long.
+  float windY = 0.f;
+  uint16_t slabHeight = 1; // in decimeters.
+  float picksPerTile = 0.2f; // slabs the wind tries to lift per tile and step.
+  float sandDepositChance = 0.6f; // of a slab landing on sand after a hop.
+  float bareDepositChance = 0.4f; // of a slab landing elsewhere.
+  float shadowAngle = 15.f; // in degrees, below higher terrain upwind.
+};
+
+// Moves the sand of `pTerrain` for one step. Updates the cached columns first and keeps the total heights up to date. Slabs blown across
+// the edges of the map leave it.
+lsResult terrainAeolian_step(terrain *pTerrain, const terrain_aeolian_params *pParams, rand_seed *pSeed, thread_pool *pPool);
@@ -0,0 +1,464 @@
+#include "terrainCheckpoint.h"
+#include "io.h"
+#include "pngWriter.h"
+#include "queue.h"
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+//////////////////////////////////////////////////////////////////////////
+
+constexpr uint32_t terrainCheckpoint_EndOfSnapshot = (uint32_t)-1;
+
+struct terrain_checkpoint_job
+{
+  uint32_t chunkIndex; // `terrainCheckpoint_EndOfSnapshot` after the last chunk of a snapshot.
+  uint32_t bufferIndex;
+};
+
+struct terrain_checkpoint_writer
+{
+  FILE *pFile = nullptr;
+  bool compress = false;
+  thread_pool *pPool = nullptr;
+
+  uint16_t width = 0;
+  uint16_t height = 0;
+  size_t chunkCount = 0;
+  bool firstSnapshot = true;
+
+  tile *pBuffers = nullptr;
+  size_t bufferCount = 0;
+  size_t batchSize = 0; // the writer waits for this many chunks, so the snapshot fills the other buffers in the meantime.
+
+  // Only accessed by the writer thread.
+  terrain_checkpoint_job *pBatch = nullptr;
+  uint8_t **ppCompressed = nullptr; // per batch entry, `nullptr` for chunks that are all zero.
+  int32_t *pCompressedSizes = nullptr;
+  terrain_compressed_chunk *pChunkTable = nullptr;
+  uint64_t endOffset = 0;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  queue<uint32_t> freeBuffers;
+  queue<terrain_checkpoint_job> jobs;
+  size_t queuedSnapshotEnds = 0;
+  size_t snapshotCount = 0;
+  size_t writtenSnapshotCount = 0;
+  lsResult writeResult = lsR_Success; // once writing failed, the remaining snapshots are dropped.
+  bool stop = false;
+
+  std::thread thread;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+static tile *terrainCheckpoint_getBuffer_internal(terrain_checkpoint_writer *pWriter, const uint32_t bufferIndex)
+{
+  return pWriter->pBuffers + (size_t)bufferIndex * terrain_chunkSize * terrain_chunkSize;
+}
+
+static void terrainCheckpoint_compress_internal(void *pUserData, const size_t index)
+{
+  terrain_checkpoint_writer *pWriter = reinterpret_cast<terrain_checkpoint_writer *>(pUserData);
+  uint8_t *pChunk = reinterpret_cast<uint8_t *>(terrainCheckpoint_getBuffer_internal(pWriter, pWriter->pBatch[index].bufferIndex));
+
+  bool empty = true;
+
+  for (size_t i = 0; i < terrain_chunkBytes && empty; i++)
+    empty = pChunk[i] == 0;
+
+  pWriter->ppCompressed[index] = nullptr;
+  pWriter->pCompressedSizes[index] = 0;
+
+  if (empty)
+    return;
+
+  pWriter->pCompressedSizes[index] = -1; // in case compressing fails.
+  pWriter->ppCompressed[index] = stbi_zlib_compress(pChunk, (int32_t)terrain_chunkBytes, &pWriter->pCompressedSizes[index], pngWriter_CompressionQuality);
+}
+
+static lsResult terrainCheckpoint_writeBatch_internal(terrain_checkpoint_writer *pWriter, const size_t count)
+{
+  lsResult result = lsR_Success;
+
+  if (pWriter->compress)
+  {
+    threadPool_parallelFor(pWriter->pPool, count, terrainCheckpoint_compress_internal, pWriter);
+
+    // The chunk table still references the previous versions of these chunks until the snapshot is complete.
+    LS_ERROR_CHECK(lsSeekFile(pWriter->pFile, pWriter->endOffset));
+
+    for (size_t i = 0; i < count; i++)
+    {
+      const int32_t size = pWriter->pCompressedSizes[i];
+      terrain_compressed_chunk *pEntry = &pWriter->pChunkTable[pWriter->pBatch[i].chunkIndex];
+
+      LS_ERROR_IF(size < 0, lsR_MemoryAllocationFailure);
+
+      if (size > 0)
+        LS_ERROR_IF((size_t)size != fwrite(pWriter->ppCompressed[i], 1, (size_t)size, pWriter->pFile), lsR_IOFailure);
+
+      pEntry->offset = size > 0 ? pWriter->endOffset : 0;
+      pEntry->size = (uint32_t)size;
+      pWriter->endOffset += (uint64_t)size;
+    }
+  }
+  else
+  {
+    // Chunks are queued in row major order, so runs of neighbouring chunks are written without seeking in between.
+    for (size_t i = 0; i < count;)
+    {
+      LS_ERROR_CHECK(lsSeekFile(pWriter->pFile, terrain_chunkedHeaderSize + (uint64_t)pWriter->pBatch[i].chunkIndex * terrain_chunkBytes));
+
+      do
+      {
+        LS_ERROR_IF(terrain_chunkBytes != fwrite(terrainCheckpoint_getBuffer_internal(pWriter, pWriter->pBatch[i].bufferIndex), 1, terrain_chunkBytes, pWriter->pFile), lsR_IOFailure);
+        i++;
+      } while (i < count && pWriter->pBatch[i].chunkIndex == pWriter->pBatch[i - 1].chunkIndex + 1);
+    }
+  }
+
+epilogue:
+  if (pWriter->compress)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      free(pWriter->ppCompressed[i]);
+      pWriter->ppCompressed[i] = nullptr;
+    }
+  }
+
+  return result;
+}
+
+static lsResult terrainCheckpoint_finishSnapshot_internal(terrain_checkpoint_writer *pWriter)
+{
+  lsResult result = lsR_Success;
+
+  // Replacing the chunk table last keeps the previous snapshot readable until then.
+  if (pWriter->compress)
+  {
+    LS_ERROR_CHECK(lsSeekFile(pWriter->pFile, terrain_chunkedHeaderSize));
+    LS_ERROR_IF(pWriter->chunkCount != fwrite(pWriter->pChunkTable, sizeof(terrain_compressed_chunk), pWriter->chunkCount, pWriter->pFile), lsR_IOFailure);
+  }
+
+  LS_ERROR_IF(0 != fflush(pWriter->pFile), lsR_IOFailure);
+
+epilogue:
+  return result;
+}
+
+static void terrainCheckpoint_writer_internal(terrain_checkpoint_writer *pWriter)
+{
+  while (true)
+  {
+    size_t count = 0;
+    bool endOfSnapshot = false;
+    bool failed = false;
+
+    {
+      std::unique_lock<std::mutex> lock(pWriter->mutex);
+
+      pWriter->condition.wait(lock, [pWriter]() { return pWriter->stop || pWriter->queuedSnapshotEnds > 0 || pWriter->jobs.count >= pWriter->batchSize; });
+
+      if (pWriter->jobs.count == 0)
+        return; // stopped.
+
+      while (pWriter->jobs.count > 0 && count < pWriter->batchSize)
+      {
+        terrain_checkpoint_job job;
+        queue_popFront(&pWriter->jobs, &job);
+
+        if (job.chunkIndex == terrainCheckpoint_EndOfSnapshot)
+        {
+          pWriter->queuedSnapshotEnds--;
+          endOfSnapshot = true;
+          break;
+        }
+
+        pWriter->pBatch[count++] = job;
+      }
+
+      failed = LS_FAILED(pWriter->writeResult);
+    }
+
+    lsResult result = lsR_Success;
+
+    if (!failed && count > 0)
+      result = terrainCheckpoint_writeBatch_internal(pWriter, count);
+
+    if (!failed && endOfSnapshot && LS_SUCCESS(result))
+      result = terrainCheckpoint_finishSnapshot_internal(pWriter);
+
+    {
+      std::unique_lock<std::mutex> lock(pWriter->mutex);
+
+      for (size_t i = 0; i < count; i++)
+        queue_pushBack(&pWriter->freeBuffers, pWriter->pBatch[i].bufferIndex); // can't fail, there's capacity for all buffers.
+
+      if (LS_FAILED(result) && LS_SUCCESS(pWriter->writeResult))
+        pWriter->writeResult = result;
+
+      if (endOfSnapshot)
+        pWriter->writtenSnapshotCount++;
+    }
+
+    pWriter->condition.notify_all();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainCheckpoint_create(_Out_ terrain_checkpoint_writer **ppWriter, const char *filename, const terrain *pTerrain, const size_t memoryBudgetBytes, const bool compress, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_checkpoint_writer *pWriter = nullptr;
+
+  LS_ERROR_IF(ppWriter == nullptr || filename == nullptr || pTerrain == nullptr || pPool == nullptr, lsR_ArgumentNull);
+
+  pWriter = new (std::nothrow) terrain_checkpoint_writer();
+  LS_ERROR_IF(pWriter == nullptr, lsR_MemoryAllocationFailure);
+
+  pWriter->compress = compress;
+  pWriter->pPool = pPool;
+  pWriter->width = pTerrain->width;
+  pWriter->height = pTerrain->height;
+  pWriter->chunkCount = (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY;
+
+  pWriter->bufferCount = lsMin(memoryBudgetBytes / terrain_chunkBytes, pWriter->chunkCount);
+  LS_ERROR_IF(pWriter->bufferCount < lsMin(terrainCheckpoint_MinStagingChunks, pWriter->chunkCount), lsR_ResourceInsufficient);
+  pWriter->batchSize = lsMax((size_t)1, pWriter->bufferCount / 2);
+
+  LS_ERROR_CHECK(lsAlloc(&pWriter->pBuffers, pWriter->bufferCount * terrain_chunkSize * terrain_chunkSize));
+  LS_ERROR_CHECK(lsAlloc(&pWriter->pBatch, pWriter->batchSize));
+  LS_ERROR_CHECK(queue_reserve(&pWriter->freeBuffers, pWriter->bufferCount + 1)); // `queue_pushBack` grows before the queue is full.
+  LS_ERROR_CHECK(queue_reserve(&pWriter->jobs, pWriter->bufferCount + 1));
+
+  for (uint32_t i = 0; i < (uint32_t)pWriter->bufferCount; i++)
+    LS_ERROR_CHECK(queue_pushBack(&pWriter->freeBuffers, i));
+
+  if (compress)
+  {
+    LS_ERROR_CHECK(lsAllocZero(&pWriter->ppCompressed, pWriter->batchSize));
+    LS_ERROR_CHECK(lsAllocZero(&pWriter->pCompressedSizes, pWriter->batchSize));
+    LS_ERROR_CHECK(lsAllocZero(&pWriter->pChunkTable, pWriter->chunkCount)); // all chunks are zero until the first snapshot.
+  }
+
+  pWriter->pFile = fopen(filename, "wb");
+  LS_ERROR_IF(pWriter->pFile == nullptr, lsR_IOFailure);
+
+  LS_ERROR_CHECK(terrain_writeChunkedHeader(pWriter->pFile, compress ? _CompressedChunkedVersion : _ChunkedVersion, pWriter->width, pWriter->height));
+
+  // Extend the file to the end of the chunk table or the chunks, so it's valid before the first snapshot has been written.
+  {
+    const uint64_t size = terrain_chunkedHeaderSize + pWriter->chunkCount * (compress ? sizeof(terrain_compressed_chunk) : terrain_chunkBytes);
+    const uint8_t zero = 0;
+
+    LS_ERROR_CHECK(lsSeekFile(pWriter->pFile, size - 1));
+    LS_ERROR_IF(1 != fwrite(&zero, 1, 1, pWriter->pFile), lsR_IOFailure);
+
+    pWriter->endOffset = size;
+  }
+
+  pWriter->thread = std::thread(terrainCheckpoint_writer_internal, pWriter);
+
+  *ppWriter = pWriter;
+  pWriter = nullptr;
+
+epilogue:
+  terrainCheckpoint_destroy(&pWriter);
+  return result;
+}
+
+void terrainCheckpoint_destroy(terrain_checkpoint_writer **ppWriter)
+{
+  if (ppWriter == nullptr || *ppWriter == nullptr)
+    return;
+
+  terrain_checkpoint_writer *pWriter = *ppWriter;
+
+  if (pWriter->thread.joinable())
+  {
+    {
+      std::unique_lock<std::mutex> lock(pWriter->mutex);
+      pWriter->stop = true;
+    }
+
+    pWriter->condition.notify_all();
+    pWriter->thread.join();
+  }
+
+  if (pWriter->pFile != nullptr)
+    fclose(pWriter->pFile);
+
+  lsFreePtr(&pWriter->pBuffers);
+  lsFreePtr(&pWriter->pBatch);
+  lsFreePtr(&pWriter->ppCompressed);
+  lsFreePtr(&pWriter->pCompressedSizes);
+  lsFreePtr(&pWriter->pChunkTable);
+  queue_destroy(&pWriter->freeBuffers);
+  queue_destroy(&pWriter->jobs);
+
+  delete pWriter;
+  *ppWriter = nullptr;
+}
+
+lsResult terrainCheckpoint_snapshot(terrain_checkpoint_writer *pWriter, terrain *pTerrain)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pWriter == nullptr || pTerrain == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pTerrain->width != pWriter->width || pTerrain->height != pWriter->height, lsR_ResourceIncompatible);
+
+  {
+    std::unique_lock<std::mutex> lock(pWriter->mutex);
+    LS_ERROR_CHECK(pWriter->writeResult);
+  }
+
+  for (size_t cy = 0; cy < pTerrain->chunkCountY; cy++)
+  {
+    for (size_t cx = 0; cx < pTerrain->chunkCountX; cx++)
+    {
+      if (!pWriter->firstSnapshot && !terrain_isChunkUnsaved(pTerrain, cx, cy))
+        continue;
+
+      terrain_checkpoint_job job;
+      job.chunkIndex = (uint32_t)(cy * pTerrain->chunkCountX + cx);
+
+      // Only waits for the writer if all staging buffers are in flight.
+      {
+        std::unique_lock<std::mutex> lock(pWriter->mutex);
+        pWriter->condition.wait(lock, [pWriter]() { return pWriter->freeBuffers.count > 0; });
+        queue_popFront(&pWriter->freeBuffers, &job.bufferIndex);
+      }
+
+      {
+        tile *pChunk = terrainCheckpoint_getBuffer_internal(pWriter, job.bufferIndex);
+        const size_t x = cx * terrain_chunkSize;
+        const size_t y = cy * terrain_chunkSize;
+        const size_t chunkWidth = lsMin(terrain_chunkSize, pTerrain->width - x);
+        const size_t chunkHeight = lsMin(terrain_chunkSize, pTerrain->height - y);
+
+        // Tiles outside of the terrain are zero.
+        if (chunkWidth < terrain_chunkSize || chunkHeight < terrain_chunkSize)
+          lsZeroMemory(pChunk, terrain_chunkSize * terrain_chunkSize);
+
+        for (size_t row = 0; row < chunkHeight; row++)
+          lsMemcpy(&pChunk[row * terrain_chunkSize], &pTerrain->pTiles[(y + row) * pTerrain->width + x], chunkWidth);
+      }
+
+      terrain_clearChunkUnsaved(pTerrain, cx, cy);
+
+      {
+        std::unique_lock<std::mutex> lock(pWriter->mutex);
+        LS_ERROR_CHECK(queue_pushBack(&pWriter->jobs, job));
+      }
+
+      pWriter->condition.notify_all();
+    }
+  }
+
+  {
+    terrain_checkpoint_job end;
+    end.chunkIndex = terrainCheckpoint_EndOfSnapshot;
+    end.bufferIndex = 0;
+
+    {
+      std::unique_lock<std::mutex> lock(pWriter->mutex);
+
+      LS_ERROR_CHECK(queue_pushBack(&pWriter->jobs, end));
+      pWriter->queuedSnapshotEnds++;
+      pWriter->snapshotCount++;
+    }
+
+    pWriter->condition.notify_all();
+  }
+
+  pWriter->firstSnapshot = false;
+
+epilogue:
+  return result;
+}
+
+lsResult terrainCheckpoint_wait(terrain_checkpoint_writer *pWriter)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pWriter == nullptr, lsR_ArgumentNull);
+
+  {
+    std::unique_lock<std::mutex> lock(pWriter->mutex);
+
+    pWriter->condition.wait(lock, [pWriter]() { return pWriter->writtenSnapshotCount == pWriter->snapshotCount; });
+    result = pWriter->writeResult;
+  }
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(8)
+
+DEFINE_TESTABLE(terrainCheckpoint_TestSnapshots)
+{
+  lsResult result = lsR_Success;
+
+  const char *filename = "terrainCheckpoint_TestSnapshots.terrain";
+
+  terrain original;
+  terrain loaded;
+  lsZeroMemory(&original);
+  lsZeroMemory(&loaded);
+
+  thread_pool *pPool = nullptr;
+  terrain_checkpoint_writer *pWriter = nullptr;
+  rand_seed seed(3, 4);
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&original, 200, 130)); // with partial chunks.
+
+  for (size_t compress = 0; compress < 2; compress++)
+  {
+    for (size_t i = 0; i < (size_t)original.width * original.height; i++)
+      for (size_t layer = 0; layer < tt_count; layer++)
+        original.pTiles[i].layerHeights[layer] = (uint16_t)(lsGetRand(seed) % 256);
+
+    lsZeroMemory(original.pTiles, original.width * 64); // a chunk row that's all zero.
+
+    // Fewer staging buffers than chunks, so snapshots have to wait for the writer.
+    TESTABLE_ASSERT_SUCCESS(terrainCheckpoint_create(&pWriter, filename, &original, terrain_chunkBytes * 3, compress != 0, pPool));
+    TESTABLE_ASSERT_SUCCESS(terrainCheckpoint_snapshot(pWriter, &original));
+
+    // Only the modified chunks are written by the next snapshot.
+    for (size_t y = 70; y < 100; y++)
+      for (size_t x = 10; x < 50; x++)
+        original.pTiles[y * original.width + x].layerHeights[tt_soil] = (uint16_t)(x + y);
+
+    terrain_markDirty(&original, 10, 70, 40, 30);
+    TESTABLE_ASSERT_SUCCESS(terrainCheckpoint_snapshot(pWriter, &original));
+
+    TESTABLE_ASSERT_SUCCESS(terrainCheckpoint_wait(pWriter));
+    terrainCheckpoint_destroy(&pWriter);
+
+    terrain_destroy(&loaded);
+    TESTABLE_ASSERT_SUCCESS(terrain_read(&loaded, filename));
+
+    TESTABLE_ASSERT_EQUAL(loaded.width, original.width);
+    TESTABLE_ASSERT_EQUAL(loaded.height, original.height);
+    TESTABLE_ASSERT_EQUAL(memcmp(loaded.pTiles, original.pTiles, sizeof(tile) * original.width * original.height), 0);
+  }
+
+epilogue:
+  terrainCheckpoint_destroy(&pWriter);
+  threadPool_destroy(&pPool);
+  remove(filename);
+  terrain_destroy(&original);
+  terrain_destroy(&loaded);
+  return result;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Writes checkpoints of a terrain to disk on a background thread while the simulation keeps running. Snapshots copy the unsaved chunks
+// into staging buffers within a memory budget, the simulation only waits for the writer if all of them are still in flight.
+// Compressed checkpoints append the chunks of every snapshot to the file, so they grow until the checkpoint is recreated.
+
+struct terrain_checkpoint_writer;
+
+constexpr size_t terrainCheckpoint_MinStagingChunks = 2;
+
+// Creates a checkpoint of the size of `pTerrain` in the chunked file format, or the compressed chunked file format if `compress` is set.
+// Compression runs on `pPool`.
+lsResult terrainCheckpoint_create(_Out_ terrain_checkpoint_writer **ppWriter, const char *filename, const terrain *pTerrain, const size_t memoryBudgetBytes, const bool compress, thread_pool *pPool);
+void terrainCheckpoint_destroy(terrain_checkpoint_writer **ppWriter); // finishes writing all snapshots.
+
+// Call between simulation steps. Copies all chunks that are unsaved (or all of them for the first snapshot) and clears their unsaved flag.
+// Returns failures of previous snapshots that have been written in the meantime.
+lsResult terrainCheckpoint_snapshot(terrain_checkpoint_writer *pWriter, terrain *pTerrain);
+
+// Waits until all snapshots have been written.
+lsResult terrainCheckpoint_wait(terrain_checkpoint_writer *pWriter);
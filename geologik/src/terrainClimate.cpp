@@ -0,0 +1,499 @@
+#include "terrainClimate.h"
+
+#include "terrainColumns.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+constexpr uint8_t terrainClimate_SnowFlag = 1;
+constexpr uint8_t terrainClimate_ChangedFlag = 2; // during this step, cleared when marked as dirty.
+constexpr uint8_t terrainClimate_GatherFlag = 4; // already in `pGatherChunks`.
+
+constexpr float terrainClimate_Diagonal = 1.41421356f;
+
+struct terrain_climate_context
+{
+  terrain_climate *pClimate;
+  terrain *pTerrain;
+  const terrain_climate_params *pParams;
+  float talusSlope; // height difference in decimeters per tile that snow still holds on.
+};
+
+static void terrainClimate_getChunkRect_internal(const terrain *pTerrain, const size_t chunk, _Out_ size_t *pX, _Out_ size_t *pY, _Out_ size_t *pWidth, _Out_ size_t *pHeight)
+{
+  *pX = (chunk % pTerrain->chunkCountX) * terrain_chunkSize;
+  *pY = (chunk / pTerrain->chunkCountX) * terrain_chunkSize;
+  *pWidth = lsMin(terrain_chunkSize, pTerrain->width - *pX);
+  *pHeight = lsMin(terrain_chunkSize, pTerrain->height - *pY);
+}
+
+// Snow is tracked as a float thickness in fixed point height units, and mass as the water equivalent in the same units.
+static void terrainClimate_processChunk_internal(void *pUserData, const size_t index)
+{
+  terrain_climate_context *pContext = reinterpret_cast<terrain_climate_context *>(pUserData);
+  terrain_climate *pClimate = pContext->pClimate;
+  terrain *pTerrain = pContext->pTerrain;
+  const terrain_climate_params *pParams = pContext->pParams;
+
+  const size_t chunk = pClimate->pActiveChunks[index];
+  size_t x0, y0, width, height;
+  terrainClimate_getChunkRect_internal(pTerrain, chunk, &x0, &y0, &width, &height);
+
+  const float freshUnits = pParams->snowfall * terrain_fixedOne;
+  uint8_t flags = pClimate->pChunkFlags[chunk] & ~terrainClimate_SnowFlag;
+
+  for (size_t y = y0; y < y0 + height; y++)
+  {
+    for (size_t x = x0; x < x0 + width; x++)
+    {
+      const size_t i = y * pTerrain->width + x;
+      const float temperature = pParams->temperature - pParams->lapseRate * (float)pTerrain->pTotalHeights[i];
+      const uint32_t snowBefore = terrain_getFixedHeight(pTerrain, i, tt_snow);
+
+      float snow = (float)snowBefore;
+      float density = pClimate->pDensities[i] != 0 ? pClimate->pDensities[i] / terrainClimate_DensityOne : terrainMaterial_Properties[tt_snow].density;
+      int32_t melt = 0;
+
+      pClimate->pAvalanches[i] = 0;
+
+      if (temperature < pParams->snowTemperature && freshUnits > 0)
+      {
+        density = (snow * density + freshUnits * terrainClimate_FreshDensity) / (snow + freshUnits);
+        snow += freshUnits;
+      }
+
+      if (snow > 0)
+      {
+        // Compaction keeps the mass, so the snow gets thinner as it gets denser.
+        const float compacted = density + pParams->compactionRate * (terrainClimate_IceDensity - density);
+        snow *= density / compacted;
+        density = compacted;
+
+        if (temperature > 0)
+        {
+          const float waterEquivalent = snow * density;
+          const float potential = pParams->degreeDayFactor * temperature * terrain_fixedOne;
+
+          // Remnants below a fixed point unit would never melt otherwise.
+          melt = terrain_addFixedHeight(pTerrain, i, tt_water, (int32_t)(lsMin(potential, waterEquivalent) + 0.5f));
+          snow = potential + 1.f >= waterEquivalent ? 0.f : lsMax(0.f, snow - melt / density);
+        }
+      }
+
+      if (pParams->avalanches && snow > 0)
+      {
+        const uint32_t totalHeight = pTerrain->pTotalHeights[i];
+        float steepest = 0;
+        uint8_t direction = tfd_outlet;
+
+        for (uint8_t d = 0; d < tfd_count; d++)
+        {
+          const size_t nx = x + (size_t)terrainFlow_OffsetX[d];
+          const size_t ny = y + (size_t)terrainFlow_OffsetY[d];
+
+          if (nx >= pTerrain->width || ny >= pTerrain->height)
+            continue;
+
+          const float drop = ((float)totalHeight - (float)pTerrain->pTotalHeights[ny * pTerrain->width + nx]) / ((d & 1) ? terrainClimate_Diagonal : 1.f);
+
+          if (drop > steepest)
+          {
+            steepest = drop;
+            direction = d;
+          }
+        }
+
+        // Half of the excess evens out the slope.
+        const float excess = (steepest - pContext->talusSlope) * 0.5f * ((direction & 1) ? terrainClimate_Diagonal : 1.f);
+
+        if (direction != tfd_outlet && excess > 0)
+        {
+          const float slide = lsMin(excess * terrain_fixedOne, snow);
+
+          pClimate->pAvalanches[i] = slide * density;
+          pClimate->pAvalancheDirections[i] = direction;
+          snow -= slide;
+        }
+      }
+
+      const uint32_t snowAfter = (uint32_t)lsMin(snow + 0.5f, (float)UINT32_MAX);
+      terrain_setFixedHeight(pTerrain, i, tt_snow, snowAfter);
+      pClimate->pDensities[i] = snowAfter != 0 ? (uint16_t)lsMin(density * terrainClimate_DensityOne + 0.5f, (float)UINT16_MAX) : 0;
+
+      if (terrain_getFixedHeight(pTerrain, i, tt_snow) != 0)
+        flags |= terrainClimate_SnowFlag;
+
+      if (terrain_getFixedHeight(pTerrain, i, tt_snow) != snowBefore || melt != 0)
+        flags |= terrainClimate_ChangedFlag;
+    }
+  }
+
+  pClimate->pChunkFlags[chunk] = flags;
+}
+
+// Collects the avalanches sliding into each tile. Runs on neighbouring chunks as well, which may not have been visited.
+static void terrainClimate_gatherChunk_internal(void *pUserData, const size_t index)
+{
+  terrain_climate_context *pContext = reinterpret_cast<terrain_climate_context *>(pUserData);
+  terrain_climate *pClimate = pContext->pClimate;
+  terrain *pTerrain = pContext->pTerrain;
+
+  const size_t chunk = pClimate->pGatherChunks[index];
+  size_t x0, y0, width, height;
+  terrainClimate_getChunkRect_internal(pTerrain, chunk, &x0, &y0, &width, &height);
+
+  uint8_t flags = pClimate->pChunkFlags[chunk];
+
+  for (size_t y = y0; y < y0 + height; y++)
+  {
+    for (size_t x = x0; x < x0 + width; x++)
+    {
+      const size_t i = y * pTerrain->width + x;
+      float incoming = 0;
+
+      for (uint8_t d = 0; d < tfd_count; d++)
+      {
+        const size_t sx = x - (size_t)terrainFlow_OffsetX[d];
+        const size_t sy = y - (size_t)terrainFlow_OffsetY[d];
+
+        if (sx >= pTerrain->width || sy >= pTerrain->height)
+          continue;
+
+        const size_t source = sy * pTerrain->width + sx;
+
+        if (pClimate->pAvalanches[source] > 0 && pClimate->pAvalancheDirections[source] == d)
+          incoming += pClimate->pAvalanches[source];
+      }
+
+      if (incoming == 0)
+        continue;
+
+      const float snow = (float)terrain_getFixedHeight(pTerrain, i, tt_snow);
+      const float density = pClimate->pDensities[i] != 0 ? pClimate->pDensities[i] / terrainClimate_DensityOne : terrainMaterial_Properties[tt_snow].density;
+      const float deposited = incoming / terrainClimate_AvalancheDensity;
+      const uint32_t snowAfter = (uint32_t)lsMin(snow + deposited + 0.5f, (float)UINT32_MAX);
+
+      terrain_setFixedHeight(pTerrain, i, tt_snow, snowAfter);
+      pClimate->pDensities[i] = (uint16_t)lsMin((snow * density + incoming) / (snow + deposited) * terrainClimate_DensityOne + 0.5f, (float)UINT16_MAX);
+
+      flags |= terrainClimate_SnowFlag | terrainClimate_ChangedFlag;
+    }
+  }
+
+  pClimate->pChunkFlags[chunk] = flags;
+}
+
+static void terrainClimate_clearChunk_internal(void *pUserData, const size_t index)
+{
+  terrain_climate_context *pContext = reinterpret_cast<terrain_climate_context *>(pUserData);
+  const terrain *pTerrain = pContext->pTerrain;
+
+  size_t x0, y0, width, height;
+  terrainClimate_getChunkRect_internal(pTerrain, pContext->pClimate->pActiveChunks[index], &x0, &y0, &width, &height);
+
+  for (size_t y = y0; y < y0 + height; y++)
+    lsZeroMemory(pContext->pClimate->pAvalanches + y * pTerrain->width + x0, width);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainClimate_init(_Out_ terrain_climate *pClimate, terrain *pTerrain)
+{
+  lsResult result = lsR_Success;
+
+  size_t chunkCount = 0;
+
+  LS_ERROR_IF(pClimate == nullptr || pTerrain == nullptr, lsR_ArgumentNull);
+
+  lsZeroMemory(pClimate);
+  pClimate->width = pTerrain->width;
+  pClimate->height = pTerrain->height;
+
+  chunkCount = (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY;
+
+  LS_ERROR_CHECK(lsAllocZero(&pClimate->pDensities, (size_t)pTerrain->width * pTerrain->height));
+  LS_ERROR_CHECK(lsAllocZero(&pClimate->pChunkFlags, chunkCount));
+  LS_ERROR_CHECK(lsAllocZero(&pClimate->pSeenVersions, chunkCount));
+  LS_ERROR_CHECK(lsAlloc(&pClimate->pActiveChunks, chunkCount));
+  LS_ERROR_CHECK(lsAlloc(&pClimate->pGatherChunks, chunkCount));
+  LS_ERROR_CHECK(lsAllocZero(&pClimate->pAvalanches, (size_t)pTerrain->width * pTerrain->height));
+  LS_ERROR_CHECK(lsAlloc(&pClimate->pAvalancheDirections, (size_t)pTerrain->width * pTerrain->height));
+  LS_ERROR_CHECK(terrain_enableFractions(pTerrain, (1U << tt_snow) | (1U << tt_water)));
+
+epilogue:
+  if (LS_FAILED(result) && pClimate != nullptr)
+    terrainClimate_destroy(pClimate);
+
+  return result;
+}
+
+void terrainClimate_destroy(terrain_climate *pClimate)
+{
+  if (pClimate == nullptr)
+    return;
+
+  lsFreePtr(&pClimate->pDensities);
+  lsFreePtr(&pClimate->pChunkFlags);
+  lsFreePtr(&pClimate->pSeenVersions);
+  lsFreePtr(&pClimate->pActiveChunks);
+  lsFreePtr(&pClimate->pGatherChunks);
+  lsFreePtr(&pClimate->pAvalanches);
+  lsFreePtr(&pClimate->pAvalancheDirections);
+}
+
+lsResult terrainClimate_step(terrain_climate *pClimate, terrain *pTerrain, const terrain_climate_params *pParams, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_climate_context context = { pClimate, pTerrain, pParams, 0 };
+  size_t chunkCount = 0;
+  size_t activeCount = 0;
+  size_t gatherCount = 0;
+  float snowLine = 0; // lowest total height in decimeters that gets fresh snow.
+
+  LS_ERROR_IF(pClimate == nullptr || pTerrain == nullptr || pParams == nullptr || pPool == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pClimate->width != pTerrain->width || pClimate->height != pTerrain->height, lsR_ArgumentOutOfBounds);
+  LS_ERROR_IF(pParams->lapseRate <= 0 || pParams->snowfall < 0 || pParams->compactionRate < 0 || pParams->compactionRate > 1, lsR_ArgumentOutOfBounds);
+
+  chunkCount = (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY;
+  snowLine = (pParams->temperature - pParams->snowTemperature) / pParams->lapseRate;
+  context.talusSlope = tanf(terrainMaterial_Properties[tt_snow].talusAngle * (float)(3.14159265358979 / 180.0)) * terrain_tileSize;
+
+  LS_ERROR_CHECK(terrainColumns_update(pTerrain, pPool));
+
+  for (size_t chunk = 0; chunk < chunkCount; chunk++)
+    if ((pClimate->pChunkFlags[chunk] & terrainClimate_SnowFlag) != 0 || pClimate->pSeenVersions[chunk] != pTerrain->pChunkVersions[chunk] || (pParams->snowfall > 0 && (float)pTerrain->pChunkMaxHeights[chunk] > snowLine))
+      pClimate->pActiveChunks[activeCount++] = (uint32_t)chunk;
+
+  threadPool_parallelFor(pPool, activeCount, terrainClimate_processChunk_internal, &context);
+
+  if (pParams->avalanches)
+  {
+    for (size_t i = 0; i < activeCount; i++)
+    {
+      const size_t chunkX = pClimate->pActiveChunks[i] % pTerrain->chunkCountX;
+      const size_t chunkY = pClimate->pActiveChunks[i] / pTerrain->chunkCountX;
+
+      for (size_t cy = chunkY - (chunkY > 0); cy <= lsMin(chunkY + 1, (size_t)pTerrain->chunkCountY - 1); cy++)
+      {
+        for (size_t cx = chunkX - (chunkX > 0); cx <= lsMin(chunkX + 1, (size_t)pTerrain->chunkCountX - 1); cx++)
+        {
+          const size_t chunk = cy * pTerrain->chunkCountX + cx;
+
+          if (pClimate->pChunkFlags[chunk] & terrainClimate_GatherFlag)
+            continue;
+
+          pClimate->pChunkFlags[chunk] |= terrainClimate_GatherFlag;
+          pClimate->pGatherChunks[gatherCount++] = (uint32_t)chunk;
+        }
+      }
+    }
+
+    threadPool_parallelFor(pPool, gatherCount, terrainClimate_gatherChunk_internal, &context);
+    threadPool_parallelFor(pPool, activeCount, terrainClimate_clearChunk_internal, &context);
+  }
+
+  // Only chunks that actually changed are marked. The chunk has been seen in that state, so this step doesn't cause another visit.
+  for (size_t i = 0; i < activeCount + gatherCount; i++)
+  {
+    const size_t chunk = i < activeCount ? pClimate->pActiveChunks[i] : pClimate->pGatherChunks[i - activeCount];
+
+    if (pClimate->pChunkFlags[chunk] & terrainClimate_ChangedFlag)
+      terrain_markDirty(pTerrain, (chunk % pTerrain->chunkCountX) * terrain_chunkSize, (chunk / pTerrain->chunkCountX) * terrain_chunkSize, lsMin(terrain_chunkSize, pTerrain->width - (chunk % pTerrain->chunkCountX) * terrain_chunkSize), lsMin(terrain_chunkSize, pTerrain->height - (chunk / pTerrain->chunkCountX) * terrain_chunkSize));
+
+    pClimate->pChunkFlags[chunk] &= ~(terrainClimate_ChangedFlag | terrainClimate_GatherFlag);
+  }
+
+  for (size_t i = 0; i < activeCount; i++)
+    pClimate->pSeenVersions[pClimate->pActiveChunks[i]] = pTerrain->pChunkVersions[pClimate->pActiveChunks[i]];
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(15)
+
+// Water equivalent of the snow plus the water, in fixed point height units.
+static double terrainClimate_getWater_internal(const terrain *pTerrain, const terrain_climate *pClimate)
+{
+  double water = 0;
+
+  for (size_t i = 0; i < (size_t)pTerrain->width * pTerrain->height; i++)
+    water += (double)terrain_getFixedHeight(pTerrain, i, tt_snow) * (pClimate->pDensities[i] / terrainClimate_DensityOne) + terrain_getFixedHeight(pTerrain, i, tt_water);
+
+  return water;
+}
+
+DEFINE_TESTABLE(terrainClimate_TestSnowLine)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_climate climate;
+  lsZeroMemory(&climate);
+
+  thread_pool *pPool = nullptr;
+  terrain_climate_params params;
+  params.temperature = 10.f;
+  params.lapseRate = 0.005f; // freezing at 2000 dm.
+  params.avalanches = false;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 130, 64)); // with a partial chunk.
+  TESTABLE_ASSERT_SUCCESS(terrainClimate_init(&climate, &t));
+
+  // Lowlands in the western chunk, mountains in the others.
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      lsZeroMemory(&t.pTiles[y * t.width + x]);
+      t.pTiles[y * t.width + x].layerHeights[tt_bedrock] = (uint16_t)(x < terrain_chunkSize ? 10 : 4000);
+    }
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainClimate_step(&climate, &t, &params, pPool));
+
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 5, tt_snow), 0u);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 70, tt_snow) > 0u, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 129, tt_snow) > 0u, true);
+  TESTABLE_ASSERT_EQUAL(climate.pDensities[70] > (uint16_t)(terrainClimate_FreshDensity * terrainClimate_DensityOne), true); // already compacted.
+
+  // The lowlands aren't visited any more once their columns are up to date.
+  for (size_t i = 0; i < (size_t)t.chunkCountX * t.chunkCountY; i++)
+    terrain_clearChunkDirty(&t, i % t.chunkCountX, i / t.chunkCountX);
+
+  TESTABLE_ASSERT_SUCCESS(terrainClimate_step(&climate, &t, &params, pPool));
+  TESTABLE_ASSERT_EQUAL(terrain_isChunkDirty(&t, 0, 0), false);
+  TESTABLE_ASSERT_EQUAL(terrain_isChunkDirty(&t, 1, 0), true);
+  TESTABLE_ASSERT_EQUAL(terrain_isChunkDirty(&t, 2, 0), true);
+
+  // Snow added from elsewhere melts.
+  t.pTiles[5].layerHeights[tt_snow] = 1;
+  terrain_markDirty(&t, 5, 0, 1, 1);
+
+  for (size_t step = 0; step < 20; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainClimate_step(&climate, &t, &params, pPool));
+
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 5, tt_snow), 0u);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 5, tt_water) > 0u, true);
+
+epilogue:
+  terrainClimate_destroy(&climate);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainClimate_TestMelt)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_climate climate;
+  lsZeroMemory(&climate);
+
+  thread_pool *pPool = nullptr;
+  terrain_climate_params params;
+  params.temperature = -5.f;
+  params.lapseRate = 0.001f;
+  params.snowfall = 0.f;
+
+  double waterBefore = 0;
+  uint32_t snowBefore = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 80, 70));
+  TESTABLE_ASSERT_SUCCESS(terrainClimate_init(&climate, &t));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    lsZeroMemory(&t.pTiles[i]);
+    t.pTiles[i].layerHeights[tt_bedrock] = 100;
+    t.pTiles[i].layerHeights[tt_snow] = (uint16_t)(i % 7);
+  }
+
+  // Cold snow only compacts.
+  TESTABLE_ASSERT_SUCCESS(terrainClimate_step(&climate, &t, &params, pPool));
+  waterBefore = terrainClimate_getWater_internal(&t, &climate);
+  snowBefore = terrain_getFixedHeight(&t, 6, tt_snow);
+
+  TESTABLE_ASSERT_SUCCESS(terrainClimate_step(&climate, &t, &params, pPool));
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 6, tt_snow) < snowBefore, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 6, tt_water), 0u);
+  TESTABLE_ASSERT_EQUAL(fabs(terrainClimate_getWater_internal(&t, &climate) - waterBefore) < waterBefore * 1e-3, true);
+
+  // Warm snow melts into the water layer, until none is left.
+  params.temperature = 5.f;
+
+  for (size_t step = 0; step < 200; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainClimate_step(&climate, &t, &params, pPool));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+    TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, i, tt_snow), 0u);
+
+  TESTABLE_ASSERT_EQUAL(fabs(terrainClimate_getWater_internal(&t, &climate) - waterBefore) < waterBefore * 1e-3, true);
+
+epilogue:
+  terrainClimate_destroy(&climate);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainClimate_TestAvalanche)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_climate climate;
+  lsZeroMemory(&climate);
+
+  thread_pool *pPool = nullptr;
+  terrain_climate_params params;
+  params.temperature = -10.f;
+  params.snowfall = 0.f;
+  params.compactionRate = 0.f;
+
+  constexpr size_t peakX = 64; // on the chunk border, so that the snow slides into the neighbouring chunk as well.
+  constexpr size_t peakY = 20;
+  double waterBefore = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 128, 40));
+  TESTABLE_ASSERT_SUCCESS(terrainClimate_init(&climate, &t));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    lsZeroMemory(&t.pTiles[i]);
+    t.pTiles[i].layerHeights[tt_bedrock] = 100;
+  }
+
+  t.pTiles[peakY * t.width + peakX].layerHeights[tt_snow] = 2000;
+
+  TESTABLE_ASSERT_SUCCESS(terrainClimate_step(&climate, &t, &params, pPool));
+  waterBefore = terrainClimate_getWater_internal(&t, &climate);
+
+  for (size_t step = 0; step < 30; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainClimate_step(&climate, &t, &params, pPool));
+
+  // The pile spreads out both ways, without losing any snow.
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, peakY * t.width + peakX, tt_snow) < 1000u * terrain_fixedOne, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, peakY * t.width + peakX - 1, tt_snow) > 0u, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, peakY * t.width + peakX + 1, tt_snow) > 0u, true);
+  TESTABLE_ASSERT_EQUAL(fabs(terrainClimate_getWater_internal(&t, &climate) - waterBefore) < waterBefore * 1e-3, true);
+
+epilogue:
+  terrainClimate_destroy(&climate);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "terrainFlow.h"
+#include "terrainMaterial.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Snow. The temperature falls with height, precipitation above the snow line falls as fresh snow, which compacts over time and melts
+// into the water layer with the degree-day method where it's warmer than 0 °C. Snow steeper than its talus angle slides down as an
+// avalanche. Only chunks that reach above the snow line or hold snow are visited, using the height range of the cached columns.
+
+struct terrain_climate_params
+{
+  float temperature = 10.f; // in °C at a height of 0. vary it between steps for seasons.
+  float lapseRate = 6.5e-4f; // temperature drop in °C per decimeter of height.
+  float snowTemperature = 1.f; // in °C, precipitation falls as snow below it.
+  float snowfall = 0.2f; // fresh snow per step, in decimeters.
+  float degreeDayFactor = 0.03f; // melted water per step and °C above 0, in decimeters.
+  float compactionRate = 0.05f; // share of the difference to `terrainClimate_IceDensity` the snow compacts per step.
+  bool avalanches = true;
+};
+
+constexpr float terrainClimate_FreshDensity = 0.1f; // in t/m^3.
+constexpr float terrainClimate_AvalancheDensity = 0.5f; // of snow deposited by avalanches.
+constexpr float terrainClimate_IceDensity = 0.917f;
+constexpr float terrainClimate_DensityOne = 65536.f; // fixed point scale of `pDensities`.
+
+struct terrain_climate
+{
+  uint16_t width, height;
+
+  uint16_t *pDensities; // of the snow per tile, in 1/65536 t/m^3. 0 for snow that predates the climate, see `terrainMaterial_Properties`.
+  uint8_t *pChunkFlags; // per chunk, whether it has snow.
+  uint32_t *pSeenVersions; // `pChunkVersions` of the terrain after the chunk was last visited.
+  uint32_t *pActiveChunks; // chunks visited during a step.
+  uint32_t *pGatherChunks; // `pActiveChunks` and their neighbours, which avalanches can reach.
+  float *pAvalanches; // water equivalent leaving each tile during a step, in fixed point height units.
+  uint8_t *pAvalancheDirections; // `terrain_flow_direction` of `pAvalanches`.
+};
+
+// Enables fractions for snow and water, since a step usually moves much less than a decimeter.
+lsResult terrainClimate_init(_Out_ terrain_climate *pClimate, terrain *pTerrain);
+void terrainClimate_destroy(terrain_climate *pClimate);
+
+// Snows, compacts, melts and slides for one step. Updates the cached columns of `pTerrain` first. Chunks marked as dirty since the
+// last step are always visited, so snow added from elsewhere is picked up.
+lsResult terrainClimate_step(terrain_climate *pClimate, terrain *pTerrain, const terrain_climate_params *pParams, thread_pool *pPool);
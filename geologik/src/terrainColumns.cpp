@@ -0,0 +1,582 @@
+#include "terrainColumns.h"
+#include "simd.h"
+
+static_assert(sizeof(tile) == 16 && tt_count == 8, "the kernels load one tile per 128 bit lane");
+
+//////////////////////////////////////////////////////////////////////////
+
+static void terrainColumns_computeTile_internal(const tile *pTile, _Out_ uint32_t *pTotalHeight, _Out_ uint8_t *pTopLayer)
+{
+  uint32_t total = 0;
+  uint8_t top = terrainColumns_NoLayer;
+
+  for (size_t layer = tt_count; layer > 0; layer--)
+  {
+    total += pTile->layerHeights[layer - 1];
+
+    if (pTile->layerHeights[layer - 1] != 0)
+      top = (uint8_t)(layer - 1);
+  }
+
+  if (pTotalHeight != nullptr)
+    *pTotalHeight = total;
+
+  if (pTopLayer != nullptr)
+    *pTopLayer = top;
+}
+
+static void terrainColumns_computeRowScalar_internal(const tile *pTiles, const size_t count, _Out_ uint32_t *pTotalHeights, _Out_ uint8_t *pTopLayers)
+{
+  for (size_t i = 0; i < count; i++)
+    terrainColumns_computeTile_internal(pTiles + i, pTotalHeights != nullptr ? pTotalHeights + i : nullptr, pTopLayers != nullptr ? pTopLayers + i : nullptr);
+}
+
+// The kernels for the other levels need x86 intrinsics. Without SSE2 (see `simd.h`) every level uses the scalar one.
+#ifdef LS_SIMD_SSE2
+
+// Bits of `emptyMask` are set for layers that are empty, 8 per tile. Layers are ordered from top to bottom.
+static uint8_t terrainColumns_topLayer_internal(const uint32_t emptyMask)
+{
+  const uint32_t occupied = ~emptyMask & 0xFF;
+  return occupied == 0 ? terrainColumns_NoLayer : (uint8_t)lsLowestBit(occupied);
+}
+
+// `_mm_madd_epi16` only multiplies signed values, so the heights are biased by -32768, adding -65536 per pair of layers.
+constexpr int32_t terrainColumns_MaddBias = 4 * 65536;
+
+static void terrainColumns_computeRowSse2_internal(const tile *pTiles, const size_t count, _Out_ uint32_t *pTotalHeights, _Out_ uint8_t *pTopLayers)
+{
+  const __m128i signFlip = _mm_set1_epi16((int16_t)0x8000);
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i bias = _mm_set1_epi32(terrainColumns_MaddBias);
+  const __m128i zero = _mm_setzero_si128();
+
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4)
+  {
+    const __m128i t0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pTiles + i));
+    const __m128i t1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pTiles + i + 1));
+    const __m128i t2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pTiles + i + 2));
+    const __m128i t3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pTiles + i + 3));
+
+    if (pTotalHeights != nullptr)
+    {
+      // Four partial sums per tile, transposed so that each lane ends up with the total of one tile.
+      const __m128i m0 = _mm_madd_epi16(_mm_xor_si128(t0, signFlip), one);
+      const __m128i m1 = _mm_madd_epi16(_mm_xor_si128(t1, signFlip), one);
+      const __m128i m2 = _mm_madd_epi16(_mm_xor_si128(t2, signFlip), one);
+      const __m128i m3 = _mm_madd_epi16(_mm_xor_si128(t3, signFlip), one);
+
+      const __m128i s01 = _mm_add_epi32(_mm_unpacklo_epi32(m0, m1), _mm_unpackhi_epi32(m0, m1));
+      const __m128i s23 = _mm_add_epi32(_mm_unpacklo_epi32(m2, m3), _mm_unpackhi_epi32(m2, m3));
+      const __m128i total = _mm_add_epi32(_mm_add_epi32(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23)), bias);
+
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(pTotalHeights + i), total);
+    }
+
+    if (pTopLayers != nullptr)
+    {
+      const uint32_t empty01 = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(t0, zero), _mm_cmpeq_epi16(t1, zero)));
+      const uint32_t empty23 = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(t2, zero), _mm_cmpeq_epi16(t3, zero)));
+
+      pTopLayers[i] = terrainColumns_topLayer_internal(empty01);
+      pTopLayers[i + 1] = terrainColumns_topLayer_internal(empty01 >> 8);
+      pTopLayers[i + 2] = terrainColumns_topLayer_internal(empty23);
+      pTopLayers[i + 3] = terrainColumns_topLayer_internal(empty23 >> 8);
+    }
+  }
+
+  for (; i < count; i++)
+    terrainColumns_computeTile_internal(pTiles + i, pTotalHeights != nullptr ? pTotalHeights + i : nullptr, pTopLayers != nullptr ? pTopLayers + i : nullptr);
+}
+
+LS_TARGET_AVX2 static void terrainColumns_computeRowAvx2_internal(const tile *pTiles, const size_t count, _Out_ uint32_t *pTotalHeights, _Out_ uint8_t *pTopLayers)
+{
+  const __m256i signFlip = _mm256_set1_epi16((int16_t)0x8000);
+  const __m256i one = _mm256_set1_epi16(1);
+  const __m256i bias = _mm256_set1_epi32(terrainColumns_MaddBias);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i interleave = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+  size_t i = 0;
+
+  for (; i + 8 <= count; i += 8)
+  {
+    // Two tiles per register, one per 128 bit lane.
+    const __m256i t01 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pTiles + i));
+    const __m256i t23 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pTiles + i + 2));
+    const __m256i t45 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pTiles + i + 4));
+    const __m256i t67 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pTiles + i + 6));
+
+    if (pTotalHeights != nullptr)
+    {
+      const __m256i m01 = _mm256_madd_epi16(_mm256_xor_si256(t01, signFlip), one);
+      const __m256i m23 = _mm256_madd_epi16(_mm256_xor_si256(t23, signFlip), one);
+      const __m256i m45 = _mm256_madd_epi16(_mm256_xor_si256(t45, signFlip), one);
+      const __m256i m67 = _mm256_madd_epi16(_mm256_xor_si256(t67, signFlip), one);
+
+      // Horizontal adds work within lanes, so the low lane ends up with the even tiles and the high lane with the odd ones.
+      const __m256i h = _mm256_hadd_epi32(_mm256_hadd_epi32(m01, m23), _mm256_hadd_epi32(m45, m67));
+      const __m256i total = _mm256_permutevar8x32_epi32(_mm256_add_epi32(h, bias), interleave);
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(pTotalHeights + i), total);
+    }
+
+    if (pTopLayers != nullptr)
+    {
+      // Packing works within lanes as well, so the bytes are tiles 0, 2, 1, 3.
+      const uint32_t empty0213 = (uint32_t)_mm256_movemask_epi8(_mm256_packs_epi16(_mm256_cmpeq_epi16(t01, zero), _mm256_cmpeq_epi16(t23, zero)));
+      const uint32_t empty4657 = (uint32_t)_mm256_movemask_epi8(_mm256_packs_epi16(_mm256_cmpeq_epi16(t45, zero), _mm256_cmpeq_epi16(t67, zero)));
+
+      pTopLayers[i] = terrainColumns_topLayer_internal(empty0213);
+      pTopLayers[i + 1] = terrainColumns_topLayer_internal(empty0213 >> 16);
+      pTopLayers[i + 2] = terrainColumns_topLayer_internal(empty0213 >> 8);
+      pTopLayers[i + 3] = terrainColumns_topLayer_internal(empty0213 >> 24);
+      pTopLayers[i + 4] = terrainColumns_topLayer_internal(empty4657);
+      pTopLayers[i + 5] = terrainColumns_topLayer_internal(empty4657 >> 16);
+      pTopLayers[i + 6] = terrainColumns_topLayer_internal(empty4657 >> 8);
+      pTopLayers[i + 7] = terrainColumns_topLayer_internal(empty4657 >> 24);
+    }
+  }
+
+  terrainColumns_computeRowSse2_internal(pTiles + i, count - i, pTotalHeights != nullptr ? pTotalHeights + i : nullptr, pTopLayers != nullptr ? pTopLayers + i : nullptr);
+}
+
+LS_TARGET_AVX512 static void terrainColumns_computeRowAvx512_internal(const tile *pTiles, const size_t count, _Out_ uint32_t *pTotalHeights, _Out_ uint8_t *pTopLayers)
+{
+  const __m512i signFlip = _mm512_set1_epi16((int16_t)0x8000);
+  const __m512i one = _mm512_set1_epi16(1);
+  const __m512i bias = _mm512_set1_epi32(terrainColumns_MaddBias);
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i transpose = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i lowNibbleTops = _mm_setr_epi8(terrainColumns_NoLayer, 0, 1, 0, 2, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i highNibbleTops = _mm_setr_epi8(terrainColumns_NoLayer, 4, 5, 0, 6, 0, 0, 0, 7, 0, 0, 0, 0, 0, 0, 0);
+
+  size_t i = 0;
+
+  for (; i + 16 <= count; i += 16)
+  {
+    // Four tiles per register, one per 128 bit lane.
+    const __m512i t0 = _mm512_loadu_si512(pTiles + i);
+    const __m512i t1 = _mm512_loadu_si512(pTiles + i + 4);
+    const __m512i t2 = _mm512_loadu_si512(pTiles + i + 8);
+    const __m512i t3 = _mm512_loadu_si512(pTiles + i + 12);
+
+    if (pTotalHeights != nullptr)
+    {
+      const __m512i m0 = _mm512_madd_epi16(_mm512_xor_si512(t0, signFlip), one);
+      const __m512i m1 = _mm512_madd_epi16(_mm512_xor_si512(t1, signFlip), one);
+      const __m512i m2 = _mm512_madd_epi16(_mm512_xor_si512(t2, signFlip), one);
+      const __m512i m3 = _mm512_madd_epi16(_mm512_xor_si512(t3, signFlip), one);
+
+      // The same transposition as with SSE2 within each lane, which leaves tile `4 * j + k` in element `4 * k + j`.
+      const __m512i s01 = _mm512_add_epi32(_mm512_unpacklo_epi32(m0, m1), _mm512_unpackhi_epi32(m0, m1));
+      const __m512i s23 = _mm512_add_epi32(_mm512_unpacklo_epi32(m2, m3), _mm512_unpackhi_epi32(m2, m3));
+      const __m512i h = _mm512_add_epi32(_mm512_add_epi32(_mm512_unpacklo_epi64(s01, s23), _mm512_unpackhi_epi64(s01, s23)), bias);
+
+      _mm512_storeu_si512(pTotalHeights + i, _mm512_permutexvar_epi32(transpose, h));
+    }
+
+    if (pTopLayers != nullptr)
+    {
+      // Comparisons into mask registers keep the order, so each byte holds the empty layers of one tile.
+      const uint64_t empty0 = (uint64_t)_mm512_cmpeq_epi16_mask(t0, zero) | ((uint64_t)_mm512_cmpeq_epi16_mask(t1, zero) << 32);
+      const uint64_t empty1 = (uint64_t)_mm512_cmpeq_epi16_mask(t2, zero) | ((uint64_t)_mm512_cmpeq_epi16_mask(t3, zero) << 32);
+      const __m128i occupied = _mm_xor_si128(_mm_set_epi64x((int64_t)empty1, (int64_t)empty0), _mm_set1_epi8(-1));
+
+      // The lowest occupied bit of each byte, looked up per nibble.
+      const __m128i lowest = _mm_and_si128(occupied, _mm_sub_epi8(_mm_setzero_si128(), occupied));
+      const __m128i lowTop = _mm_shuffle_epi8(lowNibbleTops, _mm_and_si128(lowest, nibble));
+      const __m128i highTop = _mm_shuffle_epi8(highNibbleTops, _mm_and_si128(_mm_srli_epi16(lowest, 4), nibble));
+
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(pTopLayers + i), _mm_min_epu8(lowTop, highTop));
+    }
+  }
+
+  terrainColumns_computeRowAvx2_internal(pTiles + i, count - i, pTotalHeights != nullptr ? pTotalHeights + i : nullptr, pTopLayers != nullptr ? pTopLayers + i : nullptr);
+}
+
+#endif
+
+typedef void terrainColumns_computeRowFunc(const tile *pTiles, const size_t count, _Out_ uint32_t *pTotalHeights, _Out_ uint8_t *pTopLayers);
+
+static terrainColumns_computeRowFunc *const terrainColumns_ComputeRow[lsCL_Count] =
+{
+  terrainColumns_computeRowScalar_internal,
+#ifdef LS_SIMD_SSE2
+  terrainColumns_computeRowSse2_internal,
+  terrainColumns_computeRowAvx2_internal,
+  terrainColumns_computeRowAvx512_internal,
+#else
+  terrainColumns_computeRowScalar_internal,
+  terrainColumns_computeRowScalar_internal,
+  terrainColumns_computeRowScalar_internal,
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Extends `*pMin` and `*pMax` by the range of `pValues`.
+static void terrainColumns_getRangeScalar_internal(const uint32_t *pValues, const size_t count, _In_Out_ uint32_t *pMin, _In_Out_ uint32_t *pMax)
+{
+  uint32_t min = *pMin;
+  uint32_t max = *pMax;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    min = lsMin(min, pValues[i]);
+    max = lsMax(max, pValues[i]);
+  }
+
+  *pMin = min;
+  *pMax = max;
+}
+
+#ifdef LS_SIMD_SSE2
+
+// SSE2 only compares signed values, so the sign bits are flipped.
+static void terrainColumns_getRangeSse2_internal(const uint32_t *pValues, const size_t count, _In_Out_ uint32_t *pMin, _In_Out_ uint32_t *pMax)
+{
+  const __m128i signFlip = _mm_set1_epi32(INT32_MIN);
+  __m128i min = _mm_set1_epi32((int32_t)(*pMin ^ 0x80000000));
+  __m128i max = _mm_set1_epi32((int32_t)(*pMax ^ 0x80000000));
+
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4)
+  {
+    const __m128i values = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pValues + i)), signFlip);
+    const __m128i less = _mm_cmplt_epi32(values, min);
+    const __m128i greater = _mm_cmpgt_epi32(values, max);
+
+    min = _mm_or_si128(_mm_and_si128(less, values), _mm_andnot_si128(less, min));
+    max = _mm_or_si128(_mm_and_si128(greater, values), _mm_andnot_si128(greater, max));
+  }
+
+  uint32_t mins[4];
+  uint32_t maxs[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(mins), _mm_xor_si128(min, signFlip));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(maxs), _mm_xor_si128(max, signFlip));
+
+  for (size_t lane = 0; lane < 4; lane++)
+  {
+    *pMin = lsMin(*pMin, mins[lane]);
+    *pMax = lsMax(*pMax, maxs[lane]);
+  }
+
+  terrainColumns_getRangeScalar_internal(pValues + i, count - i, pMin, pMax);
+}
+
+LS_TARGET_AVX2 static void terrainColumns_getRangeAvx2_internal(const uint32_t *pValues, const size_t count, _In_Out_ uint32_t *pMin, _In_Out_ uint32_t *pMax)
+{
+  __m256i min = _mm256_set1_epi32((int32_t)*pMin);
+  __m256i max = _mm256_set1_epi32((int32_t)*pMax);
+
+  size_t i = 0;
+
+  for (; i + 8 <= count; i += 8)
+  {
+    const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pValues + i));
+
+    min = _mm256_min_epu32(min, values);
+    max = _mm256_max_epu32(max, values);
+  }
+
+  uint32_t mins[8];
+  uint32_t maxs[8];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(mins), min);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(maxs), max);
+
+  for (size_t lane = 0; lane < 8; lane++)
+  {
+    *pMin = lsMin(*pMin, mins[lane]);
+    *pMax = lsMax(*pMax, maxs[lane]);
+  }
+
+  terrainColumns_getRangeScalar_internal(pValues + i, count - i, pMin, pMax);
+}
+
+LS_TARGET_AVX512 static void terrainColumns_getRangeAvx512_internal(const uint32_t *pValues, const size_t count, _In_Out_ uint32_t *pMin, _In_Out_ uint32_t *pMax)
+{
+  __m512i min = _mm512_set1_epi32((int32_t)*pMin);
+  __m512i max = _mm512_set1_epi32((int32_t)*pMax);
+
+  size_t i = 0;
+
+  for (; i + 16 <= count; i += 16)
+  {
+    const __m512i values = _mm512_loadu_si512(pValues + i);
+
+    min = _mm512_min_epu32(min, values);
+    max = _mm512_max_epu32(max, values);
+  }
+
+  // The rest is masked, inactive elements keep the previous range.
+  if (i < count)
+  {
+    const __mmask16 rest = (__mmask16)((1U << (count - i)) - 1);
+    const __m512i values = _mm512_maskz_loadu_epi32(rest, pValues + i);
+
+    min = _mm512_mask_min_epu32(min, rest, min, values);
+    max = _mm512_mask_max_epu32(max, rest, max, values);
+  }
+
+  *pMin = _mm512_reduce_min_epu32(min);
+  *pMax = _mm512_reduce_max_epu32(max);
+}
+
+#endif
+
+typedef void terrainColumns_getRangeFunc(const uint32_t *pValues, const size_t count, _In_Out_ uint32_t *pMin, _In_Out_ uint32_t *pMax);
+
+static terrainColumns_getRangeFunc *const terrainColumns_GetRange[lsCL_Count] =
+{
+  terrainColumns_getRangeScalar_internal,
+#ifdef LS_SIMD_SSE2
+  terrainColumns_getRangeSse2_internal,
+  terrainColumns_getRangeAvx2_internal,
+  terrainColumns_getRangeAvx512_internal,
+#else
+  terrainColumns_getRangeScalar_internal,
+  terrainColumns_getRangeScalar_internal,
+  terrainColumns_getRangeScalar_internal,
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+static void terrainColumns_updateChunk_internal(void *pUserData, const size_t index)
+{
+  terrain *pTerrain = reinterpret_cast<terrain *>(pUserData);
+
+  if (((pTerrain->pStaleColumnChunks[index / 64] >> (index % 64)) & 1) == 0)
+    return;
+
+  const size_t x = (index % pTerrain->chunkCountX) * terrain_chunkSize;
+  const size_t y = (index / pTerrain->chunkCountX) * terrain_chunkSize;
+  const size_t offset = y * pTerrain->width + x;
+
+  const size_t width = lsMin(terrain_chunkSize, pTerrain->width - x);
+  const size_t height = lsMin(terrain_chunkSize, pTerrain->height - y);
+
+  terrainColumns_compute(pTerrain, x, y, width, height, pTerrain->pTotalHeights + offset, pTerrain->pTopLayers + offset, pTerrain->width);
+
+  terrainColumns_getRangeFunc *getRange = terrainColumns_GetRange[lsGetCpuLevel()];
+  uint32_t minHeight = UINT32_MAX;
+  uint32_t maxHeight = 0;
+
+  for (size_t row = 0; row < height; row++)
+    getRange(pTerrain->pTotalHeights + offset + row * pTerrain->width, width, &minHeight, &maxHeight);
+
+  pTerrain->pChunkMinHeights[index] = minHeight;
+  pTerrain->pChunkMaxHeights[index] = maxHeight;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void terrainColumns_compute(const terrain *pTerrain, const size_t x, const size_t y, const size_t width, const size_t height, _Out_ uint32_t *pTotalHeights, _Out_ uint8_t *pTopLayers, const size_t stride)
+{
+  lsAssert(pTerrain != nullptr && x + width <= pTerrain->width && y + height <= pTerrain->height);
+
+  terrainColumns_computeRowFunc *computeRow = terrainColumns_ComputeRow[lsGetCpuLevel()];
+
+  for (size_t row = 0; row < height; row++)
+  {
+    const tile *pTiles = pTerrain->pTiles + (y + row) * pTerrain->width + x;
+    uint32_t *pRowTotalHeights = pTotalHeights != nullptr ? pTotalHeights + row * stride : nullptr;
+    uint8_t *pRowTopLayers = pTopLayers != nullptr ? pTopLayers + row * stride : nullptr;
+
+    computeRow(pTiles, width, pRowTotalHeights, pRowTopLayers);
+  }
+}
+
+lsResult terrainColumns_update(terrain *pTerrain, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  size_t chunkCount = 0;
+
+  LS_ERROR_IF(pTerrain == nullptr || pPool == nullptr, lsR_ArgumentNull);
+
+  chunkCount = (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY;
+
+  if (pTerrain->pTotalHeights == nullptr || pTerrain->pTopLayers == nullptr || pTerrain->pChunkMinHeights == nullptr || pTerrain->pChunkMaxHeights == nullptr)
+  {
+    LS_ERROR_CHECK(lsRealloc(&pTerrain->pTotalHeights, (size_t)pTerrain->width * pTerrain->height));
+    LS_ERROR_CHECK(lsRealloc(&pTerrain->pTopLayers, (size_t)pTerrain->width * pTerrain->height));
+    LS_ERROR_CHECK(lsRealloc(&pTerrain->pChunkMinHeights, chunkCount));
+    LS_ERROR_CHECK(lsRealloc(&pTerrain->pChunkMaxHeights, chunkCount));
+
+    for (size_t i = 0; i < chunkCount; i++)
+      pTerrain->pStaleColumnChunks[i / 64] |= (uint64_t)1 << (i % 64);
+  }
+
+  threadPool_parallelFor(pPool, chunkCount, terrainColumns_updateChunk_internal, pTerrain);
+
+  lsZeroMemory(pTerrain->pStaleColumnChunks, (chunkCount + 63) / 64);
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(10)
+
+DEFINE_TESTABLE(terrainColumns_TestKernels)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t count = 37; // not a multiple of any vector width.
+
+  tile tiles[count];
+  uint32_t totals[count];
+  uint8_t tops[count];
+  uint32_t values[count];
+  rand_seed seed(7, 8);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    // Some empty layers on top, to find the top layer of.
+    const size_t emptyLayers = lsGetRand(seed) % (tt_count + 1);
+
+    for (size_t layer = 0; layer < tt_count; layer++)
+      tiles[i].layerHeights[layer] = layer < emptyLayers ? 0 : (i % 3 == 0 ? UINT16_MAX : (uint16_t)(lsGetRand(seed) % 4 + 1)); // max. heights overflow 16 bit sums.
+
+    values[i] = (uint32_t)lsGetRand(seed); // with the sign bit set for some.
+  }
+
+  // Every level the CPU supports matches the reference.
+  for (size_t level = 0; level <= (size_t)lsGetCpuLevel(); level++)
+  {
+    lsZeroMemory(totals, count);
+    lsMemset(tops, count, 0xFF);
+
+    terrainColumns_ComputeRow[level](tiles, count, totals, tops);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      uint32_t expectedTotal;
+      uint8_t expectedTop;
+      terrainColumns_computeTile_internal(&tiles[i], &expectedTotal, &expectedTop);
+
+      TESTABLE_ASSERT_EQUAL(totals[i], expectedTotal);
+      TESTABLE_ASSERT_EQUAL(tops[i], expectedTop);
+    }
+
+    // Ranges of all lengths, including the partial vectors at the end.
+    for (size_t length = 0; length <= count; length++)
+    {
+      uint32_t min = UINT32_MAX;
+      uint32_t max = 0;
+      uint32_t expectedMin = UINT32_MAX;
+      uint32_t expectedMax = 0;
+
+      terrainColumns_GetRange[level](values, length, &min, &max);
+      terrainColumns_getRangeScalar_internal(values, length, &expectedMin, &expectedMax);
+
+      TESTABLE_ASSERT_EQUAL(min, expectedMin);
+      TESTABLE_ASSERT_EQUAL(max, expectedMax);
+    }
+  }
+
+epilogue:
+  return result;
+}
+
+// Prints the time per tile of each level the CPU supports. The tiles about fit into the L2 cache, so this measures the kernels rather than
+// the memory bandwidth.
+DEFINE_BENCHMARK(terrainColumns_BenchmarkKernels)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t count = 64 * 1024;
+  constexpr size_t repetitions = 64;
+
+  tile *pTiles = nullptr;
+  uint32_t *pTotals = nullptr;
+  uint8_t *pTops = nullptr;
+  rand_seed seed(3, 5);
+  int64_t scalarNs = 0;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pTiles, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pTotals, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pTops, count));
+
+  for (size_t i = 0; i < count; i++)
+    for (size_t layer = 0; layer < tt_count; layer++)
+      pTiles[i].layerHeights[layer] = (uint16_t)(lsGetRand(seed) % 3 == 0 ? 0 : lsGetRand(seed) % 1000);
+
+  for (size_t level = 0; level <= (size_t)lsGetCpuLevel(); level++)
+  {
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+
+    const int64_t start = lsGetCurrentTimeNs();
+
+    for (size_t i = 0; i < repetitions; i++)
+    {
+      terrainColumns_ComputeRow[level](pTiles, count, pTotals, pTops);
+      terrainColumns_GetRange[level](pTotals, count, &min, &max);
+    }
+
+    const int64_t ns = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    if (level == lsCL_Scalar)
+      scalarNs = ns;
+
+    print("terrainColumns ", lsCpuLevel_to_string((lsCpuLevel)level), ": ", (double)ns / (double)(count * repetitions), " ns per tile, ", (double)scalarNs / (double)ns, "x scalar\n");
+  }
+
+epilogue:
+  lsFreePtr(&pTiles);
+  lsFreePtr(&pTotals);
+  lsFreePtr(&pTops);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainColumns_TestUpdateDirtyChunks)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  thread_pool *pPool = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 150, 100)); // with partial chunks.
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    lsZeroMemory(&t.pTiles[i]);
+    t.pTiles[i].layerHeights[tt_soil] = (uint16_t)(i % 100);
+    t.pTiles[i].layerHeights[tt_bedrock] = 8;
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainColumns_update(&t, pPool));
+  TESTABLE_ASSERT_EQUAL(t.pTotalHeights[t.width * 99 + 149], (uint32_t)((t.width * 99 + 149) % 100 + 8));
+  TESTABLE_ASSERT_EQUAL(t.pTopLayers[0], (uint8_t)tt_bedrock);
+  TESTABLE_ASSERT_EQUAL(t.pTopLayers[1], (uint8_t)tt_soil);
+
+  // Only marked chunks are updated.
+  t.pTiles[70 * t.width + 70].layerHeights[tt_snow] = 5;
+  t.pTiles[10 * t.width + 10].layerHeights[tt_snow] = 5;
+  terrain_markDirty(&t, 70, 70, 1, 1);
+
+  TESTABLE_ASSERT_SUCCESS(terrainColumns_update(&t, pPool));
+  TESTABLE_ASSERT_EQUAL(t.pTopLayers[70 * t.width + 70], (uint8_t)tt_snow);
+  TESTABLE_ASSERT_EQUAL(t.pTotalHeights[70 * t.width + 70], (uint32_t)((70 * t.width + 70) % 100 + 8 + 5));
+  TESTABLE_ASSERT_EQUAL(t.pTopLayers[10 * t.width + 10], (uint8_t)tt_soil);
+
+  TESTABLE_ASSERT_EQUAL(t.pChunkMinHeights[0], 8u);
+  TESTABLE_ASSERT_EQUAL(t.pChunkMaxHeights[0], 99u + 8);
+
+epilogue:
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
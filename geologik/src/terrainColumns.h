@@ -0,0 +1,20 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Total height and top layer of the columns of tiles, which most kernels need. Computed with the highest `lsCpuLevel` available, as a
+// tile is exactly 128 bits.
+
+constexpr uint8_t terrainColumns_NoLayer = tt_count; // top layer of tiles without any material.
+
+// Computes the total height and index of the topmost layer that isn't empty for a rect of tiles. Either output may be `nullptr`.
+// `stride` is the row pitch of the outputs in elements.
+void terrainColumns_compute(const terrain *pTerrain, const size_t x, const size_t y, const size_t width, const size_t height, _Out_ uint32_t *pTotalHeights, _Out_ uint8_t *pTopLayers, const size_t stride);
+
+// Updates `pTotalHeights`, `pTopLayers` and the height range of each chunk of `pTerrain` for all chunks that have been marked as dirty
+// since the last update, in parallel.
+lsResult terrainColumns_update(terrain *pTerrain, thread_pool *pPool);
@@ -0,0 +1,284 @@
+#include "terrainCreep.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+struct terrain_creep_context
+{
+  terrain *pTerrain;
+  terrain_creep *pCreep;
+  const terrain_creep_params *pParams;
+};
+
+// Everything that makes up the ground except the soil, snow and water lie on top of it.
+static int64_t terrainCreep_getBedHeight_internal(const terrain *pTerrain, const size_t index)
+{
+  int64_t height = 0;
+
+  for (size_t layer = terrainMaterial_FirstBedLayer; layer < tt_count; layer++)
+    if (layer != tt_soil)
+      height += terrain_getFixedHeight(pTerrain, index, (terrain_type)layer);
+
+  return height;
+}
+
+// The bed slopes are taken from the exact heights, so they stay precise however high the terrain is.
+static void terrainCreep_load_internal(void *pUserData, const size_t index)
+{
+  terrain_creep_context *pContext = reinterpret_cast<terrain_creep_context *>(pUserData);
+  const terrain *pTerrain = pContext->pTerrain;
+  terrain_multigrid_layer *pSoil = &pContext->pCreep->soil;
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pTerrain->height);
+  const float scale = pContext->pParams->diffusivity * pContext->pParams->timeStep / (terrain_tileSize * terrain_tileSize);
+
+  for (size_t y = index * terrain_chunkSize; y < endY; y++)
+  {
+    for (size_t x = 0; x < pTerrain->width; x++)
+    {
+      const size_t i = y * pTerrain->width + x;
+      const int64_t bed = terrainCreep_getBedHeight_internal(pTerrain, i);
+
+      pSoil->pThicknesses[i] = (float)terrain_getFixedHeight(pTerrain, i, tt_soil) / terrain_fixedOne;
+      pSoil->pBedSlopesX[i] = x + 1 < pTerrain->width ? (float)(terrainCreep_getBedHeight_internal(pTerrain, i + 1) - bed) / terrain_fixedOne : 0.f;
+      pSoil->pBedSlopesY[i] = y + 1 < pTerrain->height ? (float)(terrainCreep_getBedHeight_internal(pTerrain, i + pTerrain->width) - bed) / terrain_fixedOne : 0.f;
+      pSoil->pCoefficients[i] = scale * terrainMaterial_getRootFactor(&pTerrain->pTiles[i]);
+    }
+  }
+}
+
+// Reads the coefficients of the neighbouring blocks, so it runs after all of them are loaded.
+static void terrainCreep_getRightHandSides_internal(void *pUserData, const size_t index)
+{
+  terrain_creep_context *pContext = reinterpret_cast<terrain_creep_context *>(pUserData);
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pContext->pTerrain->height);
+
+  terrainMultigrid_getLayerRightHandSides(&pContext->pCreep->soil, index * terrain_chunkSize, endY);
+}
+
+static void terrainCreep_getLimiters_internal(void *pUserData, const size_t index)
+{
+  terrain_creep_context *pContext = reinterpret_cast<terrain_creep_context *>(pUserData);
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pContext->pTerrain->height);
+
+  terrainMultigrid_getLayerLimiters(&pContext->pCreep->soil, pContext->pTerrain, tt_soil, index * terrain_chunkSize, endY);
+}
+
+static void terrainCreep_apply_internal(void *pUserData, const size_t index)
+{
+  terrain_creep_context *pContext = reinterpret_cast<terrain_creep_context *>(pUserData);
+  terrain *pTerrain = pContext->pTerrain;
+  terrain_creep *pCreep = pContext->pCreep;
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pCreep->height);
+  bool changed = false;
+
+  for (size_t y = index * terrain_chunkSize; y < endY; y++)
+  {
+    for (size_t x = 0; x < pCreep->width; x++)
+    {
+      const size_t i = y * pCreep->width + x;
+      const float outflow = terrainMultigrid_getLayerOutflow(&pCreep->soil, x, y);
+      const uint32_t before = terrain_getFixedHeight(pTerrain, i, tt_soil);
+      const uint32_t after = (uint32_t)lsClamp((double)before - (double)outflow * terrain_fixedOne + 0.5, 0.0, (double)UINT32_MAX);
+
+      if (after == before)
+        continue;
+
+      changed = true;
+      terrain_setFixedHeight(pTerrain, i, tt_soil, after);
+    }
+  }
+
+  pCreep->pChangedBlocks[index] = changed;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainCreep_init(_Out_ terrain_creep *pCreep, const uint16_t width, const uint16_t height)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pCreep == nullptr, lsR_ArgumentNull);
+
+  lsZeroMemory(pCreep);
+  pCreep->width = width;
+  pCreep->height = height;
+
+  LS_ERROR_CHECK(terrainMultigrid_initLayer(&pCreep->soil, width, height));
+  LS_ERROR_CHECK(lsAlloc(&pCreep->pChangedBlocks, (height + terrain_chunkSize - 1) / terrain_chunkSize));
+  LS_ERROR_CHECK(terrainMultigrid_init(&pCreep->multigrid, width, height));
+
+epilogue:
+  if (LS_FAILED(result) && pCreep != nullptr)
+    terrainCreep_destroy(pCreep);
+
+  return result;
+}
+
+void terrainCreep_destroy(terrain_creep *pCreep)
+{
+  if (pCreep == nullptr)
+    return;
+
+  terrainMultigrid_destroyLayer(&pCreep->soil);
+  lsFreePtr(&pCreep->pChangedBlocks);
+  terrainMultigrid_destroy(&pCreep->multigrid);
+}
+
+lsResult terrainCreep_step(terrain_creep *pCreep, terrain *pTerrain, const terrain_creep_params *pParams, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_creep_context context;
+  size_t blockCount = 0;
+
+  LS_ERROR_IF(pCreep == nullptr || pTerrain == nullptr || pParams == nullptr || pPool == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pCreep->width != pTerrain->width || pCreep->height != pTerrain->height, lsR_ArgumentOutOfBounds);
+  LS_ERROR_IF(pParams->timeStep < 0 || pParams->diffusivity < 0, lsR_ArgumentOutOfBounds);
+
+  blockCount = (pTerrain->height + terrain_chunkSize - 1) / terrain_chunkSize;
+
+  context.pTerrain = pTerrain;
+  context.pCreep = pCreep;
+  context.pParams = pParams;
+
+  threadPool_parallelFor(pPool, blockCount, terrainCreep_load_internal, &context);
+  threadPool_parallelFor(pPool, blockCount, terrainCreep_getRightHandSides_internal, &context);
+
+  LS_ERROR_CHECK(terrainMultigrid_solve(&pCreep->multigrid, pCreep->soil.pThicknesses, pCreep->soil.pRightHandSides, pCreep->soil.pCoefficients, &pParams->solver, pPool));
+
+  threadPool_parallelFor(pPool, blockCount, terrainCreep_getLimiters_internal, &context);
+  threadPool_parallelFor(pPool, blockCount, terrainCreep_apply_internal, &context);
+
+  for (size_t i = 0; i < blockCount; i++)
+    if (pCreep->pChangedBlocks[i])
+      terrain_markDirty(pTerrain, 0, i * terrain_chunkSize, pTerrain->width, lsMin(terrain_chunkSize, pTerrain->height - i * terrain_chunkSize));
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(20)
+
+static double terrainCreep_getSoil_internal(const terrain *pTerrain)
+{
+  double soil = 0;
+
+  for (size_t i = 0; i < (size_t)pTerrain->width * pTerrain->height; i++)
+    soil += (double)terrain_getFixedHeight(pTerrain, i, tt_soil) / terrain_fixedOne;
+
+  return soil;
+}
+
+// A ridge along the middle of the map, with the same soil cover everywhere. Grass on the northern half if `grassed`.
+static lsResult terrainCreep_createRidge_internal(terrain *pTerrain, const bool grassed)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_CHECK(terrain_init(pTerrain, 48, 16));
+  LS_ERROR_CHECK(terrain_enableFractions(pTerrain, 1U << tt_soil));
+
+  for (size_t y = 0; y < pTerrain->height; y++)
+  {
+    for (size_t x = 0; x < pTerrain->width; x++)
+    {
+      tile *pTile = &pTerrain->pTiles[y * pTerrain->width + x];
+      const size_t distance = x < pTerrain->width / 2u ? pTerrain->width / 2u - x : x - pTerrain->width / 2u;
+
+      lsZeroMemory(pTile);
+      pTile->layerHeights[tt_bedrock] = 8;
+      pTile->layerHeights[tt_stone] = (uint16_t)(2000 - distance * 50);
+      pTile->layerHeights[tt_soil] = 20;
+      pTile->layerHeights[tt_grass] = (uint16_t)(grassed && y < pTerrain->height / 2u ? 8 : 0);
+    }
+  }
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(terrainCreep_TestRidge)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_creep creep;
+  lsZeroMemory(&creep);
+
+  thread_pool *pPool = nullptr;
+  terrain_creep_params params;
+  double soilBefore = 0;
+
+  const size_t crest = 8 * 48 + 24;
+  const size_t foot = 8 * 48;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrainCreep_createRidge_internal(&t, false));
+  TESTABLE_ASSERT_SUCCESS(terrainCreep_init(&creep, t.width, t.height));
+
+  soilBefore = terrainCreep_getSoil_internal(&t);
+
+  for (size_t step = 0; step < 10; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainCreep_step(&creep, &t, &params, pPool));
+
+  // The soil creeps off the crest towards the foot of the ridge, without gaining or losing any. The rock stays.
+  TESTABLE_ASSERT_EQUAL(fabs(terrainCreep_getSoil_internal(&t) - soilBefore) < soilBefore * 1e-4, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, crest, tt_soil) < 20 * terrain_fixedOne, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, foot, tt_soil) > 20 * terrain_fixedOne, true);
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    const size_t x = i % t.width;
+    TESTABLE_ASSERT_EQUAL((size_t)t.pTiles[i].layerHeights[tt_stone], 2000 - (x < 24 ? 24 - x : x - 24) * 50);
+  }
+
+  // Long time steps strip the crest, but stay stable.
+  params.timeStep = 1e7f;
+
+  for (size_t step = 0; step < 5; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainCreep_step(&creep, &t, &params, pPool));
+
+  TESTABLE_ASSERT_EQUAL(fabs(terrainCreep_getSoil_internal(&t) - soilBefore) < soilBefore * 1e-4, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, crest, tt_soil) < terrain_fixedOne, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, foot, tt_soil) > 40 * terrain_fixedOne, true);
+
+epilogue:
+  terrainCreep_destroy(&creep);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainCreep_TestGrass)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_creep creep;
+  lsZeroMemory(&creep);
+
+  thread_pool *pPool = nullptr;
+  terrain_creep_params params;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrainCreep_createRidge_internal(&t, true));
+  TESTABLE_ASSERT_SUCCESS(terrainCreep_init(&creep, t.width, t.height));
+
+  for (size_t step = 0; step < 10; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainCreep_step(&creep, &t, &params, pPool));
+
+  // The roots hold the soil on the grassed half of the crest. The grass itself doesn't move.
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 4 * t.width + 24, tt_soil) > terrain_getFixedHeight(&t, 12 * t.width + 24, tt_soil), true);
+  TESTABLE_ASSERT_EQUAL(t.pTiles[4 * t.width + 24].layerHeights[tt_grass], 8);
+
+epilogue:
+  terrainCreep_destroy(&creep);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "terrainMaterial.h"
+#include "terrainMultigrid.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Soil creep on hillslopes: soil moves with the flux `-D * grad(s)` of the surface `s`, which rounds off ridges and fills hollows. Each
+// step solves that diffusion implicitly for the soil thickness with `terrainMultigrid_solve`, so it stays stable for arbitrarily long
+// time steps, then moves the soil by the fluxes of that solution, limited to what each tile has, so none is gained or lost.
+// Only soil creeps, everything below it stays in place. Grass stays on its tile, its roots slow the soil below it down.
+
+struct terrain_creep_params
+{
+  float timeStep = 1000.f; // in years.
+  float diffusivity = 1.f; // `D` in square decimeters per year.
+  terrain_multigrid_params solver;
+};
+
+// Planes that steps work in, kept between them like those of `terrain_glacier`.
+struct terrain_creep
+{
+  uint16_t width, height;
+
+  terrain_multigrid_layer soil; // the bed is everything but the soil. `k = D * dt / terrain_tileSize^2`.
+  bool *pChangedBlocks; // per block of `terrain_chunkSize` rows.
+  terrain_multigrid multigrid;
+};
+
+lsResult terrainCreep_init(_Out_ terrain_creep *pCreep, const uint16_t width, const uint16_t height);
+void terrainCreep_destroy(terrain_creep *pCreep);
+
+// Moves the soil of `pTerrain` for one time step. Soil doesn't creep across the edges of the map. Steps are usually much less than a
+// decimeter, so layers without fractions (see `terrain_enableFractions`) round it away.
+lsResult terrainCreep_step(terrain_creep *pCreep, terrain *pTerrain, const terrain_creep_params *pParams, thread_pool *pPool);
@@ -0,0 +1,1131 @@
+#include "terrainFlow.h"
+#include "terrainColumns.h"
+
+#include <atomic>
+
+//////////////////////////////////////////////////////////////////////////
+
+constexpr uint32_t terrainFlow_NoTile = UINT32_MAX;
+constexpr uint8_t terrainFlow_Unvisited = 0xFF;
+constexpr uint8_t terrainFlow_Source = 0x80; // marks tiles without any upstream neighbours before accumulating.
+constexpr float terrainFlow_Diagonal = 0.70710678f; // 1 / sqrt(2)
+constexpr float terrainFlow_Pi = 3.14159265f;
+constexpr size_t terrainFlow_FillBlockSize = 256; // in tiles, the depressions are filled in blocks of this size in parallel.
+constexpr size_t terrainFlow_FlatChunkSize = 4096; // tiles of a front through flats handled by one task.
+
+struct terrain_flow_context
+{
+  const terrain *pTerrain;
+  terrain_flow *pFlow;
+  uint8_t *pDonors; // number of upstream neighbours that haven't been accumulated yet.
+};
+
+static void terrainFlow_computeHeights_internal(void *pUserData, const size_t index)
+{
+  terrain_flow_context *pContext = reinterpret_cast<terrain_flow_context *>(pUserData);
+  const size_t y = index * terrain_chunkSize;
+  const size_t rows = lsMin(terrain_chunkSize, (size_t)pContext->pFlow->height - y);
+
+  terrainColumns_compute(pContext->pTerrain, 0, y, pContext->pFlow->width, rows, pContext->pFlow->pFilledHeights + y * pContext->pFlow->width, nullptr, pContext->pFlow->width);
+}
+
+// Where water can pass between two watersheds of the blocks, or from one out of the map.
+struct terrain_flow_spill
+{
+  uint32_t from, to; // watersheds, `to` is the larger one.
+  uint32_t height; // lowest height water has to rise to, to get from one to the other.
+};
+
+struct terrain_flow_block
+{
+  uint32_t watershedCount;
+  uint32_t firstWatershed; // over all blocks, watersheds are numbered block by block.
+  terrain_flow_spill *pSpills;
+  size_t spillCount;
+  lsResult result;
+};
+
+// The depressions are filled in three steps, the first and last of which are parallel over the blocks:
+// - Each block is flooded on its own from its perimeter, which yields the filled heights within the block and splits it into watersheds,
+//   the tiles reached from the same perimeter tile. Where watersheds touch, water spills over at the higher filled height of both tiles.
+// - The watersheds of all blocks and the spills between them form a much smaller graph, in which the lowest height each watershed has
+//   to be raised to, to drain out of the map, is the largest spill on its way to the edge. Adding the spills from the lowest up until
+//   each watershed is connected to the edge finds all of them.
+// - Each tile is raised to the level of its watershed.
+// The result is the same as flooding the whole map at once (Barnes et al. 2016).
+struct terrain_flow_fill_context
+{
+  terrain_flow *pFlow;
+  size_t blockSize;
+  size_t blocksX, blocksY;
+  terrain_flow_block *pBlocks;
+  uint32_t *pLevels; // per watershed.
+};
+
+// While filling, `pAccumulation` holds the watershed of each tile, numbered within its block.
+static void terrainFlow_getBlock_internal(const terrain_flow_fill_context *pContext, const size_t index, _Out_ size_t *pX, _Out_ size_t *pY, _Out_ size_t *pWidth, _Out_ size_t *pHeight)
+{
+  *pX = (index % pContext->blocksX) * pContext->blockSize;
+  *pY = (index / pContext->blocksX) * pContext->blockSize;
+  *pWidth = lsMin(pContext->blockSize, (size_t)pContext->pFlow->width - *pX);
+  *pHeight = lsMin(pContext->blockSize, (size_t)pContext->pFlow->height - *pY);
+}
+
+// Sorts the spills by watersheds and keeps the lowest one per pair.
+static size_t terrainFlow_mergeSpills_internal(terrain_flow_spill *pSpills, const size_t count)
+{
+  size_t merged = 0;
+
+  std::sort(pSpills, pSpills + count, [](const terrain_flow_spill &a, const terrain_flow_spill &b) { return a.from != b.from ? a.from < b.from : a.to != b.to ? a.to < b.to : a.height < b.height; });
+
+  for (size_t i = 0; i < count; i++)
+    if (merged == 0 || pSpills[merged - 1].from != pSpills[i].from || pSpills[merged - 1].to != pSpills[i].to)
+      pSpills[merged++] = pSpills[i];
+
+  return merged;
+}
+
+// Priority flood of a block from its perimeter. Tiles are visited in order of their filled height, which is their own height or that of
+// the neighbour the flood came from, whichever is higher. Heights are integers, so the priority queue is a bucket per height, each a
+// list through `pNext`. The filled heights are always heights of tiles in the block, so blocks with cliffs much higher than they have
+// tiles get a bucket per distinct height instead. Perimeter tiles that are reached before they are visited themselves join the watershed
+// that reached them, so only perimeter tiles that are local minima start a new one.
+static void terrainFlow_fillBlock_internal(void *pUserData, const size_t index)
+{
+  lsResult result = lsR_Success;
+
+  terrain_flow_fill_context *pContext = reinterpret_cast<terrain_flow_fill_context *>(pUserData);
+  terrain_flow *pFlow = pContext->pFlow;
+  terrain_flow_block *pBlock = &pContext->pBlocks[index];
+  const size_t width = pFlow->width;
+
+  size_t x0, y0, blockWidth, blockHeight;
+  terrainFlow_getBlock_internal(pContext, index, &x0, &y0, &blockWidth, &blockHeight);
+
+  const size_t tileCount = blockWidth * blockHeight;
+
+  uint32_t *pNext = nullptr;
+  uint32_t *pHeads = nullptr;
+  uint32_t *pTails = nullptr;
+  uint32_t *pDistinct = nullptr;
+  size_t bucketCount = 0;
+  uint32_t minHeight = UINT32_MAX;
+  uint32_t maxHeight = 0;
+  size_t spillCapacity = 0;
+
+  pBlock->watershedCount = 0;
+  pBlock->pSpills = nullptr;
+  pBlock->spillCount = 0;
+
+  for (size_t y = y0; y < y0 + blockHeight; y++)
+  {
+    for (size_t x = x0; x < x0 + blockWidth; x++)
+    {
+      minHeight = lsMin(minHeight, pFlow->pFilledHeights[y * width + x]);
+      maxHeight = lsMax(maxHeight, pFlow->pFilledHeights[y * width + x]);
+      pFlow->pDirections[y * width + x] = terrainFlow_Unvisited;
+      pFlow->pAccumulation[y * width + x] = terrainFlow_NoTile;
+    }
+  }
+
+  if (maxHeight - minHeight < 4 * tileCount)
+  {
+    bucketCount = (size_t)(maxHeight - minHeight) + 1;
+  }
+  else
+  {
+    LS_ERROR_CHECK(lsAlloc(&pDistinct, tileCount));
+
+    for (size_t y = 0; y < blockHeight; y++)
+      lsMemcpy(pDistinct + y * blockWidth, pFlow->pFilledHeights + (y0 + y) * width + x0, blockWidth);
+
+    std::sort(pDistinct, pDistinct + tileCount);
+    bucketCount = (size_t)(std::unique(pDistinct, pDistinct + tileCount) - pDistinct);
+  }
+
+  LS_ERROR_CHECK(lsAlloc(&pNext, tileCount));
+  LS_ERROR_CHECK(lsAlloc(&pHeads, bucketCount));
+  LS_ERROR_CHECK(lsAlloc(&pTails, bucketCount));
+
+  lsMemset(pHeads, bucketCount, 0xFF);
+
+  {
+    auto push = [&](const size_t x, const size_t y)
+    {
+      const uint32_t level = pFlow->pFilledHeights[y * width + x];
+      const size_t bucket = pDistinct == nullptr ? level - minHeight : (size_t)(std::lower_bound(pDistinct, pDistinct + bucketCount, level) - pDistinct);
+      const uint32_t local = (uint32_t)((y - y0) * blockWidth + (x - x0));
+
+      pFlow->pDirections[y * width + x] = 0;
+      pNext[local] = terrainFlow_NoTile;
+
+      if (pHeads[bucket] == terrainFlow_NoTile)
+        pHeads[bucket] = local;
+      else
+        pNext[pTails[bucket]] = local;
+
+      pTails[bucket] = local;
+    };
+
+    for (size_t y = y0; y < y0 + blockHeight; y++)
+      for (size_t x = x0; x < x0 + blockWidth; x += (y == y0 || y == y0 + blockHeight - 1) ? 1 : lsMax(blockWidth - 1, (size_t)1))
+        push(x, y);
+
+    for (size_t bucket = 0; bucket < bucketCount; bucket++)
+    {
+      while (pHeads[bucket] != terrainFlow_NoTile)
+      {
+        const uint32_t local = pHeads[bucket];
+        pHeads[bucket] = pNext[local];
+
+        const size_t x = x0 + local % blockWidth;
+        const size_t y = y0 + local / blockWidth;
+        const size_t i = y * width + x;
+        const uint32_t level = pFlow->pFilledHeights[i];
+
+        if (pFlow->pAccumulation[i] == terrainFlow_NoTile)
+          pFlow->pAccumulation[i] = pBlock->watershedCount++;
+
+        for (uint8_t direction = 0; direction < tfd_count; direction++)
+        {
+          const size_t nx = x + (size_t)terrainFlow_OffsetX[direction];
+          const size_t ny = y + (size_t)terrainFlow_OffsetY[direction];
+
+          if (nx - x0 >= blockWidth || ny - y0 >= blockHeight)
+            continue;
+
+          const size_t neighbour = ny * width + nx;
+
+          if (pFlow->pDirections[neighbour] == terrainFlow_Unvisited)
+          {
+            pFlow->pFilledHeights[neighbour] = lsMax(pFlow->pFilledHeights[neighbour], level);
+            pFlow->pAccumulation[neighbour] = pFlow->pAccumulation[i];
+            push(nx, ny);
+          }
+          else if (pFlow->pAccumulation[neighbour] == terrainFlow_NoTile)
+          {
+            // A perimeter tile that's still queued, at its own height, which is at least `level`.
+            pFlow->pAccumulation[neighbour] = pFlow->pAccumulation[i];
+          }
+        }
+      }
+    }
+  }
+
+  // Spills between the watersheds within the block, to the right and below of each tile.
+  for (size_t y = y0; y < y0 + blockHeight; y++)
+  {
+    for (size_t x = x0; x < x0 + blockWidth; x++)
+    {
+      const size_t i = y * width + x;
+
+      for (uint8_t direction = tfd_east; direction <= tfd_southWest; direction++)
+      {
+        const size_t nx = x + (size_t)terrainFlow_OffsetX[direction];
+        const size_t ny = y + (size_t)terrainFlow_OffsetY[direction];
+
+        if (nx - x0 >= blockWidth || ny - y0 >= blockHeight)
+          continue;
+
+        const size_t neighbour = ny * width + nx;
+
+        if (pFlow->pAccumulation[neighbour] == pFlow->pAccumulation[i])
+          continue;
+
+        if (pBlock->spillCount == spillCapacity)
+        {
+          spillCapacity = lsMax(spillCapacity * 2, (size_t)64);
+          LS_ERROR_CHECK(lsRealloc(&pBlock->pSpills, spillCapacity));
+        }
+
+        pBlock->pSpills[pBlock->spillCount++] = { lsMin(pFlow->pAccumulation[i], pFlow->pAccumulation[neighbour]), lsMax(pFlow->pAccumulation[i], pFlow->pAccumulation[neighbour]), lsMax(pFlow->pFilledHeights[i], pFlow->pFilledHeights[neighbour]) };
+      }
+    }
+  }
+
+  pBlock->spillCount = terrainFlow_mergeSpills_internal(pBlock->pSpills, pBlock->spillCount);
+
+epilogue:
+  lsFreePtr(&pNext);
+  lsFreePtr(&pHeads);
+  lsFreePtr(&pTails);
+  lsFreePtr(&pDistinct);
+  pBlock->result = result;
+}
+
+// Spills from the perimeter of a block into the blocks after it, and out of the map, with the watersheds numbered over all blocks.
+// Perimeter tiles aren't raised by the flood of their block, so the spills are at the higher of the two heights. The map itself is the
+// watershed after all others.
+static void terrainFlow_getBorderSpills_internal(void *pUserData, const size_t index)
+{
+  lsResult result = lsR_Success;
+
+  terrain_flow_fill_context *pContext = reinterpret_cast<terrain_flow_fill_context *>(pUserData);
+  terrain_flow *pFlow = pContext->pFlow;
+  terrain_flow_block *pBlock = &pContext->pBlocks[index];
+  const size_t width = pFlow->width;
+  const size_t height = pFlow->height;
+  const uint32_t outside = pContext->pBlocks[pContext->blocksX * pContext->blocksY - 1].firstWatershed + pContext->pBlocks[pContext->blocksX * pContext->blocksY - 1].watershedCount;
+
+  size_t x0, y0, blockWidth, blockHeight;
+  terrainFlow_getBlock_internal(pContext, index, &x0, &y0, &blockWidth, &blockHeight);
+
+  const size_t firstBorderSpill = pBlock->spillCount;
+  size_t spillCapacity = pBlock->spillCount;
+
+  for (size_t y = y0; y < y0 + blockHeight; y++)
+  {
+    for (size_t x = x0; x < x0 + blockWidth; x += (y == y0 || y == y0 + blockHeight - 1) ? 1 : lsMax(blockWidth - 1, (size_t)1))
+    {
+      const size_t i = y * width + x;
+      const uint32_t watershed = pBlock->firstWatershed + pFlow->pAccumulation[i];
+
+      // Tiles at the edges of the map drain out of it.
+      if (x == 0 || y == 0 || x == width - 1 || y == height - 1)
+      {
+        if (pBlock->spillCount == spillCapacity)
+        {
+          spillCapacity = lsMax(spillCapacity * 2, (size_t)64);
+          LS_ERROR_CHECK(lsRealloc(&pBlock->pSpills, spillCapacity));
+        }
+
+        pBlock->pSpills[pBlock->spillCount++] = { watershed, outside, pFlow->pFilledHeights[i] };
+      }
+
+      for (uint8_t direction = 0; direction < tfd_count; direction++)
+      {
+        const size_t nx = x + (size_t)terrainFlow_OffsetX[direction];
+        const size_t ny = y + (size_t)terrainFlow_OffsetY[direction];
+
+        if (nx >= width || ny >= height)
+          continue;
+
+        const size_t other = (ny / pContext->blockSize) * pContext->blocksX + nx / pContext->blockSize;
+
+        if (other <= index)
+          continue;
+
+        if (pBlock->spillCount == spillCapacity)
+        {
+          spillCapacity = lsMax(spillCapacity * 2, (size_t)64);
+          LS_ERROR_CHECK(lsRealloc(&pBlock->pSpills, spillCapacity));
+        }
+
+        const size_t neighbour = ny * width + nx;
+        pBlock->pSpills[pBlock->spillCount++] = { watershed, pContext->pBlocks[other].firstWatershed + pFlow->pAccumulation[neighbour], lsMax(pFlow->pFilledHeights[i], pFlow->pFilledHeights[neighbour]) };
+      }
+    }
+  }
+
+  // The spills within the block were numbered within it.
+  for (size_t i = 0; i < firstBorderSpill; i++)
+  {
+    pBlock->pSpills[i].from += pBlock->firstWatershed;
+    pBlock->pSpills[i].to += pBlock->firstWatershed;
+  }
+
+  pBlock->spillCount = firstBorderSpill + terrainFlow_mergeSpills_internal(pBlock->pSpills + firstBorderSpill, pBlock->spillCount - firstBorderSpill);
+
+epilogue:
+  pBlock->result = result;
+}
+
+// Kruskal's algorithm on the spills, with a union-find over the watersheds that keeps a list of the members of each set. When a set
+// first connects to the outside of the map, all its members drain at the height of that spill, which is the largest one on their way.
+static lsResult terrainFlow_joinWatersheds_internal(terrain_flow_fill_context *pContext)
+{
+  lsResult result = lsR_Success;
+
+  const size_t blockCount = pContext->blocksX * pContext->blocksY;
+  const uint32_t outside = pContext->pBlocks[blockCount - 1].firstWatershed + pContext->pBlocks[blockCount - 1].watershedCount;
+
+  terrain_flow_spill *pSpills = nullptr;
+  uint32_t *pParents = nullptr;
+  uint32_t *pSizes = nullptr;
+  uint32_t *pNextMembers = nullptr;
+  uint32_t *pLastMembers = nullptr;
+  size_t spillCount = 0;
+  size_t drained = 0;
+
+  for (size_t i = 0; i < blockCount; i++)
+    spillCount += pContext->pBlocks[i].spillCount;
+
+  LS_ERROR_CHECK(lsAlloc(&pSpills, spillCount));
+  LS_ERROR_CHECK(lsAlloc(&pParents, (size_t)outside + 1));
+  LS_ERROR_CHECK(lsAlloc(&pSizes, (size_t)outside + 1));
+  LS_ERROR_CHECK(lsAlloc(&pNextMembers, (size_t)outside + 1));
+  LS_ERROR_CHECK(lsAlloc(&pLastMembers, (size_t)outside + 1));
+
+  spillCount = 0;
+
+  for (size_t i = 0; i < blockCount; i++)
+  {
+    lsMemcpy(pSpills + spillCount, pContext->pBlocks[i].pSpills, pContext->pBlocks[i].spillCount);
+    spillCount += pContext->pBlocks[i].spillCount;
+  }
+
+  std::sort(pSpills, pSpills + spillCount, [](const terrain_flow_spill &a, const terrain_flow_spill &b) { return a.height < b.height; });
+
+  for (uint32_t i = 0; i <= outside; i++)
+  {
+    pParents[i] = i;
+    pSizes[i] = 1;
+    pNextMembers[i] = terrainFlow_NoTile;
+    pLastMembers[i] = i;
+  }
+
+  {
+    auto find = [&](uint32_t watershed)
+    {
+      while (pParents[watershed] != watershed)
+      {
+        pParents[watershed] = pParents[pParents[watershed]];
+        watershed = pParents[watershed];
+      }
+
+      return watershed;
+    };
+
+    for (size_t i = 0; i < spillCount && drained < outside; i++)
+    {
+      uint32_t a = find(pSpills[i].from);
+      uint32_t b = find(pSpills[i].to);
+
+      if (a == b)
+        continue;
+
+      const uint32_t outsideSet = find(outside);
+
+      if (a == outsideSet || b == outsideSet)
+      {
+        for (uint32_t member = a == outsideSet ? b : a; member != terrainFlow_NoTile; member = pNextMembers[member])
+        {
+          pContext->pLevels[member] = pSpills[i].height;
+          drained++;
+        }
+      }
+
+      if (pSizes[a] < pSizes[b])
+        std::swap(a, b);
+
+      pParents[b] = a;
+      pSizes[a] += pSizes[b];
+      pNextMembers[pLastMembers[a]] = b;
+      pLastMembers[a] = pLastMembers[b];
+    }
+  }
+
+  // Every watershed touches its neighbours or the edge of the map.
+  lsAssert(drained == outside);
+
+epilogue:
+  lsFreePtr(&pSpills);
+  lsFreePtr(&pParents);
+  lsFreePtr(&pSizes);
+  lsFreePtr(&pNextMembers);
+  lsFreePtr(&pLastMembers);
+  return result;
+}
+
+static void terrainFlow_raiseBlock_internal(void *pUserData, const size_t index)
+{
+  terrain_flow_fill_context *pContext = reinterpret_cast<terrain_flow_fill_context *>(pUserData);
+  terrain_flow *pFlow = pContext->pFlow;
+  const uint32_t firstWatershed = pContext->pBlocks[index].firstWatershed;
+
+  size_t x0, y0, blockWidth, blockHeight;
+  terrainFlow_getBlock_internal(pContext, index, &x0, &y0, &blockWidth, &blockHeight);
+
+  for (size_t y = y0; y < y0 + blockHeight; y++)
+  {
+    for (size_t x = x0; x < x0 + blockWidth; x++)
+    {
+      const size_t i = y * pFlow->width + x;
+      pFlow->pFilledHeights[i] = lsMax(pFlow->pFilledHeights[i], pContext->pLevels[firstWatershed + pFlow->pAccumulation[i]]);
+    }
+  }
+}
+
+// Fills the depressions of `pFilledHeights` in place. Uses `pDirections` and `pAccumulation` as scratch space.
+static lsResult terrainFlow_fill_internal(terrain_flow *pFlow, thread_pool *pPool, const size_t blockSize)
+{
+  lsResult result = lsR_Success;
+
+  terrain_flow_fill_context context;
+  size_t blockCount = 0;
+  uint32_t watershedCount = 0;
+
+  context.pFlow = pFlow;
+  context.blockSize = blockSize;
+  context.blocksX = (pFlow->width + blockSize - 1) / blockSize;
+  context.blocksY = (pFlow->height + blockSize - 1) / blockSize;
+  context.pBlocks = nullptr;
+  context.pLevels = nullptr;
+
+  blockCount = context.blocksX * context.blocksY;
+
+  LS_ERROR_CHECK(lsAllocZero(&context.pBlocks, blockCount));
+
+  threadPool_parallelFor(pPool, blockCount, terrainFlow_fillBlock_internal, &context);
+
+  for (size_t i = 0; i < blockCount; i++)
+  {
+    LS_ERROR_CHECK(context.pBlocks[i].result);
+
+    context.pBlocks[i].firstWatershed = watershedCount;
+    watershedCount += context.pBlocks[i].watershedCount;
+  }
+
+  threadPool_parallelFor(pPool, blockCount, terrainFlow_getBorderSpills_internal, &context);
+
+  for (size_t i = 0; i < blockCount; i++)
+    LS_ERROR_CHECK(context.pBlocks[i].result);
+
+  LS_ERROR_CHECK(lsAlloc(&context.pLevels, watershedCount));
+  LS_ERROR_CHECK(terrainFlow_joinWatersheds_internal(&context));
+
+  threadPool_parallelFor(pPool, blockCount, terrainFlow_raiseBlock_internal, &context);
+
+epilogue:
+  if (context.pBlocks != nullptr)
+    for (size_t i = 0; i < blockCount; i++)
+      lsFreePtr(&context.pBlocks[i].pSpills);
+
+  lsFreePtr(&context.pBlocks);
+  lsFreePtr(&context.pLevels);
+  return result;
+}
+
+// Tiles in flats, without a lower neighbour, are marked with `terrainFlow_Unvisited`. Edge tiles without one are outlets.
+static void terrainFlow_computeDirections_internal(void *pUserData, const size_t index)
+{
+  terrain_flow *pFlow = reinterpret_cast<terrain_flow_context *>(pUserData)->pFlow;
+  const size_t width = pFlow->width;
+  const size_t height = pFlow->height;
+  const size_t yEnd = lsMin((index + 1) * terrain_chunkSize, height);
+
+  for (size_t y = index * terrain_chunkSize; y < yEnd; y++)
+  {
+    for (size_t x = 0; x < width; x++)
+    {
+      const size_t i = y * width + x;
+      const float elevation = (float)pFlow->pFilledHeights[i];
+      const bool isEdge = x == 0 || y == 0 || x == width - 1 || y == height - 1;
+
+      float steepest = 0;
+      uint8_t direction = isEdge ? (uint8_t)tfd_outlet : terrainFlow_Unvisited;
+
+      for (uint8_t d = 0; d < tfd_count; d++)
+      {
+        if (isEdge && !terrainFlow_hasNeighbour(pFlow, x, y, d))
+          continue;
+
+        const size_t neighbour = (size_t)((int64_t)i + terrainFlow_OffsetY[d] * (int64_t)width + terrainFlow_OffsetX[d]);
+        const float slope = (elevation - (float)pFlow->pFilledHeights[neighbour]) * ((d & 1) ? terrainFlow_Diagonal : 1.f);
+
+        if (slope > steepest)
+        {
+          steepest = slope;
+          direction = d;
+        }
+      }
+
+      pFlow->pDirections[i] = direction;
+      pFlow->pAccumulation[i] = direction == terrainFlow_Unvisited ? terrainFlow_NoTile : 0; // steps out of flats, see `terrainFlow_drainFlats_internal`.
+    }
+  }
+}
+
+// Filled depressions leave flats, from which the water has to be led along the shortest path to a tile that drains. That's a breadth
+// first search through each flat, from the tiles of the same height around it that already have a direction. The fronts are kept in
+// `pOrder`, which is only filled later.
+struct terrain_flow_flat_context
+{
+  terrain_flow *pFlow;
+  uint32_t step; // of the front being expanded, in `pAccumulation`.
+  size_t frontStart, frontEnd;
+  std::atomic<size_t> queueEnd;
+};
+
+// Tiles next to one that drains.
+static void terrainFlow_findFlats_internal(void *pUserData, const size_t index)
+{
+  terrain_flow_flat_context *pContext = reinterpret_cast<terrain_flow_flat_context *>(pUserData);
+  terrain_flow *pFlow = pContext->pFlow;
+  const size_t width = pFlow->width;
+  const size_t yEnd = lsMin((index + 1) * terrain_chunkSize, (size_t)pFlow->height);
+
+  for (size_t y = index * terrain_chunkSize; y < yEnd; y++)
+  {
+    for (size_t x = 0; x < width; x++)
+    {
+      const size_t i = y * width + x;
+
+      if (pFlow->pDirections[i] != terrainFlow_Unvisited)
+        continue;
+
+      // Tiles in flats are never at the edges.
+      for (uint8_t d = 0; d < tfd_count; d++)
+      {
+        const size_t neighbour = (size_t)((int64_t)i + terrainFlow_OffsetY[d] * (int64_t)width + terrainFlow_OffsetX[d]);
+
+        if (pFlow->pFilledHeights[neighbour] == pFlow->pFilledHeights[i] && std::atomic_ref<uint32_t>(pFlow->pAccumulation[neighbour]).load(std::memory_order_relaxed) == 0)
+        {
+          std::atomic_ref<uint32_t>(pFlow->pAccumulation[i]).store(1, std::memory_order_relaxed);
+          pFlow->pOrder[pContext->queueEnd.fetch_add(1, std::memory_order_relaxed)] = (uint32_t)i;
+          break;
+        }
+      }
+    }
+  }
+}
+
+// Points each tile of the front at the first neighbour of the same height one step closer to the edge of the flat, which is known by now,
+// then claims the neighbours not reached yet for the next front.
+static void terrainFlow_expandFlats_internal(void *pUserData, const size_t index)
+{
+  terrain_flow_flat_context *pContext = reinterpret_cast<terrain_flow_flat_context *>(pUserData);
+  terrain_flow *pFlow = pContext->pFlow;
+  const size_t width = pFlow->width;
+  const uint32_t step = pContext->step;
+  const size_t end = lsMin(pContext->frontStart + (index + 1) * terrainFlow_FlatChunkSize, pContext->frontEnd);
+
+  for (size_t k = pContext->frontStart + index * terrainFlow_FlatChunkSize; k < end; k++)
+  {
+    const size_t i = pFlow->pOrder[k];
+    const uint32_t level = pFlow->pFilledHeights[i];
+    bool pointed = false;
+
+    for (uint8_t d = 0; d < tfd_count; d++)
+    {
+      const size_t neighbour = (size_t)((int64_t)i + terrainFlow_OffsetY[d] * (int64_t)width + terrainFlow_OffsetX[d]);
+
+      if (pFlow->pFilledHeights[neighbour] != level)
+        continue;
+
+      uint32_t distance = std::atomic_ref<uint32_t>(pFlow->pAccumulation[neighbour]).load(std::memory_order_relaxed);
+
+      if (!pointed && distance == step - 1)
+      {
+        pFlow->pDirections[i] = d;
+        pointed = true;
+      }
+      else if (distance == terrainFlow_NoTile && std::atomic_ref<uint32_t>(pFlow->pAccumulation[neighbour]).compare_exchange_strong(distance, step + 1, std::memory_order_relaxed))
+      {
+        pFlow->pOrder[pContext->queueEnd.fetch_add(1, std::memory_order_relaxed)] = (uint32_t)neighbour;
+      }
+    }
+  }
+}
+
+static void terrainFlow_drainFlats_internal(terrain_flow *pFlow, thread_pool *pPool)
+{
+  terrain_flow_flat_context context;
+  context.pFlow = pFlow;
+  context.step = 1;
+  context.frontStart = 0;
+  context.queueEnd = 0;
+
+  threadPool_parallelFor(pPool, (pFlow->height + terrain_chunkSize - 1) / terrain_chunkSize, terrainFlow_findFlats_internal, &context);
+
+  while (context.frontStart < context.queueEnd)
+  {
+    context.frontEnd = context.queueEnd;
+    threadPool_parallelFor(pPool, (context.frontEnd - context.frontStart + terrainFlow_FlatChunkSize - 1) / terrainFlow_FlatChunkSize, terrainFlow_expandFlats_internal, &context);
+
+    context.frontStart = context.frontEnd;
+    context.step++;
+  }
+}
+
+// Breadth first search upstream from each outlet, through the tiles that drain into each other. The tiles draining into an outlet are
+// its accumulation, so every outlet gets its own range of `pOrder` and they run in parallel.
+struct terrain_flow_order_context
+{
+  terrain_flow *pFlow;
+  uint32_t *pOutlets;
+  size_t *pOffsets; // into `pOrder`, per outlet.
+};
+
+static void terrainFlow_orderBasin_internal(void *pUserData, const size_t index)
+{
+  terrain_flow_order_context *pContext = reinterpret_cast<terrain_flow_order_context *>(pUserData);
+  terrain_flow *pFlow = pContext->pFlow;
+  const size_t width = pFlow->width;
+
+  size_t next = pContext->pOffsets[index];
+  size_t end = next;
+
+  pFlow->pOrder[end++] = pContext->pOutlets[index];
+
+  for (; next < end; next++)
+  {
+    const size_t i = pFlow->pOrder[next];
+    const size_t x = i % width;
+    const size_t y = i / width;
+
+    for (uint8_t d = 0; d < tfd_count; d++)
+    {
+      if (!terrainFlow_hasNeighbour(pFlow, x, y, d))
+        continue;
+
+      const size_t neighbour = (size_t)((int64_t)i + terrainFlow_OffsetY[d] * (int64_t)width + terrainFlow_OffsetX[d]);
+
+      if (pFlow->pDirections[neighbour] == (d + tfd_count / 2) % tfd_count)
+        pFlow->pOrder[end++] = (uint32_t)neighbour;
+    }
+  }
+
+  lsAssert(end == pContext->pOffsets[index] + pFlow->pAccumulation[pContext->pOutlets[index]]);
+}
+
+static lsResult terrainFlow_order_internal(terrain_flow *pFlow, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_flow_order_context context = { pFlow, nullptr, nullptr };
+  const size_t width = pFlow->width;
+  const size_t height = pFlow->height;
+  size_t outletCount = 0;
+  size_t offset = 0;
+
+  LS_ERROR_CHECK(lsAlloc(&context.pOutlets, 2 * (width + height)));
+  LS_ERROR_CHECK(lsAlloc(&context.pOffsets, 2 * (width + height)));
+
+  for (size_t y = 0; y < height; y++)
+  {
+    for (size_t x = 0; x < width; x += (y == 0 || y == height - 1) ? 1 : lsMax(width - 1, (size_t)1))
+    {
+      if (pFlow->pDirections[y * width + x] != tfd_outlet)
+        continue;
+
+      context.pOutlets[outletCount] = (uint32_t)(y * width + x);
+      context.pOffsets[outletCount] = offset;
+      offset += pFlow->pAccumulation[y * width + x];
+      outletCount++;
+    }
+  }
+
+  lsAssert(offset == width * height);
+
+  threadPool_parallelFor(pPool, outletCount, terrainFlow_orderBasin_internal, &context);
+
+epilogue:
+  lsFreePtr(&context.pOutlets);
+  lsFreePtr(&context.pOffsets);
+  return result;
+}
+
+// Tarboton's D-infinity: the steepest downwards slope over the eight triangular facets between a cardinal and a diagonal neighbour.
+static void terrainFlow_computeAngles_internal(void *pUserData, const size_t index)
+{
+  terrain_flow *pFlow = reinterpret_cast<terrain_flow_context *>(pUserData)->pFlow;
+  const size_t width = pFlow->width;
+  const size_t height = pFlow->height;
+  const size_t yEnd = lsMin((index + 1) * terrain_chunkSize, height);
+
+  for (size_t y = index * terrain_chunkSize; y < yEnd; y++)
+  {
+    for (size_t x = 0; x < width; x++)
+    {
+      const size_t i = y * width + x;
+      const float e0 = (float)pFlow->pFilledHeights[i];
+
+      float steepest = 0;
+      float angle = pFlow->pDirections[i] == tfd_outlet ? terrainFlow_NoAngle : pFlow->pDirections[i] * (terrainFlow_Pi / 4);
+
+      for (uint8_t facet = 0; facet < tfd_count; facet++)
+      {
+        // Even facets start at the cardinal neighbour and turn clockwise, odd ones start at the next cardinal neighbour and turn back.
+        const uint8_t cardinal = (facet & 1) ? (uint8_t)((facet + 1) % tfd_count) : facet;
+        const uint8_t diagonal = (facet & 1) ? facet : (uint8_t)(facet + 1);
+
+        if (!terrainFlow_hasNeighbour(pFlow, x, y, cardinal) || !terrainFlow_hasNeighbour(pFlow, x, y, diagonal))
+          continue;
+
+        const float e1 = (float)pFlow->pFilledHeights[(size_t)((int64_t)i + terrainFlow_OffsetY[cardinal] * (int64_t)width + terrainFlow_OffsetX[cardinal])];
+        const float e2 = (float)pFlow->pFilledHeights[(size_t)((int64_t)i + terrainFlow_OffsetY[diagonal] * (int64_t)width + terrainFlow_OffsetX[diagonal])];
+        const float s1 = e0 - e1;
+        const float s2 = e1 - e2;
+
+        float r = atan2f(s2, s1);
+        float slope;
+
+        if (r < 0)
+        {
+          r = 0;
+          slope = s1;
+        }
+        else if (r > terrainFlow_Pi / 4)
+        {
+          r = terrainFlow_Pi / 4;
+          slope = (e0 - e2) * terrainFlow_Diagonal;
+        }
+        else
+        {
+          slope = sqrtf(s1 * s1 + s2 * s2);
+        }
+
+        if (slope > steepest)
+        {
+          steepest = slope;
+          angle = (facet & 1) ? (facet + 1) * (terrainFlow_Pi / 4) - r : facet * (terrainFlow_Pi / 4) + r;
+
+          if (angle >= 2 * terrainFlow_Pi)
+            angle -= 2 * terrainFlow_Pi;
+        }
+      }
+
+      pFlow->pAngles[i] = angle;
+    }
+  }
+}
+
+// Every tile drains itself, plus everything its upstream neighbours drain.
+static void terrainFlow_countDonors_internal(void *pUserData, const size_t index)
+{
+  terrain_flow_context *pContext = reinterpret_cast<terrain_flow_context *>(pUserData);
+  terrain_flow *pFlow = pContext->pFlow;
+  const size_t end = lsMin((index + 1) * terrain_chunkSize, (size_t)pFlow->height) * pFlow->width;
+
+  for (size_t i = index * terrain_chunkSize * pFlow->width; i < end; i++)
+  {
+    const size_t receiver = terrainFlow_getReceiver(pFlow, i);
+
+    pFlow->pAccumulation[i] = 1;
+
+    if (receiver != i)
+      std::atomic_ref<uint8_t>(pContext->pDonors[receiver]).fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Donor counts of other tiles reach zero while accumulating, so the tiles that start with none are marked beforehand.
+static void terrainFlow_markSources_internal(void *pUserData, const size_t index)
+{
+  terrain_flow_context *pContext = reinterpret_cast<terrain_flow_context *>(pUserData);
+  const size_t end = lsMin((index + 1) * terrain_chunkSize, (size_t)pContext->pFlow->height) * pContext->pFlow->width;
+
+  for (size_t i = index * terrain_chunkSize * pContext->pFlow->width; i < end; i++)
+    if (pContext->pDonors[i] == 0)
+      pContext->pDonors[i] = terrainFlow_Source;
+}
+
+// Walks downstream from every source, adding the accumulation to the receiver. Only the last donor to arrive at a tile continues from
+// there, when the tile is complete, so every tile is passed on exactly once without any locks.
+static void terrainFlow_accumulate_internal(void *pUserData, const size_t index)
+{
+  terrain_flow_context *pContext = reinterpret_cast<terrain_flow_context *>(pUserData);
+  terrain_flow *pFlow = pContext->pFlow;
+  const size_t end = lsMin((index + 1) * terrain_chunkSize, (size_t)pFlow->height) * pFlow->width;
+
+  for (size_t i = index * terrain_chunkSize * pFlow->width; i < end; i++)
+  {
+    // Other tiles are being counted down concurrently.
+    if (std::atomic_ref<uint8_t>(pContext->pDonors[i]).load(std::memory_order_relaxed) != terrainFlow_Source)
+      continue;
+
+    size_t current = i;
+    uint32_t accumulation = pFlow->pAccumulation[i];
+
+    while (true)
+    {
+      const size_t receiver = terrainFlow_getReceiver(pFlow, current);
+
+      if (receiver == current)
+        break;
+
+      std::atomic_ref<uint32_t>(pFlow->pAccumulation[receiver]).fetch_add(accumulation, std::memory_order_relaxed);
+
+      if (std::atomic_ref<uint8_t>(pContext->pDonors[receiver]).fetch_sub(1, std::memory_order_acq_rel) != 1)
+        break;
+
+      // The other donors released their additions along with their decrements.
+      current = receiver;
+      accumulation = std::atomic_ref<uint32_t>(pFlow->pAccumulation[receiver]).load(std::memory_order_relaxed);
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainFlow_compute(_Out_ terrain_flow *pFlow, const terrain *pTerrain, thread_pool *pPool, const bool computeAngles /* = false */)
+{
+  lsResult result = lsR_Success;
+
+  terrain_flow_context context = { pTerrain, pFlow, nullptr };
+  size_t tileCount = 0;
+  size_t blockCount = 0;
+
+  LS_ERROR_IF(pFlow == nullptr || pTerrain == nullptr || pTerrain->pTiles == nullptr || pPool == nullptr, lsR_ArgumentNull);
+
+  lsZeroMemory(pFlow);
+  pFlow->width = pTerrain->width;
+  pFlow->height = pTerrain->height;
+
+  tileCount = (size_t)pFlow->width * pFlow->height;
+  blockCount = (pFlow->height + terrain_chunkSize - 1) / terrain_chunkSize;
+
+  LS_ERROR_CHECK(lsAlloc(&pFlow->pFilledHeights, tileCount));
+  LS_ERROR_CHECK(lsAlloc(&pFlow->pDirections, tileCount));
+  LS_ERROR_CHECK(lsAlloc(&pFlow->pAccumulation, tileCount));
+  LS_ERROR_CHECK(lsAlloc(&pFlow->pOrder, tileCount));
+
+  if (computeAngles)
+    LS_ERROR_CHECK(lsAlloc(&pFlow->pAngles, tileCount));
+
+  threadPool_parallelFor(pPool, blockCount, terrainFlow_computeHeights_internal, &context);
+  LS_ERROR_CHECK(terrainFlow_fill_internal(pFlow, pPool, terrainFlow_FillBlockSize));
+
+  threadPool_parallelFor(pPool, blockCount, terrainFlow_computeDirections_internal, &context);
+  terrainFlow_drainFlats_internal(pFlow, pPool);
+
+  // The angles fall back to the directions on flats.
+  if (computeAngles)
+    threadPool_parallelFor(pPool, blockCount, terrainFlow_computeAngles_internal, &context);
+
+  LS_ERROR_CHECK(lsAllocZero(&context.pDonors, tileCount));
+
+  threadPool_parallelFor(pPool, blockCount, terrainFlow_countDonors_internal, &context);
+  threadPool_parallelFor(pPool, blockCount, terrainFlow_markSources_internal, &context);
+  threadPool_parallelFor(pPool, blockCount, terrainFlow_accumulate_internal, &context);
+
+  LS_ERROR_CHECK(terrainFlow_order_internal(pFlow, pPool));
+
+epilogue:
+  lsFreePtr(&context.pDonors);
+
+  if (LS_FAILED(result) && pFlow != nullptr)
+    terrainFlow_destroy(pFlow);
+
+  return result;
+}
+
+void terrainFlow_destroy(terrain_flow *pFlow)
+{
+  if (pFlow == nullptr)
+    return;
+
+  lsFreePtr(&pFlow->pFilledHeights);
+  lsFreePtr(&pFlow->pDirections);
+  lsFreePtr(&pFlow->pAccumulation);
+  lsFreePtr(&pFlow->pOrder);
+  lsFreePtr(&pFlow->pAngles);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(12)
+
+DEFINE_TESTABLE(terrainFlow_TestDrainage)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  thread_pool *pPool = nullptr;
+  uint32_t *pPositions = nullptr;
+  uint32_t *pExpected = nullptr;
+  rand_seed seed(3, 4);
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 3));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 150, 130)); // with partial blocks.
+
+  // Coarse noise, to have plenty of depressions and flats.
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      lsZeroMemory(&t.pTiles[y * t.width + x]);
+      t.pTiles[y * t.width + x].layerHeights[tt_stone] = (uint16_t)(lsGetRand(seed) % 8 + (x / 16 + y / 16) % 5 * 4);
+    }
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &t, pPool, true));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pPositions, (size_t)t.width * t.height));
+  TESTABLE_ASSERT_SUCCESS(lsAllocZero(&pExpected, (size_t)t.width * t.height));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+    pPositions[flow.pOrder[i]] = (uint32_t)i;
+
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      const size_t i = y * t.width + x;
+      const size_t receiver = terrainFlow_getReceiver(&flow, i);
+      const bool isEdge = x == 0 || y == 0 || x == t.width - 1u || y == t.height - 1u;
+
+      TESTABLE_ASSERT_EQUAL(flow.pFilledHeights[i] >= (uint32_t)t.pTiles[i].layerHeights[tt_stone], true);
+      TESTABLE_ASSERT_EQUAL(flow.pDirections[i] == tfd_outlet, receiver == i);
+      TESTABLE_ASSERT_EQUAL(isEdge || receiver != i, true); // nothing is left in a depression.
+      TESTABLE_ASSERT_EQUAL(flow.pAngles[i] == terrainFlow_NoAngle, receiver == i);
+
+      if (receiver != i)
+      {
+        TESTABLE_ASSERT_EQUAL(flow.pFilledHeights[receiver] <= flow.pFilledHeights[i], true);
+        TESTABLE_ASSERT_EQUAL(pPositions[receiver] < pPositions[i], true);
+      }
+    }
+  }
+
+  // Sequential accumulation in reverse topological order.
+  for (size_t i = (size_t)t.width * t.height; i > 0; i--)
+  {
+    const size_t index = flow.pOrder[i - 1];
+    const size_t receiver = terrainFlow_getReceiver(&flow, index);
+
+    pExpected[index]++;
+
+    if (receiver != index)
+      pExpected[receiver] += pExpected[index];
+  }
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+    TESTABLE_ASSERT_EQUAL(flow.pAccumulation[i], pExpected[i]);
+
+epilogue:
+  lsFreePtr(&pPositions);
+  lsFreePtr(&pExpected);
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainFlow_TestFillAndAngles)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  thread_pool *pPool = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 9, 9));
+
+  // A plane falling towards the east with a pit behind a wall, that spills diagonally around it.
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      lsZeroMemory(&t.pTiles[y * t.width + x]);
+      t.pTiles[y * t.width + x].layerHeights[tt_stone] = (uint16_t)((t.width - x) * 10);
+    }
+  }
+
+  t.pTiles[4 * t.width + 4].layerHeights[tt_stone] = 0;
+  t.pTiles[4 * t.width + 5].layerHeights[tt_stone] = 100;
+
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &t, pPool, true));
+
+  TESTABLE_ASSERT_EQUAL(flow.pFilledHeights[4 * t.width + 4], 40u);
+  TESTABLE_ASSERT_EQUAL(flow.pDirections[4 * t.width + 4] == tfd_northEast || flow.pDirections[4 * t.width + 4] == tfd_southEast, true);
+  TESTABLE_ASSERT_EQUAL(flow.pFilledHeights[4 * t.width + 5], 100u);
+  TESTABLE_ASSERT_EQUAL(flow.pDirections[2 * t.width + 2], (uint8_t)tfd_east);
+  TESTABLE_ASSERT_EQUAL(flow.pAngles[2 * t.width + 2], 0.f);
+  TESTABLE_ASSERT_EQUAL(flow.pAccumulation[2 * t.width + t.width - 1], (uint32_t)t.width); // the whole row.
+
+  // Falling towards the south-south-east, between two D8 directions.
+  for (size_t y = 0; y < t.height; y++)
+    for (size_t x = 0; x < t.width; x++)
+      t.pTiles[y * t.width + x].layerHeights[tt_stone] = (uint16_t)((t.width - x) * 10 + (t.height - y) * 20);
+
+  terrainFlow_destroy(&flow);
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &t, pPool, true));
+
+  TESTABLE_ASSERT_EQUAL(flow.pDirections[4 * t.width + 4], (uint8_t)tfd_southEast);
+  TESTABLE_ASSERT_EQUAL(fabsf(flow.pAngles[4 * t.width + 4] - atan2f(2.f, 1.f)) < 1e-5f, true);
+
+epilogue:
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainFlow_TestFillBlocks)
+{
+  lsResult result = lsR_Success;
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  thread_pool *pPool = nullptr;
+  uint32_t *pHeights = nullptr;
+  uint32_t *pExpected = nullptr;
+  rand_seed seed(5, 6);
+
+  const size_t blockSizes[] = { 1, 7, 16, 64, terrainFlow_FillBlockSize };
+
+  flow.width = 150;
+  flow.height = 130;
+
+  const size_t tileCount = (size_t)flow.width * flow.height;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 3));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&flow.pFilledHeights, tileCount));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&flow.pDirections, tileCount));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&flow.pAccumulation, tileCount));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pHeights, tileCount));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pExpected, tileCount));
+
+  // Noise with some cliffs, so that blocks also get a bucket per distinct height.
+  for (size_t y = 0; y < flow.height; y++)
+    for (size_t x = 0; x < flow.width; x++)
+      pHeights[y * flow.width + x] = (uint32_t)(lsGetRand(seed) % 8 + (x / 16 + y / 16) % 5 * 4 + (lsGetRand(seed) % 64 == 0 ? 5000 : 0));
+
+  // Raising every tile to the lowest of its neighbours until nothing changes also leaves only paths out of the map that never go up.
+  for (size_t y = 0; y < flow.height; y++)
+    for (size_t x = 0; x < flow.width; x++)
+      pExpected[y * flow.width + x] = (x == 0 || y == 0 || x == flow.width - 1u || y == flow.height - 1u) ? pHeights[y * flow.width + x] : UINT32_MAX;
+
+  for (bool changed = true; changed;)
+  {
+    changed = false;
+
+    for (size_t y = 1; y + 1 < flow.height; y++)
+    {
+      for (size_t x = 1; x + 1 < flow.width; x++)
+      {
+        const size_t i = y * flow.width + x;
+        uint32_t lowest = UINT32_MAX;
+
+        for (uint8_t d = 0; d < tfd_count; d++)
+          lowest = lsMin(lowest, pExpected[(size_t)((int64_t)i + terrainFlow_OffsetY[d] * (int64_t)flow.width + terrainFlow_OffsetX[d])]);
+
+        const uint32_t level = lsMax(pHeights[i], lowest);
+
+        if (level < pExpected[i])
+        {
+          pExpected[i] = level;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  for (size_t blockSize : blockSizes)
+  {
+    lsMemcpy(flow.pFilledHeights, pHeights, tileCount);
+    TESTABLE_ASSERT_SUCCESS(terrainFlow_fill_internal(&flow, pPool, blockSize));
+
+    for (size_t i = 0; i < tileCount; i++)
+      TESTABLE_ASSERT_EQUAL(flow.pFilledHeights[i], pExpected[i]);
+  }
+
+epilogue:
+  lsFreePtr(&pHeights);
+  lsFreePtr(&pExpected);
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  return result;
+}
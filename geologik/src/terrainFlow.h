@@ -0,0 +1,66 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Drainage network of the total height of a terrain: depressions are filled, so that water from every tile reaches the edge of the map,
+// then every tile gets a downstream neighbour and the number of tiles upstream of it.
+
+// D8 directions, clockwise in image space. `y` increases downwards.
+enum terrain_flow_direction : uint8_t
+{
+  tfd_east,
+  tfd_southEast,
+  tfd_south,
+  tfd_southWest,
+  tfd_west,
+  tfd_northWest,
+  tfd_north,
+  tfd_northEast,
+
+  tfd_count,
+  tfd_outlet = tfd_count, // water leaves the map here.
+};
+
+constexpr int8_t terrainFlow_OffsetX[tfd_count] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+constexpr int8_t terrainFlow_OffsetY[tfd_count] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+constexpr float terrainFlow_NoAngle = -1.f;
+
+struct terrain_flow
+{
+  uint16_t width, height;
+
+  uint32_t *pFilledHeights; // total height in decimeters, raised to the lowest spill point of depressions.
+  uint8_t *pDirections; // `terrain_flow_direction` to the steepest lower neighbour, or along the shortest path out of flats.
+  uint32_t *pAccumulation; // tiles draining through each tile, including itself.
+  uint32_t *pOrder; // tile indices from the outlets upstream, so every tile comes after its downstream neighbour.
+  float *pAngles; // D-infinity flow angle in radians, clockwise from east like the directions, `terrainFlow_NoAngle` at outlets. Optional.
+};
+
+// Computes everything in `pFlow` for the current heights of `pTerrain`. Depressions are filled with priority floods in blocks of tiles,
+// which are then joined at the heights where water spills from one into the other. Flats drain along their shortest path and `pOrder`
+// is searched upstream from each outlet. All passes but joining the blocks and the search through the largest basin run in parallel on
+// `pPool`. On a single core it takes about 4 s for 4096^2 tiles and 16 s for 8192^2, and it needs about 14 bytes per tile on top of the
+// terrain, 18 with angles.
+lsResult terrainFlow_compute(_Out_ terrain_flow *pFlow, const terrain *pTerrain, thread_pool *pPool, const bool computeAngles = false);
+void terrainFlow_destroy(terrain_flow *pFlow);
+
+// Negative offsets wrap around to huge values, so this also checks the western and northern edges.
+inline bool terrainFlow_hasNeighbour(const terrain_flow *pFlow, const size_t x, const size_t y, const uint8_t direction)
+{
+  return x + (size_t)terrainFlow_OffsetX[direction] < pFlow->width && y + (size_t)terrainFlow_OffsetY[direction] < pFlow->height;
+}
+
+inline size_t terrainFlow_getReceiver(const terrain_flow *pFlow, const size_t index)
+{
+  const uint8_t direction = pFlow->pDirections[index];
+
+  if (direction == tfd_outlet)
+    return index;
+
+  return (size_t)((int64_t)index + terrainFlow_OffsetY[direction] * (int64_t)pFlow->width + terrainFlow_OffsetX[direction]);
+}
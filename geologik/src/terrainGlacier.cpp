@@ -0,0 +1,385 @@
+#include "terrainGlacier.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+struct terrain_glacier_context
+{
+  terrain *pTerrain;
+  const terrain_glacier_params *pParams;
+  terrain_multigrid_layer *pIce;
+  bool *pChangedBlocks;
+};
+
+// Everything that makes up the ground below the ice.
+static int64_t terrainGlacier_getBedHeight_internal(const terrain *pTerrain, const size_t index)
+{
+  int64_t height = 0;
+
+  for (size_t layer = tt_water; layer < tt_count; layer++)
+    height += terrain_getFixedHeight(pTerrain, index, (terrain_type)layer);
+
+  return height;
+}
+
+// Central differences of the surface, one sided at the edges of the map.
+static float terrainGlacier_getSquaredSlope_internal(const terrain_glacier_context *pContext, const size_t x, const size_t y)
+{
+  const terrain_multigrid_layer *pIce = pContext->pIce;
+  const size_t width = pIce->width;
+  const size_t i = y * width + x;
+
+  const size_t left = x > 0 ? i - 1 : i;
+  const size_t right = x + 1 < width ? i + 1 : i;
+  const size_t top = y > 0 ? i - width : i;
+  const size_t bottom = y + 1 < pIce->height ? i + width : i;
+
+  float dx = pIce->pThicknesses[right] - pIce->pThicknesses[left];
+  float dy = pIce->pThicknesses[bottom] - pIce->pThicknesses[top];
+
+  if (left != i)
+    dx += pIce->pBedSlopesX[left];
+
+  if (right != i)
+    dx += pIce->pBedSlopesX[i];
+
+  if (top != i)
+    dy += pIce->pBedSlopesY[top];
+
+  if (bottom != i)
+    dy += pIce->pBedSlopesY[i];
+
+  dx /= (float)lsMax(right - left, (size_t)1);
+  dy /= (float)lsMax((bottom - top) / width, (size_t)1);
+
+  return (dx * dx + dy * dy) / (terrain_tileSize * terrain_tileSize);
+}
+
+static float terrainGlacier_getDiffusivity_internal(const terrain_glacier_params *pParams, const float ice, const float squaredSlope)
+{
+  const float ice2 = ice * ice;
+  const float ice4 = ice2 * ice2;
+
+  return (pParams->flowRate * ice4 * ice + pParams->slidingRate * ice4) * squaredSlope;
+}
+
+// The bed slopes are taken from the exact heights, so they stay precise however high the terrain is.
+static void terrainGlacier_load_internal(void *pUserData, const size_t index)
+{
+  terrain_glacier_context *pContext = reinterpret_cast<terrain_glacier_context *>(pUserData);
+  const terrain *pTerrain = pContext->pTerrain;
+  terrain_multigrid_layer *pIce = pContext->pIce;
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pTerrain->height);
+
+  for (size_t y = index * terrain_chunkSize; y < endY; y++)
+  {
+    for (size_t x = 0; x < pTerrain->width; x++)
+    {
+      const size_t i = y * pTerrain->width + x;
+      const int64_t bed = terrainGlacier_getBedHeight_internal(pTerrain, i);
+
+      pIce->pThicknesses[i] = (float)terrain_getFixedHeight(pTerrain, i, tt_snow) / terrain_fixedOne;
+      pIce->pBedSlopesX[i] = x + 1 < pTerrain->width ? (float)(terrainGlacier_getBedHeight_internal(pTerrain, i + 1) - bed) / terrain_fixedOne : 0.f;
+      pIce->pBedSlopesY[i] = y + 1 < pTerrain->height ? (float)(terrainGlacier_getBedHeight_internal(pTerrain, i + pTerrain->width) - bed) / terrain_fixedOne : 0.f;
+    }
+  }
+}
+
+static void terrainGlacier_getDiffusivities_internal(void *pUserData, const size_t index)
+{
+  terrain_glacier_context *pContext = reinterpret_cast<terrain_glacier_context *>(pUserData);
+  const terrain *pTerrain = pContext->pTerrain;
+  const terrain_glacier_params *pParams = pContext->pParams;
+  terrain_multigrid_layer *pIce = pContext->pIce;
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pTerrain->height);
+  const float scale = pParams->timeStep / (terrain_tileSize * terrain_tileSize);
+
+  for (size_t y = index * terrain_chunkSize; y < endY; y++)
+  {
+    for (size_t x = 0; x < pTerrain->width; x++)
+    {
+      const size_t i = y * pTerrain->width + x;
+      const float ice = pIce->pThicknesses[i];
+
+      if (ice <= 0)
+      {
+        pIce->pCoefficients[i] = 0;
+        continue;
+      }
+
+      pIce->pCoefficients[i] = lsMin(pParams->maxDiffusivity, terrainGlacier_getDiffusivity_internal(pParams, ice, terrainGlacier_getSquaredSlope_internal(pContext, x, y)) * scale);
+    }
+  }
+}
+
+static void terrainGlacier_getRightHandSides_internal(void *pUserData, const size_t index)
+{
+  terrain_glacier_context *pContext = reinterpret_cast<terrain_glacier_context *>(pUserData);
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pContext->pTerrain->height);
+
+  terrainMultigrid_getLayerRightHandSides(pContext->pIce, index * terrain_chunkSize, endY);
+}
+
+static void terrainGlacier_getLimiters_internal(void *pUserData, const size_t index)
+{
+  terrain_glacier_context *pContext = reinterpret_cast<terrain_glacier_context *>(pUserData);
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pContext->pTerrain->height);
+
+  terrainMultigrid_getLayerLimiters(pContext->pIce, pContext->pTerrain, tt_snow, index * terrain_chunkSize, endY);
+}
+
+// Writes the new thickness back and abrades the bed by the sliding velocity `slidingRate * (H * |grad(s)|)^3`, in the solved state.
+static void terrainGlacier_apply_internal(void *pUserData, const size_t index)
+{
+  terrain_glacier_context *pContext = reinterpret_cast<terrain_glacier_context *>(pUserData);
+  terrain *pTerrain = pContext->pTerrain;
+  const terrain_glacier_params *pParams = pContext->pParams;
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pTerrain->height);
+  const float scale = pParams->timeStep / (terrain_tileSize * terrain_tileSize);
+  bool changed = false;
+
+  for (size_t y = index * terrain_chunkSize; y < endY; y++)
+  {
+    for (size_t x = 0; x < pTerrain->width; x++)
+    {
+      const size_t i = y * pTerrain->width + x;
+      const uint32_t before = terrain_getFixedHeight(pTerrain, i, tt_snow);
+      const float outflow = terrainMultigrid_getLayerOutflow(pContext->pIce, x, y);
+
+      if (before == 0 && outflow >= 0)
+        continue;
+
+      const uint32_t after = (uint32_t)lsClamp((float)before - outflow * terrain_fixedOne + 0.5f, 0.f, (float)UINT32_MAX);
+
+      changed = true;
+      terrain_setFixedHeight(pTerrain, i, tt_snow, after);
+
+      // Capping the diffusivity slows the sliding down as well.
+      const float ice = lsMax(0.f, pContext->pIce->pThicknesses[i]);
+      const float squaredSlope = terrainGlacier_getSquaredSlope_internal(pContext, x, y);
+      const float diffusivity = terrainGlacier_getDiffusivity_internal(pParams, ice, squaredSlope) * scale;
+      const float stress = ice * sqrtf(squaredSlope);
+      const float sliding = pParams->slidingRate * stress * stress * stress * (diffusivity > pParams->maxDiffusivity ? pParams->maxDiffusivity / diffusivity : 1.f);
+      const int64_t abrasion = (int64_t)(pParams->abrasionRate * sliding * pParams->timeStep * terrain_fixedOne + 0.5f);
+
+      if (abrasion > 0)
+        terrain_erodeFixedHeight(pTerrain, i, (terrain_type)terrainMaterial_FirstBedLayer, tt_bedrock, abrasion);
+    }
+  }
+
+  pContext->pChangedBlocks[index] = changed;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainGlacier_init(_Out_ terrain_glacier *pGlacier, const uint16_t width, const uint16_t height)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pGlacier == nullptr, lsR_ArgumentNull);
+
+  lsZeroMemory(pGlacier);
+  pGlacier->width = width;
+  pGlacier->height = height;
+
+  LS_ERROR_CHECK(terrainMultigrid_initLayer(&pGlacier->ice, width, height));
+  LS_ERROR_CHECK(lsAlloc(&pGlacier->pChangedBlocks, (height + terrain_chunkSize - 1) / terrain_chunkSize));
+  LS_ERROR_CHECK(terrainMultigrid_init(&pGlacier->multigrid, width, height));
+
+epilogue:
+  if (LS_FAILED(result) && pGlacier != nullptr)
+    terrainGlacier_destroy(pGlacier);
+
+  return result;
+}
+
+void terrainGlacier_destroy(terrain_glacier *pGlacier)
+{
+  if (pGlacier == nullptr)
+    return;
+
+  terrainMultigrid_destroyLayer(&pGlacier->ice);
+  lsFreePtr(&pGlacier->pChangedBlocks);
+  terrainMultigrid_destroy(&pGlacier->multigrid);
+}
+
+lsResult terrainGlacier_step(terrain_glacier *pGlacier, terrain *pTerrain, const terrain_glacier_params *pParams, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_glacier_context context;
+  size_t blockCount = 0;
+
+  LS_ERROR_IF(pGlacier == nullptr || pTerrain == nullptr || pParams == nullptr || pPool == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pGlacier->width != pTerrain->width || pGlacier->height != pTerrain->height, lsR_ArgumentOutOfBounds);
+  LS_ERROR_IF(pParams->timeStep < 0 || pParams->flowRate < 0 || pParams->slidingRate < 0 || pParams->maxDiffusivity < 0, lsR_ArgumentOutOfBounds);
+
+  blockCount = (pTerrain->height + terrain_chunkSize - 1) / terrain_chunkSize;
+
+  context.pTerrain = pTerrain;
+  context.pParams = pParams;
+  context.pIce = &pGlacier->ice;
+  context.pChangedBlocks = pGlacier->pChangedBlocks;
+
+  threadPool_parallelFor(pPool, blockCount, terrainGlacier_load_internal, &context);
+  threadPool_parallelFor(pPool, blockCount, terrainGlacier_getDiffusivities_internal, &context);
+  threadPool_parallelFor(pPool, blockCount, terrainGlacier_getRightHandSides_internal, &context);
+
+  LS_ERROR_CHECK(terrainMultigrid_solve(&pGlacier->multigrid, pGlacier->ice.pThicknesses, pGlacier->ice.pRightHandSides, pGlacier->ice.pCoefficients, &pParams->solver, pPool));
+
+  threadPool_parallelFor(pPool, blockCount, terrainGlacier_getLimiters_internal, &context);
+  threadPool_parallelFor(pPool, blockCount, terrainGlacier_apply_internal, &context);
+
+  for (size_t i = 0; i < blockCount; i++)
+    if (context.pChangedBlocks[i])
+      terrain_markDirty(pTerrain, 0, i * terrain_chunkSize, pTerrain->width, lsMin(terrain_chunkSize, pTerrain->height - i * terrain_chunkSize));
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(16)
+
+constexpr size_t terrainGlacier_TestValleyY = 16;
+constexpr size_t terrainGlacier_TestSourceWidth = 8;
+
+// A valley falling towards the east, with an ice field at its head.
+static lsResult terrainGlacier_createValley_internal(terrain *pTerrain)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_CHECK(terrain_init(pTerrain, 64, 33));
+  LS_ERROR_CHECK(terrain_enableFractions(pTerrain, (1U << tt_snow) | (1U << tt_stone)));
+
+  for (size_t y = 0; y < pTerrain->height; y++)
+  {
+    for (size_t x = 0; x < pTerrain->width; x++)
+    {
+      tile *pTile = &pTerrain->pTiles[y * pTerrain->width + x];
+      const size_t side = y > terrainGlacier_TestValleyY ? y - terrainGlacier_TestValleyY : terrainGlacier_TestValleyY - y;
+
+      lsZeroMemory(pTile);
+      pTile->layerHeights[tt_bedrock] = 8;
+      pTile->layerHeights[tt_stone] = (uint16_t)(2000 - x * 20 + side * 30);
+      pTile->layerHeights[tt_snow] = (uint16_t)(x < terrainGlacier_TestSourceWidth && side < 4 ? 1000 : 0);
+    }
+  }
+
+epilogue:
+  return result;
+}
+
+// In decimeters, of the tiles from `firstX` eastwards.
+static double terrainGlacier_getIce_internal(const terrain *pTerrain, const size_t firstX = 0)
+{
+  double ice = 0;
+
+  for (size_t y = 0; y < pTerrain->height; y++)
+    for (size_t x = firstX; x < pTerrain->width; x++)
+      ice += (double)terrain_getFixedHeight(pTerrain, y * pTerrain->width + x, tt_snow) / terrain_fixedOne;
+
+  return ice;
+}
+
+DEFINE_TESTABLE(terrainGlacier_TestValley)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_glacier glacier;
+  lsZeroMemory(&glacier);
+
+  thread_pool *pPool = nullptr;
+  terrain_glacier_params params;
+
+  constexpr size_t valleyY = terrainGlacier_TestValleyY;
+  constexpr size_t sourceWidth = terrainGlacier_TestSourceWidth;
+  double iceBefore = 0;
+  double iceAfter = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrainGlacier_createValley_internal(&t));
+  TESTABLE_ASSERT_SUCCESS(terrainGlacier_init(&glacier, t.width, t.height));
+
+  iceBefore = terrainGlacier_getIce_internal(&t);
+
+  for (size_t step = 0; step < 20; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainGlacier_step(&glacier, &t, &params, pPool));
+
+  iceAfter = terrainGlacier_getIce_internal(&t);
+
+  // The ice flows down the valley without gaining or losing any, and wears down the bed below it.
+  TESTABLE_ASSERT_EQUAL(fabs(iceAfter - iceBefore) < iceBefore * 1e-4, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, valleyY * t.width + sourceWidth + 2, tt_snow) > 0u, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, valleyY * t.width + 2, tt_snow) < 1000u * terrain_fixedOne, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, valleyY * t.width + sourceWidth - 1, tt_stone) < (2000u - (sourceWidth - 1) * 20) * terrain_fixedOne, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 2 * t.width + t.width - 1, tt_stone), (2000u - (t.width - 1) * 20 + (valleyY - 2) * 30) * terrain_fixedOne);
+  TESTABLE_ASSERT_EQUAL(t.pTiles[valleyY * t.width].layerHeights[tt_bedrock], 8);
+
+  // Long time steps stay stable.
+  params.timeStep = 10000.f;
+
+  for (size_t step = 0; step < 5; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainGlacier_step(&glacier, &t, &params, pPool));
+
+  iceAfter = terrainGlacier_getIce_internal(&t);
+
+  TESTABLE_ASSERT_EQUAL(fabs(iceAfter - iceBefore) < iceBefore * 1e-4, true);
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, valleyY * t.width + sourceWidth + 12, tt_snow) > 0u, true);
+
+epilogue:
+  terrainGlacier_destroy(&glacier);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainGlacier_TestDiffusivityCap)
+{
+  lsResult result = lsR_Success;
+
+  terrain capped, t;
+  lsZeroMemory(&capped);
+  lsZeroMemory(&t);
+
+  terrain_glacier glacier;
+  lsZeroMemory(&glacier);
+
+  thread_pool *pPool = nullptr;
+  terrain_glacier_params cappedParams;
+  cappedParams.maxDiffusivity = 2.f;
+  terrain_glacier_params params;
+
+  double iceBefore = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrainGlacier_createValley_internal(&capped));
+  TESTABLE_ASSERT_SUCCESS(terrainGlacier_createValley_internal(&t));
+  TESTABLE_ASSERT_SUCCESS(terrainGlacier_init(&glacier, t.width, t.height));
+
+  iceBefore = terrainGlacier_getIce_internal(&t);
+
+  for (size_t step = 0; step < 10; step++)
+  {
+    TESTABLE_ASSERT_SUCCESS(terrainGlacier_step(&glacier, &capped, &cappedParams, pPool));
+    TESTABLE_ASSERT_SUCCESS(terrainGlacier_step(&glacier, &t, &params, pPool));
+  }
+
+  // The thick ice at the head of the valley exceeds both caps. The multigrid solve stays exact with the default cap, which lets the ice
+  // flow noticeably faster than a cap of 2 would, without gaining or losing any.
+  TESTABLE_ASSERT_EQUAL(params.maxDiffusivity > cappedParams.maxDiffusivity, true);
+  TESTABLE_ASSERT_EQUAL(fabs(terrainGlacier_getIce_internal(&capped) - iceBefore) < iceBefore * 1e-4, true);
+  TESTABLE_ASSERT_EQUAL(fabs(terrainGlacier_getIce_internal(&t) - iceBefore) < iceBefore * 1e-4, true);
+  TESTABLE_ASSERT_EQUAL(terrainGlacier_getIce_internal(&t, terrainGlacier_TestSourceWidth) > 1.5 * terrainGlacier_getIce_internal(&capped, terrainGlacier_TestSourceWidth), true);
+
+epilogue:
+  terrainGlacier_destroy(&glacier);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&capped);
+  terrain_destroy(&t);
+  return result;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "terrainMaterial.h"
+#include "terrainMultigrid.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Glaciers with the shallow ice approximation: the snow layer is taken as ice, which flows down the slope of its surface with the flux
+// `-D * grad(s)`, `D = (flowRate * H^5 + slidingRate * H^4) * |grad(s)|^2` for the thickness `H` and surface `s`. Each step freezes `D`
+// and solves the resulting diffusion implicitly with `terrainMultigrid_solve`, which stays stable for long time steps. The ice is then
+// moved by the fluxes of that solution, limited to what each tile has, so none is gained or lost. The front of a glacier advances by at
+// most a tile per step.
+// The ice abrades the bed below it in proportion to how fast it slides, which carves U-shaped valleys.
+
+struct terrain_glacier_params
+{
+  float timeStep = 10.f; // in years.
+  float flowRate = 2.2e-8f; // `2A(rho g)^3 / 5` of Glen's flow law, per year with lengths in decimeters.
+  float slidingRate = 5e-4f; // sliding velocity per `(H * |grad(s)|)^3`, in decimeters per year.
+  float abrasionRate = 1e-4f; // bed lowered per decimeter of sliding.
+  terrain_multigrid_params solver;
+  float maxDiffusivity = 20.f; // `D * timeStep / terrain_tileSize^2` is capped to this, since `D` is frozen for the step. fast ice is slowed down.
+};
+
+// Planes that steps work in, kept between them so large maps don't reallocate them every step.
+struct terrain_glacier
+{
+  uint16_t width, height;
+
+  terrain_multigrid_layer ice; // `k = D * dt / terrain_tileSize^2`.
+  bool *pChangedBlocks; // per block of `terrain_chunkSize` rows.
+  terrain_multigrid multigrid;
+};
+
+lsResult terrainGlacier_init(_Out_ terrain_glacier *pGlacier, const uint16_t width, const uint16_t height);
+void terrainGlacier_destroy(terrain_glacier *pGlacier);
+
+// Moves the ice of `pTerrain` for one time step and abrades the exposed layer of the bed below it (see `terrain_erodeFixedHeight`). Like
+// the other processes, the abraded material leaves the map and bedrock isn't affected. Ice doesn't flow across the edges of the map.
+// Steps are usually much less than a decimeter, so layers without fractions (see `terrain_enableFractions`) round it away.
+lsResult terrainGlacier_step(terrain_glacier *pGlacier, terrain *pTerrain, const terrain_glacier_params *pParams, thread_pool *pPool);
@@ -0,0 +1,687 @@
+#include "terrainHistory.h"
+#include "io.h"
+#include "pngWriter.h"
+
+#pragma warning(push)
+#pragma warning(disable: 4100)
+#include "stb_image.h"
+#pragma warning(pop)
+
+//////////////////////////////////////////////////////////////////////////
+
+constexpr size_t terrainHistory_None = (size_t)-1;
+constexpr size_t terrainHistory_HeaderSize = sizeof(uint8_t) + sizeof(uint16_t) * 4; // version, width, height, chunk size, keyframe interval.
+constexpr size_t terrainHistory_PlaneSize = terrain_chunkSize * terrain_chunkSize;
+
+struct terrain_history_frame_header
+{
+  uint64_t step;
+  uint64_t size; // of the chunk entries and compressed chunks that follow.
+  uint32_t chunkCount;
+  uint8_t keyframe;
+  uint8_t _reserved[3];
+};
+
+static_assert(sizeof(terrain_history_frame_header) == 24, "frame headers are written to files as is");
+
+struct terrain_history_chunk
+{
+  uint32_t chunkIndex;
+  uint32_t size;
+};
+
+static_assert(sizeof(terrain_history_chunk) == 8, "chunk entries are written to files as is");
+
+struct terrain_history_frame
+{
+  uint64_t offset; // of the frame header.
+  terrain_history_frame_header header;
+};
+
+struct terrain_history_writer
+{
+  FILE *pFile = nullptr;
+  thread_pool *pPool = nullptr;
+
+  uint16_t width = 0;
+  uint16_t height = 0;
+  uint16_t keyframeInterval = 0;
+  size_t chunkCountX = 0;
+  size_t chunkCount = 0;
+
+  tile *pPrevious = nullptr; // the terrain as of the last frame.
+  uint32_t *pChunks = nullptr; // indices of the chunks of the current frame.
+  terrain_history_chunk *pEntries = nullptr;
+
+  size_t batchSize = 0;
+  uint8_t *pPlanes = nullptr; // `terrain_chunkBytes` per batch entry.
+  uint8_t **ppCompressed = nullptr;
+  int32_t *pCompressedSizes = nullptr;
+
+  // Of the frame that's being appended.
+  const terrain *pTerrain = nullptr;
+  size_t batchStart = 0;
+  bool keyframe = false;
+
+  uint64_t endOffset = 0;
+  size_t frameCount = 0;
+  size_t framesSinceKeyframe = 0;
+  bool keyframePending = true; // after failures, as `pPrevious` may not match the file anymore.
+  uint64_t lastStep = 0;
+};
+
+struct terrain_history_reader
+{
+  FILE *pFile = nullptr;
+  thread_pool *pPool = nullptr;
+
+  uint16_t width = 0;
+  uint16_t height = 0;
+  size_t chunkCountX = 0;
+  size_t chunkCount = 0;
+
+  terrain_history_frame *pFrames = nullptr;
+  size_t frameCount = 0;
+  size_t frameCapacity = 0;
+
+  tile *pTiles = nullptr; // the terrain as of `currentFrame`.
+  size_t currentFrame = terrainHistory_None;
+
+  uint8_t *pPayload = nullptr;
+  size_t payloadCapacity = 0;
+  const uint8_t **ppBlobs = nullptr;
+
+  size_t batchSize = 0;
+  uint8_t *pPlanes = nullptr; // `terrain_chunkBytes` per batch entry.
+  lsResult *pResults = nullptr;
+
+  // Of the frame that's being applied.
+  const terrain_history_chunk *pEntries = nullptr;
+  size_t batchStart = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+static lsResult terrainHistory_readValue_internal(FILE *pFile, _Out_ void *pData, const size_t size)
+{
+  return size == fread(pData, 1, size, pFile) ? lsR_Success : lsR_EndOfStream;
+}
+
+static lsResult terrainHistory_writeValue_internal(FILE *pFile, const void *pData, const size_t size)
+{
+  return size == fwrite(pData, 1, size, pFile) ? lsR_Success : lsR_IOFailure;
+}
+
+// Chunks are stored as byte planes, the low bytes of a layer followed by its high bytes, so the mostly zero high bytes of small changes
+// compress well. Tiles outside of the terrain are zero.
+static void terrainHistory_encodeChunk_internal(const tile *pTiles, const tile *pPrevious, const size_t width, const size_t height, const size_t chunkX, const size_t chunkY, _Out_ uint8_t *pPlanes)
+{
+  for (size_t ty = 0; ty < terrain_chunkSize; ty++)
+  {
+    const size_t y = chunkY * terrain_chunkSize + ty;
+
+    for (size_t tx = 0; tx < terrain_chunkSize; tx++)
+    {
+      const size_t x = chunkX * terrain_chunkSize + tx;
+      const size_t t = ty * terrain_chunkSize + tx;
+
+      for (size_t layer = 0; layer < tt_count; layer++)
+      {
+        uint16_t value = 0;
+
+        if (x < width && y < height)
+          value = (uint16_t)(pTiles[y * width + x].layerHeights[layer] ^ (pPrevious != nullptr ? pPrevious[y * width + x].layerHeights[layer] : 0));
+
+        pPlanes[(layer * 2) * terrainHistory_PlaneSize + t] = (uint8_t)value;
+        pPlanes[(layer * 2 + 1) * terrainHistory_PlaneSize + t] = (uint8_t)(value >> 8);
+      }
+    }
+  }
+}
+
+static void terrainHistory_applyChunk_internal(tile *pTiles, const size_t width, const size_t height, const size_t chunkX, const size_t chunkY, const uint8_t *pPlanes)
+{
+  const size_t chunkWidth = lsMin(terrain_chunkSize, width - chunkX * terrain_chunkSize);
+  const size_t chunkHeight = lsMin(terrain_chunkSize, height - chunkY * terrain_chunkSize);
+
+  for (size_t ty = 0; ty < chunkHeight; ty++)
+  {
+    tile *pRow = pTiles + (chunkY * terrain_chunkSize + ty) * width + chunkX * terrain_chunkSize;
+
+    for (size_t tx = 0; tx < chunkWidth; tx++)
+    {
+      const size_t t = ty * terrain_chunkSize + tx;
+
+      for (size_t layer = 0; layer < tt_count; layer++)
+      {
+        const uint16_t delta = (uint16_t)(pPlanes[(layer * 2) * terrainHistory_PlaneSize + t] | (pPlanes[(layer * 2 + 1) * terrainHistory_PlaneSize + t] << 8));
+        pRow[tx].layerHeights[layer] = (uint16_t)(pRow[tx].layerHeights[layer] ^ delta);
+      }
+    }
+  }
+}
+
+static bool terrainHistory_isChunkEqual_internal(const tile *pA, const tile *pB, const size_t width, const size_t height, const size_t chunkX, const size_t chunkY)
+{
+  const size_t x = chunkX * terrain_chunkSize;
+  const size_t chunkWidth = lsMin(terrain_chunkSize, width - x);
+  const size_t chunkHeight = lsMin(terrain_chunkSize, height - chunkY * terrain_chunkSize);
+
+  for (size_t row = 0; row < chunkHeight; row++)
+  {
+    const size_t offset = (chunkY * terrain_chunkSize + row) * width + x;
+
+    if (memcmp(pA + offset, pB + offset, sizeof(tile) * chunkWidth) != 0)
+      return false;
+  }
+
+  return true;
+}
+
+static void terrainHistory_compressTask_internal(void *pUserData, const size_t index)
+{
+  terrain_history_writer *pWriter = reinterpret_cast<terrain_history_writer *>(pUserData);
+
+  const uint32_t chunkIndex = pWriter->pChunks[pWriter->batchStart + index];
+  const size_t chunkX = chunkIndex % pWriter->chunkCountX;
+  const size_t chunkY = chunkIndex / pWriter->chunkCountX;
+  uint8_t *pPlanes = pWriter->pPlanes + index * terrain_chunkBytes;
+
+  terrainHistory_encodeChunk_internal(pWriter->pTerrain->pTiles, pWriter->keyframe ? nullptr : pWriter->pPrevious, pWriter->width, pWriter->height, chunkX, chunkY, pPlanes);
+
+  // Chunks of a frame don't overlap, so the previous frame can be updated in parallel.
+  {
+    const size_t x = chunkX * terrain_chunkSize;
+    const size_t chunkWidth = lsMin(terrain_chunkSize, pWriter->width - x);
+    const size_t chunkHeight = lsMin(terrain_chunkSize, pWriter->height - chunkY * terrain_chunkSize);
+
+    for (size_t row = 0; row < chunkHeight; row++)
+    {
+      const size_t offset = (chunkY * terrain_chunkSize + row) * pWriter->width + x;
+      lsMemcpy(pWriter->pPrevious + offset, pWriter->pTerrain->pTiles + offset, chunkWidth);
+    }
+  }
+
+  pWriter->pCompressedSizes[index] = -1; // in case compressing fails.
+  pWriter->ppCompressed[index] = stbi_zlib_compress(pPlanes, (int32_t)terrain_chunkBytes, &pWriter->pCompressedSizes[index], pngWriter_CompressionQuality);
+}
+
+static void terrainHistory_decompressTask_internal(void *pUserData, const size_t index)
+{
+  terrain_history_reader *pReader = reinterpret_cast<terrain_history_reader *>(pUserData);
+
+  const size_t entry = pReader->batchStart + index;
+  const uint32_t chunkIndex = pReader->pEntries[entry].chunkIndex;
+  uint8_t *pPlanes = pReader->pPlanes + index * terrain_chunkBytes;
+
+  if ((int32_t)terrain_chunkBytes != stbi_zlib_decode_buffer(reinterpret_cast<char *>(pPlanes), (int32_t)terrain_chunkBytes, reinterpret_cast<const char *>(pReader->ppBlobs[entry]), (int32_t)pReader->pEntries[entry].size))
+  {
+    pReader->pResults[index] = lsR_ResourceInvalid;
+    return;
+  }
+
+  terrainHistory_applyChunk_internal(pReader->pTiles, pReader->width, pReader->height, chunkIndex % pReader->chunkCountX, chunkIndex / pReader->chunkCountX, pPlanes);
+  pReader->pResults[index] = lsR_Success;
+}
+
+static size_t terrainHistory_getBatchSize_internal(thread_pool *pPool, const size_t chunkCount)
+{
+  return lsMax((size_t)1, lsMin((threadPool_getWorkerCount(pPool) + 1) * 4, chunkCount));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainHistory_createWriter(_Out_ terrain_history_writer **ppWriter, const char *filename, const uint16_t width, const uint16_t height, thread_pool *pPool, const uint16_t keyframeInterval /* = terrainHistory_DefaultKeyframeInterval */)
+{
+  lsResult result = lsR_Success;
+
+  terrain_history_writer *pWriter = nullptr;
+  const uint16_t chunkSize = (uint16_t)terrain_chunkSize;
+
+  LS_ERROR_IF(ppWriter == nullptr || filename == nullptr || pPool == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(width == 0 || height == 0 || keyframeInterval == 0, lsR_ArgumentOutOfBounds);
+
+  pWriter = new (std::nothrow) terrain_history_writer();
+  LS_ERROR_IF(pWriter == nullptr, lsR_MemoryAllocationFailure);
+
+  pWriter->pPool = pPool;
+  pWriter->width = width;
+  pWriter->height = height;
+  pWriter->keyframeInterval = keyframeInterval;
+  pWriter->chunkCountX = (width + terrain_chunkSize - 1) / terrain_chunkSize;
+  pWriter->chunkCount = pWriter->chunkCountX * ((height + terrain_chunkSize - 1) / terrain_chunkSize);
+  pWriter->batchSize = terrainHistory_getBatchSize_internal(pPool, pWriter->chunkCount);
+
+  LS_ERROR_CHECK(lsAllocZero(&pWriter->pPrevious, (size_t)width * height));
+  LS_ERROR_CHECK(lsAlloc(&pWriter->pChunks, pWriter->chunkCount));
+  LS_ERROR_CHECK(lsAlloc(&pWriter->pEntries, pWriter->chunkCount));
+  LS_ERROR_CHECK(lsAlloc(&pWriter->pPlanes, pWriter->batchSize * terrain_chunkBytes));
+  LS_ERROR_CHECK(lsAllocZero(&pWriter->ppCompressed, pWriter->batchSize));
+  LS_ERROR_CHECK(lsAllocZero(&pWriter->pCompressedSizes, pWriter->batchSize));
+
+  pWriter->pFile = fopen(filename, "wb");
+  LS_ERROR_IF(pWriter->pFile == nullptr, lsR_IOFailure);
+
+  LS_ERROR_CHECK(terrainHistory_writeValue_internal(pWriter->pFile, &_HistoryVersion, sizeof(_HistoryVersion)));
+  LS_ERROR_CHECK(terrainHistory_writeValue_internal(pWriter->pFile, &width, sizeof(width)));
+  LS_ERROR_CHECK(terrainHistory_writeValue_internal(pWriter->pFile, &height, sizeof(height)));
+  LS_ERROR_CHECK(terrainHistory_writeValue_internal(pWriter->pFile, &chunkSize, sizeof(chunkSize)));
+  LS_ERROR_CHECK(terrainHistory_writeValue_internal(pWriter->pFile, &keyframeInterval, sizeof(keyframeInterval)));
+
+  pWriter->endOffset = terrainHistory_HeaderSize;
+
+  *ppWriter = pWriter;
+  pWriter = nullptr;
+
+epilogue:
+  terrainHistory_destroyWriter(&pWriter);
+  return result;
+}
+
+void terrainHistory_destroyWriter(terrain_history_writer **ppWriter)
+{
+  if (ppWriter == nullptr || *ppWriter == nullptr)
+    return;
+
+  terrain_history_writer *pWriter = *ppWriter;
+
+  if (pWriter->pFile != nullptr)
+    fclose(pWriter->pFile);
+
+  lsFreePtr(&pWriter->pPrevious);
+  lsFreePtr(&pWriter->pChunks);
+  lsFreePtr(&pWriter->pEntries);
+  lsFreePtr(&pWriter->pPlanes);
+  lsFreePtr(&pWriter->ppCompressed);
+  lsFreePtr(&pWriter->pCompressedSizes);
+
+  delete pWriter;
+  *ppWriter = nullptr;
+}
+
+lsResult terrainHistory_append(terrain_history_writer *pWriter, const terrain *pTerrain, const uint64_t step)
+{
+  lsResult result = lsR_Success;
+
+  terrain_history_frame_header header;
+  lsZeroMemory(&header);
+
+  uint64_t payloadSize = 0;
+
+  LS_ERROR_IF(pWriter == nullptr || pTerrain == nullptr || pTerrain->pTiles == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pTerrain->width != pWriter->width || pTerrain->height != pWriter->height, lsR_ResourceIncompatible);
+  LS_ERROR_IF(pWriter->frameCount > 0 && step <= pWriter->lastStep, lsR_InvalidParameter);
+
+  pWriter->pTerrain = pTerrain;
+  pWriter->keyframe = pWriter->keyframePending || pWriter->framesSinceKeyframe >= pWriter->keyframeInterval;
+  pWriter->keyframePending = true; // until the frame has been written.
+
+  for (uint32_t chunkIndex = 0; chunkIndex < (uint32_t)pWriter->chunkCount; chunkIndex++)
+    if (pWriter->keyframe || !terrainHistory_isChunkEqual_internal(pTerrain->pTiles, pWriter->pPrevious, pWriter->width, pWriter->height, chunkIndex % pWriter->chunkCountX, chunkIndex / pWriter->chunkCountX))
+      pWriter->pChunks[header.chunkCount++] = chunkIndex;
+
+  header.step = step;
+  header.keyframe = pWriter->keyframe ? 1 : 0;
+
+  // The compressed chunks are written after the space for the chunk entries, which are only known afterwards.
+  LS_ERROR_CHECK(lsSeekFile(pWriter->pFile, pWriter->endOffset + sizeof(header) + sizeof(terrain_history_chunk) * header.chunkCount));
+
+  for (pWriter->batchStart = 0; pWriter->batchStart < header.chunkCount; pWriter->batchStart += pWriter->batchSize)
+  {
+    const size_t count = lsMin(pWriter->batchSize, header.chunkCount - pWriter->batchStart);
+
+    threadPool_parallelFor(pWriter->pPool, count, terrainHistory_compressTask_internal, pWriter);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      const int32_t size = pWriter->pCompressedSizes[i];
+
+      LS_ERROR_IF(size < 0, lsR_MemoryAllocationFailure);
+      LS_ERROR_CHECK(terrainHistory_writeValue_internal(pWriter->pFile, pWriter->ppCompressed[i], (size_t)size));
+
+      pWriter->pEntries[pWriter->batchStart + i].chunkIndex = pWriter->pChunks[pWriter->batchStart + i];
+      pWriter->pEntries[pWriter->batchStart + i].size = (uint32_t)size;
+      payloadSize += (uint64_t)size;
+
+      free(pWriter->ppCompressed[i]);
+      pWriter->ppCompressed[i] = nullptr;
+    }
+  }
+
+  header.size = sizeof(terrain_history_chunk) * header.chunkCount + payloadSize;
+
+  LS_ERROR_CHECK(lsSeekFile(pWriter->pFile, pWriter->endOffset));
+  LS_ERROR_CHECK(terrainHistory_writeValue_internal(pWriter->pFile, &header, sizeof(header)));
+
+  if (header.chunkCount > 0)
+    LS_ERROR_CHECK(terrainHistory_writeValue_internal(pWriter->pFile, pWriter->pEntries, sizeof(terrain_history_chunk) * header.chunkCount));
+
+  LS_ERROR_IF(0 != fflush(pWriter->pFile), lsR_IOFailure);
+
+  pWriter->endOffset += sizeof(header) + header.size;
+  pWriter->frameCount++;
+  pWriter->framesSinceKeyframe = pWriter->keyframe ? 1 : pWriter->framesSinceKeyframe + 1;
+  pWriter->keyframePending = false;
+  pWriter->lastStep = step;
+
+epilogue:
+  if (pWriter != nullptr)
+  {
+    for (size_t i = 0; i < pWriter->batchSize; i++)
+    {
+      free(pWriter->ppCompressed[i]);
+      pWriter->ppCompressed[i] = nullptr;
+    }
+  }
+
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainHistory_open(_Out_ terrain_history_reader **ppReader, const char *filename, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_history_reader *pReader = nullptr;
+  uint8_t version = 0;
+  uint16_t chunkSize = 0;
+  uint16_t keyframeInterval = 0;
+  uint64_t offset = terrainHistory_HeaderSize;
+
+  LS_ERROR_IF(ppReader == nullptr || filename == nullptr || pPool == nullptr, lsR_ArgumentNull);
+
+  pReader = new (std::nothrow) terrain_history_reader();
+  LS_ERROR_IF(pReader == nullptr, lsR_MemoryAllocationFailure);
+
+  pReader->pPool = pPool;
+
+  pReader->pFile = fopen(filename, "rb");
+  LS_ERROR_IF(pReader->pFile == nullptr, lsR_ResourceNotFound);
+
+  LS_ERROR_CHECK(terrainHistory_readValue_internal(pReader->pFile, &version, sizeof(version)));
+  LS_ERROR_IF(version != _HistoryVersion, lsR_ResourceIncompatible);
+  LS_ERROR_CHECK(terrainHistory_readValue_internal(pReader->pFile, &pReader->width, sizeof(pReader->width)));
+  LS_ERROR_CHECK(terrainHistory_readValue_internal(pReader->pFile, &pReader->height, sizeof(pReader->height)));
+  LS_ERROR_CHECK(terrainHistory_readValue_internal(pReader->pFile, &chunkSize, sizeof(chunkSize)));
+  LS_ERROR_CHECK(terrainHistory_readValue_internal(pReader->pFile, &keyframeInterval, sizeof(keyframeInterval)));
+  LS_ERROR_IF(chunkSize != terrain_chunkSize || pReader->width == 0 || pReader->height == 0, lsR_ResourceIncompatible);
+
+  pReader->chunkCountX = (pReader->width + terrain_chunkSize - 1) / terrain_chunkSize;
+  pReader->chunkCount = pReader->chunkCountX * ((pReader->height + terrain_chunkSize - 1) / terrain_chunkSize);
+  pReader->batchSize = terrainHistory_getBatchSize_internal(pPool, pReader->chunkCount);
+
+  LS_ERROR_CHECK(lsAlloc(&pReader->pTiles, (size_t)pReader->width * pReader->height));
+  LS_ERROR_CHECK(lsAlloc(&pReader->ppBlobs, pReader->chunkCount));
+  LS_ERROR_CHECK(lsAlloc(&pReader->pPlanes, pReader->batchSize * terrain_chunkBytes));
+  LS_ERROR_CHECK(lsAlloc(&pReader->pResults, pReader->batchSize));
+
+  // Index the frame headers. Stops at the first one that's incomplete or doesn't make sense, e.g. after a failed append.
+  while (true)
+  {
+    terrain_history_frame frame;
+    frame.offset = offset;
+
+    LS_ERROR_CHECK(lsSeekFile(pReader->pFile, offset));
+
+    if (LS_FAILED(terrainHistory_readValue_internal(pReader->pFile, &frame.header, sizeof(frame.header))))
+      break;
+
+    if (frame.header.chunkCount > pReader->chunkCount || frame.header.size < sizeof(terrain_history_chunk) * frame.header.chunkCount || frame.header.keyframe > 1)
+      break;
+
+    if (pReader->frameCount == 0 ? !frame.header.keyframe : frame.header.step <= pReader->pFrames[pReader->frameCount - 1].header.step)
+      break;
+
+    if (pReader->frameCount == pReader->frameCapacity)
+    {
+      const size_t capacity = lsMax((size_t)64, pReader->frameCapacity * 2);
+
+      LS_ERROR_CHECK(lsRealloc(&pReader->pFrames, capacity));
+      pReader->frameCapacity = capacity;
+    }
+
+    pReader->pFrames[pReader->frameCount++] = frame;
+    offset += sizeof(frame.header) + frame.header.size;
+  }
+
+  *ppReader = pReader;
+  pReader = nullptr;
+
+epilogue:
+  terrainHistory_close(&pReader);
+  return result;
+}
+
+void terrainHistory_close(terrain_history_reader **ppReader)
+{
+  if (ppReader == nullptr || *ppReader == nullptr)
+    return;
+
+  terrain_history_reader *pReader = *ppReader;
+
+  if (pReader->pFile != nullptr)
+    fclose(pReader->pFile);
+
+  lsFreePtr(&pReader->pFrames);
+  lsFreePtr(&pReader->pTiles);
+  lsFreePtr(&pReader->pPayload);
+  lsFreePtr(&pReader->ppBlobs);
+  lsFreePtr(&pReader->pPlanes);
+  lsFreePtr(&pReader->pResults);
+
+  delete pReader;
+  *ppReader = nullptr;
+}
+
+size_t terrainHistory_getFrameCount(const terrain_history_reader *pReader)
+{
+  lsAssert(pReader != nullptr);
+
+  return pReader->frameCount;
+}
+
+uint64_t terrainHistory_getStep(const terrain_history_reader *pReader, const size_t frameIndex)
+{
+  lsAssert(pReader != nullptr && frameIndex < pReader->frameCount);
+
+  return pReader->pFrames[frameIndex].header.step;
+}
+
+lsResult terrainHistory_findFrame(const terrain_history_reader *pReader, const uint64_t step, _Out_ size_t *pFrameIndex)
+{
+  lsResult result = lsR_Success;
+
+  size_t first = 0;
+  size_t last = 0;
+
+  LS_ERROR_IF(pReader == nullptr || pFrameIndex == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pReader->frameCount == 0 || pReader->pFrames[0].header.step > step, lsR_ResourceNotFound);
+
+  // Binary search for the last frame with a step <= `step`.
+  last = pReader->frameCount - 1;
+
+  while (first < last)
+  {
+    const size_t middle = first + (last - first + 1) / 2;
+
+    if (pReader->pFrames[middle].header.step <= step)
+      first = middle;
+    else
+      last = middle - 1;
+  }
+
+  *pFrameIndex = first;
+
+epilogue:
+  return result;
+}
+
+static lsResult terrainHistory_applyFrame_internal(terrain_history_reader *pReader, const size_t frameIndex)
+{
+  lsResult result = lsR_Success;
+
+  const terrain_history_frame *pFrame = &pReader->pFrames[frameIndex];
+  const size_t payloadSize = (size_t)pFrame->header.size;
+  size_t blobOffset = sizeof(terrain_history_chunk) * pFrame->header.chunkCount;
+
+  if (pReader->payloadCapacity < payloadSize)
+  {
+    LS_ERROR_CHECK(lsRealloc(&pReader->pPayload, payloadSize));
+    pReader->payloadCapacity = payloadSize;
+  }
+
+  LS_ERROR_CHECK(lsSeekFile(pReader->pFile, pFrame->offset + sizeof(pFrame->header)));
+  LS_ERROR_CHECK(terrainHistory_readValue_internal(pReader->pFile, pReader->pPayload, payloadSize));
+
+  pReader->pEntries = reinterpret_cast<const terrain_history_chunk *>(pReader->pPayload);
+
+  for (size_t i = 0; i < pFrame->header.chunkCount; i++)
+  {
+    LS_ERROR_IF(pReader->pEntries[i].chunkIndex >= pReader->chunkCount || pReader->pEntries[i].size > payloadSize - blobOffset || pReader->pEntries[i].size > INT32_MAX, lsR_ResourceInvalid);
+
+    pReader->ppBlobs[i] = pReader->pPayload + blobOffset;
+    blobOffset += pReader->pEntries[i].size;
+  }
+
+  // Keyframes are xor'ed onto an empty terrain.
+  if (pFrame->header.keyframe)
+    lsZeroMemory(pReader->pTiles, (size_t)pReader->width * pReader->height);
+
+  for (pReader->batchStart = 0; pReader->batchStart < pFrame->header.chunkCount; pReader->batchStart += pReader->batchSize)
+  {
+    const size_t count = lsMin(pReader->batchSize, pFrame->header.chunkCount - pReader->batchStart);
+
+    threadPool_parallelFor(pReader->pPool, count, terrainHistory_decompressTask_internal, pReader);
+
+    for (size_t i = 0; i < count; i++)
+      LS_ERROR_CHECK(pReader->pResults[i]);
+  }
+
+epilogue:
+  return result;
+}
+
+lsResult terrainHistory_read(terrain_history_reader *pReader, const size_t frameIndex, terrain *pTerrain)
+{
+  lsResult result = lsR_Success;
+
+  size_t first = frameIndex;
+
+  LS_ERROR_IF(pReader == nullptr || pTerrain == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(frameIndex >= pReader->frameCount, lsR_ArgumentOutOfBounds);
+
+  if (pTerrain->pTiles == nullptr)
+    LS_ERROR_CHECK(terrain_init(pTerrain, pReader->width, pReader->height));
+  else
+    LS_ERROR_IF(pTerrain->width != pReader->width || pTerrain->height != pReader->height, lsR_ResourceIncompatible);
+
+  // The first frame is always a keyframe.
+  while (!pReader->pFrames[first].header.keyframe)
+    first--;
+
+  if (pReader->currentFrame != terrainHistory_None && pReader->currentFrame >= first && pReader->currentFrame <= frameIndex)
+    first = pReader->currentFrame + 1;
+
+  pReader->currentFrame = terrainHistory_None; // in case applying a frame fails.
+
+  for (size_t i = first; i <= frameIndex; i++)
+    LS_ERROR_CHECK(terrainHistory_applyFrame_internal(pReader, i));
+
+  pReader->currentFrame = frameIndex;
+
+  lsMemcpy(pTerrain->pTiles, pReader->pTiles, (size_t)pReader->width * pReader->height);
+  terrain_markAllDirty(pTerrain);
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(9)
+
+DEFINE_TESTABLE(terrainHistory_TestRandomAccess)
+{
+  lsResult result = lsR_Success;
+
+  const char *filename = "terrainHistory_TestRandomAccess.history";
+  constexpr size_t frameCount = 10;
+  constexpr uint16_t width = 150;
+  constexpr uint16_t height = 100; // with partial chunks.
+
+  terrain current;
+  terrain loaded;
+  lsZeroMemory(&current);
+  lsZeroMemory(&loaded);
+
+  tile *pExpected = nullptr;
+  thread_pool *pPool = nullptr;
+  terrain_history_writer *pWriter = nullptr;
+  terrain_history_reader *pReader = nullptr;
+  rand_seed seed(5, 6);
+  size_t frameIndex = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&current, width, height));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pExpected, (size_t)width * height * frameCount));
+
+  for (size_t i = 0; i < (size_t)width * height; i++)
+    for (size_t layer = 0; layer < tt_count; layer++)
+      current.pTiles[i].layerHeights[layer] = (uint16_t)(lsGetRand(seed) % 1024);
+
+  TESTABLE_ASSERT_SUCCESS(terrainHistory_createWriter(&pWriter, filename, width, height, pPool, 4));
+
+  for (size_t frame = 0; frame < frameCount; frame++)
+  {
+    // Changes a few tiles in a single chunk, except for a frame without any changes.
+    if (frame != 6)
+    {
+      for (size_t i = 0; i < 20; i++)
+      {
+        const size_t x = 64 + lsGetRand(seed) % (width - 64);
+        const size_t y = lsGetRand(seed) % 64;
+
+        uint16_t *pHeight = &current.pTiles[y * width + x].layerHeights[lsGetRand(seed) % tt_count];
+
+        *pHeight = (uint16_t)(*pHeight + lsGetRand(seed) % 16);
+      }
+    }
+
+    lsMemcpy(pExpected + frame * width * height, current.pTiles, (size_t)width * height);
+    TESTABLE_ASSERT_SUCCESS(terrainHistory_append(pWriter, &current, 50 + frame * 100));
+  }
+
+  TESTABLE_ASSERT_FAILURE(terrainHistory_append(pWriter, &current, 50)); // steps have to be increasing.
+  terrainHistory_destroyWriter(&pWriter);
+
+  TESTABLE_ASSERT_SUCCESS(terrainHistory_open(&pReader, filename, pPool));
+  TESTABLE_ASSERT_EQUAL(terrainHistory_getFrameCount(pReader), frameCount);
+
+  TESTABLE_ASSERT_FAILURE(terrainHistory_findFrame(pReader, 10, &frameIndex));
+  TESTABLE_ASSERT_SUCCESS(terrainHistory_findFrame(pReader, 780, &frameIndex));
+  TESTABLE_ASSERT_EQUAL(frameIndex, (size_t)7);
+  TESTABLE_ASSERT_EQUAL(terrainHistory_getStep(pReader, frameIndex), (uint64_t)750);
+
+  // Backwards, forwards within and across keyframes.
+  {
+    const size_t order[] = { 7, 2, 3, 9, 0, 5, 6, 4, 1, 8 };
+
+    for (size_t i = 0; i < LS_ARRAYSIZE(order); i++)
+    {
+      TESTABLE_ASSERT_SUCCESS(terrainHistory_read(pReader, order[i], &loaded));
+      TESTABLE_ASSERT_EQUAL(memcmp(loaded.pTiles, pExpected + order[i] * width * height, sizeof(tile) * width * height), 0);
+    }
+  }
+
+epilogue:
+  terrainHistory_destroyWriter(&pWriter);
+  terrainHistory_close(&pReader);
+  threadPool_destroy(&pPool);
+  remove(filename);
+  lsFreePtr(&pExpected);
+  terrain_destroy(&current);
+  terrain_destroy(&loaded);
+  return result;
+}
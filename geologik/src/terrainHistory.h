@@ -0,0 +1,34 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Time series of a terrain in a single file, e.g. for time-lapses of erosion runs. Every `keyframeInterval`th frame stores all chunks,
+// the frames in between only the chunks that changed, xor'ed with the previous frame. See the file format in the `README.md`.
+
+struct terrain_history_writer;
+struct terrain_history_reader;
+
+constexpr uint16_t terrainHistory_DefaultKeyframeInterval = 32;
+
+lsResult terrainHistory_createWriter(_Out_ terrain_history_writer **ppWriter, const char *filename, const uint16_t width, const uint16_t height, thread_pool *pPool, const uint16_t keyframeInterval = terrainHistory_DefaultKeyframeInterval);
+void terrainHistory_destroyWriter(terrain_history_writer **ppWriter);
+
+// Appends `pTerrain` as it is at simulation step `step`. Steps have to be increasing.
+lsResult terrainHistory_append(terrain_history_writer *pWriter, const terrain *pTerrain, const uint64_t step);
+
+lsResult terrainHistory_open(_Out_ terrain_history_reader **ppReader, const char *filename, thread_pool *pPool);
+void terrainHistory_close(terrain_history_reader **ppReader);
+
+size_t terrainHistory_getFrameCount(const terrain_history_reader *pReader);
+uint64_t terrainHistory_getStep(const terrain_history_reader *pReader, const size_t frameIndex);
+
+// Finds the last frame at or before `step`.
+lsResult terrainHistory_findFrame(const terrain_history_reader *pReader, const uint64_t step, _Out_ size_t *pFrameIndex);
+
+// Reconstructs a frame from the keyframe before it, or from the previously read frame when reading forwards.
+// Initializes `pTerrain` if it doesn't have any tiles yet, otherwise it has to be of the same size.
+lsResult terrainHistory_read(terrain_history_reader *pReader, const size_t frameIndex, terrain *pTerrain);
@@ -0,0 +1,249 @@
+#include "terrainImage.h"
+#include "terrainPreview.h"
+#include "terrainFlow.h"
+#include "pngWriter.h"
+
+#pragma warning(push)
+#pragma warning(disable: 4100)
+#include "stb_image.h"
+#pragma warning(pop)
+
+//////////////////////////////////////////////////////////////////////////
+
+struct terrain_image_context
+{
+  const terrain *pTerrain;
+  terrain_type layer;
+  uint8_t colors[tt_count][3];
+  const terrain_flow *pFlow;
+  float accumulationScale;
+};
+
+static void terrainImage_getHeightRow_internal(void *pUserData, const size_t y, _Out_ uint8_t *pRow)
+{
+  const terrain_image_context *pContext = reinterpret_cast<const terrain_image_context *>(pUserData);
+  const tile *pTiles = pContext->pTerrain->pTiles + y * pContext->pTerrain->width;
+
+  for (size_t x = 0; x < pContext->pTerrain->width; x++)
+  {
+    uint32_t height = 0;
+
+    for (size_t layer = 0; layer < tt_count; layer++)
+      height += pTiles[x].layerHeights[layer];
+
+    height = lsMin(height, (uint32_t)UINT16_MAX);
+
+    pRow[x * 2] = (uint8_t)(height >> 8);
+    pRow[x * 2 + 1] = (uint8_t)height;
+  }
+}
+
+static void terrainImage_getLayerRow_internal(void *pUserData, const size_t y, _Out_ uint8_t *pRow)
+{
+  const terrain_image_context *pContext = reinterpret_cast<const terrain_image_context *>(pUserData);
+  const tile *pTiles = pContext->pTerrain->pTiles + y * pContext->pTerrain->width;
+
+  for (size_t x = 0; x < pContext->pTerrain->width; x++)
+  {
+    const uint16_t thickness = pTiles[x].layerHeights[pContext->layer];
+
+    pRow[x * 2] = (uint8_t)(thickness >> 8);
+    pRow[x * 2 + 1] = (uint8_t)thickness;
+  }
+}
+
+static void terrainImage_getMaterialRow_internal(void *pUserData, const size_t y, _Out_ uint8_t *pRow)
+{
+  const terrain_image_context *pContext = reinterpret_cast<const terrain_image_context *>(pUserData);
+  const tile *pTiles = pContext->pTerrain->pTiles + y * pContext->pTerrain->width;
+
+  for (size_t x = 0; x < pContext->pTerrain->width; x++)
+  {
+    // Ties go to the upper layer, tiles without any material to bedrock.
+    size_t dominant = tt_bedrock;
+    uint16_t thickness = 0;
+
+    for (size_t layer = 0; layer < tt_count; layer++)
+    {
+      if (pTiles[x].layerHeights[layer] > thickness)
+      {
+        dominant = layer;
+        thickness = pTiles[x].layerHeights[layer];
+      }
+    }
+
+    lsMemcpy(pRow + x * 3, pContext->colors[dominant], 3);
+  }
+}
+
+static void terrainImage_getAccumulationRow_internal(void *pUserData, const size_t y, _Out_ uint8_t *pRow)
+{
+  const terrain_image_context *pContext = reinterpret_cast<const terrain_image_context *>(pUserData);
+  const uint32_t *pAccumulation = pContext->pFlow->pAccumulation + y * pContext->pFlow->width;
+
+  for (size_t x = 0; x < pContext->pFlow->width; x++)
+  {
+    const uint16_t value = (uint16_t)lsMin(log2f((float)pAccumulation[x]) * pContext->accumulationScale + 0.5f, (float)UINT16_MAX);
+
+    pRow[x * 2] = (uint8_t)(value >> 8);
+    pRow[x * 2 + 1] = (uint8_t)value;
+  }
+}
+
+static lsResult terrainImage_write_internal(const terrain *pTerrain, const char *filename, const png_pixel_format format, png_writer_row_func *pFunc, terrain_image_context *pContext)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pTerrain == nullptr || pTerrain->pTiles == nullptr, lsR_ArgumentNull);
+
+  pContext->pTerrain = pTerrain;
+
+  LS_ERROR_CHECK(pngWriter_write(filename, pTerrain->width, pTerrain->height, format, pFunc, pContext));
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainImage_writeHeight(const terrain *pTerrain, const char *filename)
+{
+  terrain_image_context context;
+
+  return terrainImage_write_internal(pTerrain, filename, ppf_gray16, terrainImage_getHeightRow_internal, &context);
+}
+
+lsResult terrainImage_writeLayerThickness(const terrain *pTerrain, const terrain_type layer, const char *filename)
+{
+  lsResult result = lsR_Success;
+
+  terrain_image_context context;
+  context.layer = layer;
+
+  LS_ERROR_IF((size_t)layer >= tt_count, lsR_ArgumentOutOfBounds);
+  LS_ERROR_CHECK(terrainImage_write_internal(pTerrain, filename, ppf_gray16, terrainImage_getLayerRow_internal, &context));
+
+epilogue:
+  return result;
+}
+
+lsResult terrainImage_writeMaterial(const terrain *pTerrain, const char *filename)
+{
+  terrain_image_context context;
+
+  for (size_t layer = 0; layer < tt_count; layer++)
+  {
+    context.colors[layer][0] = (uint8_t)(terrainPreview_LayerColors[layer].x * 255.f);
+    context.colors[layer][1] = (uint8_t)(terrainPreview_LayerColors[layer].y * 255.f);
+    context.colors[layer][2] = (uint8_t)(terrainPreview_LayerColors[layer].z * 255.f);
+  }
+
+  return terrainImage_write_internal(pTerrain, filename, ppf_rgb8, terrainImage_getMaterialRow_internal, &context);
+}
+
+lsResult terrainImage_writeFlowAccumulation(const terrain_flow *pFlow, const char *filename)
+{
+  lsResult result = lsR_Success;
+
+  terrain_image_context context;
+
+  LS_ERROR_IF(pFlow == nullptr || pFlow->pAccumulation == nullptr, lsR_ArgumentNull);
+
+  context.pFlow = pFlow;
+  context.accumulationScale = UINT16_MAX / lsMax(1.f, log2f((float)pFlow->width * pFlow->height));
+
+  LS_ERROR_CHECK(pngWriter_write(filename, pFlow->width, pFlow->height, ppf_gray16, terrainImage_getAccumulationRow_internal, &context));
+
+epilogue:
+  return result;
+}
+
+lsResult terrainImage_readHeight(_Out_ terrain *pTerrain, const char *filename, const uint16_t maxHeight /* = UINT16_MAX */, const uint16_t bedrockThickness /* = terrainImage_DefaultBedrockThickness */)
+{
+  lsResult result = lsR_Success;
+
+  uint16_t *pImage = nullptr;
+  int32_t width = 0;
+  int32_t height = 0;
+  int32_t channels = 0;
+
+  LS_ERROR_IF(pTerrain == nullptr || filename == nullptr, lsR_ArgumentNull);
+
+  pImage = stbi_load_16(filename, &width, &height, &channels, 1); // 8 bit images are scaled to the full 16 bit range.
+  LS_ERROR_IF(pImage == nullptr, lsR_ResourceInvalid);
+  LS_ERROR_IF(width <= 0 || height <= 0 || width > UINT16_MAX || height > UINT16_MAX, lsR_ResourceIncompatible);
+
+  LS_ERROR_CHECK(terrain_init(pTerrain, (uint16_t)width, (uint16_t)height));
+
+  for (size_t i = 0; i < (size_t)width * (size_t)height; i++)
+  {
+    const uint16_t total = (uint16_t)(((uint32_t)pImage[i] * maxHeight + UINT16_MAX / 2) / UINT16_MAX);
+    tile *pTile = &pTerrain->pTiles[i];
+
+    lsZeroMemory(pTile);
+    pTile->layerHeights[tt_bedrock] = lsMin(total, bedrockThickness);
+    pTile->layerHeights[tt_stone] = (uint16_t)(total - pTile->layerHeights[tt_bedrock]);
+  }
+
+epilogue:
+  if (pImage != nullptr)
+    stbi_image_free(pImage);
+
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(6)
+
+DEFINE_TESTABLE(terrainImage_TestHeightRoundTrip)
+{
+  lsResult result = lsR_Success;
+
+  const char *filename = "terrainImage_TestHeightRoundTrip.png";
+
+  terrain original;
+  terrain imported;
+  lsZeroMemory(&original);
+  lsZeroMemory(&imported);
+
+  rand_seed seed(1, 2);
+
+  // Enough rows for multiple strips.
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&original, 1024, 1100));
+
+  for (size_t y = 0; y < original.height; y++)
+  {
+    for (size_t x = 0; x < original.width; x++)
+    {
+      tile *pTile = &original.pTiles[y * original.width + x];
+
+      lsZeroMemory(pTile);
+      pTile->layerHeights[tt_bedrock] = terrainImage_DefaultBedrockThickness;
+      pTile->layerHeights[tt_stone] = (uint16_t)(x * 16 + y * 8); // smooth, so the compressor finds matches.
+      pTile->layerHeights[tt_soil] = (uint16_t)(lsGetRand(seed) % 64);
+    }
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainImage_writeHeight(&original, filename));
+  TESTABLE_ASSERT_SUCCESS(terrainImage_readHeight(&imported, filename));
+
+  TESTABLE_ASSERT_EQUAL(imported.width, original.width);
+  TESTABLE_ASSERT_EQUAL(imported.height, original.height);
+
+  for (size_t i = 0; i < (size_t)original.width * original.height; i++)
+  {
+    const tile &a = original.pTiles[i];
+    const tile &b = imported.pTiles[i];
+
+    TESTABLE_ASSERT_EQUAL(b.layerHeights[tt_stone] + b.layerHeights[tt_bedrock], a.layerHeights[tt_stone] + a.layerHeights[tt_soil] + a.layerHeights[tt_bedrock]);
+    TESTABLE_ASSERT_EQUAL(b.layerHeights[tt_bedrock], terrainImage_DefaultBedrockThickness);
+  }
+
+epilogue:
+  remove(filename);
+  terrain_destroy(&original);
+  terrain_destroy(&imported);
+  return result;
+}
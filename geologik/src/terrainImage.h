@@ -0,0 +1,27 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+
+struct terrain_flow;
+
+//////////////////////////////////////////////////////////////////////////
+
+// Top-down orthographic maps of a terrain as PNG, one pixel per tile.
+
+constexpr uint16_t terrainImage_DefaultBedrockThickness = 8; // in decimeters
+
+// 16 bit grayscale of the total height in decimeters, clamped to `UINT16_MAX`.
+lsResult terrainImage_writeHeight(const terrain *pTerrain, const char *filename);
+
+// 16 bit grayscale of the thickness of `layer` in decimeters.
+lsResult terrainImage_writeLayerThickness(const terrain *pTerrain, const terrain_type layer, const char *filename);
+
+// RGB of the colour of the thickest layer per tile.
+lsResult terrainImage_writeMaterial(const terrain *pTerrain, const char *filename);
+
+// 16 bit grayscale of the logarithm of the flow accumulation, so rivers and their tributaries are visible alike. Full white drains the whole map.
+lsResult terrainImage_writeFlowAccumulation(const terrain_flow *pFlow, const char *filename);
+
+// Creates a terrain from an 8 or 16 bit heightmap. Full white is `maxHeight` decimeters. The height is stone on top of up to `bedrockThickness` of bedrock.
+lsResult terrainImage_readHeight(_Out_ terrain *pTerrain, const char *filename, const uint16_t maxHeight = UINT16_MAX, const uint16_t bedrockThickness = terrainImage_DefaultBedrockThickness);
@@ -0,0 +1,518 @@
+#include "terrainIncision.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+constexpr float terrainIncision_Diagonal = 1.41421356f;
+constexpr size_t terrainIncision_AreaTableSize = 4096; // most tiles drain only a few others, `powf` is only needed for large rivers.
+
+struct terrain_incision_context
+{
+  terrain *pTerrain;
+  const terrain_flow *pFlow;
+  const terrain_incision_params *pParams;
+  double *pElevations; // of the bed, in decimeters. floats would round away the steps on high terrain.
+  float *pFactors; // `K * A^m * dt / distance to the receiver`.
+  bool *pChangedBlocks; // per block of `terrain_chunkSize` rows.
+  float areaFactors[terrainIncision_AreaTableSize]; // `K * A^m * dt` by accumulation.
+};
+
+static int64_t terrainIncision_getBedHeight_internal(const terrain *pTerrain, const size_t index)
+{
+  int64_t height = 0;
+
+  for (size_t layer = terrainMaterial_FirstBedLayer; layer < tt_count; layer++)
+    height += terrain_getFixedHeight(pTerrain, index, (terrain_type)layer);
+
+  return height;
+}
+
+// In 16.16 fixed point, so the sweep and the bedrock get exactly the same amount.
+static int64_t terrainIncision_getUplift_internal(const terrain_incision_params *pParams)
+{
+  return (int64_t)((double)pParams->upliftRate * pParams->timeStep * terrain_fixedOne + 0.5);
+}
+
+static void terrainIncision_prepare_internal(void *pUserData, const size_t index)
+{
+  terrain_incision_context *pContext = reinterpret_cast<terrain_incision_context *>(pUserData);
+  const terrain *pTerrain = pContext->pTerrain;
+  const terrain_incision_params *pParams = pContext->pParams;
+  const size_t end = lsMin((index + 1) * terrain_chunkSize, (size_t)pTerrain->height) * pTerrain->width;
+  const float tileArea = terrain_tileSize * terrain_tileSize;
+  const float factor = pParams->erodibility * pParams->timeStep;
+
+  for (size_t i = index * terrain_chunkSize * pTerrain->width; i < end; i++)
+  {
+    const uint8_t direction = pContext->pFlow->pDirections[i];
+
+    pContext->pElevations[i] = (double)terrainIncision_getBedHeight_internal(pTerrain, i) / terrain_fixedOne;
+
+    if (direction == tfd_outlet)
+    {
+      pContext->pFactors[i] = 0;
+      continue;
+    }
+
+    size_t top = terrainMaterial_FirstBedLayer;
+
+    while (top < tt_count - 1 && pTerrain->pTiles[i].layerHeights[top] == 0)
+      top++;
+
+    const float distance = (direction & 1) ? terrain_tileSize * terrainIncision_Diagonal : terrain_tileSize;
+    const uint32_t accumulation = pContext->pFlow->pAccumulation[i];
+    const float areaFactor = accumulation < terrainIncision_AreaTableSize ? pContext->areaFactors[accumulation] : factor * powf((float)accumulation * tileArea, pParams->areaExponent);
+
+    pContext->pFactors[i] = terrainMaterial_Properties[top].erodibility * areaFactor / distance;
+  }
+}
+
+// Removes what the sweep eroded from the exposed layer of the bed, see `terrain_erodeFixedHeight`, and adds the uplift to the bedrock. Outlets are the base level and
+// stay as they are.
+static void terrainIncision_apply_internal(void *pUserData, const size_t index)
+{
+  terrain_incision_context *pContext = reinterpret_cast<terrain_incision_context *>(pUserData);
+  terrain *pTerrain = pContext->pTerrain;
+  const size_t end = lsMin((index + 1) * terrain_chunkSize, (size_t)pTerrain->height) * pTerrain->width;
+  const int64_t upliftFixed = terrainIncision_getUplift_internal(pContext->pParams);
+  bool changed = false;
+
+  for (size_t i = index * terrain_chunkSize * pTerrain->width; i < end; i++)
+  {
+    if (pContext->pFlow->pDirections[i] == tfd_outlet)
+      continue;
+
+    const int64_t after = (int64_t)(pContext->pElevations[i] * terrain_fixedOne + 0.5);
+    const int64_t erosion = terrainIncision_getBedHeight_internal(pTerrain, i) + upliftFixed - after;
+
+    if (upliftFixed > 0)
+      changed |= terrain_addFixedHeight(pTerrain, i, tt_bedrock, (int32_t)lsMin(upliftFixed, (int64_t)INT32_MAX)) != 0;
+
+    if (erosion > 0)
+      changed |= terrain_erodeFixedHeight(pTerrain, i, (terrain_type)terrainMaterial_FirstBedLayer, tt_bedrock, erosion) != 0;
+  }
+
+  pContext->pChangedBlocks[index] = changed;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainIncision_step(terrain *pTerrain, const terrain_flow *pFlow, const terrain_incision_params *pParams, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_incision_context context;
+  context.pTerrain = pTerrain;
+  context.pFlow = pFlow;
+  context.pParams = pParams;
+  context.pElevations = nullptr;
+  context.pFactors = nullptr;
+  context.pChangedBlocks = nullptr;
+  size_t tileCount = 0;
+  size_t blockCount = 0;
+
+  LS_ERROR_IF(pTerrain == nullptr || pFlow == nullptr || pParams == nullptr || pPool == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pFlow->width != pTerrain->width || pFlow->height != pTerrain->height, lsR_ArgumentOutOfBounds);
+  LS_ERROR_IF(pParams->timeStep < 0, lsR_ArgumentOutOfBounds);
+
+  tileCount = (size_t)pTerrain->width * pTerrain->height;
+  blockCount = (pTerrain->height + terrain_chunkSize - 1) / terrain_chunkSize;
+
+  LS_ERROR_CHECK(lsAlloc(&context.pElevations, tileCount));
+  LS_ERROR_CHECK(lsAlloc(&context.pFactors, tileCount));
+  LS_ERROR_CHECK(lsAlloc(&context.pChangedBlocks, blockCount));
+
+  for (size_t i = 0; i < terrainIncision_AreaTableSize; i++)
+    context.areaFactors[i] = pParams->erodibility * pParams->timeStep * powf((float)i * terrain_tileSize * terrain_tileSize, pParams->areaExponent);
+
+  threadPool_parallelFor(pPool, blockCount, terrainIncision_prepare_internal, &context);
+
+  // Receivers come first in `pOrder`, so their new elevation is known: h' = (h + U * dt + F * h'_receiver) / (1 + F).
+  // Tiles in filled depressions can be below their receiver, those only get the uplift. Outlets keep their elevation.
+  {
+    const double uplift = (double)terrainIncision_getUplift_internal(pParams) / terrain_fixedOne;
+
+    for (size_t k = 0; k < tileCount; k++)
+    {
+      const size_t i = pFlow->pOrder[k];
+      const size_t receiver = terrainFlow_getReceiver(pFlow, i);
+
+      if (receiver == i)
+        continue;
+
+      const double elevation = context.pElevations[i] + uplift;
+
+      const double receiverElevation = context.pElevations[receiver];
+      const double factor = context.pFactors[i];
+
+      context.pElevations[i] = receiverElevation >= elevation ? elevation : (elevation + factor * receiverElevation) / (1.0 + factor);
+    }
+  }
+
+  threadPool_parallelFor(pPool, blockCount, terrainIncision_apply_internal, &context);
+
+  for (size_t i = 0; i < blockCount; i++)
+    if (context.pChangedBlocks[i])
+      terrain_markDirty(pTerrain, 0, i * terrain_chunkSize, pTerrain->width, lsMin(terrain_chunkSize, pTerrain->height - i * terrain_chunkSize));
+
+epilogue:
+  lsFreePtr(&context.pElevations);
+  lsFreePtr(&context.pFactors);
+  lsFreePtr(&context.pChangedBlocks);
+  return result;
+}
+
+lsResult terrainIncision_run(terrain *pTerrain, const terrain_incision_params *pParams, const size_t stepCount, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  LS_ERROR_IF(pParams == nullptr, lsR_ArgumentNull);
+
+  for (size_t step = 0; step < stepCount; step++)
+  {
+    if (step % lsMax(pParams->flowInterval, 1U) == 0)
+    {
+      terrainFlow_destroy(&flow);
+      LS_ERROR_CHECK(terrainFlow_compute(&flow, pTerrain, pPool));
+    }
+
+    LS_ERROR_CHECK(terrainIncision_step(pTerrain, &flow, pParams, pPool));
+  }
+
+epilogue:
+  terrainFlow_destroy(&flow);
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(13)
+
+DEFINE_TESTABLE(terrainIncision_TestMaterials)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  thread_pool *pPool = nullptr;
+  terrain_incision_params params;
+
+  constexpr size_t sandRow = 2;
+  constexpr size_t stoneRow = 5;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 32, 8));
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&t, (1U << tt_sand) | (1U << tt_stone)));
+
+  // A plane falling towards the east, so every row drains on its own.
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      tile *pTile = &t.pTiles[y * t.width + x];
+
+      lsZeroMemory(pTile);
+      pTile->layerHeights[tt_bedrock] = 8;
+      pTile->layerHeights[tt_stone] = (uint16_t)((t.width - x) * 10 + (y == sandRow ? 0 : 100));
+      pTile->layerHeights[tt_sand] = y == sandRow ? 100 : 0;
+    }
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &t, pPool));
+  TESTABLE_ASSERT_SUCCESS(terrainIncision_step(&t, &flow, &params, pPool));
+
+  // Next to the outlet, the implicit solution only depends on the fixed outlet. The western edge drains into the row as well.
+  {
+    const size_t x = t.width - 2u;
+    const float area = (float)(t.width - 1) * terrain_tileSize * terrain_tileSize;
+    const float factor = params.erodibility * terrainMaterial_Properties[tt_stone].erodibility * powf(area, params.areaExponent) * params.timeStep / terrain_tileSize;
+    const float expected = (float)(2 * 10 + 108 + factor * (10 + 108)) / (1.f + factor);
+    const float actual = (float)terrainIncision_getBedHeight_internal(&t, stoneRow * t.width + x) / terrain_fixedOne;
+
+    TESTABLE_ASSERT_EQUAL(fabsf(actual - expected) < 1e-3f, true);
+    TESTABLE_ASSERT_EQUAL(actual < 2 * 10 + 108, true);
+  }
+
+  // Sand erodes faster than stone, bedrock and the outlets not at all.
+  for (size_t x = 1; x < t.width - 1u; x++)
+  {
+    const uint32_t sandErosion = (t.width - (uint32_t)x) * 10 * terrain_fixedOne + 100 * terrain_fixedOne - terrain_getFixedHeight(&t, sandRow * t.width + x, tt_sand) - terrain_getFixedHeight(&t, sandRow * t.width + x, tt_stone);
+    const uint32_t stoneErosion = ((t.width - (uint32_t)x) * 10 + 100) * terrain_fixedOne - terrain_getFixedHeight(&t, stoneRow * t.width + x, tt_stone);
+
+    TESTABLE_ASSERT_EQUAL(sandErosion > stoneErosion, true);
+    TESTABLE_ASSERT_EQUAL(stoneErosion > 0u, true);
+  }
+
+  for (size_t y = 0; y < t.height; y++)
+  {
+    TESTABLE_ASSERT_EQUAL(t.pTiles[y * t.width + t.width - 1].layerHeights[tt_stone], y == sandRow ? 10 : 110);
+    TESTABLE_ASSERT_EQUAL(t.pTiles[y * t.width].layerHeights[tt_bedrock], 8);
+  }
+
+epilogue:
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainIncision_TestOutlets)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  thread_pool *pPool = nullptr;
+  tile *pBefore = nullptr;
+  rand_seed seed(7, 8);
+  terrain_incision_params params;
+  params.upliftRate = 1e-3f;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 40, 30));
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&t, (1U << tt_soil) | (1U << tt_sand) | (1U << tt_stone)));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pBefore, (size_t)t.width * t.height));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    lsZeroMemory(&t.pTiles[i]);
+    t.pTiles[i].layerHeights[tt_bedrock] = 8;
+    t.pTiles[i].layerHeights[tt_stone] = (uint16_t)(200 + lsGetRand(seed) % 200);
+    t.pTiles[i].layerHeights[tt_sand] = (uint16_t)(lsGetRand(seed) % 3);
+    t.pTiles[i].layerHeights[tt_soil] = (uint16_t)(1 + lsGetRand(seed) % 5);
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &t, pPool));
+  lsMemcpy(pBefore, t.pTiles, (size_t)t.width * t.height);
+
+  for (size_t step = 0; step < 3; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainIncision_step(&t, &flow, &params, pPool));
+
+  // Outlets keep their layers, everything else rises with the bedrock.
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    if (flow.pDirections[i] == tfd_outlet)
+    {
+      for (size_t layer = 0; layer < tt_count; layer++)
+      {
+        TESTABLE_ASSERT_EQUAL(t.pTiles[i].layerHeights[layer], pBefore[i].layerHeights[layer]);
+
+        if (t.pFractions[layer] != nullptr)
+          TESTABLE_ASSERT_EQUAL(t.pFractions[layer][i], 0);
+      }
+    }
+    else
+    {
+      TESTABLE_ASSERT_EQUAL(t.pTiles[i].layerHeights[tt_bedrock] > pBefore[i].layerHeights[tt_bedrock], true);
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pBefore);
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainIncision_TestHighTerrain)
+{
+  lsResult result = lsR_Success;
+
+  terrain low, high;
+  lsZeroMemory(&low);
+  lsZeroMemory(&high);
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  thread_pool *pPool = nullptr;
+  terrain_incision_params params;
+  params.timeStep = 10.f;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&low, 32, 8));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&high, 32, 8));
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&low, 1U << tt_stone));
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&high, 1U << tt_stone));
+
+  // The same slope, once on top of 6.5 km of bedrock, where floats only have steps of 1/128 dm.
+  for (size_t y = 0; y < low.height; y++)
+  {
+    for (size_t x = 0; x < low.width; x++)
+    {
+      const size_t i = y * low.width + x;
+
+      lsZeroMemory(&low.pTiles[i]);
+      low.pTiles[i].layerHeights[tt_stone] = (uint16_t)((low.width - x) * 10);
+      high.pTiles[i] = low.pTiles[i];
+      high.pTiles[i].layerHeights[tt_bedrock] = UINT16_MAX;
+    }
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &low, pPool));
+  TESTABLE_ASSERT_SUCCESS(terrainIncision_step(&low, &flow, &params, pPool));
+  terrainFlow_destroy(&flow);
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &high, pPool));
+  TESTABLE_ASSERT_SUCCESS(terrainIncision_step(&high, &flow, &params, pPool));
+
+  for (size_t i = 0; i < (size_t)low.width * low.height; i++)
+  {
+    const int64_t lowHeight = terrain_getFixedHeight(&low, i, tt_stone);
+    const int64_t highHeight = terrain_getFixedHeight(&high, i, tt_stone);
+
+    TESTABLE_ASSERT_EQUAL(lsAbs(lowHeight - highHeight) <= 1, true);
+    TESTABLE_ASSERT_EQUAL(high.pTiles[i].layerHeights[tt_bedrock], UINT16_MAX);
+  }
+
+  // Otherwise these steps would have rounded away.
+  TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&high, 4 * high.width + 1, tt_stone) < (high.width - 1u) * 10 * terrain_fixedOne, true);
+
+epilogue:
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&low);
+  terrain_destroy(&high);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainIncision_TestLongTimeSteps)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  thread_pool *pPool = nullptr;
+  int64_t *pBefore = nullptr;
+  rand_seed seed(5, 6);
+  terrain_incision_params params;
+  params.timeStep = 1e8f;
+
+  int64_t totalBefore = 0;
+  int64_t totalAfter = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 100, 90));
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&t, (1U << tt_soil) | (1U << tt_stone)));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pBefore, (size_t)t.width * t.height));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    lsZeroMemory(&t.pTiles[i]);
+    t.pTiles[i].layerHeights[tt_bedrock] = 8;
+    t.pTiles[i].layerHeights[tt_stone] = (uint16_t)(lsGetRand(seed) % 2000);
+    t.pTiles[i].layerHeights[tt_soil] = (uint16_t)(lsGetRand(seed) % 50);
+
+    totalBefore += terrainIncision_getBedHeight_internal(&t, i);
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainIncision_run(&t, &params, 2, pPool));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+    pBefore[i] = terrainIncision_getBedHeight_internal(&t, i);
+
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &t, pPool));
+  TESTABLE_ASSERT_SUCCESS(terrainIncision_step(&t, &flow, &params, pPool));
+
+  // An explicit scheme would overshoot with these steps. The implicit one settles between a tile and its receiver.
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    const int64_t height = terrainIncision_getBedHeight_internal(&t, i);
+    const int64_t receiverHeight = terrainIncision_getBedHeight_internal(&t, terrainFlow_getReceiver(&flow, i));
+    constexpr int64_t tolerance = 1; // rounding to the fixed point heights.
+
+    totalAfter += height;
+
+    TESTABLE_ASSERT_EQUAL(height <= pBefore[i] + tolerance, true);
+    TESTABLE_ASSERT_EQUAL(height >= lsMin(pBefore[i], receiverHeight) - tolerance, true);
+    TESTABLE_ASSERT_EQUAL(t.pTiles[i].layerHeights[tt_bedrock], 8);
+  }
+
+  TESTABLE_ASSERT_EQUAL(totalAfter < totalBefore / 4, true);
+
+epilogue:
+  lsFreePtr(&pBefore);
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainIncision_TestFlowInterval)
+{
+  lsResult result = lsR_Success;
+
+  terrain fresh;
+  lsZeroMemory(&fresh);
+
+  terrain stale;
+  lsZeroMemory(&stale);
+
+  thread_pool *pPool = nullptr;
+  int64_t *pBefore = nullptr;
+  rand_seed seed(7, 8);
+  terrain_incision_params params;
+  params.timeStep = 1e5f;
+
+  int64_t freshErosion = 0;
+  int64_t staleErosion = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&fresh, 64, 48));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&stale, 64, 48));
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&fresh, 1U << tt_stone));
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&stale, 1U << tt_stone));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pBefore, (size_t)fresh.width * fresh.height));
+
+  for (size_t i = 0; i < (size_t)fresh.width * fresh.height; i++)
+  {
+    lsZeroMemory(&fresh.pTiles[i]);
+    fresh.pTiles[i].layerHeights[tt_bedrock] = 8;
+    fresh.pTiles[i].layerHeights[tt_stone] = (uint16_t)(1000 + (i % fresh.width) * 20 + lsGetRand(seed) % 300);
+    stale.pTiles[i] = fresh.pTiles[i];
+
+    pBefore[i] = terrainIncision_getBedHeight_internal(&fresh, i);
+  }
+
+  params.flowInterval = 1;
+  TESTABLE_ASSERT_SUCCESS(terrainIncision_run(&fresh, &params, 8, pPool));
+
+  params.flowInterval = 4;
+  TESTABLE_ASSERT_SUCCESS(terrainIncision_run(&stale, &params, 8, pPool));
+
+  // Reusing the drainage network for a few steps never raises a tile and erodes about as much as recomputing it every step.
+  for (size_t i = 0; i < (size_t)fresh.width * fresh.height; i++)
+  {
+    const int64_t staleHeight = terrainIncision_getBedHeight_internal(&stale, i);
+
+    TESTABLE_ASSERT_EQUAL(staleHeight <= pBefore[i], true);
+
+    freshErosion += pBefore[i] - terrainIncision_getBedHeight_internal(&fresh, i);
+    staleErosion += pBefore[i] - staleHeight;
+  }
+
+  TESTABLE_ASSERT_EQUAL(freshErosion > 0, true);
+  TESTABLE_ASSERT_EQUAL(staleErosion > freshErosion * 4 / 5 && staleErosion < freshErosion * 6 / 5, true);
+
+epilogue:
+  lsFreePtr(&pBefore);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&fresh);
+  terrain_destroy(&stale);
+  return result;
+}
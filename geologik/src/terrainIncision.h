@@ -0,0 +1,31 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "terrainFlow.h"
+#include "terrainMaterial.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// River incision with the stream power law: the bed erodes at `K * A^m * S`, with the upstream area `A` and the slope `S` towards the
+// downstream neighbour. Solved implicitly along the drainage network (Braun & Willett 2013), visiting every tile after its receiver,
+// which is stable for arbitrarily long time steps. `K` is scaled by the erodibility of the topmost layer of the bed.
+
+struct terrain_incision_params
+{
+  float timeStep = 1000.f; // in years.
+  float erodibility = 2e-5f; // `K`, per year with lengths in decimeters.
+  float areaExponent = 0.5f; // `m`. the slope exponent is 1, which keeps the implicit solution linear.
+  float upliftRate = 0.f; // in decimeters per year, added to the bedrock.
+  uint32_t flowInterval = 4; // steps between recomputing the drainage network in `terrainIncision_run`. 1 recomputes it every step.
+};
+
+// Erodes `pTerrain` for one time step along `pFlow`, which may have been computed a few steps earlier: tiles that have since dropped below
+// their receiver only get the uplift. The eroded material is carried out of the map. Outlets at the edge of the map are the base level, they neither get the uplift nor erode. Steps are usually much less
+// than a decimeter, so layers without fractions (see `terrain_enableFractions`) round it away.
+lsResult terrainIncision_step(terrain *pTerrain, const terrain_flow *pFlow, const terrain_incision_params *pParams, thread_pool *pPool);
+
+// Erodes for `stepCount` steps, recomputing the drainage network every `flowInterval` steps. The network dominates the cost: on a single
+// core a step takes about 0.9 s for 4096^2 tiles and 3 s for 8192^2, computing the network another 4 s and 17 s.
+lsResult terrainIncision_run(terrain *pTerrain, const terrain_incision_params *pParams, const size_t stepCount, thread_pool *pPool);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Physical properties of the layers. All of them are `constexpr`, so kernels can resolve per-layer decisions at compile time.
+
+struct terrain_material
+{
+  float erodibility; // relative to soil. 0 for layers that flowing water doesn't carry away.
+  float density; // in t/m^3.
+  float talusAngle; // steepest stable slope of loose material, in degrees.
+  float solubility; // relative rate of chemical weathering by water, 1 for limestone.
+};
+
+constexpr terrain_material terrainMaterial_Properties[tt_count] =
+{
+  { 0.0f, 0.3f, 38.f, 0.0f }, // snow
+  { 0.0f, 1.0f, 0.f, 0.0f }, // water
+  { 0.5f, 1.2f, 45.f, 0.0f }, // grass, the roots hold the soil together.
+  { 1.0f, 1.5f, 35.f, 0.01f }, // soil
+  { 2.0f, 1.6f, 33.f, 0.0f }, // sand
+  { 0.4f, 2.6f, 70.f, 1.0f }, // limestone
+  { 0.2f, 2.7f, 80.f, 0.01f }, // stone
+  { 0.0f, 2.8f, 90.f, 0.0f }, // bedrock can't be carried away, see the file format.
+};
+
+// Layers that can be eroded, snow and water aren't part of the bed.
+constexpr size_t terrainMaterial_FirstBedLayer = tt_grass;
+
+// Roots of grass hold the soil below it together, its erodibility is divided by `1 + grass / terrainMaterial_RootDepth`.
+constexpr float terrainMaterial_RootDepth = 2.f; // in decimeters of grass.
+
+inline float terrainMaterial_getRootFactor(const tile *pTile)
+{
+  return 1.f / (1.f + (float)pTile->layerHeights[tt_grass] / terrainMaterial_RootDepth);
+}
+
+// Deposits become soil where there is soil or grass already, otherwise sand, which is the topmost bed layer below soil. The layer order
+// is fixed (see the `README.md`), so on grassed tiles the new soil goes below the grass, which grows through it. On all other tiles it
+// ends up on top of the bed.
+inline terrain_type terrainMaterial_getDepositLayer(const tile *pTile)
+{
+  return (pTile->layerHeights[tt_grass] | pTile->layerHeights[tt_soil]) != 0 ? tt_soil : tt_sand;
+}
@@ -0,0 +1,733 @@
+#include "terrainMultigrid.h"
+
+#include "simd.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// The finest grid has a coefficient per tile and an area of one, the coarser ones have coefficients per edge.
+struct terrain_multigrid_grid
+{
+  size_t width, height;
+  float *pSolutions;
+  const float *pRightHandSides;
+  const float *pCoefficients;
+  const float *pAreas;
+  const float *pEdgesX;
+  const float *pEdgesY;
+  float *pResiduals;
+};
+
+struct terrain_multigrid_context
+{
+  const terrain_multigrid_grid *pGrid;
+  terrain_multigrid_level *pCoarse; // of `pGrid`, for restriction and prolongation.
+  size_t colour; // of the tiles updated by the current relaxation pass, `(x + y) & 1`.
+};
+
+static size_t terrainMultigrid_getBlockCount_internal(const size_t height)
+{
+  return (height + terrain_chunkSize - 1) / terrain_chunkSize;
+}
+
+template <bool Coarse>
+inline float terrainMultigrid_getArea_internal(const terrain_multigrid_grid *pGrid, const size_t i)
+{
+  return Coarse ? pGrid->pAreas[i] : 1.f;
+}
+
+// Between `i` and the tile to its right.
+template <bool Coarse>
+inline float terrainMultigrid_getEdgeX_internal(const terrain_multigrid_grid *pGrid, const size_t i)
+{
+  return Coarse ? pGrid->pEdgesX[i] : 0.5f * (pGrid->pCoefficients[i] + pGrid->pCoefficients[i + 1]);
+}
+
+// Between `i` and the tile below it.
+template <bool Coarse>
+inline float terrainMultigrid_getEdgeY_internal(const terrain_multigrid_grid *pGrid, const size_t i)
+{
+  return Coarse ? pGrid->pEdgesY[i] : 0.5f * (pGrid->pCoefficients[i] + pGrid->pCoefficients[i + pGrid->width]);
+}
+
+// Only reads tiles of the other colour, so the blocks can run in parallel.
+template <bool Coarse>
+static void terrainMultigrid_relax_internal(void *pUserData, const size_t index)
+{
+  const terrain_multigrid_context *pContext = reinterpret_cast<const terrain_multigrid_context *>(pUserData);
+  const terrain_multigrid_grid *pGrid = pContext->pGrid;
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, pGrid->height);
+
+  for (size_t y = index * terrain_chunkSize; y < endY; y++)
+  {
+    for (size_t x = (y + pContext->colour) & 1; x < pGrid->width; x += 2)
+    {
+      const size_t i = y * pGrid->width + x;
+      float weights = terrainMultigrid_getArea_internal<Coarse>(pGrid, i);
+      float sum = pGrid->pRightHandSides[i];
+
+      if (x > 0)
+      {
+        const float edge = terrainMultigrid_getEdgeX_internal<Coarse>(pGrid, i - 1);
+        weights += edge;
+        sum += edge * pGrid->pSolutions[i - 1];
+      }
+
+      if (x + 1 < pGrid->width)
+      {
+        const float edge = terrainMultigrid_getEdgeX_internal<Coarse>(pGrid, i);
+        weights += edge;
+        sum += edge * pGrid->pSolutions[i + 1];
+      }
+
+      if (y > 0)
+      {
+        const float edge = terrainMultigrid_getEdgeY_internal<Coarse>(pGrid, i - pGrid->width);
+        weights += edge;
+        sum += edge * pGrid->pSolutions[i - pGrid->width];
+      }
+
+      if (y + 1 < pGrid->height)
+      {
+        const float edge = terrainMultigrid_getEdgeY_internal<Coarse>(pGrid, i);
+        weights += edge;
+        sum += edge * pGrid->pSolutions[i + pGrid->width];
+      }
+
+      pGrid->pSolutions[i] = sum / weights;
+    }
+  }
+}
+
+template <bool Coarse>
+inline float terrainMultigrid_getResidual_internal(const terrain_multigrid_grid *pGrid, const size_t x, const size_t y)
+{
+  const size_t i = y * pGrid->width + x;
+  const float solution = pGrid->pSolutions[i];
+  float applied = terrainMultigrid_getArea_internal<Coarse>(pGrid, i) * solution;
+
+  if (x > 0)
+    applied += terrainMultigrid_getEdgeX_internal<Coarse>(pGrid, i - 1) * (solution - pGrid->pSolutions[i - 1]);
+
+  if (x + 1 < pGrid->width)
+    applied += terrainMultigrid_getEdgeX_internal<Coarse>(pGrid, i) * (solution - pGrid->pSolutions[i + 1]);
+
+  if (y > 0)
+    applied += terrainMultigrid_getEdgeY_internal<Coarse>(pGrid, i - pGrid->width) * (solution - pGrid->pSolutions[i - pGrid->width]);
+
+  if (y + 1 < pGrid->height)
+    applied += terrainMultigrid_getEdgeY_internal<Coarse>(pGrid, i) * (solution - pGrid->pSolutions[i + pGrid->width]);
+
+  return pGrid->pRightHandSides[i] - applied;
+}
+
+using terrainMultigrid_vec = simd_f32x8;
+constexpr size_t terrainMultigrid_VecLanes = 8;
+
+template <bool Coarse>
+inline terrainMultigrid_vec terrainMultigrid_getEdgesX_internal(const terrain_multigrid_grid *pGrid, const size_t i)
+{
+  if constexpr (Coarse)
+    return simd_load<terrainMultigrid_VecLanes>(pGrid->pEdgesX + i);
+  else
+    return simd_set<terrainMultigrid_VecLanes>(0.5f) * (simd_load<terrainMultigrid_VecLanes>(pGrid->pCoefficients + i) + simd_load<terrainMultigrid_VecLanes>(pGrid->pCoefficients + i + 1));
+}
+
+template <bool Coarse>
+inline terrainMultigrid_vec terrainMultigrid_getEdgesY_internal(const terrain_multigrid_grid *pGrid, const size_t i)
+{
+  if constexpr (Coarse)
+    return simd_load<terrainMultigrid_VecLanes>(pGrid->pEdgesY + i);
+  else
+    return simd_set<terrainMultigrid_VecLanes>(0.5f) * (simd_load<terrainMultigrid_VecLanes>(pGrid->pCoefficients + i) + simd_load<terrainMultigrid_VecLanes>(pGrid->pCoefficients + i + pGrid->width));
+}
+
+// Tiles away from the edges of the grid have all four neighbours, so rows in between are computed a vector at a time. The neighbours to
+// the left and right are shifted in from the vectors before and after.
+template <bool Coarse>
+static void terrainMultigrid_getResiduals_internal(void *pUserData, const size_t index)
+{
+  const terrain_multigrid_context *pContext = reinterpret_cast<const terrain_multigrid_context *>(pUserData);
+  const terrain_multigrid_grid *pGrid = pContext->pGrid;
+  const size_t width = pGrid->width;
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, pGrid->height);
+
+  for (size_t y = index * terrain_chunkSize; y < endY; y++)
+  {
+    size_t x = 0;
+
+    if (y > 0 && y + 1 < pGrid->height && width > terrainMultigrid_VecLanes + 1)
+    {
+      pGrid->pResiduals[y * width] = terrainMultigrid_getResidual_internal<Coarse>(pGrid, 0, y);
+      x = 1;
+
+      // Reads a vector ahead, which stays within the next row.
+      terrainMultigrid_vec previous = simd_load<terrainMultigrid_VecLanes>(pGrid->pSolutions + y * width + x - terrainMultigrid_VecLanes);
+      terrainMultigrid_vec current = simd_load<terrainMultigrid_VecLanes>(pGrid->pSolutions + y * width + x);
+
+      for (; x + terrainMultigrid_VecLanes < width; x += terrainMultigrid_VecLanes)
+      {
+        const size_t i = y * width + x;
+        const terrainMultigrid_vec next = simd_load<terrainMultigrid_VecLanes>(pGrid->pSolutions + i + terrainMultigrid_VecLanes);
+        const terrainMultigrid_vec left = simd_shift<terrainMultigrid_VecLanes - 1>(previous, current);
+        const terrainMultigrid_vec right = simd_shift<1>(current, next);
+
+        terrainMultigrid_vec applied = current;
+
+        if constexpr (Coarse)
+          applied = simd_load<terrainMultigrid_VecLanes>(pGrid->pAreas + i) * current;
+
+        applied += terrainMultigrid_getEdgesX_internal<Coarse>(pGrid, i - 1) * (current - left);
+        applied += terrainMultigrid_getEdgesX_internal<Coarse>(pGrid, i) * (current - right);
+        applied += terrainMultigrid_getEdgesY_internal<Coarse>(pGrid, i - width) * (current - simd_load<terrainMultigrid_VecLanes>(pGrid->pSolutions + i - width));
+        applied += terrainMultigrid_getEdgesY_internal<Coarse>(pGrid, i) * (current - simd_load<terrainMultigrid_VecLanes>(pGrid->pSolutions + i + width));
+
+        simd_store(pGrid->pResiduals + i, simd_load<terrainMultigrid_VecLanes>(pGrid->pRightHandSides + i) - applied);
+
+        previous = current;
+        current = next;
+      }
+    }
+
+    for (; x < width; x++)
+      pGrid->pResiduals[y * width + x] = terrainMultigrid_getResidual_internal<Coarse>(pGrid, x, y);
+  }
+}
+
+// Coarse tiles cover up to 2x2 fine tiles, fewer along the far edges of grids with an odd size. The edges to the right and below add up
+// the fine edges crossing them, divided by the distance between the centres in fine tiles, which is shorter next to tiles cut off.
+// Runs over the blocks of the coarse level.
+template <bool Coarse>
+static void terrainMultigrid_restrictOperator_internal(void *pUserData, const size_t index)
+{
+  const terrain_multigrid_context *pContext = reinterpret_cast<const terrain_multigrid_context *>(pUserData);
+  const terrain_multigrid_grid *pGrid = pContext->pGrid;
+  terrain_multigrid_level *pCoarse = pContext->pCoarse;
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pCoarse->height);
+
+  for (size_t y = index * terrain_chunkSize; y < endY; y++)
+  {
+    const size_t fineEndY = lsMin(y * 2 + 2, pGrid->height);
+
+    for (size_t x = 0; x < pCoarse->width; x++)
+    {
+      const size_t i = y * pCoarse->width + x;
+      const size_t fineEndX = lsMin(x * 2 + 2, pGrid->width);
+      float area = 0;
+      float edgeX = 0;
+      float edgeY = 0;
+
+      for (size_t fineY = y * 2; fineY < fineEndY; fineY++)
+        for (size_t fineX = x * 2; fineX < fineEndX; fineX++)
+          area += terrainMultigrid_getArea_internal<Coarse>(pGrid, fineY * pGrid->width + fineX);
+
+      if (x + 1 < pCoarse->width)
+      {
+        for (size_t fineY = y * 2; fineY < fineEndY; fineY++)
+          edgeX += terrainMultigrid_getEdgeX_internal<Coarse>(pGrid, fineY * pGrid->width + x * 2 + 1);
+
+        edgeX /= 0.5f * (float)(2 + lsMin((size_t)2, pGrid->width - (x + 1) * 2));
+      }
+
+      if (y + 1 < pCoarse->height)
+      {
+        for (size_t fineX = x * 2; fineX < fineEndX; fineX++)
+          edgeY += terrainMultigrid_getEdgeY_internal<Coarse>(pGrid, (y * 2 + 1) * pGrid->width + fineX);
+
+        edgeY /= 0.5f * (float)(2 + lsMin((size_t)2, pGrid->height - (y + 1) * 2));
+      }
+
+      pCoarse->pAreas[i] = area;
+      pCoarse->pEdgesX[i] = edgeX;
+      pCoarse->pEdgesY[i] = edgeY;
+    }
+  }
+}
+
+// Runs over the blocks of the coarse level. The correction starts at zero.
+static void terrainMultigrid_restrictResiduals_internal(void *pUserData, const size_t index)
+{
+  const terrain_multigrid_context *pContext = reinterpret_cast<const terrain_multigrid_context *>(pUserData);
+  const terrain_multigrid_grid *pGrid = pContext->pGrid;
+  terrain_multigrid_level *pCoarse = pContext->pCoarse;
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, (size_t)pCoarse->height);
+
+  for (size_t y = index * terrain_chunkSize; y < endY; y++)
+  {
+    const size_t fineEndY = lsMin(y * 2 + 2, pGrid->height);
+
+    for (size_t x = 0; x < pCoarse->width; x++)
+    {
+      const size_t i = y * pCoarse->width + x;
+      const size_t fineEndX = lsMin(x * 2 + 2, pGrid->width);
+      float sum = 0;
+
+      for (size_t fineY = y * 2; fineY < fineEndY; fineY++)
+        for (size_t fineX = x * 2; fineX < fineEndX; fineX++)
+          sum += pGrid->pResiduals[fineY * pGrid->width + fineX];
+
+      pCoarse->pRightHandSides[i] = sum;
+      pCoarse->pSolutions[i] = 0;
+    }
+  }
+}
+
+// Bilinear between the centres of the coarse tiles, clamped at the edges. Runs over the blocks of the fine level.
+static void terrainMultigrid_prolongate_internal(void *pUserData, const size_t index)
+{
+  const terrain_multigrid_context *pContext = reinterpret_cast<const terrain_multigrid_context *>(pUserData);
+  const terrain_multigrid_grid *pGrid = pContext->pGrid;
+  const terrain_multigrid_level *pCoarse = pContext->pCoarse;
+  const size_t endY = lsMin((index + 1) * terrain_chunkSize, pGrid->height);
+
+  for (size_t y = index * terrain_chunkSize; y < endY; y++)
+  {
+    const size_t coarseY = y / 2;
+    const size_t otherY = (size_t)lsClamp((int64_t)coarseY + ((y & 1) ? 1 : -1), (int64_t)0, (int64_t)pCoarse->height - 1);
+    const float *pRow = pCoarse->pSolutions + coarseY * pCoarse->width;
+    const float *pOtherRow = pCoarse->pSolutions + otherY * pCoarse->width;
+
+    for (size_t x = 0; x < pGrid->width; x++)
+    {
+      const size_t coarseX = x / 2;
+      const size_t otherX = (size_t)lsClamp((int64_t)coarseX + ((x & 1) ? 1 : -1), (int64_t)0, (int64_t)pCoarse->width - 1);
+
+      pGrid->pSolutions[y * pGrid->width + x] += (9.f / 16.f) * pRow[coarseX] + (3.f / 16.f) * (pRow[otherX] + pOtherRow[coarseX]) + (1.f / 16.f) * pOtherRow[otherX];
+    }
+  }
+}
+
+static void terrainMultigrid_smooth_internal(terrain_multigrid_context *pContext, const uint32_t iterations, thread_pool *pPool)
+{
+  const size_t blockCount = terrainMultigrid_getBlockCount_internal(pContext->pGrid->height);
+  const bool coarse = pContext->pGrid->pAreas != nullptr;
+
+  for (uint32_t iteration = 0; iteration < iterations; iteration++)
+  {
+    for (pContext->colour = 0; pContext->colour < 2; pContext->colour++)
+      threadPool_parallelFor(pPool, blockCount, coarse ? terrainMultigrid_relax_internal<true> : terrainMultigrid_relax_internal<false>, pContext);
+  }
+}
+
+// Diffusion only moves values around, so the solution weighted by the areas sums up to the right-hand sides. Relaxation takes very long
+// to get there for large coefficients, but shifting the whole grid by the difference doesn't change any of the differences.
+static void terrainMultigrid_balance_internal(const terrain_multigrid_grid *pGrid)
+{
+  const size_t tileCount = pGrid->width * pGrid->height;
+  const bool coarse = pGrid->pAreas != nullptr;
+  double difference = 0;
+  double area = 0;
+
+  for (size_t i = 0; i < tileCount; i++)
+  {
+    const double tileArea = coarse ? pGrid->pAreas[i] : 1.0;
+
+    difference += (double)pGrid->pRightHandSides[i] - tileArea * pGrid->pSolutions[i];
+    area += tileArea;
+  }
+
+  const float shift = (float)(difference / area);
+
+  for (size_t i = 0; i < tileCount; i++)
+    pGrid->pSolutions[i] += shift;
+}
+
+// Layer moving from `i` to the tile to its right or below it during the step, along the solved surface. Negative if it moves towards `i`.
+inline float terrainMultigrid_getLayerFluxX_internal(const terrain_multigrid_layer *pLayer, const size_t i)
+{
+  return 0.5f * (pLayer->pCoefficients[i] + pLayer->pCoefficients[i + 1]) * (pLayer->pThicknesses[i] - pLayer->pThicknesses[i + 1] - pLayer->pBedSlopesX[i]);
+}
+
+inline float terrainMultigrid_getLayerFluxY_internal(const terrain_multigrid_layer *pLayer, const size_t i)
+{
+  const size_t j = i + pLayer->width;
+  return 0.5f * (pLayer->pCoefficients[i] + pLayer->pCoefficients[j]) * (pLayer->pThicknesses[i] - pLayer->pThicknesses[j] - pLayer->pBedSlopesY[i]);
+}
+
+// Fluxes are scaled by the limiter of the tile they leave.
+inline float terrainMultigrid_limit_internal(const terrain_multigrid_layer *pLayer, const float flux, const size_t from, const size_t to)
+{
+  return flux * (flux > 0 ? pLayer->pLimiters[from] : pLayer->pLimiters[to]);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainMultigrid_init(_Out_ terrain_multigrid *pMultigrid, const size_t width, const size_t height)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pMultigrid == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(width == 0 || height == 0 || width > UINT16_MAX || height > UINT16_MAX, lsR_ArgumentOutOfBounds);
+
+  lsZeroMemory(pMultigrid);
+  pMultigrid->width = (uint16_t)width;
+  pMultigrid->height = (uint16_t)height;
+
+  pMultigrid->levels[0].width = (uint16_t)width;
+  pMultigrid->levels[0].height = (uint16_t)height;
+  pMultigrid->levelCount = 1;
+
+  LS_ERROR_CHECK(lsAlloc(&pMultigrid->levels[0].pResiduals, width * height));
+
+  while (pMultigrid->levelCount < terrainMultigrid_MaxLevels)
+  {
+    const terrain_multigrid_level *pFine = &pMultigrid->levels[pMultigrid->levelCount - 1];
+
+    if (pFine->width <= terrainMultigrid_CoarsestSize && pFine->height <= terrainMultigrid_CoarsestSize)
+      break;
+
+    terrain_multigrid_level *pLevel = &pMultigrid->levels[pMultigrid->levelCount];
+    pLevel->width = (uint16_t)((pFine->width + 1) / 2);
+    pLevel->height = (uint16_t)((pFine->height + 1) / 2);
+    pMultigrid->levelCount++;
+
+    const size_t tileCount = (size_t)pLevel->width * pLevel->height;
+
+    LS_ERROR_CHECK(lsAlloc(&pLevel->pSolutions, tileCount));
+    LS_ERROR_CHECK(lsAlloc(&pLevel->pRightHandSides, tileCount));
+    LS_ERROR_CHECK(lsAlloc(&pLevel->pAreas, tileCount));
+    LS_ERROR_CHECK(lsAlloc(&pLevel->pEdgesX, tileCount));
+    LS_ERROR_CHECK(lsAlloc(&pLevel->pEdgesY, tileCount));
+    LS_ERROR_CHECK(lsAlloc(&pLevel->pResiduals, tileCount));
+  }
+
+epilogue:
+  if (LS_FAILED(result) && pMultigrid != nullptr)
+    terrainMultigrid_destroy(pMultigrid);
+
+  return result;
+}
+
+void terrainMultigrid_destroy(terrain_multigrid *pMultigrid)
+{
+  if (pMultigrid == nullptr)
+    return;
+
+  for (size_t i = 0; i < pMultigrid->levelCount; i++)
+  {
+    lsFreePtr(&pMultigrid->levels[i].pSolutions);
+    lsFreePtr(&pMultigrid->levels[i].pRightHandSides);
+    lsFreePtr(&pMultigrid->levels[i].pAreas);
+    lsFreePtr(&pMultigrid->levels[i].pEdgesX);
+    lsFreePtr(&pMultigrid->levels[i].pEdgesY);
+    lsFreePtr(&pMultigrid->levels[i].pResiduals);
+  }
+
+  pMultigrid->levelCount = 0;
+}
+
+lsResult terrainMultigrid_solve(terrain_multigrid *pMultigrid, float *pSolutions, const float *pRightHandSides, const float *pCoefficients, const terrain_multigrid_params *pParams, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_multigrid_grid grids[terrainMultigrid_MaxLevels];
+  terrain_multigrid_context context = { nullptr, nullptr, 0 };
+  size_t last = 0;
+
+  LS_ERROR_IF(pMultigrid == nullptr || pSolutions == nullptr || pRightHandSides == nullptr || pCoefficients == nullptr || pParams == nullptr || pPool == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pMultigrid->levelCount == 0, lsR_ResourceStateInvalid);
+
+  last = pMultigrid->levelCount - 1;
+  grids[0] = { pMultigrid->width, pMultigrid->height, pSolutions, pRightHandSides, pCoefficients, nullptr, nullptr, nullptr, pMultigrid->levels[0].pResiduals };
+
+  for (size_t level = 1; level <= last; level++)
+  {
+    terrain_multigrid_level *pLevel = &pMultigrid->levels[level];
+    grids[level] = { pLevel->width, pLevel->height, pLevel->pSolutions, pLevel->pRightHandSides, nullptr, pLevel->pAreas, pLevel->pEdgesX, pLevel->pEdgesY, pLevel->pResiduals };
+
+    context.pGrid = &grids[level - 1];
+    context.pCoarse = pLevel;
+    threadPool_parallelFor(pPool, terrainMultigrid_getBlockCount_internal(pLevel->height), level > 1 ? terrainMultigrid_restrictOperator_internal<true> : terrainMultigrid_restrictOperator_internal<false>, &context);
+  }
+
+  for (uint32_t cycle = 0; cycle < pParams->cycles; cycle++)
+  {
+    for (size_t level = 0; level < last; level++)
+    {
+      context.pGrid = &grids[level];
+      context.pCoarse = &pMultigrid->levels[level + 1];
+
+      terrainMultigrid_smooth_internal(&context, pParams->smoothingIterations, pPool);
+      threadPool_parallelFor(pPool, terrainMultigrid_getBlockCount_internal(grids[level].height), level > 0 ? terrainMultigrid_getResiduals_internal<true> : terrainMultigrid_getResiduals_internal<false>, &context);
+      threadPool_parallelFor(pPool, terrainMultigrid_getBlockCount_internal(grids[level + 1].height), terrainMultigrid_restrictResiduals_internal, &context);
+    }
+
+    context.pGrid = &grids[last];
+    terrainMultigrid_smooth_internal(&context, pParams->coarsestIterations, pPool);
+    terrainMultigrid_balance_internal(&grids[last]);
+
+    for (size_t level = last; level-- > 0;)
+    {
+      context.pGrid = &grids[level];
+      context.pCoarse = &pMultigrid->levels[level + 1];
+
+      threadPool_parallelFor(pPool, terrainMultigrid_getBlockCount_internal(grids[level].height), terrainMultigrid_prolongate_internal, &context);
+      terrainMultigrid_smooth_internal(&context, pParams->smoothingIterations, pPool);
+    }
+  }
+
+epilogue:
+  return result;
+}
+
+lsResult terrainMultigrid_initLayer(_Out_ terrain_multigrid_layer *pLayer, const uint16_t width, const uint16_t height)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pLayer == nullptr, lsR_ArgumentNull);
+
+  lsZeroMemory(pLayer);
+  pLayer->width = width;
+  pLayer->height = height;
+
+  LS_ERROR_CHECK(lsAlloc(&pLayer->pThicknesses, (size_t)width * height));
+  LS_ERROR_CHECK(lsAlloc(&pLayer->pBedSlopesX, (size_t)width * height));
+  LS_ERROR_CHECK(lsAlloc(&pLayer->pBedSlopesY, (size_t)width * height));
+  LS_ERROR_CHECK(lsAlloc(&pLayer->pCoefficients, (size_t)width * height));
+  LS_ERROR_CHECK(lsAlloc(&pLayer->pRightHandSides, (size_t)width * height));
+  LS_ERROR_CHECK(lsAlloc(&pLayer->pLimiters, (size_t)width * height));
+
+epilogue:
+  if (LS_FAILED(result) && pLayer != nullptr)
+    terrainMultigrid_destroyLayer(pLayer);
+
+  return result;
+}
+
+void terrainMultigrid_destroyLayer(terrain_multigrid_layer *pLayer)
+{
+  if (pLayer == nullptr)
+    return;
+
+  lsFreePtr(&pLayer->pThicknesses);
+  lsFreePtr(&pLayer->pBedSlopesX);
+  lsFreePtr(&pLayer->pBedSlopesY);
+  lsFreePtr(&pLayer->pCoefficients);
+  lsFreePtr(&pLayer->pRightHandSides);
+  lsFreePtr(&pLayer->pLimiters);
+}
+
+// The coefficient between two tiles is the mean of both. `x_i + sum(k_ij * (x_i - x_j)) = x_old + sum(k_ij * (b_j - b_i))`.
+void terrainMultigrid_getLayerRightHandSides(terrain_multigrid_layer *pLayer, const size_t startY, const size_t endY)
+{
+  const size_t width = pLayer->width;
+
+  for (size_t y = startY; y < endY; y++)
+  {
+    for (size_t x = 0; x < width; x++)
+    {
+      const size_t i = y * width + x;
+      const float coefficient = pLayer->pCoefficients[i];
+      float sum = 0;
+
+      if (x > 0)
+        sum -= (coefficient + pLayer->pCoefficients[i - 1]) * pLayer->pBedSlopesX[i - 1];
+
+      if (x + 1 < width)
+        sum += (coefficient + pLayer->pCoefficients[i + 1]) * pLayer->pBedSlopesX[i];
+
+      if (y > 0)
+        sum -= (coefficient + pLayer->pCoefficients[i - width]) * pLayer->pBedSlopesY[i - width];
+
+      if (y + 1 < pLayer->height)
+        sum += (coefficient + pLayer->pCoefficients[i + width]) * pLayer->pBedSlopesY[i];
+
+      pLayer->pRightHandSides[i] = pLayer->pThicknesses[i] + 0.5f * sum;
+    }
+  }
+}
+
+void terrainMultigrid_getLayerLimiters(terrain_multigrid_layer *pLayer, const terrain *pTerrain, const terrain_type type, const size_t startY, const size_t endY)
+{
+  const size_t width = pLayer->width;
+
+  for (size_t y = startY; y < endY; y++)
+  {
+    for (size_t x = 0; x < width; x++)
+    {
+      const size_t i = y * width + x;
+      float outflow = 0;
+
+      if (x > 0)
+        outflow += lsMax(0.f, -terrainMultigrid_getLayerFluxX_internal(pLayer, i - 1));
+
+      if (x + 1 < width)
+        outflow += lsMax(0.f, terrainMultigrid_getLayerFluxX_internal(pLayer, i));
+
+      if (y > 0)
+        outflow += lsMax(0.f, -terrainMultigrid_getLayerFluxY_internal(pLayer, i - width));
+
+      if (y + 1 < pLayer->height)
+        outflow += lsMax(0.f, terrainMultigrid_getLayerFluxY_internal(pLayer, i));
+
+      const float available = (float)terrain_getFixedHeight(pTerrain, i, type) / terrain_fixedOne;
+      pLayer->pLimiters[i] = outflow > available ? available / outflow : 1.f;
+    }
+  }
+}
+
+float terrainMultigrid_getLayerOutflow(const terrain_multigrid_layer *pLayer, const size_t x, const size_t y)
+{
+  const size_t width = pLayer->width;
+  const size_t i = y * width + x;
+  float outflow = 0;
+
+  if (x > 0)
+    outflow -= terrainMultigrid_limit_internal(pLayer, terrainMultigrid_getLayerFluxX_internal(pLayer, i - 1), i - 1, i);
+
+  if (x + 1 < width)
+    outflow += terrainMultigrid_limit_internal(pLayer, terrainMultigrid_getLayerFluxX_internal(pLayer, i), i, i + 1);
+
+  if (y > 0)
+    outflow -= terrainMultigrid_limit_internal(pLayer, terrainMultigrid_getLayerFluxY_internal(pLayer, i - width), i - width, i);
+
+  if (y + 1 < pLayer->height)
+    outflow += terrainMultigrid_limit_internal(pLayer, terrainMultigrid_getLayerFluxY_internal(pLayer, i), i, i + width);
+
+  return outflow;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(19)
+
+// Largest residual of `pSolutions`, see `terrainMultigrid_getResiduals_internal`.
+static float terrainMultigrid_getMaxResidual_internal(const size_t width, const size_t height, float *pSolutions, const float *pRightHandSides, const float *pCoefficients, float *pResiduals)
+{
+  const terrain_multigrid_grid grid = { width, height, pSolutions, pRightHandSides, pCoefficients, nullptr, nullptr, nullptr, pResiduals };
+  terrain_multigrid_context context = { &grid, nullptr, 0 };
+  float maxResidual = 0;
+
+  for (size_t i = 0; i < terrainMultigrid_getBlockCount_internal(height); i++)
+    terrainMultigrid_getResiduals_internal<false>(&context, i);
+
+  for (size_t i = 0; i < width * height; i++)
+    maxResidual = lsMax(maxResidual, fabsf(pResiduals[i]));
+
+  return maxResidual;
+}
+
+DEFINE_TESTABLE(terrainMultigrid_TestConvergence)
+{
+  lsResult result = lsR_Success;
+
+  terrain_multigrid multigrid;
+  lsZeroMemory(&multigrid);
+
+  thread_pool *pPool = nullptr;
+  float *pSolutions = nullptr;
+  float *pRelaxed = nullptr;
+  float *pRightHandSides = nullptr;
+  float *pCoefficients = nullptr;
+  float *pResiduals = nullptr;
+
+  terrain_multigrid_params params;
+  params.cycles = 6;
+
+  constexpr size_t width = 201;
+  constexpr size_t height = 130;
+  rand_seed seed(5, 9);
+  float initialResidual = 0;
+  double massBefore = 0;
+  double massAfter = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 3));
+  TESTABLE_ASSERT_SUCCESS(terrainMultigrid_init(&multigrid, width, height));
+  TESTABLE_ASSERT_SUCCESS(lsAllocZero(&pSolutions, width * height));
+  TESTABLE_ASSERT_SUCCESS(lsAllocZero(&pRelaxed, width * height));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pRightHandSides, width * height));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pCoefficients, width * height));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pResiduals, width * height));
+
+  TESTABLE_ASSERT_EQUAL(multigrid.levelCount, 6u);
+  TESTABLE_ASSERT_EQUAL(multigrid.levels[5].width, 7);
+  TESTABLE_ASSERT_EQUAL(multigrid.levels[5].height, 5);
+
+  // Random heights with stiff diffusion increasing towards the east. There is none at all in the west.
+  for (size_t i = 0; i < width * height; i++)
+  {
+    pRightHandSides[i] = (float)(lsGetRand(seed) % 1000);
+    pCoefficients[i] = (i % width < 40) ? 0.f : 1000.f * (1.f + 3.f * (float)(i % width) / width + (float)((i / width) % 16) / 16.f);
+    massBefore += pRightHandSides[i];
+  }
+
+  initialResidual = terrainMultigrid_getMaxResidual_internal(width, height, pSolutions, pRightHandSides, pCoefficients, pResiduals);
+
+  TESTABLE_ASSERT_SUCCESS(terrainMultigrid_solve(&multigrid, pSolutions, pRightHandSides, pCoefficients, &params, pPool));
+  TESTABLE_ASSERT_EQUAL(terrainMultigrid_getMaxResidual_internal(width, height, pSolutions, pRightHandSides, pCoefficients, pResiduals) < initialResidual * 1e-2f, true);
+
+  // The vectorized rows match the tiles one by one, up to rounding.
+  {
+    const terrain_multigrid_grid grid = { width, height, pSolutions, pRightHandSides, pCoefficients, nullptr, nullptr, nullptr, pResiduals };
+
+    for (size_t y = 0; y < height; y++)
+      for (size_t x = 0; x < width; x++)
+        TESTABLE_ASSERT_EQUAL(fabsf(pResiduals[y * width + x] - terrainMultigrid_getResidual_internal<false>(&grid, x, y)) < initialResidual * 1e-4f, true);
+  }
+
+  // Diffusion moves the heights around without changing their sum. Tiles without diffusion keep theirs.
+  for (size_t i = 0; i < width * height; i++)
+    massAfter += pSolutions[i];
+
+  TESTABLE_ASSERT_EQUAL(fabs(massAfter - massBefore) < massBefore * 1e-4, true);
+  TESTABLE_ASSERT_EQUAL(pSolutions[10 * width + 5], pRightHandSides[10 * width + 5]);
+  TESTABLE_ASSERT_EQUAL(fabsf(pSolutions[10 * width + 150] - pSolutions[12 * width + 152]) < 10.f, true);
+
+  // Plain red-black Gauss-Seidel with much more work doesn't get anywhere close.
+  {
+    const terrain_multigrid_grid grid = { width, height, pRelaxed, pRightHandSides, pCoefficients, nullptr, nullptr, nullptr, pResiduals };
+    terrain_multigrid_context context = { &grid, nullptr, 0 };
+
+    terrainMultigrid_smooth_internal(&context, 200, pPool);
+    TESTABLE_ASSERT_EQUAL(terrainMultigrid_getMaxResidual_internal(width, height, pRelaxed, pRightHandSides, pCoefficients, pResiduals) > initialResidual * 1e-2f, true);
+  }
+
+epilogue:
+  lsFreePtr(&pSolutions);
+  lsFreePtr(&pRelaxed);
+  lsFreePtr(&pRightHandSides);
+  lsFreePtr(&pCoefficients);
+  lsFreePtr(&pResiduals);
+  terrainMultigrid_destroy(&multigrid);
+  threadPool_destroy(&pPool);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainMultigrid_TestSmallGrid)
+{
+  lsResult result = lsR_Success;
+
+  terrain_multigrid multigrid;
+  lsZeroMemory(&multigrid);
+
+  thread_pool *pPool = nullptr;
+  terrain_multigrid_params params;
+
+  // A single level is solved by relaxation alone.
+  float solutions[3 * 2] = {};
+  float rightHandSides[3 * 2] = { 6, 0, 0, 0, 0, 0 };
+  float coefficients[3 * 2] = { 0, 0, 0, 0, 0, 0 };
+  float residuals[3 * 2];
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 1));
+  TESTABLE_ASSERT_FAILURE(terrainMultigrid_init(&multigrid, 0, 4));
+  TESTABLE_ASSERT_SUCCESS(terrainMultigrid_init(&multigrid, 3, 2));
+  TESTABLE_ASSERT_EQUAL(multigrid.levelCount, 1u);
+
+  // Without diffusion, nothing moves.
+  TESTABLE_ASSERT_SUCCESS(terrainMultigrid_solve(&multigrid, solutions, rightHandSides, coefficients, &params, pPool));
+  TESTABLE_ASSERT_EQUAL(solutions[0], 6.f);
+  TESTABLE_ASSERT_EQUAL(solutions[1], 0.f);
+
+  for (size_t i = 0; i < 3 * 2; i++)
+    coefficients[i] = 1e4f;
+
+  TESTABLE_ASSERT_SUCCESS(terrainMultigrid_solve(&multigrid, solutions, rightHandSides, coefficients, &params, pPool));
+  TESTABLE_ASSERT_EQUAL(terrainMultigrid_getMaxResidual_internal(3, 2, solutions, rightHandSides, coefficients, residuals) < 1e-2f, true);
+  TESTABLE_ASSERT_EQUAL(fabsf(solutions[5] - 1.f) < 1e-2f, true);
+
+epilogue:
+  terrainMultigrid_destroy(&multigrid);
+  threadPool_destroy(&pPool);
+  return result;
+}
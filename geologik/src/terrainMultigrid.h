@@ -0,0 +1,76 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Geometric multigrid for implicit diffusion on height planes: solves `x_i + sum_j k_ij * (x_i - x_j) = b_i` over the four direct
+// neighbours `j` of each tile, with `k_ij = (k_i + k_j) / 2` and nothing flowing across the edges of the map. That's one backward Euler
+// step of `dx/dt = div(D * grad(x))` for `k = D * dt / terrain_tileSize^2`.
+// Red-black Gauss-Seidel only smoothes the error locally, so a V-cycle restricts the residual onto a pyramid of grids with half the
+// size each, where the remaining error is local again, and adds the corrections back bilinearly. The work stays linear in the tiles
+// however large `k` gets. The coarser grids sum up the areas and the coefficients along the edges of the tiles they cover, so tiles cut
+// off at the edges of odd sized grids and barriers of `k = 0` are represented as well as the resolution allows.
+
+constexpr size_t terrainMultigrid_MaxLevels = 16;
+constexpr size_t terrainMultigrid_CoarsestSize = 8; // the pyramid stops at grids no larger than this in both directions.
+
+struct terrain_multigrid_params
+{
+  uint32_t cycles = 2; // V-cycles, each usually reduces the error by an order of magnitude.
+  uint32_t smoothingIterations = 2; // red-black Gauss-Seidel iterations before and after the correction from the coarser grid.
+  uint32_t coarsestIterations = 32; // on the coarsest grid.
+};
+
+struct terrain_multigrid_level
+{
+  uint16_t width, height;
+  float *pSolutions; // corrections on the coarser levels.
+  float *pRightHandSides; // residuals of the covered tiles, summed up. the equations are scaled by `pAreas`.
+  float *pAreas; // tiles of the finest level covered by each tile.
+  float *pEdgesX; // `k` between each tile and the one to its right, from those along the edge on the finer level.
+  float *pEdgesY; // `k` between each tile and the one below it.
+  float *pResiduals;
+};
+
+struct terrain_multigrid
+{
+  uint16_t width, height;
+  size_t levelCount;
+  terrain_multigrid_level levels[terrainMultigrid_MaxLevels]; // the finest one only has `pResiduals`, the rest is passed to `terrainMultigrid_solve`.
+};
+
+lsResult terrainMultigrid_init(_Out_ terrain_multigrid *pMultigrid, const size_t width, const size_t height);
+void terrainMultigrid_destroy(terrain_multigrid *pMultigrid);
+
+// Improves `pSolutions` in place, which should hold an initial guess like the previous state. All arrays have a value per tile.
+lsResult terrainMultigrid_solve(terrain_multigrid *pMultigrid, float *pSolutions, const float *pRightHandSides, const float *pCoefficients, const terrain_multigrid_params *pParams, thread_pool *pPool);
+
+// A layer lying on a bed, like ice or soil, whose surface `x + b` diffuses: the thickness `x` is solved for with `b_j - b_i` added to the
+// right-hand sides. The solution can undershoot to negative thickness where the layer runs out, and clamping it would add material, so
+// the layer is moved by the fluxes between the tiles of the solution instead, limited to what each tile had before the step. This
+// conserves it exactly. Bed heights are passed as differences, so they stay precise however high the terrain is.
+struct terrain_multigrid_layer
+{
+  uint16_t width, height;
+  float *pThicknesses; // in decimeters, solved for in place.
+  float *pBedSlopesX; // bed height of the tile to the right minus that of each tile, in decimeters.
+  float *pBedSlopesY; // the same towards the tile below.
+  float *pCoefficients; // `k`.
+  float *pRightHandSides;
+  float *pLimiters; // share of the outflow of each tile that it has the layer for.
+};
+
+lsResult terrainMultigrid_initLayer(_Out_ terrain_multigrid_layer *pLayer, const uint16_t width, const uint16_t height);
+void terrainMultigrid_destroyLayer(terrain_multigrid_layer *pLayer);
+
+// The following work on the rows from `startY` to `endY`, so they can be called from the blocks of a parallel pass.
+void terrainMultigrid_getLayerRightHandSides(terrain_multigrid_layer *pLayer, const size_t startY, const size_t endY);
+
+// After the solve, from what each tile has of `type` in `pTerrain` before the step.
+void terrainMultigrid_getLayerLimiters(terrain_multigrid_layer *pLayer, const terrain *pTerrain, const terrain_type type, const size_t startY, const size_t endY);
+
+// Net limited flux out of a tile during the step, in decimeters. Needs the limiters of its neighbours.
+float terrainMultigrid_getLayerOutflow(const terrain_multigrid_layer *pLayer, const size_t x, const size_t y);
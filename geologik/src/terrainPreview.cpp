@@ -0,0 +1,571 @@
+#include "terrainPreview.h"
+#include "terrainColumns.h"
+#include "vmathBatch.h"
+#include "threadPool.h"
+#include "pngWriter.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+const vec3f terrainPreview_LayerColors[tt_count] =
+{
+  vec3f(1.f, 1.f, 1.f), // snow
+  vec3f(0.f, 0.f, 0.6f), // water
+  vec3f(0.f, 0.6f, 0.f), // grass
+  vec3f(0.4f, 0.4f, 0.f), // soil
+  vec3f(0.6f, 0.4f, 0.1f), // sand
+  vec3f(0.7f, 0.7f, 0.7f), // limestone
+  vec3f(0.4f, 0.4f, 0.4f), // stone
+  vec3f(0.1f, 0.1f, 0.1f), // bedrock
+};
+
+constexpr float_t terrainPreview_Ambient = 0.35f;
+constexpr size_t terrainPreview_RowsPerTask = 16;
+constexpr float_t terrainPreview_MinW = 1e-5f;
+
+struct terrain_preview_vertex
+{
+  float_t x, y, z; // in pixels, z in [0, 1].
+  bool visible; // false if behind the camera.
+};
+
+struct terrain_preview_rect
+{
+  int64_t x0, y0, x1, y1; // in pixels. `x1`, `y1` exclusive.
+};
+
+struct terrain_preview_context
+{
+  const terrain *pTerrain;
+  matrix viewProjection;
+  frustum viewFrustum;
+  vec2s size;
+  float_t heightScale;
+  vec3f lightDirection;
+
+  uint32_t *pHeights; // sum of all layers.
+  uint8_t *pTopLayers;
+  uint32_t *pColors; // of the quad to the bottom right of the tile.
+  terrain_preview_vertex *pVertices;
+  vec3f *pChunkMins; // bounds of the tiles reached by the quads of each chunk.
+  vec3f *pChunkMaxs;
+  bool *pChunkVisible; // whether the bounds intersect `viewFrustum`.
+  terrain_preview_rect *pChunkRects;
+  size_t screenTileCountX;
+  size_t screenTileCountY;
+  uint32_t *pScreenTileChunkOffsets; // per screen tile into `pScreenTileChunks`, plus one past the last.
+  uint32_t *pScreenTileChunks; // chunks whose rect overlaps each screen tile, in chunk order.
+
+  uint32_t *pPixels;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+static void terrainPreview_project_internal(const terrain_preview_context *pContext, const float_t x, const float_t y, const float_t z, _Out_ terrain_preview_vertex *pVertex)
+{
+  const matrix &m = pContext->viewProjection;
+
+  // row vectors, like `vec::Transform4`.
+  const float_t cx = x * m._11 + y * m._21 + z * m._31 + m._41;
+  const float_t cy = x * m._12 + y * m._22 + z * m._32 + m._42;
+  const float_t cz = x * m._13 + y * m._23 + z * m._33 + m._43;
+  const float_t cw = x * m._14 + y * m._24 + z * m._34 + m._44;
+
+  pVertex->visible = cw > terrainPreview_MinW;
+
+  if (!pVertex->visible)
+    return;
+
+  const float_t invW = 1.f / cw;
+
+  pVertex->x = (cx * invW * 0.5f + 0.5f) * (float_t)pContext->size.x;
+  pVertex->y = (0.5f - cy * invW * 0.5f) * (float_t)pContext->size.y;
+  pVertex->z = cz * invW;
+}
+
+// `terrainPreview_project_internal` for a row of tiles, `vmathBatch_Lanes` at a time.
+static void terrainPreview_projectRow_internal(const terrain_preview_context *pContext, const size_t y)
+{
+  const size_t width = pContext->pTerrain->width;
+  const batch_lanes half = simd_set<vmathBatch_Lanes>(0.5f);
+
+  for (size_t x = 0; x < width; x += vmathBatch_Lanes)
+  {
+    const size_t count = lsMin(width - x, vmathBatch_Lanes);
+
+    float_t positionsX[vmathBatch_Lanes];
+    float_t positionsZ[vmathBatch_Lanes];
+
+    for (size_t lane = 0; lane < vmathBatch_Lanes; lane++) // repeats the last tile past the end of the row.
+    {
+      positionsX[lane] = (float_t)(x + lane);
+      positionsZ[lane] = (float_t)pContext->pHeights[y * width + x + lsMin(lane, count - 1)] * pContext->heightScale;
+    }
+
+    const vec3_batch position = { simd_load<vmathBatch_Lanes>(positionsX), simd_set<vmathBatch_Lanes>((float_t)y), simd_load<vmathBatch_Lanes>(positionsZ) };
+    const vec4_batch clip = position.Transform(pContext->viewProjection);
+    const uint32_t visible = simd_getMaskBits(simd_greater(clip.w, simd_set<vmathBatch_Lanes>(terrainPreview_MinW)));
+    const batch_lanes invW = simd_set<vmathBatch_Lanes>(1.f) / clip.w; // garbage behind the camera, but those aren't used.
+
+    float_t screenX[vmathBatch_Lanes];
+    float_t screenY[vmathBatch_Lanes];
+    float_t screenZ[vmathBatch_Lanes];
+    simd_store(screenX, (clip.x * invW * half + half) * simd_set<vmathBatch_Lanes>((float_t)pContext->size.x));
+    simd_store(screenY, (half - clip.y * invW * half) * simd_set<vmathBatch_Lanes>((float_t)pContext->size.y));
+    simd_store(screenZ, clip.z * invW);
+
+    for (size_t lane = 0; lane < count; lane++)
+    {
+      terrain_preview_vertex &vertex = pContext->pVertices[y * width + x + lane];
+      vertex.x = screenX[lane];
+      vertex.y = screenY[lane];
+      vertex.z = screenZ[lane];
+      vertex.visible = (visible >> lane) & 1;
+    }
+  }
+}
+
+static void terrainPreview_heights_internal(void *pUserData, const size_t index)
+{
+  terrain_preview_context *pContext = reinterpret_cast<terrain_preview_context *>(pUserData);
+  const terrain *pTerrain = pContext->pTerrain;
+
+  const size_t y0 = index * terrainPreview_RowsPerTask;
+  const size_t y1 = lsMin(y0 + terrainPreview_RowsPerTask, (size_t)pTerrain->height);
+
+  terrainColumns_compute(pTerrain, 0, y0, pTerrain->width, y1 - y0, pContext->pHeights + y0 * pTerrain->width, pContext->pTopLayers + y0 * pTerrain->width, pTerrain->width);
+}
+
+static void terrainPreview_shadeAndProject_internal(void *pUserData, const size_t index)
+{
+  terrain_preview_context *pContext = reinterpret_cast<terrain_preview_context *>(pUserData);
+  const terrain *pTerrain = pContext->pTerrain;
+  const size_t width = pTerrain->width;
+  const size_t height = pTerrain->height;
+
+  const size_t y0 = index * terrainPreview_RowsPerTask;
+  const size_t y1 = lsMin(y0 + terrainPreview_RowsPerTask, height);
+
+  for (size_t y = y0; y < y1; y++)
+  {
+    const size_t yUp = y > 0 ? y - 1 : y;
+    const size_t yDown = y + 1 < height ? y + 1 : y;
+
+    for (size_t x = 0; x < width; x++)
+    {
+      const size_t i = y * width + x;
+      const size_t xLeft = x > 0 ? x - 1 : x;
+      const size_t xRight = x + 1 < width ? x + 1 : x;
+
+      // Hillshade from the central difference normal.
+      const float_t dx = xRight == xLeft ? 0.f : ((float_t)pContext->pHeights[y * width + xRight] - (float_t)pContext->pHeights[y * width + xLeft]) * pContext->heightScale / (float_t)(xRight - xLeft);
+      const float_t dy = yDown == yUp ? 0.f : ((float_t)pContext->pHeights[yDown * width + x] - (float_t)pContext->pHeights[yUp * width + x]) * pContext->heightScale / (float_t)(yDown - yUp);
+      const vec3f normal = vec3f(-dx, -dy, 1.f).Normalize();
+      const float_t light = lsMax(0.f, normal.x * pContext->lightDirection.x + normal.y * pContext->lightDirection.y + normal.z * pContext->lightDirection.z);
+      const float_t shade = terrainPreview_Ambient + (1.f - terrainPreview_Ambient) * light;
+
+      const size_t topLayer = lsMin((size_t)pContext->pTopLayers[i], (size_t)tt_bedrock); // empty tiles are shown as bedrock.
+      const vec3f color = terrainPreview_LayerColors[topLayer] * shade;
+      pContext->pColors[i] = (uint32_t)(color.x * 255.f) | ((uint32_t)(color.y * 255.f) << 8) | ((uint32_t)(color.z * 255.f) << 16) | 0xFF000000;
+    }
+
+    terrainPreview_projectRow_internal(pContext, y);
+  }
+}
+
+static void terrainPreview_chunkBounds_internal(void *pUserData, const size_t index)
+{
+  terrain_preview_context *pContext = reinterpret_cast<terrain_preview_context *>(pUserData);
+  const terrain *pTerrain = pContext->pTerrain;
+
+  const size_t chunkX = index % pTerrain->chunkCountX;
+  const size_t chunkY = index / pTerrain->chunkCountX;
+
+  // Quads reach into the next chunk by one tile.
+  const size_t x0 = chunkX * terrain_chunkSize;
+  const size_t y0 = chunkY * terrain_chunkSize;
+  const size_t x1 = lsMin(x0 + terrain_chunkSize + 1, (size_t)pTerrain->width);
+  const size_t y1 = lsMin(y0 + terrain_chunkSize + 1, (size_t)pTerrain->height);
+
+  uint32_t minHeight = UINT32_MAX;
+  uint32_t maxHeight = 0;
+
+  for (size_t y = y0; y < y1; y++)
+  {
+    for (size_t x = x0; x < x1; x++)
+    {
+      const uint32_t h = pContext->pHeights[y * pTerrain->width + x];
+      minHeight = lsMin(minHeight, h);
+      maxHeight = lsMax(maxHeight, h);
+    }
+  }
+
+  pContext->pChunkMins[index] = vec3f((float_t)x0, (float_t)y0, (float_t)minHeight * pContext->heightScale);
+  pContext->pChunkMaxs[index] = vec3f((float_t)(x1 - 1), (float_t)(y1 - 1), (float_t)maxHeight * pContext->heightScale);
+}
+
+static void terrainPreview_chunkRect_internal(void *pUserData, const size_t index)
+{
+  terrain_preview_context *pContext = reinterpret_cast<terrain_preview_context *>(pUserData);
+
+  terrain_preview_rect &rect = pContext->pChunkRects[index];
+
+  if (!pContext->pChunkVisible[index]) // doesn't overlap any screen tile.
+  {
+    rect.x0 = rect.y0 = rect.x1 = rect.y1 = 0;
+    return;
+  }
+
+  const vec3f &min = pContext->pChunkMins[index];
+  const vec3f &max = pContext->pChunkMaxs[index];
+
+  rect.x0 = rect.y0 = INT64_MAX;
+  rect.x1 = rect.y1 = INT64_MIN;
+
+  for (size_t corner = 0; corner < 8; corner++)
+  {
+    terrain_preview_vertex v;
+    terrainPreview_project_internal(pContext, (corner & 1) ? max.x : min.x, (corner & 2) ? max.y : min.y, (corner & 4) ? max.z : min.z, &v);
+
+    if (!v.visible) // partially behind the camera, be conservative.
+    {
+      rect.x0 = rect.y0 = 0;
+      rect.x1 = (int64_t)pContext->size.x;
+      rect.y1 = (int64_t)pContext->size.y;
+      return;
+    }
+
+    rect.x0 = lsMin(rect.x0, (int64_t)floorf(v.x));
+    rect.y0 = lsMin(rect.y0, (int64_t)floorf(v.y));
+    rect.x1 = lsMax(rect.x1, (int64_t)ceilf(v.x) + 1);
+    rect.y1 = lsMax(rect.y1, (int64_t)ceilf(v.y) + 1);
+  }
+}
+
+// The screen tiles covered by the rect of `chunk`, `x1` and `y1` exclusive. Empty if the rect is off screen.
+static terrain_preview_rect terrainPreview_getScreenTiles_internal(const terrain_preview_context *pContext, const size_t chunk)
+{
+  const terrain_preview_rect &rect = pContext->pChunkRects[chunk];
+  const int64_t x0 = lsMax(rect.x0, (int64_t)0);
+  const int64_t y0 = lsMax(rect.y0, (int64_t)0);
+  const int64_t x1 = lsMin(rect.x1, (int64_t)pContext->size.x);
+  const int64_t y1 = lsMin(rect.y1, (int64_t)pContext->size.y);
+
+  terrain_preview_rect tiles = { 0, 0, 0, 0 };
+
+  if (x0 >= x1 || y0 >= y1)
+    return tiles;
+
+  tiles.x0 = x0 / (int64_t)terrainPreview_ScreenTileSize;
+  tiles.y0 = y0 / (int64_t)terrainPreview_ScreenTileSize;
+  tiles.x1 = (x1 - 1) / (int64_t)terrainPreview_ScreenTileSize + 1;
+  tiles.y1 = (y1 - 1) / (int64_t)terrainPreview_ScreenTileSize + 1;
+
+  return tiles;
+}
+
+// Lists the chunks overlapping each screen tile, so screen tiles don't have to test every chunk.
+static lsResult terrainPreview_binChunks_internal(terrain_preview_context *pContext, const size_t chunkCount)
+{
+  lsResult result = lsR_Success;
+
+  const size_t screenTileCount = pContext->screenTileCountX * pContext->screenTileCountY;
+
+  LS_ERROR_CHECK(lsAllocZero(&pContext->pScreenTileChunkOffsets, screenTileCount + 1));
+
+  for (size_t chunk = 0; chunk < chunkCount; chunk++)
+  {
+    const terrain_preview_rect tiles = terrainPreview_getScreenTiles_internal(pContext, chunk);
+
+    for (int64_t y = tiles.y0; y < tiles.y1; y++)
+      for (int64_t x = tiles.x0; x < tiles.x1; x++)
+        pContext->pScreenTileChunkOffsets[(size_t)y * pContext->screenTileCountX + (size_t)x]++;
+  }
+
+  // Turns the counts into the end of each list.
+  for (size_t i = 1; i <= screenTileCount; i++)
+    pContext->pScreenTileChunkOffsets[i] += pContext->pScreenTileChunkOffsets[i - 1];
+
+  LS_ERROR_CHECK(lsAlloc(&pContext->pScreenTileChunks, lsMax((size_t)pContext->pScreenTileChunkOffsets[screenTileCount], (size_t)1)));
+
+  // Filled back to front, so each list ends up in chunk order and the offsets move to the start of each list.
+  for (size_t chunk = chunkCount; chunk-- > 0;)
+  {
+    const terrain_preview_rect tiles = terrainPreview_getScreenTiles_internal(pContext, chunk);
+
+    for (int64_t y = tiles.y0; y < tiles.y1; y++)
+      for (int64_t x = tiles.x0; x < tiles.x1; x++)
+        pContext->pScreenTileChunks[--pContext->pScreenTileChunkOffsets[(size_t)y * pContext->screenTileCountX + (size_t)x]] = (uint32_t)chunk;
+  }
+
+epilogue:
+  return result;
+}
+
+static void terrainPreview_rasterizeTriangle_internal(const terrain_preview_vertex &a, const terrain_preview_vertex *pB, const terrain_preview_vertex *pC, const uint32_t color, const terrain_preview_rect &tile, float_t *pDepth, uint32_t *pColor)
+{
+  float_t area = (pB->x - a.x) * (pC->y - a.y) - (pB->y - a.y) * (pC->x - a.x);
+
+  if (area == 0)
+    return;
+
+  if (area < 0)
+  {
+    std::swap(pB, pC);
+    area = -area;
+  }
+
+  const terrain_preview_vertex &b = *pB;
+  const terrain_preview_vertex &c = *pC;
+
+  const int64_t minX = lsMax(tile.x0, (int64_t)floorf(lsMin(a.x, lsMin(b.x, c.x))));
+  const int64_t minY = lsMax(tile.y0, (int64_t)floorf(lsMin(a.y, lsMin(b.y, c.y))));
+  const int64_t maxX = lsMin(tile.x1 - 1, (int64_t)ceilf(lsMax(a.x, lsMax(b.x, c.x))));
+  const int64_t maxY = lsMin(tile.y1 - 1, (int64_t)ceilf(lsMax(a.y, lsMax(b.y, c.y))));
+
+  if (minX > maxX || minY > maxY)
+    return;
+
+  const float_t invArea = 1.f / area;
+  const float_t px = (float_t)minX + 0.5f;
+  const float_t py = (float_t)minY + 0.5f;
+
+  // Edge functions, weighting the opposite vertex.
+  float_t rowA = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+  float_t rowB = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+  float_t rowC = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+
+  const float_t stepXA = -(c.y - b.y), stepYA = c.x - b.x;
+  const float_t stepXB = -(a.y - c.y), stepYB = a.x - c.x;
+  const float_t stepXC = -(b.y - a.y), stepYC = b.x - a.x;
+
+  const size_t stride = terrainPreview_ScreenTileSize;
+
+  for (int64_t y = minY; y <= maxY; y++)
+  {
+    float_t wA = rowA, wB = rowB, wC = rowC;
+    const size_t row = (size_t)(y - tile.y0) * stride;
+
+    for (int64_t x = minX; x <= maxX; x++)
+    {
+      if (wA >= 0 && wB >= 0 && wC >= 0)
+      {
+        const float_t z = (wA * a.z + wB * b.z + wC * c.z) * invArea;
+        const size_t i = row + (size_t)(x - tile.x0);
+
+        if (z >= 0 && z <= 1 && z < pDepth[i])
+        {
+          pDepth[i] = z;
+          pColor[i] = color;
+        }
+      }
+
+      wA += stepXA;
+      wB += stepXB;
+      wC += stepXC;
+    }
+
+    rowA += stepYA;
+    rowB += stepYB;
+    rowC += stepYC;
+  }
+}
+
+static void terrainPreview_rasterizeScreenTile_internal(void *pUserData, const size_t index)
+{
+  terrain_preview_context *pContext = reinterpret_cast<terrain_preview_context *>(pUserData);
+  const terrain *pTerrain = pContext->pTerrain;
+  const size_t width = pTerrain->width;
+
+  terrain_preview_rect tile;
+  tile.x0 = (int64_t)((index % pContext->screenTileCountX) * terrainPreview_ScreenTileSize);
+  tile.y0 = (int64_t)((index / pContext->screenTileCountX) * terrainPreview_ScreenTileSize);
+  tile.x1 = lsMin(tile.x0 + (int64_t)terrainPreview_ScreenTileSize, (int64_t)pContext->size.x);
+  tile.y1 = lsMin(tile.y0 + (int64_t)terrainPreview_ScreenTileSize, (int64_t)pContext->size.y);
+
+  float_t depth[terrainPreview_ScreenTileSize * terrainPreview_ScreenTileSize];
+  uint32_t color[terrainPreview_ScreenTileSize * terrainPreview_ScreenTileSize];
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(depth); i++)
+  {
+    depth[i] = FLT_MAX;
+    color[i] = 0;
+  }
+
+  for (size_t k = pContext->pScreenTileChunkOffsets[index]; k < pContext->pScreenTileChunkOffsets[index + 1]; k++)
+  {
+    const size_t chunkX = pContext->pScreenTileChunks[k] % pTerrain->chunkCountX;
+    const size_t chunkY = pContext->pScreenTileChunks[k] / pTerrain->chunkCountX;
+
+    const size_t qx1 = lsMin((chunkX + 1) * terrain_chunkSize, width - 1);
+    const size_t qy1 = lsMin((chunkY + 1) * terrain_chunkSize, (size_t)pTerrain->height - 1);
+
+    for (size_t qy = chunkY * terrain_chunkSize; qy < qy1; qy++)
+    {
+      for (size_t qx = chunkX * terrain_chunkSize; qx < qx1; qx++)
+      {
+        const size_t i = qy * width + qx;
+        const terrain_preview_vertex &v00 = pContext->pVertices[i];
+        const terrain_preview_vertex &v10 = pContext->pVertices[i + 1];
+        const terrain_preview_vertex &v01 = pContext->pVertices[i + width];
+        const terrain_preview_vertex &v11 = pContext->pVertices[i + width + 1];
+
+        if (!(v00.visible && v10.visible && v01.visible && v11.visible))
+          continue;
+
+        const float_t minX = lsMin(lsMin(v00.x, v10.x), lsMin(v01.x, v11.x));
+        const float_t maxX = lsMax(lsMax(v00.x, v10.x), lsMax(v01.x, v11.x));
+        const float_t minY = lsMin(lsMin(v00.y, v10.y), lsMin(v01.y, v11.y));
+        const float_t maxY = lsMax(lsMax(v00.y, v10.y), lsMax(v01.y, v11.y));
+
+        if (maxX < (float_t)tile.x0 || minX >= (float_t)tile.x1 || maxY < (float_t)tile.y0 || minY >= (float_t)tile.y1)
+          continue;
+
+        terrainPreview_rasterizeTriangle_internal(v00, &v10, &v11, pContext->pColors[i], tile, depth, color);
+        terrainPreview_rasterizeTriangle_internal(v00, &v11, &v01, pContext->pColors[i], tile, depth, color);
+      }
+    }
+  }
+
+  for (int64_t y = tile.y0; y < tile.y1; y++)
+    memcpy(pContext->pPixels + (size_t)y * pContext->size.x + tile.x0, color + (size_t)(y - tile.y0) * terrainPreview_ScreenTileSize, sizeof(uint32_t) * (size_t)(tile.x1 - tile.x0));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainPreview_render(const terrain *pTerrain, const matrix &viewProjection, const vec2s size, _Out_ uint32_t *pPixels, const float_t heightScale /* = terrainPreview_DefaultHeightScale */)
+{
+  lsResult result = lsR_Success;
+
+  terrain_preview_context context;
+  lsZeroMemory(&context);
+
+  thread_pool *pPool = threadPool_getDefault();
+
+  LS_ERROR_IF(pTerrain == nullptr || pPixels == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pTerrain->width < 2 || pTerrain->height < 2 || size.x == 0 || size.y == 0, lsR_InvalidParameter);
+
+  context.pTerrain = pTerrain;
+  context.viewProjection = viewProjection;
+  context.viewFrustum = frustum::FromViewProjection(viewProjection);
+  context.size = size;
+  context.heightScale = heightScale;
+  context.lightDirection = vec3f(-1.f, -1.f, 2.f).Normalize();
+  context.screenTileCountX = (size.x + terrainPreview_ScreenTileSize - 1) / terrainPreview_ScreenTileSize;
+  context.screenTileCountY = (size.y + terrainPreview_ScreenTileSize - 1) / terrainPreview_ScreenTileSize;
+  context.pPixels = pPixels;
+
+  {
+    const size_t tileCount = (size_t)pTerrain->width * pTerrain->height;
+    const size_t chunkCount = (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY;
+    const size_t rowTaskCount = (pTerrain->height + terrainPreview_RowsPerTask - 1) / terrainPreview_RowsPerTask;
+    const size_t screenTileCount = context.screenTileCountX * context.screenTileCountY;
+
+    LS_ERROR_CHECK(lsAlloc(&context.pHeights, tileCount));
+    LS_ERROR_CHECK(lsAlloc(&context.pTopLayers, tileCount));
+    LS_ERROR_CHECK(lsAlloc(&context.pColors, tileCount));
+    LS_ERROR_CHECK(lsAlloc(&context.pVertices, tileCount));
+    LS_ERROR_CHECK(lsAlloc(&context.pChunkMins, chunkCount));
+    LS_ERROR_CHECK(lsAlloc(&context.pChunkMaxs, chunkCount));
+    LS_ERROR_CHECK(lsAlloc(&context.pChunkVisible, chunkCount));
+    LS_ERROR_CHECK(lsAlloc(&context.pChunkRects, chunkCount));
+
+    threadPool_parallelFor(pPool, rowTaskCount, terrainPreview_heights_internal, &context);
+    threadPool_parallelFor(pPool, rowTaskCount, terrainPreview_shadeAndProject_internal, &context);
+    threadPool_parallelFor(pPool, chunkCount, terrainPreview_chunkBounds_internal, &context);
+    LS_ERROR_CHECK(context.viewFrustum.IntersectsBoxStream(context.pChunkVisible, context.pChunkMins, context.pChunkMaxs, chunkCount));
+    threadPool_parallelFor(pPool, chunkCount, terrainPreview_chunkRect_internal, &context);
+    LS_ERROR_CHECK(terrainPreview_binChunks_internal(&context, chunkCount));
+    threadPool_parallelFor(pPool, screenTileCount, terrainPreview_rasterizeScreenTile_internal, &context);
+  }
+
+epilogue:
+  lsFreePtr(&context.pHeights);
+  lsFreePtr(&context.pTopLayers);
+  lsFreePtr(&context.pColors);
+  lsFreePtr(&context.pVertices);
+  lsFreePtr(&context.pChunkMins);
+  lsFreePtr(&context.pChunkMaxs);
+  lsFreePtr(&context.pChunkVisible);
+  lsFreePtr(&context.pChunkRects);
+  lsFreePtr(&context.pScreenTileChunkOffsets);
+  lsFreePtr(&context.pScreenTileChunks);
+
+  return result;
+}
+
+struct terrain_preview_image
+{
+  const uint32_t *pPixels;
+  size_t width;
+};
+
+static void terrainPreview_getRow_internal(void *pUserData, const size_t y, _Out_ uint8_t *pRow)
+{
+  const terrain_preview_image *pImage = reinterpret_cast<const terrain_preview_image *>(pUserData);
+
+  lsMemcpy(pRow, reinterpret_cast<const uint8_t *>(pImage->pPixels + y * pImage->width), pImage->width * sizeof(uint32_t));
+}
+
+lsResult terrainPreview_writePng(const char *filename, const uint32_t *pPixels, const vec2s size)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pPixels == nullptr, lsR_ArgumentNull);
+
+  {
+    terrain_preview_image image;
+    image.pPixels = pPixels;
+    image.width = size.x;
+
+    LS_ERROR_CHECK(pngWriter_write(filename, size.x, size.y, ppf_rgba8, terrainPreview_getRow_internal, &image));
+  }
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(5)
+
+DEFINE_TESTABLE(terrainPreview_TestTopDown)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  constexpr size_t resolution = 128;
+  uint32_t *pPixels = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 16, 16));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pPixels, resolution * resolution));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    lsZeroMemory(&t.pTiles[i]);
+    t.pTiles[i].layerHeights[tt_grass] = 10;
+  }
+
+  // Looking straight down at the center of the terrain, which covers the center half of the image.
+  {
+    const matrix viewProjection = matrix::LookAtLH(vec(7.5f, 7.5f, 100.f), vec(7.5f, 7.5f, 0.f), vec(0.f, 1.f, 0.f)) * matrix::OrthographicLH(30.f, 30.f, 1.f, 200.f);
+    TESTABLE_ASSERT_SUCCESS(terrainPreview_render(&t, viewProjection, vec2s(resolution), pPixels));
+  }
+
+  {
+    const uint32_t center = pPixels[(resolution / 2) * resolution + resolution / 2];
+
+    TESTABLE_ASSERT_EQUAL(center >> 24, 0xFFU);
+    TESTABLE_ASSERT_EQUAL(center & 0xFF, 0U); // grass has no red.
+    TESTABLE_ASSERT_TRUE(((center >> 8) & 0xFF) > 0);
+
+    TESTABLE_ASSERT_EQUAL(pPixels[0], 0U); // outside of the terrain.
+  }
+
+epilogue:
+  lsFreePtr(&pPixels);
+  terrain_destroy(&t);
+  return result;
+}
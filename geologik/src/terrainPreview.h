@@ -0,0 +1,20 @@
+#pragma once
+
+#include "core.h"
+#include "vmath.h"
+#include "terrain.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// CPU rasterizer for thumbnails of the terrain without a GPU. Tiles are 1 unit apart, heights are scaled by `heightScale` per decimeter.
+
+constexpr float_t terrainPreview_DefaultHeightScale = 0.1f;
+constexpr size_t terrainPreview_ScreenTileSize = 64; // in pixels. screen tiles are rasterized in parallel.
+
+extern const vec3f terrainPreview_LayerColors[tt_count]; // same as `terrain.frag`.
+
+// `pPixels` receives `size.x * size.y` RGBA pixels, row major, top row first. Pixels not covered by the terrain are transparent.
+// Triangles crossing the near plane are skipped.
+lsResult terrainPreview_render(const terrain *pTerrain, const matrix &viewProjection, const vec2s size, _Out_ uint32_t *pPixels, const float_t heightScale = terrainPreview_DefaultHeightScale);
+
+lsResult terrainPreview_writePng(const char *filename, const uint32_t *pPixels, const vec2s size);
@@ -0,0 +1,551 @@
+#include "terrainSediment.h"
+#include "simd.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+constexpr float terrainSediment_Diagonal = 1.41421356f;
+constexpr size_t terrainSediment_AreaTableSize = 4096; // `powf` is only needed for large rivers, like in `terrainIncision`.
+constexpr float terrainSediment_MaxUnits = 2e9f; // dissolved per step, in fixed point height units. fits into `int32_t`.
+
+static_assert(sizeof(tile) == 16 && tt_count == 8, "the dissolution kernel loads one tile per register");
+
+struct terrain_sediment_context
+{
+  terrain_sediment *pSediment;
+  terrain *pTerrain;
+  const terrain_flow *pFlow;
+  const terrain_sediment_params *pParams;
+  float tonnesPerUnit; // of a fixed point height unit of a material with a density of 1.
+  float areaCapacities[terrainSediment_AreaTableSize]; // `capacity * A^m` by accumulation.
+  float dissolutionUnits; // limestone dissolved per decimeter of water, in fixed point height units.
+};
+
+// Takes up to `effort` tonnes, weighted by erodibility, from the exposed layer at or below `layer`. Layers that can't be eroded are
+// skipped at compile time. The soil is held together by the roots of the grass that was there before, see `terrainMaterial_getRootFactor`.
+// Returns the tonnes taken.
+template <size_t layer>
+static float terrainSediment_erode_internal(terrain *pTerrain, const size_t index, const float effort, const float tonnesPerUnit, const float rootFactor)
+{
+  if constexpr (layer >= tt_count)
+  {
+    return 0;
+  }
+  else if constexpr (terrainMaterial_Properties[layer].erodibility == 0)
+  {
+    return terrainSediment_erode_internal<layer + 1>(pTerrain, index, effort, tonnesPerUnit, rootFactor);
+  }
+  else
+  {
+    const float erodibility = terrainMaterial_Properties[layer].erodibility * (layer == tt_soil ? rootFactor : 1.f);
+    constexpr float density = terrainMaterial_Properties[layer].density;
+
+    const float available = (float)terrain_getFixedHeight(pTerrain, index, (terrain_type)layer);
+
+    if (available == 0)
+      return terrainSediment_erode_internal<layer + 1>(pTerrain, index, effort, tonnesPerUnit, rootFactor);
+
+    const float units = lsClamp(effort * erodibility / (density * tonnesPerUnit), 0.f, lsMin(available, (float)INT32_MAX));
+    const int32_t taken = -terrain_addFixedHeight(pTerrain, index, (terrain_type)layer, -(int32_t)units);
+    const float mass = (float)taken * density * tonnesPerUnit;
+
+    // Only the exposed layer erodes. Layers without fractions round what they lose, so the one below is only reached once this one is gone.
+    if (terrain_getFixedHeight(pTerrain, index, (terrain_type)layer) != 0)
+      return mass;
+
+    return mass + terrainSediment_erode_internal<layer + 1>(pTerrain, index, effort - mass / erodibility, tonnesPerUnit, rootFactor);
+  }
+}
+
+// Only exposed limestone dissolves, at most snow and water may be above it. Less than a decimeter of it is left alone. The water is the standing water plus the square root of the
+// upstream area for the water flowing through. Returns fixed point height units.
+static float terrainSediment_getDissolution_internal(const tile *pTile, const uint32_t accumulation, const float solute, const terrain_sediment_context *pContext)
+{
+  const bool exposed = (pTile->layerHeights[tt_grass] | pTile->layerHeights[tt_soil] | pTile->layerHeights[tt_sand]) == 0 && pTile->layerHeights[tt_limestone] != 0;
+  const float water = (float)pTile->layerHeights[tt_water] + sqrtf((float)accumulation);
+  const float undersaturation = lsMax(0.f, 1.f - solute / pContext->pParams->soluteSaturation);
+
+  return exposed ? lsMin(pContext->dissolutionUnits * water * undersaturation, terrainSediment_MaxUnits) : 0.f;
+}
+
+// `terrainSediment_getDissolution_internal` for four tiles at once. The tiles are transposed to get each layer of all four into one register.
+// Without SSE2 (see `simd.h`) the tiles are done one by one.
+static void terrainSediment_getDissolution4_internal(const tile *pTiles, const uint32_t *pAccumulation, const float *pSolute, const terrain_sediment_context *pContext, _Out_ float *pUnits)
+{
+#ifdef LS_SIMD_SSE2
+  const __m128i zero = _mm_setzero_si128();
+
+  const __m128i t0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pTiles));
+  const __m128i t1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pTiles + 1));
+  const __m128i t2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pTiles + 2));
+  const __m128i t3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pTiles + 3));
+
+  const __m128i lower01 = _mm_unpacklo_epi16(t0, t1);
+  const __m128i lower23 = _mm_unpacklo_epi16(t2, t3);
+  const __m128i layers01 = _mm_unpacklo_epi32(lower01, lower23); // layer 0 of the four tiles, then layer 1.
+  const __m128i layers23 = _mm_unpackhi_epi32(lower01, lower23);
+  const __m128i layers45 = _mm_unpacklo_epi32(_mm_unpackhi_epi16(t0, t1), _mm_unpackhi_epi16(t2, t3));
+
+  const __m128i cover = _mm_or_si128(_mm_or_si128(layers23, _mm_srli_si128(layers23, 8)), layers45); // grass, soil and sand.
+  const __m128i noLimestone = _mm_cmpeq_epi32(_mm_unpackhi_epi16(layers45, zero), zero);
+  const __m128 exposed = _mm_castsi128_ps(_mm_andnot_si128(noLimestone, _mm_cmpeq_epi32(_mm_unpacklo_epi16(cover, zero), zero)));
+
+  // Converting is signed, so the accumulation is halved first and the lowest bit added back.
+  const __m128i accumulationBits = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pAccumulation));
+  const __m128 accumulation = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(accumulationBits, 1)), _mm_set1_ps(2.f)), _mm_cvtepi32_ps(_mm_and_si128(accumulationBits, _mm_set1_epi32(1))));
+  const __m128 water = _mm_add_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(layers01, zero)), _mm_sqrt_ps(accumulation));
+  const __m128 undersaturation = _mm_max_ps(_mm_setzero_ps(), _mm_sub_ps(_mm_set1_ps(1.f), _mm_div_ps(_mm_loadu_ps(pSolute), _mm_set1_ps(pContext->pParams->soluteSaturation))));
+  const __m128 units = _mm_min_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(pContext->dissolutionUnits), water), undersaturation), _mm_set1_ps(terrainSediment_MaxUnits));
+
+  _mm_storeu_ps(pUnits, _mm_and_ps(units, exposed));
+#else
+  for (size_t i = 0; i < 4; i++)
+    pUnits[i] = terrainSediment_getDissolution_internal(pTiles + i, pAccumulation[i], pSolute[i], pContext);
+#endif
+}
+
+// Returns whether any limestone was dissolved.
+static bool terrainSediment_dissolve_internal(terrain_sediment_context *pContext, const size_t start, const size_t end)
+{
+  terrain *pTerrain = pContext->pTerrain;
+  terrain_sediment *pSediment = pContext->pSediment;
+  const float tonnesPerUnit = terrainMaterial_Properties[tt_limestone].density * pContext->tonnesPerUnit;
+
+  size_t i = start;
+  float units[4];
+  bool changed = false;
+
+  for (; i < end; i += 4)
+  {
+    const size_t count = lsMin(end - i, (size_t)4);
+
+    if (count == 4)
+    {
+      terrainSediment_getDissolution4_internal(pTerrain->pTiles + i, pContext->pFlow->pAccumulation + i, pSediment->pSolute + i, pContext, units);
+    }
+    else
+    {
+      for (size_t j = 0; j < count; j++)
+        units[j] = terrainSediment_getDissolution_internal(pTerrain->pTiles + i + j, pContext->pFlow->pAccumulation[i + j], pSediment->pSolute[i + j], pContext);
+    }
+
+    for (size_t j = 0; j < count; j++)
+    {
+      const int32_t dissolved = units[j] >= 1.f ? -terrain_addFixedHeight(pTerrain, i + j, tt_limestone, -(int32_t)units[j]) : 0;
+      pSediment->pSoluteOutflow[i + j] = pSediment->pSolute[i + j] + (float)dissolved * tonnesPerUnit;
+      changed |= dissolved != 0;
+    }
+  }
+
+  return changed;
+}
+
+static void terrainSediment_exchange_internal(void *pUserData, const size_t index)
+{
+  terrain_sediment_context *pContext = reinterpret_cast<terrain_sediment_context *>(pUserData);
+  terrain *pTerrain = pContext->pTerrain;
+  const terrain_flow *pFlow = pContext->pFlow;
+  const terrain_sediment_params *pParams = pContext->pParams;
+  const size_t end = lsMin((index + 1) * terrain_chunkSize, (size_t)pTerrain->height) * pTerrain->width;
+  bool changed = false;
+
+  // Before the sediment, as that can erode the limestone.
+  if (pContext->pSediment->pSolute != nullptr)
+    changed = terrainSediment_dissolve_internal(pContext, index * terrain_chunkSize * pTerrain->width, end);
+
+  for (size_t i = index * terrain_chunkSize * pTerrain->width; i < end; i++)
+  {
+    const size_t receiver = terrainFlow_getReceiver(pFlow, i);
+    float suspended = pContext->pSediment->pSuspended[i];
+
+    if (receiver != i)
+    {
+      const float distance = (pFlow->pDirections[i] & 1) ? terrain_tileSize * terrainSediment_Diagonal : terrain_tileSize;
+      const float slope = (float)(pFlow->pFilledHeights[i] - pFlow->pFilledHeights[receiver]) / distance;
+      const uint32_t accumulation = pFlow->pAccumulation[i];
+      const float capacity = slope * (accumulation < terrainSediment_AreaTableSize ? pContext->areaCapacities[accumulation] : pParams->capacity * powf((float)accumulation, pParams->areaExponent));
+
+      if (suspended < capacity)
+      {
+        const float rootFactor = terrainMaterial_getRootFactor(&pTerrain->pTiles[i]);
+        const float eroded = terrainSediment_erode_internal<terrainMaterial_FirstBedLayer>(pTerrain, i, (capacity - suspended) * pParams->erosionRate, pContext->tonnesPerUnit, rootFactor);
+
+        suspended += eroded;
+        changed |= eroded != 0;
+      }
+      else
+      {
+        const terrain_type layer = terrainMaterial_getDepositLayer(&pTerrain->pTiles[i]);
+        const float tonnesPerUnit = terrainMaterial_Properties[layer].density * pContext->tonnesPerUnit;
+        const float units = lsMin((suspended - capacity) * pParams->depositionRate / tonnesPerUnit, (float)INT32_MAX);
+
+        const int32_t deposited = terrain_addFixedHeight(pTerrain, i, layer, (int32_t)units);
+
+        suspended -= (float)deposited * tonnesPerUnit;
+        changed |= deposited != 0;
+      }
+    }
+
+    pContext->pSediment->pOutflow[i] = suspended;
+  }
+
+  pContext->pSediment->pChangedBlocks[index] = changed;
+}
+
+// Gathers from the upstream neighbours, so that no two tasks write the same tile.
+static void terrainSediment_move_internal(void *pUserData, const size_t index)
+{
+  terrain_sediment_context *pContext = reinterpret_cast<terrain_sediment_context *>(pUserData);
+  const terrain_flow *pFlow = pContext->pFlow;
+  terrain_sediment *pSediment = pContext->pSediment;
+  const size_t width = pFlow->width;
+  const size_t yEnd = lsMin((index + 1) * terrain_chunkSize, (size_t)pFlow->height);
+
+  for (size_t y = index * terrain_chunkSize; y < yEnd; y++)
+  {
+    for (size_t x = 0; x < width; x++)
+    {
+      const size_t i = y * width + x;
+      float inflow = 0;
+      float soluteInflow = 0;
+
+      for (uint8_t direction = 0; direction < tfd_count; direction++)
+      {
+        if (!terrainFlow_hasNeighbour(pFlow, x, y, direction))
+          continue;
+
+        const size_t neighbour = (size_t)((int64_t)i + terrainFlow_OffsetY[direction] * (int64_t)width + terrainFlow_OffsetX[direction]);
+
+        if (pFlow->pDirections[neighbour] == (direction + tfd_count / 2) % tfd_count)
+        {
+          inflow += pSediment->pOutflow[neighbour];
+
+          if (pSediment->pSolute != nullptr)
+            soluteInflow += pSediment->pSoluteOutflow[neighbour];
+        }
+      }
+
+      pSediment->pSuspended[i] = inflow;
+
+      if (pSediment->pSolute != nullptr)
+        pSediment->pSolute[i] = soluteInflow;
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainSediment_init(_Out_ terrain_sediment *pSediment, const uint16_t width, const uint16_t height)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pSediment == nullptr, lsR_ArgumentNull);
+
+  lsZeroMemory(pSediment);
+  pSediment->width = width;
+  pSediment->height = height;
+
+  LS_ERROR_CHECK(lsAllocZero(&pSediment->pSuspended, (size_t)width * height));
+  LS_ERROR_CHECK(lsAlloc(&pSediment->pOutflow, (size_t)width * height));
+  LS_ERROR_CHECK(lsAlloc(&pSediment->pChangedBlocks, (height + terrain_chunkSize - 1) / terrain_chunkSize));
+
+epilogue:
+  if (LS_FAILED(result) && pSediment != nullptr)
+    terrainSediment_destroy(pSediment);
+
+  return result;
+}
+
+void terrainSediment_destroy(terrain_sediment *pSediment)
+{
+  if (pSediment == nullptr)
+    return;
+
+  lsFreePtr(&pSediment->pSuspended);
+  lsFreePtr(&pSediment->pOutflow);
+  lsFreePtr(&pSediment->pChangedBlocks);
+  lsFreePtr(&pSediment->pSolute);
+  lsFreePtr(&pSediment->pSoluteOutflow);
+}
+
+lsResult terrainSediment_step(terrain_sediment *pSediment, terrain *pTerrain, const terrain_flow *pFlow, const terrain_sediment_params *pParams, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_sediment_context context;
+  size_t blockCount = 0;
+
+  LS_ERROR_IF(pSediment == nullptr || pTerrain == nullptr || pFlow == nullptr || pParams == nullptr || pPool == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pSediment->width != pTerrain->width || pSediment->height != pTerrain->height || pFlow->width != pTerrain->width || pFlow->height != pTerrain->height, lsR_ArgumentOutOfBounds);
+  LS_ERROR_IF(pParams->dissolutionRate < 0 || pParams->soluteSaturation <= 0, lsR_ArgumentOutOfBounds);
+
+  if (pParams->dissolutionRate > 0 && pSediment->pSolute == nullptr)
+  {
+    LS_ERROR_CHECK(lsAllocZero(&pSediment->pSolute, (size_t)pTerrain->width * pTerrain->height));
+    LS_ERROR_CHECK(lsAlloc(&pSediment->pSoluteOutflow, (size_t)pTerrain->width * pTerrain->height));
+    LS_ERROR_CHECK(terrain_enableFractions(pTerrain, 1U << tt_limestone));
+  }
+
+  context.pSediment = pSediment;
+  context.pTerrain = pTerrain;
+  context.pFlow = pFlow;
+  context.pParams = pParams;
+  context.tonnesPerUnit = (terrain_tileSize * 0.1f) * (terrain_tileSize * 0.1f) * 0.1f / terrain_fixedOne;
+  context.dissolutionUnits = pParams->dissolutionRate * terrainMaterial_Properties[tt_limestone].solubility / (terrainMaterial_Properties[tt_limestone].density * context.tonnesPerUnit);
+
+  for (size_t i = 0; i < terrainSediment_AreaTableSize; i++)
+    context.areaCapacities[i] = pParams->capacity * powf((float)i, pParams->areaExponent);
+
+  blockCount = (pTerrain->height + terrain_chunkSize - 1) / terrain_chunkSize;
+
+  threadPool_parallelFor(pPool, blockCount, terrainSediment_exchange_internal, &context);
+
+  // Outlets are always at the edges.
+  for (size_t y = 0; y < pTerrain->height; y++)
+  {
+    for (size_t x = 0; x < pTerrain->width; x += (y == 0 || y == pTerrain->height - 1u) ? 1 : lsMax(pTerrain->width - 1u, 1u))
+    {
+      if (pFlow->pDirections[y * pTerrain->width + x] != tfd_outlet)
+        continue;
+
+      pSediment->exportedMass += pSediment->pOutflow[y * pTerrain->width + x];
+
+      if (pSediment->pSolute != nullptr)
+        pSediment->exportedSolute += pSediment->pSoluteOutflow[y * pTerrain->width + x];
+    }
+  }
+
+  threadPool_parallelFor(pPool, blockCount, terrainSediment_move_internal, &context);
+
+  for (size_t i = 0; i < blockCount; i++)
+    if (pSediment->pChangedBlocks[i])
+      terrain_markDirty(pTerrain, 0, i * terrain_chunkSize, pTerrain->width, lsMin(terrain_chunkSize, pTerrain->height - i * terrain_chunkSize));
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(14)
+
+static double terrainSediment_getMass_internal(const terrain *pTerrain, const float tonnesPerUnit)
+{
+  double mass = 0;
+
+  for (size_t i = 0; i < (size_t)pTerrain->width * pTerrain->height; i++)
+    for (size_t layer = terrainMaterial_FirstBedLayer; layer < tt_count; layer++)
+      mass += (double)terrain_getFixedHeight(pTerrain, i, (terrain_type)layer) * terrainMaterial_Properties[layer].density * tonnesPerUnit;
+
+  return mass;
+}
+
+DEFINE_TESTABLE(terrainSediment_TestTransport)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  terrain_sediment sediment;
+  lsZeroMemory(&sediment);
+
+  thread_pool *pPool = nullptr;
+  terrain_sediment_params params;
+  params.capacity = 1.f;
+
+  constexpr size_t basinX = 24;
+  const float tonnesPerUnit = (terrain_tileSize * 0.1f) * (terrain_tileSize * 0.1f) * 0.1f / terrain_fixedOne;
+  double massBefore = 0;
+  double suspended = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 40, 12));
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&t, (1U << tt_soil) | (1U << tt_sand) | (1U << tt_limestone) | (1U << tt_stone)));
+  TESTABLE_ASSERT_SUCCESS(terrainSediment_init(&sediment, t.width, t.height));
+
+  // Slopes of stone and limestone falling towards the east into a flat basin, half of it with soil.
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      tile *pTile = &t.pTiles[y * t.width + x];
+
+      lsZeroMemory(pTile);
+      pTile->layerHeights[tt_bedrock] = 8;
+      pTile->layerHeights[y < t.height / 2 ? tt_limestone : tt_stone] = (uint16_t)(x < basinX ? (basinX - x) * 40 : 0);
+      pTile->layerHeights[tt_soil] = (x >= basinX && y < t.height / 2) ? 5 : 0;
+      pTile->layerHeights[tt_stone] += (x >= basinX && y >= t.height / 2) ? 5 : 0;
+    }
+  }
+
+  massBefore = terrainSediment_getMass_internal(&t, tonnesPerUnit);
+
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &t, pPool));
+
+  for (size_t step = 0; step < 20; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainSediment_step(&sediment, &t, &flow, &params, pPool));
+
+  // Nothing is lost.
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+    suspended += sediment.pSuspended[i];
+
+  TESTABLE_ASSERT_EQUAL(sediment.exportedMass + suspended > 0, true);
+  TESTABLE_ASSERT_EQUAL(fabs(massBefore - terrainSediment_getMass_internal(&t, tonnesPerUnit) - sediment.exportedMass - suspended) < massBefore * 1e-5, true);
+
+  // Limestone erodes faster than stone, the basin fills with soil on soil and with sand elsewhere.
+  {
+    const size_t x = basinX / 2;
+    const uint32_t limestone = terrain_getFixedHeight(&t, 2 * t.width + x, tt_limestone);
+    const uint32_t stone = terrain_getFixedHeight(&t, (t.height - 3) * t.width + x, tt_stone);
+
+    TESTABLE_ASSERT_EQUAL(limestone < stone, true);
+    TESTABLE_ASSERT_EQUAL(stone < (basinX - x) * 40 * terrain_fixedOne, true);
+  }
+
+  for (size_t y = 1; y < t.height - 1u; y++)
+  {
+    const tile *pTile = &t.pTiles[y * t.width + basinX];
+
+    if (y < t.height / 2)
+    {
+      TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, y * t.width + basinX, tt_soil) > 5 * terrain_fixedOne, true);
+      TESTABLE_ASSERT_EQUAL(pTile->layerHeights[tt_sand], 0);
+    }
+    else
+    {
+      TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, y * t.width + basinX, tt_sand) > 0u, true);
+      TESTABLE_ASSERT_EQUAL(pTile->layerHeights[tt_soil], 0);
+    }
+  }
+
+epilogue:
+  terrainSediment_destroy(&sediment);
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainSediment_TestDissolutionKernel)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t count = 64;
+
+  tile tiles[count];
+  uint32_t accumulation[count];
+  float solute[count];
+  float units[count];
+  rand_seed seed(9, 10);
+
+  terrain_sediment_params params;
+  params.dissolutionRate = 0.5f;
+
+  terrain_sediment_context context;
+  context.pParams = &params;
+  context.dissolutionUnits = 1234.5f;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    lsZeroMemory(&tiles[i]);
+
+    for (size_t layer = 0; layer < tt_count; layer++)
+      tiles[i].layerHeights[layer] = lsGetRand(seed) % 3 == 0 ? (uint16_t)(lsGetRand(seed) % 100) : 0;
+
+    accumulation[i] = i == 0 ? UINT32_MAX : (uint32_t)(lsGetRand(seed) % 1000 + 1);
+    solute[i] = (float)(lsGetRand(seed) % 120) * 0.1f;
+  }
+
+  for (size_t i = 0; i < count; i += 4)
+    terrainSediment_getDissolution4_internal(tiles + i, accumulation + i, solute + i, &context, units + i);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    const float expected = terrainSediment_getDissolution_internal(&tiles[i], accumulation[i], solute[i], &context);
+    TESTABLE_ASSERT_EQUAL(fabsf(units[i] - expected) <= expected * 1e-5f, true);
+  }
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(terrainSediment_TestDissolution)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  terrain_sediment sediment;
+  lsZeroMemory(&sediment);
+
+  thread_pool *pPool = nullptr;
+  terrain_sediment_params params;
+  params.capacity = 0;
+  params.dissolutionRate = 0.01f;
+
+  const float tonnesPerUnit = (terrain_tileSize * 0.1f) * (terrain_tileSize * 0.1f) * 0.1f / terrain_fixedOne * terrainMaterial_Properties[tt_limestone].density;
+  double limestoneBefore = 0;
+  double limestoneAfter = 0;
+  double solute = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 37, 20));
+  TESTABLE_ASSERT_SUCCESS(terrainSediment_init(&sediment, t.width, t.height));
+
+  // Limestone falling towards the east, with a lake on top in the west. The northern half is covered by soil.
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      tile *pTile = &t.pTiles[y * t.width + x];
+
+      lsZeroMemory(pTile);
+      pTile->layerHeights[tt_bedrock] = 8;
+      pTile->layerHeights[tt_limestone] = (uint16_t)(500 + (t.width - x) * 10);
+      pTile->layerHeights[tt_soil] = y < t.height / 2 ? 3 : 0;
+      pTile->layerHeights[tt_water] = x < 5 ? 20 : 0;
+
+      limestoneBefore += pTile->layerHeights[tt_limestone] * (double)terrain_fixedOne;
+    }
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &t, pPool));
+
+  for (size_t step = 0; step < 10; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainSediment_step(&sediment, &t, &flow, &params, pPool));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+  {
+    limestoneAfter += terrain_getFixedHeight(&t, i, tt_limestone);
+    solute += sediment.pSolute[i];
+  }
+
+  TESTABLE_ASSERT_EQUAL(solute > 0, true);
+  TESTABLE_ASSERT_EQUAL(fabs((limestoneBefore - limestoneAfter) * tonnesPerUnit - solute - sediment.exportedSolute) < solute * 1e-4, true);
+
+  // More water dissolves more, soil protects the limestone.
+  {
+    const size_t y = t.height - 3u;
+    const uint32_t lake = (uint32_t)(500 + (t.width - 2) * 10) * terrain_fixedOne - terrain_getFixedHeight(&t, y * t.width + 2, tt_limestone);
+    const uint32_t slope = (uint32_t)(500 + (t.width - 10) * 10) * terrain_fixedOne - terrain_getFixedHeight(&t, y * t.width + 10, tt_limestone);
+
+    TESTABLE_ASSERT_EQUAL(lake > slope, true);
+    TESTABLE_ASSERT_EQUAL(slope > 0u, true);
+    TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, 2 * t.width + 10, tt_limestone), (uint32_t)(500 + (t.width - 10) * 10) * terrain_fixedOne);
+  }
+
+epilogue:
+  terrainSediment_destroy(&sediment);
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "terrainFlow.h"
+#include "terrainMaterial.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Sediment carried by rivers. Every step, each tile compares the sediment suspended in its water with what the water can carry,
+// `capacity * A^m * S`. Below that it picks up material from the top of the bed, scaled by the erodibility of each layer, above that
+// it deposits the excess as soil or sand. What's left moves on to the downstream neighbour. Grass makes the soil below it harder to
+// erode.
+// Water also dissolves exposed limestone, depending on how much of it stands on or flows over a tile and how much it already carries.
+// The solute moves downstream along with the sediment.
+
+struct terrain_sediment_params
+{
+  float capacity = 0.02f; // in tonnes, with the upstream area `A` in tiles.
+  float areaExponent = 0.5f; // `m`
+  float erosionRate = 0.2f; // share of the missing capacity picked up per step.
+  float depositionRate = 0.5f; // share of the excess deposited per step.
+  float dissolutionRate = 0.f; // in tonnes per decimeter of standing water or square root of the upstream area in tiles. 0 disables it.
+  float soluteSaturation = 10.f; // in tonnes per tile. water doesn't dissolve any more than that.
+};
+
+struct terrain_sediment
+{
+  uint16_t width, height;
+
+  float *pSuspended; // in tonnes per tile.
+  float *pOutflow; // what each tile passes on during a step.
+  double exportedMass; // in tonnes, that left the map at outlets.
+  bool *pChangedBlocks; // per block of `terrain_chunkSize` rows.
+
+  // Dissolved limestone, `nullptr` until the first step with a `dissolutionRate`.
+  float *pSolute; // in tonnes per tile.
+  float *pSoluteOutflow;
+  double exportedSolute;
+};
+
+lsResult terrainSediment_init(_Out_ terrain_sediment *pSediment, const uint16_t width, const uint16_t height);
+void terrainSediment_destroy(terrain_sediment *pSediment);
+
+// Erodes and deposits for one step and moves the suspended sediment one tile downstream along `pFlow`, which should be recent.
+// Steps are usually much less than a decimeter, so layers without fractions (see `terrain_enableFractions`) round it away. Dissolution
+// enables them for limestone.
+lsResult terrainSediment_step(terrain_sediment *pSediment, terrain *pTerrain, const terrain_flow *pFlow, const terrain_sediment_params *pParams, thread_pool *pPool);
@@ -0,0 +1,696 @@
+#include "terrainStream.h"
+#include "io.h"
+
+#include <mutex>
+#include <thread>
+
+//////////////////////////////////////////////////////////////////////////
+
+constexpr uint32_t terrainStream_None = (uint32_t)-1;
+
+struct terrain_stream_slot
+{
+  uint32_t chunkIndex; // `terrainStream_None` if empty.
+  uint32_t evictedChunkIndex; // has to be written back before `chunkIndex` can be loaded. stays mapped to this slot until then.
+  uint32_t previous, next; // in the LRU list, which contains all slots that are neither acquired nor loading.
+  uint32_t pinCount;
+  bool dirty;
+  bool loading;
+};
+
+struct terrain_stream
+{
+  FILE *pFile = nullptr;
+  std::mutex fileMutex;
+
+  uint16_t width = 0;
+  uint16_t height = 0;
+  size_t chunkCountX = 0;
+  size_t chunkCountY = 0;
+
+  thread_pool *pPool = nullptr;
+  thread_pool_group loads;
+
+  std::mutex mutex;
+  tile *pSlotTiles = nullptr;
+  terrain_stream_slot *pSlots = nullptr;
+  size_t slotCount = 0;
+  uint32_t *pChunkSlots = nullptr; // `terrainStream_None` if not cached.
+  uint32_t lruFirst = terrainStream_None;
+  uint32_t lruLast = terrainStream_None;
+  lsResult writeBackResult = lsR_Success; // evictions can't report failures to anyone, so they're reported on flush.
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+static tile *terrainStream_getSlotTiles_internal(terrain_stream *pStream, const uint32_t slotIndex)
+{
+  return pStream->pSlotTiles + (size_t)slotIndex * terrain_chunkSize * terrain_chunkSize;
+}
+
+static void terrainStream_lruRemove_internal(terrain_stream *pStream, const uint32_t slotIndex)
+{
+  terrain_stream_slot *pSlot = &pStream->pSlots[slotIndex];
+
+  if (pSlot->previous != terrainStream_None)
+    pStream->pSlots[pSlot->previous].next = pSlot->next;
+  else
+    pStream->lruFirst = pSlot->next;
+
+  if (pSlot->next != terrainStream_None)
+    pStream->pSlots[pSlot->next].previous = pSlot->previous;
+  else
+    pStream->lruLast = pSlot->previous;
+
+  pSlot->previous = pSlot->next = terrainStream_None;
+}
+
+static void terrainStream_lruPushBack_internal(terrain_stream *pStream, const uint32_t slotIndex)
+{
+  terrain_stream_slot *pSlot = &pStream->pSlots[slotIndex];
+
+  pSlot->previous = pStream->lruLast;
+  pSlot->next = terrainStream_None;
+
+  if (pStream->lruLast != terrainStream_None)
+    pStream->pSlots[pStream->lruLast].next = slotIndex;
+  else
+    pStream->lruFirst = slotIndex;
+
+  pStream->lruLast = slotIndex;
+}
+
+static lsResult terrainStream_readChunk_internal(terrain_stream *pStream, const uint32_t chunkIndex, _Out_ tile *pTiles)
+{
+  lsResult result = lsR_Success;
+
+  std::unique_lock<std::mutex> lock(pStream->fileMutex);
+
+  LS_ERROR_CHECK(lsSeekFile(pStream->pFile, terrain_chunkedHeaderSize + (uint64_t)chunkIndex * terrain_chunkBytes));
+  LS_ERROR_IF(terrain_chunkBytes != fread(pTiles, 1, terrain_chunkBytes, pStream->pFile), lsR_EndOfStream);
+
+epilogue:
+  return result;
+}
+
+static lsResult terrainStream_writeChunk_internal(terrain_stream *pStream, const uint32_t chunkIndex, const tile *pTiles)
+{
+  lsResult result = lsR_Success;
+
+  std::unique_lock<std::mutex> lock(pStream->fileMutex);
+
+  LS_ERROR_CHECK(lsSeekFile(pStream->pFile, terrain_chunkedHeaderSize + (uint64_t)chunkIndex * terrain_chunkBytes));
+  LS_ERROR_IF(terrain_chunkBytes != fwrite(pTiles, 1, terrain_chunkBytes, pStream->pFile), lsR_IOFailure);
+
+epilogue:
+  return result;
+}
+
+// Call with `mutex` locked. Takes the least recently used slot for `chunkIndex`, which is marked as loading.
+static bool terrainStream_claimSlot_internal(terrain_stream *pStream, const uint32_t chunkIndex, const uint32_t pinCount, _Out_ uint32_t *pSlotIndex)
+{
+  const uint32_t slotIndex = pStream->lruFirst;
+
+  if (slotIndex == terrainStream_None)
+    return false;
+
+  terrain_stream_slot *pSlot = &pStream->pSlots[slotIndex];
+
+  terrainStream_lruRemove_internal(pStream, slotIndex);
+
+  if (pSlot->chunkIndex != terrainStream_None)
+  {
+    if (pSlot->dirty)
+      pSlot->evictedChunkIndex = pSlot->chunkIndex;
+    else
+      pStream->pChunkSlots[pSlot->chunkIndex] = terrainStream_None;
+  }
+
+  pSlot->chunkIndex = chunkIndex;
+  pSlot->pinCount = pinCount;
+  pSlot->dirty = false;
+  pSlot->loading = true;
+  pStream->pChunkSlots[chunkIndex] = slotIndex;
+
+  *pSlotIndex = slotIndex;
+
+  return true;
+}
+
+static lsResult terrainStream_load_internal(terrain_stream *pStream, const uint32_t slotIndex)
+{
+  lsResult result = lsR_Success;
+
+  terrain_stream_slot *pSlot = &pStream->pSlots[slotIndex];
+  tile *pTiles = terrainStream_getSlotTiles_internal(pStream, slotIndex);
+
+  // Nobody else touches a slot while it's loading.
+  if (pSlot->evictedChunkIndex != terrainStream_None)
+  {
+    const lsResult writeBackResult = terrainStream_writeChunk_internal(pStream, pSlot->evictedChunkIndex, pTiles);
+
+    std::unique_lock<std::mutex> lock(pStream->mutex);
+
+    if (LS_FAILED(writeBackResult))
+      pStream->writeBackResult = writeBackResult;
+
+    pStream->pChunkSlots[pSlot->evictedChunkIndex] = terrainStream_None;
+    pSlot->evictedChunkIndex = terrainStream_None;
+  }
+
+  result = terrainStream_readChunk_internal(pStream, pSlot->chunkIndex, pTiles);
+
+  {
+    std::unique_lock<std::mutex> lock(pStream->mutex);
+
+    pSlot->loading = false;
+
+    if (LS_FAILED(result))
+    {
+      pStream->pChunkSlots[pSlot->chunkIndex] = terrainStream_None;
+      pSlot->chunkIndex = terrainStream_None;
+      pSlot->pinCount = 0;
+    }
+
+    if (pSlot->pinCount == 0)
+      terrainStream_lruPushBack_internal(pStream, slotIndex);
+  }
+
+  return result;
+}
+
+static void terrainStream_loadTask_internal(void *pUserData, const size_t slotIndex)
+{
+  terrainStream_load_internal(reinterpret_cast<terrain_stream *>(pUserData), (uint32_t)slotIndex); // failed prefetches are retried when the chunk is acquired.
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainStream_createFile(const char *filename, const uint16_t width, const uint16_t height)
+{
+  lsResult result = lsR_Success;
+
+  FILE *pFile = nullptr;
+
+  LS_ERROR_IF(filename == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(width == 0 || height == 0, lsR_ArgumentOutOfBounds);
+
+  pFile = fopen(filename, "wb");
+  LS_ERROR_IF(pFile == nullptr, lsR_IOFailure);
+
+  LS_ERROR_CHECK(terrain_writeChunkedHeader(pFile, _ChunkedVersion, width, height));
+
+  // Extend the file to its full size, the chunks in between are zero.
+  {
+    const uint64_t chunkCount = (uint64_t)((width + terrain_chunkSize - 1) / terrain_chunkSize) * ((height + terrain_chunkSize - 1) / terrain_chunkSize);
+    const uint8_t zero = 0;
+
+    LS_ERROR_CHECK(lsSeekFile(pFile, terrain_chunkedHeaderSize + chunkCount * terrain_chunkBytes - 1));
+    LS_ERROR_IF(1 != fwrite(&zero, 1, 1, pFile), lsR_IOFailure);
+  }
+
+epilogue:
+  if (pFile != nullptr)
+    fclose(pFile);
+
+  return result;
+}
+
+lsResult terrainStream_create(_Out_ terrain_stream **ppStream, const char *filename, const size_t memoryBudgetBytes, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_stream *pStream = nullptr;
+  size_t chunkCount = 0;
+  uint8_t version = 0;
+
+  LS_ERROR_IF(ppStream == nullptr || filename == nullptr || pPool == nullptr, lsR_ArgumentNull);
+
+  pStream = new (std::nothrow) terrain_stream();
+  LS_ERROR_IF(pStream == nullptr, lsR_MemoryAllocationFailure);
+
+  pStream->pPool = pPool;
+
+  pStream->pFile = fopen(filename, "r+b");
+  LS_ERROR_IF(pStream->pFile == nullptr, lsR_ResourceNotFound);
+
+  LS_ERROR_CHECK(terrain_readChunkedHeader(pStream->pFile, &version, &pStream->width, &pStream->height));
+  LS_ERROR_IF(version != _ChunkedVersion, lsR_ResourceIncompatible); // compressed chunks can't be written in place.
+
+  pStream->chunkCountX = (pStream->width + terrain_chunkSize - 1) / terrain_chunkSize;
+  pStream->chunkCountY = (pStream->height + terrain_chunkSize - 1) / terrain_chunkSize;
+  chunkCount = pStream->chunkCountX * pStream->chunkCountY;
+
+  pStream->slotCount = lsMin(memoryBudgetBytes / terrain_chunkBytes, chunkCount);
+  LS_ERROR_IF(pStream->slotCount < lsMin(terrainStream_MinCachedChunks, chunkCount), lsR_ResourceInsufficient);
+
+  LS_ERROR_CHECK(lsAlloc(&pStream->pSlotTiles, pStream->slotCount * terrain_chunkSize * terrain_chunkSize));
+  LS_ERROR_CHECK(lsAlloc(&pStream->pSlots, pStream->slotCount));
+  LS_ERROR_CHECK(lsAlloc(&pStream->pChunkSlots, chunkCount));
+
+  for (size_t i = 0; i < chunkCount; i++)
+    pStream->pChunkSlots[i] = terrainStream_None;
+
+  for (uint32_t i = 0; i < (uint32_t)pStream->slotCount; i++)
+  {
+    terrain_stream_slot *pSlot = &pStream->pSlots[i];
+
+    pSlot->chunkIndex = terrainStream_None;
+    pSlot->evictedChunkIndex = terrainStream_None;
+    pSlot->pinCount = 0;
+    pSlot->dirty = false;
+    pSlot->loading = false;
+
+    terrainStream_lruPushBack_internal(pStream, i);
+  }
+
+  *ppStream = pStream;
+  pStream = nullptr;
+
+epilogue:
+  terrainStream_destroy(&pStream);
+  return result;
+}
+
+void terrainStream_destroy(terrain_stream **ppStream)
+{
+  if (ppStream == nullptr || *ppStream == nullptr)
+    return;
+
+  terrain_stream *pStream = *ppStream;
+
+  if (pStream->pFile != nullptr)
+  {
+    if (pStream->pSlots != nullptr)
+    {
+      threadPool_wait(pStream->pPool, &pStream->loads);
+      terrainStream_flush(pStream);
+    }
+
+    fclose(pStream->pFile);
+  }
+
+  lsFreePtr(&pStream->pSlotTiles);
+  lsFreePtr(&pStream->pSlots);
+  lsFreePtr(&pStream->pChunkSlots);
+
+  delete pStream;
+  *ppStream = nullptr;
+}
+
+void terrainStream_getSize(const terrain_stream *pStream, _Out_ uint16_t *pWidth, _Out_ uint16_t *pHeight)
+{
+  lsAssert(pStream != nullptr && pWidth != nullptr && pHeight != nullptr);
+
+  *pWidth = pStream->width;
+  *pHeight = pStream->height;
+}
+
+lsResult terrainStream_acquireChunk(terrain_stream *pStream, const size_t chunkX, const size_t chunkY, _Out_ tile **ppTiles)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pStream == nullptr || ppTiles == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(chunkX >= pStream->chunkCountX || chunkY >= pStream->chunkCountY, lsR_ArgumentOutOfBounds);
+
+  {
+    const uint32_t chunkIndex = (uint32_t)(chunkY * pStream->chunkCountX + chunkX);
+
+    while (true)
+    {
+      uint32_t slotIndex;
+
+      {
+        std::unique_lock<std::mutex> lock(pStream->mutex);
+
+        slotIndex = pStream->pChunkSlots[chunkIndex];
+
+        if (slotIndex == terrainStream_None)
+        {
+          LS_ERROR_IF(!terrainStream_claimSlot_internal(pStream, chunkIndex, 1, &slotIndex), lsR_ResourceInsufficient); // everything is acquired.
+
+          lock.unlock();
+
+          LS_ERROR_CHECK(terrainStream_load_internal(pStream, slotIndex));
+
+          *ppTiles = terrainStream_getSlotTiles_internal(pStream, slotIndex);
+          break;
+        }
+
+        terrain_stream_slot *pSlot = &pStream->pSlots[slotIndex];
+
+        if (!pSlot->loading)
+        {
+          lsAssert(pSlot->chunkIndex == chunkIndex);
+
+          if (pSlot->pinCount++ == 0)
+            terrainStream_lruRemove_internal(pStream, slotIndex);
+
+          *ppTiles = terrainStream_getSlotTiles_internal(pStream, slotIndex);
+          break;
+        }
+      }
+
+      // Being loaded on a worker, or written back if the chunk is being evicted. Helps out with queued loads in case all workers are busy.
+      threadPool_wait(pStream->pPool, &pStream->loads);
+      std::this_thread::yield();
+    }
+  }
+
+epilogue:
+  return result;
+}
+
+void terrainStream_releaseChunk(terrain_stream *pStream, const size_t chunkX, const size_t chunkY, const bool modified)
+{
+  lsAssert(pStream != nullptr && chunkX < pStream->chunkCountX && chunkY < pStream->chunkCountY);
+
+  std::unique_lock<std::mutex> lock(pStream->mutex);
+
+  const uint32_t slotIndex = pStream->pChunkSlots[chunkY * pStream->chunkCountX + chunkX];
+  lsAssert(slotIndex != terrainStream_None);
+
+  terrain_stream_slot *pSlot = &pStream->pSlots[slotIndex];
+  lsAssert(pSlot->pinCount > 0 && !pSlot->loading);
+
+  pSlot->dirty |= modified;
+
+  if (--pSlot->pinCount == 0)
+    terrainStream_lruPushBack_internal(pStream, slotIndex);
+}
+
+void terrainStream_prefetchChunk(terrain_stream *pStream, const size_t chunkX, const size_t chunkY)
+{
+  if (pStream == nullptr || chunkX >= pStream->chunkCountX || chunkY >= pStream->chunkCountY)
+    return;
+
+  // Without workers the load would only happen once the chunk is acquired anyways.
+  if (threadPool_getWorkerCount(pStream->pPool) == 0)
+    return;
+
+  const uint32_t chunkIndex = (uint32_t)(chunkY * pStream->chunkCountX + chunkX);
+  uint32_t slotIndex;
+
+  {
+    std::unique_lock<std::mutex> lock(pStream->mutex);
+
+    if (pStream->pChunkSlots[chunkIndex] != terrainStream_None)
+      return;
+
+    if (!terrainStream_claimSlot_internal(pStream, chunkIndex, 0, &slotIndex))
+      return;
+  }
+
+  if (LS_FAILED(threadPool_run(pStream->pPool, terrainStream_loadTask_internal, pStream, &pStream->loads, slotIndex)))
+    terrainStream_load_internal(pStream, slotIndex);
+}
+
+lsResult terrainStream_flush(terrain_stream *pStream)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pStream == nullptr, lsR_ArgumentNull);
+
+  for (uint32_t slotIndex = 0; slotIndex < (uint32_t)pStream->slotCount; slotIndex++)
+  {
+    terrain_stream_slot *pSlot = &pStream->pSlots[slotIndex];
+    uint32_t chunkIndex = terrainStream_None;
+
+    // Pinned while writing, so it's neither evicted nor flushed by someone else.
+    {
+      std::unique_lock<std::mutex> lock(pStream->mutex);
+
+      if (!pSlot->dirty || pSlot->loading || pSlot->pinCount != 0)
+        continue;
+
+      terrainStream_lruRemove_internal(pStream, slotIndex);
+      pSlot->pinCount = 1;
+      pSlot->dirty = false;
+      chunkIndex = pSlot->chunkIndex;
+    }
+
+    const lsResult writeResult = terrainStream_writeChunk_internal(pStream, chunkIndex, terrainStream_getSlotTiles_internal(pStream, slotIndex));
+
+    {
+      std::unique_lock<std::mutex> lock(pStream->mutex);
+
+      if (LS_FAILED(writeResult))
+        pSlot->dirty = true;
+
+      if (--pSlot->pinCount == 0)
+        terrainStream_lruPushBack_internal(pStream, slotIndex);
+    }
+
+    LS_ERROR_CHECK(writeResult);
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(pStream->mutex);
+
+    result = pStream->writeBackResult;
+    pStream->writeBackResult = lsR_Success;
+  }
+
+  LS_ERROR_CHECK(result);
+
+  {
+    std::unique_lock<std::mutex> lock(pStream->fileMutex);
+    LS_ERROR_IF(0 != fflush(pStream->pFile), lsR_IOFailure);
+  }
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainStream_sweep(terrain_stream *pStream, const size_t halo, terrain_stream_sweep_func *pFunc, void *pUserData)
+{
+  lsResult result = lsR_Success;
+
+  tile *pNeighbours[3][3] = {}; // acquired chunks around the current one.
+  size_t chunkX = 0;
+  size_t chunkY = 0;
+
+  terrain_stream_window window;
+  window.pTiles = nullptr;
+  window.halo = halo;
+  window.stride = terrain_chunkSize + 2 * halo;
+
+  LS_ERROR_IF(pStream == nullptr || pFunc == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(halo > terrain_chunkSize, lsR_ArgumentOutOfBounds);
+
+  LS_ERROR_CHECK(lsAlloc(&window.pTiles, window.stride * window.stride));
+
+  for (chunkY = 0; chunkY < pStream->chunkCountY; chunkY++)
+  {
+    for (chunkX = 0; chunkX < pStream->chunkCountX; chunkX++)
+    {
+      const size_t neighbourRange = halo > 0 ? 1 : 0;
+
+      // The columns the chunks ahead of us will need.
+      {
+        const size_t ahead = chunkY * pStream->chunkCountX + chunkX + terrainStream_PrefetchDistance;
+        const size_t aheadX = ahead % pStream->chunkCountX;
+        const size_t aheadY = ahead / pStream->chunkCountX;
+
+        for (size_t y = aheadY - neighbourRange; y != aheadY + neighbourRange + 1; y++)
+          for (size_t x = aheadX; x <= aheadX + neighbourRange; x++)
+            terrainStream_prefetchChunk(pStream, x, y);
+      }
+
+      for (size_t dy = 1 - neighbourRange; dy <= 1 + neighbourRange; dy++)
+      {
+        for (size_t dx = 1 - neighbourRange; dx <= 1 + neighbourRange; dx++)
+        {
+          const size_t x = chunkX + dx - 1;
+          const size_t y = chunkY + dy - 1;
+
+          if (x < pStream->chunkCountX && y < pStream->chunkCountY)
+            LS_ERROR_CHECK(terrainStream_acquireChunk(pStream, x, y, &pNeighbours[dy][dx]));
+        }
+      }
+
+      // The window row `wy` is `terrain_chunkSize + wy - halo` tiles below the top of the chunk row above.
+      for (size_t wy = 0; wy < window.stride; wy++)
+      {
+        const size_t offsetY = terrain_chunkSize + wy - halo;
+        const size_t localY = offsetY % terrain_chunkSize;
+        tile *pWindowRow = window.pTiles + wy * window.stride;
+
+        const size_t columnStarts[3] = { 0, halo, halo + terrain_chunkSize };
+        const size_t columnWidths[3] = { halo, terrain_chunkSize, halo };
+        const size_t columnLocalX[3] = { terrain_chunkSize - halo, 0, 0 };
+
+        for (size_t column = 0; column < 3; column++)
+        {
+          const tile *pChunk = pNeighbours[offsetY / terrain_chunkSize][column];
+
+          if (pChunk == nullptr)
+            lsZeroMemory(pWindowRow + columnStarts[column], columnWidths[column]);
+          else
+            lsMemcpy(pWindowRow + columnStarts[column], pChunk + localY * terrain_chunkSize + columnLocalX[column], columnWidths[column]);
+        }
+      }
+
+      window.chunkX = chunkX;
+      window.chunkY = chunkY;
+
+      const lsResult funcResult = pFunc(pUserData, &window);
+
+      // Tiles of the chunk outside of the terrain stay zero.
+      if (LS_SUCCESS(funcResult))
+      {
+        const size_t validWidth = lsMin(terrain_chunkSize, pStream->width - chunkX * terrain_chunkSize);
+        const size_t validHeight = lsMin(terrain_chunkSize, pStream->height - chunkY * terrain_chunkSize);
+
+        for (size_t y = 0; y < validHeight; y++)
+          lsMemcpy(pNeighbours[1][1] + y * terrain_chunkSize, window.pTiles + (y + halo) * window.stride + halo, validWidth);
+      }
+
+      for (size_t dy = 0; dy < 3; dy++)
+      {
+        for (size_t dx = 0; dx < 3; dx++)
+        {
+          if (pNeighbours[dy][dx] != nullptr)
+          {
+            terrainStream_releaseChunk(pStream, chunkX + dx - 1, chunkY + dy - 1, dx == 1 && dy == 1 && LS_SUCCESS(funcResult));
+            pNeighbours[dy][dx] = nullptr;
+          }
+        }
+      }
+
+      LS_ERROR_CHECK(funcResult);
+    }
+  }
+
+epilogue:
+  // Only if acquiring a chunk failed.
+  if (pStream != nullptr)
+    for (size_t dy = 0; dy < 3; dy++)
+      for (size_t dx = 0; dx < 3; dx++)
+        if (pNeighbours[dy][dx] != nullptr)
+          terrainStream_releaseChunk(pStream, chunkX + dx - 1, chunkY + dy - 1, false);
+
+  lsFreePtr(&window.pTiles);
+
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(7)
+
+static void terrainStream_TestFill(terrain *pTerrain, const uint64_t seed)
+{
+  rand_seed rand(seed, seed + 1);
+
+  for (size_t i = 0; i < (size_t)pTerrain->width * pTerrain->height; i++)
+    for (size_t layer = 0; layer < tt_count; layer++)
+      pTerrain->pTiles[i].layerHeights[layer] = (uint16_t)lsGetRand(rand);
+}
+
+DEFINE_TESTABLE(terrainStream_TestFileRoundTrip)
+{
+  lsResult result = lsR_Success;
+
+  const char *filename = "terrainStream_TestFileRoundTrip.terrain";
+
+  terrain original;
+  terrain loaded;
+  lsZeroMemory(&original);
+  lsZeroMemory(&loaded);
+
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&original, 200, 130)); // with partial chunks.
+  terrainStream_TestFill(&original, 1);
+
+  for (size_t chunked = 0; chunked < 2; chunked++)
+  {
+    if (chunked)
+      TESTABLE_ASSERT_SUCCESS(terrain_writeChunked(&original, filename));
+    else
+      TESTABLE_ASSERT_SUCCESS(terrain_write(&original, filename));
+
+    terrain_destroy(&loaded);
+    TESTABLE_ASSERT_SUCCESS(terrain_read(&loaded, filename));
+
+    TESTABLE_ASSERT_EQUAL(loaded.width, original.width);
+    TESTABLE_ASSERT_EQUAL(loaded.height, original.height);
+    TESTABLE_ASSERT_EQUAL(memcmp(loaded.pTiles, original.pTiles, sizeof(tile) * original.width * original.height), 0);
+  }
+
+epilogue:
+  remove(filename);
+  terrain_destroy(&original);
+  terrain_destroy(&loaded);
+  return result;
+}
+
+static lsResult terrainStream_TestKernel(void *, terrain_stream_window *pWindow)
+{
+  // Reads the halo, but only writes a layer that isn't read.
+  for (size_t y = 0; y < terrain_chunkSize; y++)
+  {
+    for (size_t x = 0; x < terrain_chunkSize; x++)
+    {
+      tile *pTile = &pWindow->pTiles[(y + pWindow->halo) * pWindow->stride + x + pWindow->halo];
+      const tile *pLeft = pTile - 1;
+      const tile *pUp = pTile - pWindow->stride;
+
+      pTile->layerHeights[tt_stone] = (uint16_t)(pLeft->layerHeights[tt_bedrock] + pUp->layerHeights[tt_bedrock]);
+    }
+  }
+
+  return lsR_Success;
+}
+
+DEFINE_TESTABLE(terrainStream_TestSweepWithEviction)
+{
+  lsResult result = lsR_Success;
+
+  const char *filename = "terrainStream_TestSweepWithEviction.terrain";
+
+  terrain original;
+  terrain swept;
+  lsZeroMemory(&original);
+  lsZeroMemory(&swept);
+
+  thread_pool *pPool = nullptr;
+  terrain_stream *pStream = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&original, 600, 300)); // 50 chunks, more than the cache can hold.
+  terrainStream_TestFill(&original, 2);
+  TESTABLE_ASSERT_SUCCESS(terrain_writeChunked(&original, filename));
+
+  TESTABLE_ASSERT_FAILURE(terrainStream_create(&pStream, filename, terrain_chunkBytes * 4, pPool));
+  TESTABLE_ASSERT_SUCCESS(terrainStream_create(&pStream, filename, terrain_chunkBytes * terrainStream_MinCachedChunks, pPool));
+  TESTABLE_ASSERT_SUCCESS(terrainStream_sweep(pStream, 1, terrainStream_TestKernel, nullptr));
+  terrainStream_destroy(&pStream);
+
+  TESTABLE_ASSERT_SUCCESS(terrain_read(&swept, filename));
+
+  for (size_t y = 0; y < original.height; y++)
+  {
+    for (size_t x = 0; x < original.width; x++)
+    {
+      const size_t i = y * original.width + x;
+      const uint16_t left = x > 0 ? original.pTiles[i - 1].layerHeights[tt_bedrock] : 0;
+      const uint16_t up = y > 0 ? original.pTiles[i - original.width].layerHeights[tt_bedrock] : 0;
+
+      TESTABLE_ASSERT_EQUAL(swept.pTiles[i].layerHeights[tt_stone], (uint16_t)(left + up));
+      TESTABLE_ASSERT_EQUAL(swept.pTiles[i].layerHeights[tt_bedrock], original.pTiles[i].layerHeights[tt_bedrock]);
+      TESTABLE_ASSERT_EQUAL(swept.pTiles[i].layerHeights[tt_snow], original.pTiles[i].layerHeights[tt_snow]);
+    }
+  }
+
+epilogue:
+  terrainStream_destroy(&pStream);
+  threadPool_destroy(&pPool);
+  remove(filename);
+  terrain_destroy(&original);
+  terrain_destroy(&swept);
+  return result;
+}
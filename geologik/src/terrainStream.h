@@ -0,0 +1,50 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Out of core access to terrains in the chunked file format that are too large to fit into memory. Chunks are kept in an LRU cache
+// within a memory budget, loaded ahead of use on the thread pool and written back once they're evicted or the stream is flushed.
+
+struct terrain_stream;
+
+constexpr size_t terrainStream_PrefetchDistance = 4; // in chunks, ahead of the current one in sweep order.
+constexpr size_t terrainStream_MinCachedChunks = 9 + 3 * terrainStream_PrefetchDistance; // a chunk and its neighbours, plus prefetched ones.
+
+// Creates a zeroed terrain file in the chunked file format without the terrain having to be in memory.
+lsResult terrainStream_createFile(const char *filename, const uint16_t width, const uint16_t height);
+
+lsResult terrainStream_create(_Out_ terrain_stream **ppStream, const char *filename, const size_t memoryBudgetBytes, thread_pool *pPool);
+void terrainStream_destroy(terrain_stream **ppStream); // writes back all modified chunks.
+
+void terrainStream_getSize(const terrain_stream *pStream, _Out_ uint16_t *pWidth, _Out_ uint16_t *pHeight);
+
+// Chunks are pinned in the cache until they're released. Mark them as `modified` to have them written back.
+lsResult terrainStream_acquireChunk(terrain_stream *pStream, const size_t chunkX, const size_t chunkY, _Out_ tile **ppTiles);
+void terrainStream_releaseChunk(terrain_stream *pStream, const size_t chunkX, const size_t chunkY, const bool modified);
+
+// Starts loading the chunk on the thread pool if it isn't cached yet.
+void terrainStream_prefetchChunk(terrain_stream *pStream, const size_t chunkX, const size_t chunkY);
+
+// Writes back all modified chunks that aren't currently acquired.
+lsResult terrainStream_flush(terrain_stream *pStream);
+
+//////////////////////////////////////////////////////////////////////////
+
+// A chunk with `halo` tiles of its neighbours around it. Tiles outside of the terrain are zero.
+struct terrain_stream_window
+{
+  tile *pTiles; // the chunk starts at (`halo`, `halo`).
+  size_t stride; // `terrain_chunkSize + 2 * halo`
+  size_t halo;
+  size_t chunkX, chunkY;
+};
+
+typedef lsResult (terrain_stream_sweep_func)(void *pUserData, terrain_stream_window *pWindow);
+
+// Calls `pFunc` for every chunk in row major order while the chunks ahead are being loaded. Only the chunk itself is written back, so
+// the halo of a chunk already contains the results of the chunks before it.
+lsResult terrainStream_sweep(terrain_stream *pStream, const size_t halo, terrain_stream_sweep_func *pFunc, void *pUserData);
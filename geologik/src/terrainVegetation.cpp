@@ -0,0 +1,411 @@
+#include "terrainVegetation.h"
+
+#include "terrainColumns.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+struct terrain_vegetation_context
+{
+  terrain_vegetation *pVegetation;
+  terrain *pTerrain;
+  const terrain_flow *pFlow;
+  const terrain_vegetation_params *pParams;
+  float maxDrop; // height difference to a neighbour in decimeters, at the steepest slope grass grows on.
+  int32_t growth; // per update, in fixed point height units.
+  int32_t dieBack;
+  uint32_t maxGrass;
+  uint32_t floodDepth;
+};
+
+// Steepest difference to one of the four direct neighbours.
+static uint32_t terrainVegetation_getDrop_internal(const terrain *pTerrain, const size_t x, const size_t y)
+{
+  const size_t i = y * pTerrain->width + x;
+  const uint32_t height = pTerrain->pTotalHeights[i];
+  uint32_t lowest = height;
+  uint32_t highest = height;
+
+  if (x > 0)
+  {
+    lowest = lsMin(lowest, pTerrain->pTotalHeights[i - 1]);
+    highest = lsMax(highest, pTerrain->pTotalHeights[i - 1]);
+  }
+
+  if (x + 1 < pTerrain->width)
+  {
+    lowest = lsMin(lowest, pTerrain->pTotalHeights[i + 1]);
+    highest = lsMax(highest, pTerrain->pTotalHeights[i + 1]);
+  }
+
+  if (y > 0)
+  {
+    lowest = lsMin(lowest, pTerrain->pTotalHeights[i - pTerrain->width]);
+    highest = lsMax(highest, pTerrain->pTotalHeights[i - pTerrain->width]);
+  }
+
+  if (y + 1 < pTerrain->height)
+  {
+    lowest = lsMin(lowest, pTerrain->pTotalHeights[i + pTerrain->width]);
+    highest = lsMax(highest, pTerrain->pTotalHeights[i + pTerrain->width]);
+  }
+
+  return lsMax(height - lowest, highest - height);
+}
+
+// Grass and soil swap material, so the total heights stay the same.
+static void terrainVegetation_updateChunk_internal(void *pUserData, const size_t index)
+{
+  terrain_vegetation_context *pContext = reinterpret_cast<terrain_vegetation_context *>(pUserData);
+  terrain *pTerrain = pContext->pTerrain;
+  const terrain_flow *pFlow = pContext->pFlow;
+
+  const size_t chunk = pContext->pVegetation->pActiveChunks[index];
+  const size_t x0 = (chunk % pTerrain->chunkCountX) * terrain_chunkSize;
+  const size_t y0 = (chunk / pTerrain->chunkCountX) * terrain_chunkSize;
+  const size_t width = lsMin(terrain_chunkSize, pTerrain->width - x0);
+  const size_t height = lsMin(terrain_chunkSize, pTerrain->height - y0);
+  bool growing = false;
+
+  for (size_t y = y0; y < y0 + height; y++)
+  {
+    for (size_t x = x0; x < x0 + width; x++)
+    {
+      const size_t i = y * pTerrain->width + x;
+      const tile *pTile = &pTerrain->pTiles[i];
+
+      if (pTile->layerHeights[tt_snow] != 0)
+        continue;
+
+      const uint32_t water = terrain_getFixedHeight(pTerrain, i, tt_water);
+      const uint32_t grass = terrain_getFixedHeight(pTerrain, i, tt_grass);
+      const uint32_t soil = terrain_getFixedHeight(pTerrain, i, tt_soil);
+      const bool moist = water != 0 || (pFlow != nullptr && pFlow->pAccumulation[i] >= pContext->pParams->moistAccumulation);
+      const bool habitable = moist && water <= pContext->floodDepth && (float)terrainVegetation_getDrop_internal(pTerrain, x, y) <= pContext->maxDrop;
+      int32_t change = 0;
+
+      if (habitable)
+        change = (int32_t)lsMin((uint32_t)pContext->growth, lsMin(pContext->maxGrass - lsMin(grass, pContext->maxGrass), soil));
+      else
+        change = -(int32_t)lsMin((uint32_t)pContext->dieBack, grass);
+
+      if (change == 0)
+        continue;
+
+      change = terrain_addFixedHeight(pTerrain, i, tt_grass, change);
+      terrain_addFixedHeight(pTerrain, i, tt_soil, -change);
+      growing = true;
+    }
+  }
+
+  pContext->pVegetation->pGrowingChunks[chunk] = growing;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult terrainVegetation_init(_Out_ terrain_vegetation *pVegetation, terrain *pTerrain)
+{
+  lsResult result = lsR_Success;
+
+  size_t chunkCount = 0;
+
+  LS_ERROR_IF(pVegetation == nullptr || pTerrain == nullptr, lsR_ArgumentNull);
+
+  lsZeroMemory(pVegetation);
+  pVegetation->width = pTerrain->width;
+  pVegetation->height = pTerrain->height;
+
+  chunkCount = (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY;
+
+  LS_ERROR_CHECK(lsAllocZero(&pVegetation->pGrowingChunks, chunkCount));
+  LS_ERROR_CHECK(lsAllocZero(&pVegetation->pSeenVersions, chunkCount));
+  LS_ERROR_CHECK(lsAlloc(&pVegetation->pActiveChunks, chunkCount));
+  LS_ERROR_CHECK(terrain_enableFractions(pTerrain, (1U << tt_grass) | (1U << tt_soil)));
+
+epilogue:
+  if (LS_FAILED(result) && pVegetation != nullptr)
+    terrainVegetation_destroy(pVegetation);
+
+  return result;
+}
+
+void terrainVegetation_destroy(terrain_vegetation *pVegetation)
+{
+  if (pVegetation == nullptr)
+    return;
+
+  lsFreePtr(&pVegetation->pGrowingChunks);
+  lsFreePtr(&pVegetation->pSeenVersions);
+  lsFreePtr(&pVegetation->pActiveChunks);
+}
+
+lsResult terrainVegetation_step(terrain_vegetation *pVegetation, terrain *pTerrain, const terrain_flow *pFlow, const terrain_vegetation_params *pParams, thread_pool *pPool)
+{
+  lsResult result = lsR_Success;
+
+  terrain_vegetation_context context = { pVegetation, pTerrain, pFlow, pParams, 0, 0, 0, 0, 0 };
+  size_t chunkCount = 0;
+  size_t activeCount = 0;
+
+  LS_ERROR_IF(pVegetation == nullptr || pTerrain == nullptr || pParams == nullptr || pPool == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pVegetation->width != pTerrain->width || pVegetation->height != pTerrain->height || (pFlow != nullptr && (pFlow->width != pTerrain->width || pFlow->height != pTerrain->height)), lsR_ArgumentOutOfBounds);
+  LS_ERROR_IF(pParams->interval == 0 || pParams->growthRate < 0 || pParams->dieBackRate < 0 || pParams->maxGrass < 0 || pParams->floodDepth < 0, lsR_ArgumentOutOfBounds);
+
+  pVegetation->stepCount++;
+
+  if (pVegetation->stepCount % pParams->interval != 0)
+    goto epilogue;
+
+  LS_ERROR_CHECK(terrainColumns_update(pTerrain, pPool));
+
+  context.maxDrop = tanf(pParams->maxSlope * (float)(3.14159265358979 / 180.0)) * terrain_tileSize;
+  context.growth = (int32_t)lsMin(pParams->growthRate * (float)pParams->interval * terrain_fixedOne + 0.5f, (float)INT32_MAX);
+  context.dieBack = (int32_t)lsMin(pParams->dieBackRate * (float)pParams->interval * terrain_fixedOne + 0.5f, (float)INT32_MAX);
+  context.maxGrass = (uint32_t)lsMin(pParams->maxGrass * terrain_fixedOne + 0.5f, (float)UINT32_MAX);
+  context.floodDepth = (uint32_t)lsMin(pParams->floodDepth * terrain_fixedOne + 0.5f, (float)UINT32_MAX);
+
+  chunkCount = (size_t)pTerrain->chunkCountX * pTerrain->chunkCountY;
+
+  for (size_t chunk = 0; chunk < chunkCount; chunk++)
+    if (pVegetation->pGrowingChunks[chunk] || pVegetation->pSeenVersions[chunk] != pTerrain->pChunkVersions[chunk])
+      pVegetation->pActiveChunks[activeCount++] = (uint32_t)chunk;
+
+  threadPool_parallelFor(pPool, activeCount, terrainVegetation_updateChunk_internal, &context);
+
+  for (size_t i = 0; i < activeCount; i++)
+  {
+    const size_t chunk = pVegetation->pActiveChunks[i];
+    const size_t x = (chunk % pTerrain->chunkCountX) * terrain_chunkSize;
+    const size_t y = (chunk / pTerrain->chunkCountX) * terrain_chunkSize;
+
+    if (pVegetation->pGrowingChunks[chunk])
+      terrain_markDirty(pTerrain, x, y, lsMin(terrain_chunkSize, pTerrain->width - x), lsMin(terrain_chunkSize, pTerrain->height - y));
+
+    pVegetation->pSeenVersions[chunk] = pTerrain->pChunkVersions[chunk];
+  }
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(18)
+
+#include "terrainSediment.h"
+
+DEFINE_TESTABLE(terrainVegetation_TestGrowth)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_vegetation vegetation;
+  lsZeroMemory(&vegetation);
+
+  thread_pool *pPool = nullptr;
+  terrain_vegetation_params params;
+  params.interval = 4;
+  params.growthRate = 0.05f;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 40, 10));
+  TESTABLE_ASSERT_SUCCESS(terrainVegetation_init(&vegetation, &t));
+
+  // Moist, flooded and dry rows of soil, with a cliff in the east.
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      tile *pTile = &t.pTiles[y * t.width + x];
+
+      lsZeroMemory(pTile);
+      pTile->layerHeights[tt_bedrock] = 8;
+      pTile->layerHeights[tt_stone] = (uint16_t)(x > 30 ? (x - 30) * 100 : 0);
+      pTile->layerHeights[tt_soil] = 10;
+      pTile->layerHeights[tt_water] = (uint16_t)(y < 3 ? 1 : (y < 6 ? 5 : 0));
+    }
+  }
+
+  terrain_markAllDirty(&t);
+
+  // Nothing happens between updates.
+  for (size_t step = 0; step < 3; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainVegetation_step(&vegetation, &t, nullptr, &params, pPool));
+
+  for (size_t i = 0; i < (size_t)t.width * t.height; i++)
+    TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, i, tt_grass), 0u);
+
+  terrain_clearChunkDirty(&t, 0, 0);
+  TESTABLE_ASSERT_SUCCESS(terrainVegetation_step(&vegetation, &t, nullptr, &params, pPool));
+
+  // The update grows for the whole interval, but only on moist and flat soil.
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      const size_t i = y * t.width + x;
+      const uint32_t grass = terrain_getFixedHeight(&t, i, tt_grass);
+
+      if (y < 3 && x < 30)
+        TESTABLE_ASSERT_EQUAL(grass, (uint32_t)(0.2f * terrain_fixedOne + 0.5f));
+      else
+        TESTABLE_ASSERT_EQUAL(grass, 0u);
+
+      TESTABLE_ASSERT_EQUAL(grass + terrain_getFixedHeight(&t, i, tt_soil), 10 * terrain_fixedOne);
+    }
+  }
+
+  TESTABLE_ASSERT_EQUAL(terrain_isChunkDirty(&t, 0, 0), true);
+
+  // Until it's fully grown.
+  for (size_t step = 0; step < 400; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainVegetation_step(&vegetation, &t, nullptr, &params, pPool));
+
+  TESTABLE_ASSERT_EQUAL(t.pTiles[t.width + 5].layerHeights[tt_grass], 3);
+  TESTABLE_ASSERT_EQUAL(t.pTiles[t.width + 5].layerHeights[tt_soil], 7);
+  TESTABLE_ASSERT_EQUAL(vegetation.pGrowingChunks[0], false);
+
+epilogue:
+  terrainVegetation_destroy(&vegetation);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainVegetation_TestDieBack)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  terrain_vegetation vegetation;
+  lsZeroMemory(&vegetation);
+
+  thread_pool *pPool = nullptr;
+  terrain_vegetation_params params;
+  params.interval = 1;
+  params.growthRate = 0.1f;
+  params.dieBackRate = 0.3f;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 30, 8));
+  TESTABLE_ASSERT_SUCCESS(terrainVegetation_init(&vegetation, &t));
+
+  // A gentle slope falling towards the east, covered in grass. The south is under snow.
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      tile *pTile = &t.pTiles[y * t.width + x];
+
+      lsZeroMemory(pTile);
+      pTile->layerHeights[tt_bedrock] = 8;
+      pTile->layerHeights[tt_stone] = (uint16_t)(t.width - x);
+      pTile->layerHeights[tt_soil] = 5;
+      pTile->layerHeights[tt_grass] = 2;
+      pTile->layerHeights[tt_snow] = (uint16_t)(y + 2u >= t.height ? 3 : 0);
+    }
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &t, pPool));
+
+  for (size_t step = 0; step < 10; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainVegetation_step(&vegetation, &t, &flow, &params, pPool));
+
+  // Grass only survives where enough water drains through, or dormant under snow.
+  for (size_t y = 1; y < t.height - 1u; y++)
+  {
+    for (size_t x = 1; x < t.width - 1u; x++)
+    {
+      const size_t i = y * t.width + x;
+
+      if (y >= t.height - 2u)
+        TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, i, tt_grass), 2 * terrain_fixedOne);
+      else if (flow.pAccumulation[i] >= params.moistAccumulation)
+        TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, i, tt_grass) > 2 * terrain_fixedOne, true);
+      else
+        TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, i, tt_grass) < 2 * terrain_fixedOne, true);
+
+      TESTABLE_ASSERT_EQUAL(terrain_getFixedHeight(&t, i, tt_grass) + terrain_getFixedHeight(&t, i, tt_soil), 7 * terrain_fixedOne);
+    }
+  }
+
+  TESTABLE_ASSERT_EQUAL(t.pTiles[t.width + 1].layerHeights[tt_grass], 0);
+  TESTABLE_ASSERT_EQUAL(t.pTiles[t.width + t.width - 2].layerHeights[tt_grass] > 2, true);
+
+epilogue:
+  terrainVegetation_destroy(&vegetation);
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
+
+DEFINE_TESTABLE(terrainVegetation_TestRoots)
+{
+  lsResult result = lsR_Success;
+
+  terrain t;
+  lsZeroMemory(&t);
+
+  terrain_flow flow;
+  lsZeroMemory(&flow);
+
+  terrain_sediment sediment;
+  lsZeroMemory(&sediment);
+
+  thread_pool *pPool = nullptr;
+  terrain_sediment_params params;
+  params.capacity = 1.f;
+
+  int64_t bareLoss = 0;
+  int64_t grassyLoss = 0;
+
+  TESTABLE_ASSERT_SUCCESS(threadPool_create(&pPool, 2));
+  TESTABLE_ASSERT_SUCCESS(terrain_init(&t, 30, 12));
+  TESTABLE_ASSERT_SUCCESS(terrain_enableFractions(&t, (1U << tt_grass) | (1U << tt_soil) | (1U << tt_sand) | (1U << tt_stone)));
+  TESTABLE_ASSERT_SUCCESS(terrainSediment_init(&sediment, t.width, t.height));
+
+  // A steep slope of soil falling towards the east, with grass on the northern half.
+  for (size_t y = 0; y < t.height; y++)
+  {
+    for (size_t x = 0; x < t.width; x++)
+    {
+      tile *pTile = &t.pTiles[y * t.width + x];
+
+      lsZeroMemory(pTile);
+      pTile->layerHeights[tt_bedrock] = 8;
+      pTile->layerHeights[tt_soil] = (uint16_t)((t.width - x) * 20);
+      pTile->layerHeights[tt_grass] = (uint16_t)(y < t.height / 2 ? 6 : 0);
+      pTile->layerHeights[tt_soil] -= pTile->layerHeights[tt_grass];
+    }
+  }
+
+  TESTABLE_ASSERT_SUCCESS(terrainFlow_compute(&flow, &t, pPool));
+
+  for (size_t step = 0; step < 10; step++)
+    TESTABLE_ASSERT_SUCCESS(terrainSediment_step(&sediment, &t, &flow, &params, pPool));
+
+  // The soil erodes slower below grass.
+  for (size_t x = 5; x < 15; x++)
+  {
+    grassyLoss += (int64_t)((t.width - x) * 20 - 6) * terrain_fixedOne - terrain_getFixedHeight(&t, 3 * t.width + x, tt_soil);
+    bareLoss += (int64_t)((t.width - x) * 20) * terrain_fixedOne - terrain_getFixedHeight(&t, (t.height - 4) * t.width + x, tt_soil);
+  }
+
+  TESTABLE_ASSERT_EQUAL(bareLoss > 0, true);
+  TESTABLE_ASSERT_EQUAL(grassyLoss < bareLoss, true);
+
+epilogue:
+  terrainSediment_destroy(&sediment);
+  terrainFlow_destroy(&flow);
+  threadPool_destroy(&pPool);
+  terrain_destroy(&t);
+  return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core.h"
+#include "terrain.h"
+#include "terrainFlow.h"
+#include "terrainMaterial.h"
+#include "threadPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Grass. It grows out of moist soil at moderate slopes and turns back into soil where it's too steep, too dry or flooded. Snow keeps it
+// dormant. The roots protect the soil below from erosion, see `terrainMaterial_getRootFactor`.
+// Vegetation changes much slower than the terrain, so it's only updated every few steps, and only where the terrain changed since or
+// the grass was still growing or dying.
+
+struct terrain_vegetation_params
+{
+  uint32_t interval = 8; // steps between updates, which grow and die back for all of them at once.
+  float growthRate = 0.01f; // soil turning into grass per step, in decimeters.
+  float dieBackRate = 0.02f; // grass turning back into soil per step.
+  float maxGrass = 3.f; // in decimeters.
+  float maxSlope = 30.f; // in degrees.
+  uint32_t moistAccumulation = 4; // tiles draining through a tile to keep it moist. standing water always does.
+  float floodDepth = 2.f; // of standing water that drowns the grass, in decimeters.
+};
+
+struct terrain_vegetation
+{
+  uint16_t width, height;
+
+  size_t stepCount;
+  uint8_t *pGrowingChunks; // per chunk, whether the grass changed during the last update.
+  uint32_t *pSeenVersions; // `pChunkVersions` of the terrain after the chunk was last updated.
+  uint32_t *pActiveChunks;
+};
+
+// Enables fractions for grass and soil, since they change by much less than a decimeter.
+lsResult terrainVegetation_init(_Out_ terrain_vegetation *pVegetation, terrain *pTerrain);
+void terrainVegetation_destroy(terrain_vegetation *pVegetation);
+
+// Counts a step and updates the vegetation every `interval` steps. `pFlow` should be recent, or `nullptr` to only count standing water
+// as moisture. Updates the cached columns of `pTerrain` first.
+lsResult terrainVegetation_step(terrain_vegetation *pVegetation, terrain *pTerrain, const terrain_flow *pFlow, const terrain_vegetation_params *pParams, thread_pool *pPool);
@@ -0,0 +1,50 @@
+#include "uniformBuffer.h"
+
+#include "GL/glew.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult uniformBuffer_create(uniform_buffer *pBuffer, const size_t size, const uint32_t bindingPoint)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pBuffer == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(size == 0, lsR_InvalidParameter);
+
+  glCreateBuffers(1, &pBuffer->bufferId);
+  LS_ERROR_IF(pBuffer->bufferId == 0, lsR_ResourceInvalid);
+
+  pBuffer->size = size;
+  pBuffer->bindingPoint = bindingPoint;
+
+  glNamedBufferStorage(pBuffer->bufferId, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+  glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, pBuffer->bufferId);
+
+epilogue:
+  return result;
+}
+
+lsResult uniformBuffer_set(uniform_buffer *pBuffer, const uint8_t *pData, const size_t size)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pBuffer == nullptr || pData == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(!pBuffer->bufferId, lsR_ResourceStateInvalid);
+  LS_ERROR_IF(size > pBuffer->size, lsR_ArgumentOutOfBounds);
+
+  glNamedBufferSubData(pBuffer->bufferId, 0, size, pData);
+  glBindBufferBase(GL_UNIFORM_BUFFER, pBuffer->bindingPoint, pBuffer->bufferId);
+
+epilogue:
+  return result;
+}
+
+void uniformBuffer_destroy(uniform_buffer *pBuffer)
+{
+  if (pBuffer == nullptr || !pBuffer->bufferId)
+    return;
+
+  glDeleteBuffers(1, &pBuffer->bufferId);
+
+  pBuffer->bufferId = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "core.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Uniform block shared by all shaders bound to `bindingPoint` (see `shader_bindUniformBlock`).
+struct uniform_buffer
+{
+  uint32_t bufferId = 0; // this is actually a GLuint.
+
+  size_t size; // in bytes
+  uint32_t bindingPoint;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult uniformBuffer_create(uniform_buffer *pBuffer, const size_t size, const uint32_t bindingPoint);
+lsResult uniformBuffer_set(uniform_buffer *pBuffer, const uint8_t *pData, const size_t size);
+void uniformBuffer_destroy(uniform_buffer *pBuffer);
+
+// `T` has to match the std140 layout of the uniform block.
+template <typename T>
+lsResult uniformBuffer_create(uniform_buffer *pBuffer, const uint32_t bindingPoint)
+{
+  return uniformBuffer_create(pBuffer, sizeof(T), bindingPoint);
+}
+
+template <typename T>
+lsResult uniformBuffer_set(uniform_buffer *pBuffer, const T &data)
+{
+  return uniformBuffer_set(pBuffer, reinterpret_cast<const uint8_t *>(&data), sizeof(T));
+}
@@ -18,6 +18,7 @@ struct vb_attribute_float : vb_attribute
   static size_t getDataSize() { return sizeof(float_t) * TCount; };
 
   static GLenum getDataType() { return GL_FLOAT; };
+  static constexpr bool IsInteger = false;
 };
 
 template <size_t TCount, const char *TAttributeName>
@@ -29,6 +30,7 @@ struct vb_attribute_uint : vb_attribute
   static size_t getDataSize() { return sizeof(uint32_t) * TCount; };
 
   static GLenum getDataType() { return GL_UNSIGNED_INT; };
+  static constexpr bool IsInteger = true;
 };
 
 template <size_t TCount, const char *TAttributeName>
@@ -39,7 +41,8 @@ struct vb_attribute_vec2u32 : vb_attribute
   static size_t getValuesPerBlock() { return TCount; };
   static size_t getDataSize() { return sizeof(vec2u32) * TCount; };
 
-  static GLenum getDataType() { return GL_INT_VEC2; };
+  static GLenum getDataType() { return GL_UNSIGNED_INT; };
+  static constexpr bool IsInteger = true;
 };
 
 template <const char *TAttributeName>
@@ -49,6 +52,7 @@ struct vb_attribute_mat4 : vb_attribute
   static size_t getDataSize() { return sizeof(float_t) * 4 * 4; };
 
   static GLenum getDataType() { return GL_FLOAT; };
+  static constexpr bool IsInteger = false;
 };
 
 template <typename ...Args>
@@ -77,7 +81,11 @@ struct vb_attributeQuery_internal<T>
     const uint32_t attributeIndex = shader_getAttributeIndex(pShader, T::getAttributeName());
     
     glEnableVertexAttribArray(attributeIndex);
-    glVertexAttribPointer(attributeIndex, (GLint)T::getSingleSize(), T::getDataType(), GL_FALSE, (GLsizei)totalSize, (const void *)offset);
+
+    if constexpr (T::IsInteger)
+      glVertexAttribIPointer(attributeIndex, (GLint)(T::getDataSize() / sizeof(uint32_t)), T::getDataType(), (GLsizei)totalSize, (const void *)offset); // integer attributes (`uint`, `uvec2`) must not be converted to float.
+    else
+      glVertexAttribPointer(attributeIndex, (GLint)T::getSingleSize(), T::getDataType(), GL_FALSE, (GLsizei)totalSize, (const void *)offset);
 
     if (instanced)
       glVertexAttribDivisor(attributeIndex, 1);
@@ -87,7 +95,7 @@ struct vb_attributeQuery_internal<T>
 template <const char *TAttributeName>
 struct vb_attributeQuery_internal<vb_attribute_mat4<TAttributeName>>
 {
-  static size_t getSize() { return vb_attribute_mat4::getDataSize(); };
+  static size_t getSize() { return vb_attribute_mat4<TAttributeName>::getDataSize(); };
 
   static void setAttribute(shader *pShader, const size_t totalSize, const size_t offset, const bool instanced)
   {
@@ -320,3 +328,44 @@ inline void instancedVertexBuffer_render(instancedVertexBuffer<T, Args...> *pBuf
 
   glDrawArraysInstanced(pBuffer->instancedBuffer.renderMode, 0, (GLsizei)pBuffer->instancedBuffer.count, (GLsizei)pBuffer->instanceCount);
 }
+
+// Binds the vertex & instance attributes once. Use with `instancedVertexBuffer_renderRange` or `instancedVertexBuffer_renderIndirect` to submit multiple batches from the same instance buffer.
+template<typename T, typename ...Args>
+inline void instancedVertexBuffer_setAttributes(instancedVertexBuffer<T, Args...> *pBuffer)
+{
+  vertexBuffer_setAttributes(&pBuffer->instancedBuffer);
+
+  lsAssert(pBuffer->instancedBuffer.initialized);
+  lsAssert(pBuffer->hasInstanceData);
+
+  glBindBuffer(GL_ARRAY_BUFFER, pBuffer->instanceVBO);
+
+  vb_attributeQuery_internal_setAttributes<Args...>(pBuffer->instancedBuffer.pShader, true);
+}
+
+// Requires `instancedVertexBuffer_setAttributes` to have been called.
+template<typename T, typename ...Args>
+inline void instancedVertexBuffer_renderRange(instancedVertexBuffer<T, Args...> *pBuffer, const size_t firstInstance, const size_t instanceCount)
+{
+  lsAssert(firstInstance + instanceCount <= pBuffer->instanceCount);
+
+  glDrawArraysInstancedBaseInstance(pBuffer->instancedBuffer.renderMode, 0, (GLsizei)pBuffer->instancedBuffer.count, (GLsizei)instanceCount, (GLuint)firstInstance);
+}
+
+// Layout of a single command in the `GL_DRAW_INDIRECT_BUFFER` consumed by `instancedVertexBuffer_renderIndirect`.
+struct vb_drawArraysIndirectCommand
+{
+  uint32_t vertexCount;
+  uint32_t instanceCount;
+  uint32_t firstVertex;
+  uint32_t baseInstance; // selects the per-instance attributes of this draw.
+};
+
+// Requires `instancedVertexBuffer_setAttributes` to have been called and `indirectBuffer` to contain `drawCount` `vb_drawArraysIndirectCommand`s.
+template<typename T, typename ...Args>
+inline void instancedVertexBuffer_renderIndirect(instancedVertexBuffer<T, Args...> *pBuffer, const GLuint indirectBuffer, const size_t drawCount)
+{
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+  glMultiDrawArraysIndirect(pBuffer->instancedBuffer.renderMode, nullptr, (GLsizei)drawCount, sizeof(vb_drawArraysIndirectCommand));
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,304 @@
+#include "vmathBatch.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Copies the last `count < vmathBatch_Lanes` values into a full batch, repeating the last one.
+template <typename T>
+static void vmathBatch_padTail_internal(_Out_ T *pPadded, const T *pValues, const size_t count)
+{
+  for (size_t i = 0; i < vmathBatch_Lanes; i++)
+    pPadded[i] = pValues[lsMin(i, count - 1)];
+}
+
+lsResult vec3_batch::TransformCoordStream(_Out_ vec3f *pOutput, _In_ const vec3f *pInput, const size_t count, const matrix &matrix)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pOutput == nullptr || pInput == nullptr, lsR_ArgumentNull);
+
+  {
+    size_t i = 0;
+
+    for (; i + vmathBatch_Lanes <= count; i += vmathBatch_Lanes)
+      vec3_batch::Load(pInput + i).TransformCoord(matrix).Store(pOutput + i);
+
+    if (i < count)
+    {
+      vec3f values[vmathBatch_Lanes];
+      vmathBatch_padTail_internal(values, pInput + i, count - i);
+
+      vec3_batch::Load(values).TransformCoord(matrix).Store(values);
+      lsMemcpy(pOutput + i, values, count - i);
+    }
+  }
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+frustum frustum::FromViewProjection(const matrix &viewProjection)
+{
+  const matrix &m = viewProjection;
+
+  // Row vectors, so clip space coordinates are the dot products with the columns.
+  const vec4f x = vec4f(m._11, m._21, m._31, m._41);
+  const vec4f y = vec4f(m._12, m._22, m._32, m._42);
+  const vec4f z = vec4f(m._13, m._23, m._33, m._43);
+  const vec4f w = vec4f(m._14, m._24, m._34, m._44);
+
+  frustum ret;
+  ret.planes[0] = w + x; // -w <= x
+  ret.planes[1] = w - x; // x <= w
+  ret.planes[2] = w + y;
+  ret.planes[3] = w - y;
+  ret.planes[4] = z; // 0 <= z
+  ret.planes[5] = w - z;
+
+  return ret;
+}
+
+simd_mask<float_t, vmathBatch_Lanes> frustum::IntersectsBoxes(const vec3_batch &min, const vec3_batch &max) const
+{
+  const batch_lanes zero = simd_set<vmathBatch_Lanes>(0.f);
+  simd_mask<float_t, vmathBatch_Lanes> intersects = simd_equal(zero, zero);
+
+  // The corner furthest inside of each plane decides whether the box is entirely outside of it.
+  for (size_t i = 0; i < LS_ARRAYSIZE(planes); i++)
+  {
+    const vec4f &plane = planes[i];
+
+    const batch_lanes distance = (plane.x >= 0 ? max.x : min.x) * simd_set<vmathBatch_Lanes>(plane.x)
+      + (plane.y >= 0 ? max.y : min.y) * simd_set<vmathBatch_Lanes>(plane.y)
+      + (plane.z >= 0 ? max.z : min.z) * simd_set<vmathBatch_Lanes>(plane.z)
+      + simd_set<vmathBatch_Lanes>(plane.w);
+
+    intersects = intersects & (simd_greater(distance, zero) | simd_equal(distance, zero));
+  }
+
+  return intersects;
+}
+
+lsResult frustum::IntersectsBoxStream(_Out_ bool *pIntersects, _In_ const vec3f *pMins, _In_ const vec3f *pMaxs, const size_t count) const
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pIntersects == nullptr || pMins == nullptr || pMaxs == nullptr, lsR_ArgumentNull);
+
+  for (size_t i = 0; i < count; i += vmathBatch_Lanes)
+  {
+    const size_t batchCount = lsMin(count - i, vmathBatch_Lanes);
+    uint32_t bits;
+
+    if (batchCount == vmathBatch_Lanes)
+    {
+      bits = simd_getMaskBits(IntersectsBoxes(vec3_batch::Load(pMins + i), vec3_batch::Load(pMaxs + i)));
+    }
+    else
+    {
+      vec3f mins[vmathBatch_Lanes];
+      vec3f maxs[vmathBatch_Lanes];
+      vmathBatch_padTail_internal(mins, pMins + i, batchCount);
+      vmathBatch_padTail_internal(maxs, pMaxs + i, batchCount);
+
+      bits = simd_getMaskBits(IntersectsBoxes(vec3_batch::Load(mins), vec3_batch::Load(maxs)));
+    }
+
+    for (size_t j = 0; j < batchCount; j++)
+      pIntersects[i + j] = (bits >> j) & 1;
+  }
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "testable.h"
+REGISTER_TESTABLE_FILE(22)
+
+// Like `terrainPreview_project_internal`, one point at a time.
+static vec3f vmathBatch_TestTransformCoord(const vec3f &v, const matrix &m)
+{
+  const float_t x = v.x * m._11 + v.y * m._21 + v.z * m._31 + m._41;
+  const float_t y = v.x * m._12 + v.y * m._22 + v.z * m._32 + m._42;
+  const float_t z = v.x * m._13 + v.y * m._23 + v.z * m._33 + m._43;
+  const float_t w = v.x * m._14 + v.y * m._24 + v.z * m._34 + m._44;
+
+  return vec3f(x / w, y / w, z / w);
+}
+
+static bool vmathBatch_TestIntersectsBox(const frustum &f, const vec3f &min, const vec3f &max)
+{
+  for (size_t i = 0; i < LS_ARRAYSIZE(f.planes); i++)
+  {
+    const vec4f &plane = f.planes[i];
+
+    if ((plane.x >= 0 ? max.x : min.x) * plane.x + (plane.y >= 0 ? max.y : min.y) * plane.y + (plane.z >= 0 ? max.z : min.z) * plane.z + plane.w < 0)
+      return false;
+  }
+
+  return true;
+}
+
+static bool vmathBatch_TestClose(const vec3f &a, const vec3f &b)
+{
+  return fabsf(a.x - b.x) < 1e-4f && fabsf(a.y - b.y) < 1e-4f && fabsf(a.z - b.z) < 1e-4f;
+}
+
+DEFINE_TESTABLE(vmathBatch_TestVectors)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t count = 19; // with a tail.
+  const matrix viewProjection = matrix::LookAtLH(vec(3.f, -20.f, 15.f), vec(0.f, 0.f, 0.f), vec(0.f, 0.f, 1.f)) * matrix::PerspectiveFovLH(1.f, 1.5f, 0.5f, 100.f);
+
+  vec3f points[count];
+  vec3f transformed[count];
+  float_t dots[vmathBatch_Lanes];
+  vec3f normalized[vmathBatch_Lanes];
+  vec3f crossed[vmathBatch_Lanes];
+
+  for (size_t i = 0; i < count; i++)
+    points[i] = vec3f((float_t)i - 9.f, (float_t)(i % 5), 0.5f * (float_t)(i % 3) + 1.f);
+
+  TESTABLE_ASSERT_FAILURE(vec3_batch::TransformCoordStream(nullptr, points, count, viewProjection));
+  TESTABLE_ASSERT_SUCCESS(vec3_batch::TransformCoordStream(transformed, points, count, viewProjection));
+
+  for (size_t i = 0; i < count; i++)
+    TESTABLE_ASSERT_TRUE(vmathBatch_TestClose(transformed[i], vmathBatch_TestTransformCoord(points[i], viewProjection)));
+
+  {
+    const vec3_batch a = vec3_batch::Load(points);
+    const vec3_batch b = vec3_batch::Load(points + vmathBatch_Lanes);
+
+    simd_store(dots, a.Dot(b));
+    a.Normalize().Store(normalized);
+    a.Cross(b).Store(crossed);
+  }
+
+  for (size_t i = 0; i < vmathBatch_Lanes; i++)
+  {
+    const vec3f &a = points[i];
+    const vec3f &b = points[i + vmathBatch_Lanes];
+
+    TESTABLE_ASSERT_EQUAL(dots[i], a.x * b.x + a.y * b.y + a.z * b.z);
+    TESTABLE_ASSERT_TRUE(vmathBatch_TestClose(normalized[i], a.Normalize()));
+    TESTABLE_ASSERT_TRUE(vmathBatch_TestClose(crossed[i], vec3f(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x)));
+  }
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(vmathBatch_TestFrustum)
+{
+  lsResult result = lsR_Success;
+
+  // Looking north from the south, the near plane is at `y = -9.5` and the far plane at `y = 90`. Boxes in front of, behind, beside and
+  // across the planes.
+  const matrix viewProjection = matrix::LookAtLH(vec(0.f, -10.f, 0.f), vec(0.f, 0.f, 0.f), vec(0.f, 0.f, 1.f)) * matrix::PerspectiveFovLH(1.f, 1.f, 0.5f, 100.f);
+  const frustum f = frustum::FromViewProjection(viewProjection);
+
+  const vec3f mins[] = { vec3f(-1, -1, -1), vec3f(-1, -20, -1), vec3f(-1, 85, -1), vec3f(50, -1, -1), vec3f(-100, 50, -100), vec3f(-1, -10.2f, -1), vec3f(-1, -10.2f, -1), vec3f(-1, 60, 60), vec3f(2, 0, 0) };
+  const vec3f maxs[] = { vec3f(1, 1, 1), vec3f(1, -15, 1), vec3f(1, 200, 1), vec3f(60, 1, 1), vec3f(100, 51, 100), vec3f(1, -9.4f, 1), vec3f(1, -9.8f, 1), vec3f(1, 61, 61), vec3f(3, 1, 1) };
+  const bool expected[] = { true, false, true, false, true, true, false, false, true };
+  bool intersects[LS_ARRAYSIZE(mins)];
+
+  static_assert(LS_ARRAYSIZE(mins) == LS_ARRAYSIZE(maxs) && LS_ARRAYSIZE(mins) == LS_ARRAYSIZE(expected));
+
+  TESTABLE_ASSERT_SUCCESS(f.IntersectsBoxStream(intersects, mins, maxs, LS_ARRAYSIZE(mins)));
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(mins); i++)
+  {
+    TESTABLE_ASSERT_EQUAL(intersects[i], expected[i]);
+    TESTABLE_ASSERT_EQUAL(intersects[i], vmathBatch_TestIntersectsBox(f, mins[i], maxs[i]));
+  }
+
+epilogue:
+  return result;
+}
+
+DEFINE_BENCHMARK(vmathBatch_BenchmarkStreams)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t count = 64 * 1024;
+  constexpr size_t repetitions = 32;
+
+  const matrix viewProjection = matrix::LookAtLH(vec(0.f, -10.f, 5.f), vec(0.f, 0.f, 0.f), vec(0.f, 0.f, 1.f)) * matrix::PerspectiveFovLH(1.f, 1.f, 0.5f, 100.f);
+  const frustum f = frustum::FromViewProjection(viewProjection);
+
+  vec3f *pMins = nullptr;
+  vec3f *pMaxs = nullptr;
+  vec3f *pTransformed = nullptr;
+  bool *pIntersects = nullptr;
+  rand_seed seed(7, 11);
+  size_t scalarCount = 0;
+  size_t batchCount = 0;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pMins, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pMaxs, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pTransformed, count));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pIntersects, count));
+
+  for (size_t i = 0; i < count; i++)
+  {
+    pMins[i] = vec3f((float_t)(lsGetRand(seed) % 200) - 100.f, (float_t)(lsGetRand(seed) % 200) - 100.f, (float_t)(lsGetRand(seed) % 20) - 10.f);
+    pMaxs[i] = vec3f(pMins[i].x + 2.f, pMins[i].y + 2.f, pMins[i].z + 2.f);
+  }
+
+  {
+    const int64_t start = lsGetCurrentTimeNs();
+
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+      for (size_t i = 0; i < count; i++)
+        pTransformed[i] = vmathBatch_TestTransformCoord(pMins[i], viewProjection);
+
+    const int64_t scalarNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    const int64_t batchStart = lsGetCurrentTimeNs();
+
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+      TESTABLE_ASSERT_SUCCESS(vec3_batch::TransformCoordStream(pTransformed, pMins, count, viewProjection));
+
+    const int64_t batchNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - batchStart);
+
+    print("vmathBatch TransformCoord: ", (double)scalarNs / (double)(count * repetitions), " ns per point scalar, ", (double)batchNs / (double)(count * repetitions), " ns batched, ", (double)scalarNs / (double)batchNs, "x\n");
+  }
+
+  {
+    const int64_t start = lsGetCurrentTimeNs();
+
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+      for (size_t i = 0; i < count; i++)
+        pIntersects[i] = vmathBatch_TestIntersectsBox(f, pMins[i], pMaxs[i]);
+
+    const int64_t scalarNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - start);
+
+    for (size_t i = 0; i < count; i++)
+      scalarCount += pIntersects[i];
+
+    const int64_t batchStart = lsGetCurrentTimeNs();
+
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+      TESTABLE_ASSERT_SUCCESS(f.IntersectsBoxStream(pIntersects, pMins, pMaxs, count));
+
+    const int64_t batchNs = lsMax((int64_t)1, lsGetCurrentTimeNs() - batchStart);
+
+    for (size_t i = 0; i < count; i++)
+      batchCount += pIntersects[i];
+
+    print("vmathBatch IntersectsBox: ", (double)scalarNs / (double)(count * repetitions), " ns per box scalar, ", (double)batchNs / (double)(count * repetitions), " ns batched, ", (double)scalarNs / (double)batchNs, "x\n");
+  }
+
+  TESTABLE_ASSERT_EQUAL(scalarCount, batchCount);
+
+epilogue:
+  lsFreePtr(&pMins);
+  lsFreePtr(&pMaxs);
+  lsFreePtr(&pTransformed);
+  lsFreePtr(&pIntersects);
+  return result;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "core.h"
+#include "simd.h"
+#include "vmath.h"
+
+//////////////////////////////////////////////////////////////////////////
+
+// Structure of arrays counterparts of `vec` for bulk data. A batch holds `vmathBatch_Lanes` vectors with a register per component, so
+// all of them are processed at once instead of spending the lanes of a `vec` on a single one. Matrices are applied to row vectors,
+// like `vec::Transform3`.
+
+constexpr size_t vmathBatch_Lanes = 8;
+using batch_lanes = simd<float_t, vmathBatch_Lanes>;
+
+struct vec4_batch;
+
+static_assert(sizeof(vec3f) == sizeof(float_t) * 3, "`vec3_batch::Load` expects packed `vec3f`s.");
+
+struct vec3_batch
+{
+  batch_lanes x, y, z;
+
+  inline static vec3_batch Set(const vec3f &v) { return { simd_set<vmathBatch_Lanes>(v.x), simd_set<vmathBatch_Lanes>(v.y), simd_set<vmathBatch_Lanes>(v.z) }; }
+  inline static vec3_batch LoadComponents(const float_t *pX, const float_t *pY, const float_t *pZ) { return { simd_load<vmathBatch_Lanes>(pX), simd_load<vmathBatch_Lanes>(pY), simd_load<vmathBatch_Lanes>(pZ) }; }
+
+  inline static vec3_batch Load(const vec3f *pValues)
+  {
+    vec3_batch ret;
+    simd_loadInterleaved3(reinterpret_cast<const float_t *>(pValues), &ret.x, &ret.y, &ret.z);
+    return ret;
+  }
+
+  inline void StoreComponents(float_t *pX, float_t *pY, float_t *pZ) const
+  {
+    simd_store(pX, x);
+    simd_store(pY, y);
+    simd_store(pZ, z);
+  }
+
+  inline void Store(vec3f *pValues) const { simd_storeInterleaved3(reinterpret_cast<float_t *>(pValues), x, y, z); }
+
+  inline vec3_batch operator+(const vec3_batch &a) const { return { x + a.x, y + a.y, z + a.z }; }
+  inline vec3_batch operator-(const vec3_batch &a) const { return { x - a.x, y - a.y, z - a.z }; }
+  inline vec3_batch operator*(const vec3_batch &a) const { return { x * a.x, y * a.y, z * a.z }; }
+  inline vec3_batch operator*(const batch_lanes &s) const { return { x * s, y * s, z * s }; }
+  inline vec3_batch operator/(const batch_lanes &s) const { return { x / s, y / s, z / s }; }
+
+  inline batch_lanes Dot(const vec3_batch &a) const { return x * a.x + y * a.y + z * a.z; }
+  inline vec3_batch Cross(const vec3_batch &a) const { return { y * a.z - z * a.y, z * a.x - x * a.z, x * a.y - y * a.x }; }
+  inline batch_lanes Length() const { return simd_sqrt(Dot(*this)); }
+  inline vec3_batch Normalize() const { return *this / Length(); } // like `vec3f::Normalize`, zero vectors end up as NaN.
+
+  inline vec4_batch Transform(const matrix &m) const;
+  inline vec3_batch TransformCoord(const matrix &m) const; // divided by `w`.
+  inline vec3_batch TransformNormal(const matrix &m) const; // without translation.
+
+  // Like `vec::TransformCoordStream3` for tightly packed `vec3f`s. `pOutput` may be `pInput`.
+  static lsResult TransformCoordStream(_Out_ vec3f *pOutput, _In_ const vec3f *pInput, const size_t count, const matrix &matrix);
+};
+
+struct vec4_batch
+{
+  batch_lanes x, y, z, w;
+
+  inline static vec4_batch Set(const vec4f &v) { return { simd_set<vmathBatch_Lanes>(v.x), simd_set<vmathBatch_Lanes>(v.y), simd_set<vmathBatch_Lanes>(v.z), simd_set<vmathBatch_Lanes>(v.w) }; }
+
+  inline void StoreComponents(float_t *pX, float_t *pY, float_t *pZ, float_t *pW) const
+  {
+    simd_store(pX, x);
+    simd_store(pY, y);
+    simd_store(pZ, z);
+    simd_store(pW, w);
+  }
+
+  inline vec4_batch operator+(const vec4_batch &a) const { return { x + a.x, y + a.y, z + a.z, w + a.w }; }
+  inline vec4_batch operator-(const vec4_batch &a) const { return { x - a.x, y - a.y, z - a.z, w - a.w }; }
+  inline vec4_batch operator*(const batch_lanes &s) const { return { x * s, y * s, z * s, w * s }; }
+
+  inline batch_lanes Dot(const vec4_batch &a) const { return x * a.x + y * a.y + z * a.z + w * a.w; }
+  inline vec3_batch DivideByW() const { return vec3_batch { x, y, z } * (simd_set<vmathBatch_Lanes>(1.f) / w); }
+};
+
+inline vec4_batch vec3_batch::Transform(const matrix &m) const
+{
+  return
+  {
+    x * simd_set<vmathBatch_Lanes>(m._11) + y * simd_set<vmathBatch_Lanes>(m._21) + z * simd_set<vmathBatch_Lanes>(m._31) + simd_set<vmathBatch_Lanes>(m._41),
+    x * simd_set<vmathBatch_Lanes>(m._12) + y * simd_set<vmathBatch_Lanes>(m._22) + z * simd_set<vmathBatch_Lanes>(m._32) + simd_set<vmathBatch_Lanes>(m._42),
+    x * simd_set<vmathBatch_Lanes>(m._13) + y * simd_set<vmathBatch_Lanes>(m._23) + z * simd_set<vmathBatch_Lanes>(m._33) + simd_set<vmathBatch_Lanes>(m._43),
+    x * simd_set<vmathBatch_Lanes>(m._14) + y * simd_set<vmathBatch_Lanes>(m._24) + z * simd_set<vmathBatch_Lanes>(m._34) + simd_set<vmathBatch_Lanes>(m._44),
+  };
+}
+
+inline vec3_batch vec3_batch::TransformCoord(const matrix &m) const
+{
+  return Transform(m).DivideByW();
+}
+
+inline vec3_batch vec3_batch::TransformNormal(const matrix &m) const
+{
+  return
+  {
+    x * simd_set<vmathBatch_Lanes>(m._11) + y * simd_set<vmathBatch_Lanes>(m._21) + z * simd_set<vmathBatch_Lanes>(m._31),
+    x * simd_set<vmathBatch_Lanes>(m._12) + y * simd_set<vmathBatch_Lanes>(m._22) + z * simd_set<vmathBatch_Lanes>(m._32),
+    x * simd_set<vmathBatch_Lanes>(m._13) + y * simd_set<vmathBatch_Lanes>(m._23) + z * simd_set<vmathBatch_Lanes>(m._33),
+  };
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// The six planes of the volume a view projection matrix maps into clip space, with `0 <= z <= w` like DirectX. A point `p` is inside
+// where `plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w >= 0` for all of them.
+struct frustum
+{
+  vec4f planes[6]; // left, right, bottom, top, near, far.
+
+  static frustum FromViewProjection(const matrix &viewProjection);
+
+  // Set for boxes that aren't entirely outside of one of the planes. That's conservative: boxes close to the edges of the frustum may
+  // still miss it.
+  simd_mask<float_t, vmathBatch_Lanes> IntersectsBoxes(const vec3_batch &min, const vec3_batch &max) const;
+
+  lsResult IntersectsBoxStream(_Out_ bool *pIntersects, _In_ const vec3f *pMins, _In_ const vec3f *pMaxs, const size_t count) const;
+};